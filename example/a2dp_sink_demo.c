@@ -340,10 +340,18 @@ static void hal_audio_dma_process(btstack_data_source_t * ds, btstack_data_sourc
 	}
 
 	while (playback_buffer != write_buffer && btstack_ring_buffer_bytes_available(&ring_buffer) >= sbc_frame_size ){
-		uint8_t frame[MAX_SBC_FRAME_SIZE];
+	    // decode in place, copy only if frame wraps around end of ring buffer
+	    uint32_t bytes_contiguous = 0;
+	    uint8_t * frame = btstack_ring_buffer_peek_contiguous(&ring_buffer, &bytes_contiguous);
+	    if (bytes_contiguous >= sbc_frame_size){
+	        btstack_sbc_decoder_process_data(&state, 0, frame, sbc_frame_size);
+	        btstack_ring_buffer_consume(&ring_buffer, sbc_frame_size);
+	        continue;
+	    }
+		uint8_t frame_buffer[MAX_SBC_FRAME_SIZE];
 	    uint32_t bytes_read = 0;
-	    btstack_ring_buffer_read(&ring_buffer, frame, sbc_frame_size, &bytes_read);
-	    btstack_sbc_decoder_process_data(&state, 0, frame, sbc_frame_size);
+	    btstack_ring_buffer_read(&ring_buffer, frame_buffer, sbc_frame_size, &bytes_read);
+	    btstack_sbc_decoder_process_data(&state, 0, frame_buffer, sbc_frame_size);
 	}
 
 	if (trigger_resume){
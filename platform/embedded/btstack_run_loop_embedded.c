@@ -58,6 +58,9 @@
 #include "btstack_run_loop.h"
 #include "btstack_run_loop_embedded.h"
 #include "btstack_linked_list.h"
+#ifdef ENABLE_TIMER_WHEEL
+#include "btstack_timer_wheel.h"
+#endif
 #include "hal_tick.h"
 #include "hal_cpu.h"
 
@@ -83,8 +86,12 @@ static const btstack_run_loop_t btstack_run_loop_embedded;
 static btstack_linked_list_t data_sources;
 
 #ifdef TIMER_SUPPORT
+#ifdef ENABLE_TIMER_WHEEL
+static btstack_timer_wheel_t timers;
+#else
 static btstack_linked_list_t timers;
 #endif
+#endif
 
 #ifdef HAVE_EMBEDDED_TICK
 static volatile uint32_t system_ticks;
@@ -119,6 +126,18 @@ static void btstack_run_loop_embedded_set_timer(btstack_timer_source_t *ts, uint
 #endif
 }
 
+#ifdef TIMER_SUPPORT
+static uint32_t btstack_run_loop_embedded_get_now(void){
+#ifdef HAVE_EMBEDDED_TICK
+    return system_ticks;
+#endif
+#ifdef HAVE_EMBEDDED_TIME_MS
+    return hal_time_ms();
+#endif
+}
+#endif
+
+#if defined(TIMER_SUPPORT) && !defined(ENABLE_TIMER_WHEEL)
 // under the assumption that a tick value is +/- 2^30 away from now, calculate the upper bits of the tick value
 static int btstack_run_loop_embedded_reconstruct_higher_bits(uint32_t now, uint32_t ticks){
     int32_t delta = ticks - now;
@@ -136,6 +155,7 @@ static int btstack_run_loop_embedded_reconstruct_higher_bits(uint32_t now, uint3
         }
     }
 }
+#endif
 
 /**
  * Add timer to run_loop (keep list sorted)
@@ -143,13 +163,10 @@ static int btstack_run_loop_embedded_reconstruct_higher_bits(uint32_t now, uint3
 static void btstack_run_loop_embedded_add_timer(btstack_timer_source_t *ts){
 #ifdef TIMER_SUPPORT
 
-#ifdef HAVE_EMBEDDED_TICK
-    uint32_t now = system_ticks;
-#endif
-#ifdef HAVE_EMBEDDED_TIME_MS
-    uint32_t now = hal_time_ms();
-#endif
-
+#ifdef ENABLE_TIMER_WHEEL
+    btstack_timer_wheel_add(&timers, ts);
+#else
+    uint32_t now = btstack_run_loop_embedded_get_now();
     uint32_t new_low = ts->timeout;
     int     new_high = btstack_run_loop_embedded_reconstruct_higher_bits(now, new_low);
 
@@ -169,13 +186,16 @@ static void btstack_run_loop_embedded_add_timer(btstack_timer_source_t *ts){
     ts->item.next = it->next;
     it->next = (btstack_linked_item_t *) ts;
 #endif
+#endif
 }
 
 /**
  * Remove timer from run loop
  */
 static int btstack_run_loop_embedded_remove_timer(btstack_timer_source_t *ts){
-#ifdef TIMER_SUPPORT
+#if defined(TIMER_SUPPORT) && defined(ENABLE_TIMER_WHEEL)
+    return btstack_timer_wheel_remove(&timers, ts);
+#elif defined(TIMER_SUPPORT)
     return btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
 #else
     return 0;
@@ -183,7 +203,9 @@ static int btstack_run_loop_embedded_remove_timer(btstack_timer_source_t *ts){
 }
 
 static void btstack_run_loop_embedded_dump_timer(void){
-#ifdef TIMER_SUPPORT
+#if defined(TIMER_SUPPORT) && defined(ENABLE_TIMER_WHEEL)
+    btstack_timer_wheel_dump(&timers);
+#elif defined(TIMER_SUPPORT)
 #ifdef ENABLE_LOG_INFO 
     btstack_linked_item_t *it;
     int i = 0;
@@ -220,14 +242,12 @@ void btstack_run_loop_embedded_execute_once(void) {
     
 #ifdef TIMER_SUPPORT
 
-#ifdef HAVE_EMBEDDED_TICK
-    uint32_t now = system_ticks;
-#endif
-#ifdef HAVE_EMBEDDED_TIME_MS
-    uint32_t now = hal_time_ms();
-#endif
+    uint32_t now = btstack_run_loop_embedded_get_now();
 
     // process timers
+#ifdef ENABLE_TIMER_WHEEL
+    btstack_timer_wheel_process(&timers, now);
+#else
     while (timers) {
         btstack_timer_source_t *ts = (btstack_timer_source_t *) timers;
         uint32_t timeout_low = ts->timeout;
@@ -236,6 +256,7 @@ void btstack_run_loop_embedded_execute_once(void) {
         btstack_run_loop_embedded_remove_timer(ts);
         ts->process(ts);
     }
+#endif
 #endif
     
     // disable IRQs and check if run loop iteration has been requested. if not, go to sleep
@@ -282,6 +303,9 @@ static uint32_t btstack_run_loop_embedded_get_time_ms(void){
 #endif
 }
 
+static uint32_t btstack_run_loop_embedded_get_time_us(void){
+    return btstack_run_loop_embedded_get_time_ms() * 1000;
+}
 
 /**
  * trigger run loop iteration
@@ -293,15 +317,17 @@ void btstack_run_loop_embedded_trigger(void){
 static void btstack_run_loop_embedded_init(void){
     data_sources = NULL;
 
-#ifdef TIMER_SUPPORT
-    timers = NULL;
-#endif
-
 #ifdef HAVE_EMBEDDED_TICK
     system_ticks = 0;
     hal_tick_init();
     hal_tick_set_handler(&btstack_run_loop_embedded_tick_handler);
 #endif
+
+#if defined(TIMER_SUPPORT) && defined(ENABLE_TIMER_WHEEL)
+    btstack_timer_wheel_init(&timers, btstack_run_loop_embedded_get_now());
+#elif defined(TIMER_SUPPORT)
+    timers = NULL;
+#endif
 }
 
 /**
@@ -323,4 +349,5 @@ static const btstack_run_loop_t btstack_run_loop_embedded = {
     &btstack_run_loop_embedded_execute,
     &btstack_run_loop_embedded_dump_timer,
     &btstack_run_loop_embedded_get_time_ms,
+    &btstack_run_loop_embedded_get_time_us,
 };
@@ -49,6 +49,9 @@
 
 #include "btstack_linked_list.h"
 #include "btstack_debug.h"
+#ifdef ENABLE_TIMER_WHEEL
+#include "btstack_timer_wheel.h"
+#endif
 #include "btstack_run_loop_freertos.h"
 
 // #include "hal_time_ms.h"
@@ -77,18 +80,42 @@ static EventGroupHandle_t   btstack_run_loop_event_group;
 #define EVENT_GROUP_FLAG_RUN_LOOP 1
 
 // the run loop
+#ifdef ENABLE_TIMER_WHEEL
+static btstack_timer_wheel_t timers;
+#else
 static btstack_linked_list_t timers;
+#endif
 static btstack_linked_list_t data_sources;
 
 static uint32_t btstack_run_loop_freertos_get_time_ms(void){
     return hal_time_ms();
 }
 
+static uint32_t btstack_run_loop_freertos_get_time_us(void){
+    return hal_time_ms() * 1000;
+}
+
 // set timer
 static void btstack_run_loop_freertos_set_timer(btstack_timer_source_t *ts, uint32_t timeout_in_ms){
     ts->timeout = btstack_run_loop_freertos_get_time_ms() + timeout_in_ms + 1;
 }
 
+#ifdef ENABLE_TIMER_WHEEL
+
+static void btstack_run_loop_freertos_add_timer(btstack_timer_source_t *ts){
+    btstack_timer_wheel_add(&timers, ts);
+}
+
+static int btstack_run_loop_freertos_remove_timer(btstack_timer_source_t *ts){
+    return btstack_timer_wheel_remove(&timers, ts);
+}
+
+static void btstack_run_loop_freertos_dump_timer(void){
+    btstack_timer_wheel_dump(&timers);
+}
+
+#else
+
 /**
  * Add timer to run_loop (keep list sorted)
  */
@@ -126,6 +153,8 @@ static void btstack_run_loop_freertos_dump_timer(void){
 #endif
 }
 
+#endif
+
 // schedules execution from regular thread
 void btstack_run_loop_freertos_trigger(void){
 #ifdef HAVE_FREERTOS_TASK_NOTIFICATIONS
@@ -135,15 +164,21 @@ void btstack_run_loop_freertos_trigger(void){
 #endif
 }
 
-void btstack_run_loop_freertos_execute_code_on_main_thread(void (*fn)(void *arg), void * arg){
+static int btstack_run_loop_freertos_execute_on_main_thread(void (*fn)(void *arg), void * arg){
     function_call_t message;
     message.fn  = fn;
     message.arg = arg;
     BaseType_t res = xQueueSendToBack(btstack_run_loop_queue, &message, 0); // portMAX_DELAY);
     if (res != pdTRUE){
         log_error("Failed to post fn %p", fn);
+        return -1;
     }
     btstack_run_loop_freertos_trigger();
+    return 0;
+}
+
+void btstack_run_loop_freertos_execute_code_on_main_thread(void (*fn)(void *arg), void * arg){
+    btstack_run_loop_freertos_execute_on_main_thread(fn, arg);
 }
 
 #if defined(HAVE_FREERTOS_TASK_NOTIFICATIONS) || (INCLUDE_xEventGroupSetBitFromISR == 1)
@@ -204,6 +239,14 @@ static void btstack_run_loop_freertos_execute(void) {
         // process timers and get et next timeout
         uint32_t timeout_ms = portMAX_DELAY;
         log_debug("RL: portMAX_DELAY %u", portMAX_DELAY);
+#ifdef ENABLE_TIMER_WHEEL
+        uint32_t now = btstack_run_loop_freertos_get_time_ms();
+        btstack_timer_wheel_process(&timers, now);
+        int32_t delta = btstack_timer_wheel_get_timeout(&timers, now);
+        if (delta >= 0){
+            timeout_ms = delta;
+        }
+#else
         while (timers) {
             btstack_timer_source_t * ts = (btstack_timer_source_t *) timers;
             uint32_t now = btstack_run_loop_freertos_get_time_ms();
@@ -217,6 +260,7 @@ static void btstack_run_loop_freertos_execute(void) {
             log_debug("RL: first timer %p", ts->process);
             ts->process(ts);
         }
+#endif
 
         // wait for timeout or event group/task notification
         log_debug("RL: wait with timeout %u", (int) timeout_ms);
@@ -245,7 +289,11 @@ static void btstack_run_loop_freertos_disable_data_source_callbacks(btstack_data
 }
 
 static void btstack_run_loop_freertos_init(void){
+#ifdef ENABLE_TIMER_WHEEL
+    btstack_timer_wheel_init(&timers, btstack_run_loop_freertos_get_time_ms());
+#else
     timers = NULL;
+#endif
 
     // queue to receive events: up to 2 calls from transport, up to 3 for app
     btstack_run_loop_queue = xQueueCreate(20, sizeof(function_call_t));
@@ -277,4 +325,6 @@ static const btstack_run_loop_t btstack_run_loop_freertos = {
     &btstack_run_loop_freertos_execute,
     &btstack_run_loop_freertos_dump_timer,
     &btstack_run_loop_freertos_get_time_ms,
+    &btstack_run_loop_freertos_get_time_us,
+    &btstack_run_loop_freertos_execute_on_main_thread,
 };
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define __BTSTACK_FILE__ "btstack_ring_buffer_mirror.c"
+
+/*
+ *  btstack_ring_buffer_mirror.c
+ *
+ *  A memfd is mapped twice into a reserved address range of twice the size,
+ *  so data that wraps around the end of the ring buffer is contiguous in memory.
+ */
+
+#include "btstack_ring_buffer_mirror.h"
+#include "btstack_debug.h"
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+uint8_t * btstack_ring_buffer_mirror_alloc(uint32_t size){
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (size == 0 || page_size <= 0 || (size % page_size) != 0){
+        log_error("btstack_ring_buffer_mirror_alloc: size %u not a multiple of page size %ld", size, page_size);
+        return NULL;
+    }
+
+    // anonymous file, use syscall as memfd_create wrapper is missing in older C libraries
+    int fd = (int) syscall(SYS_memfd_create, "btstack_ring_buffer", 0);
+    if (fd < 0){
+        log_error("btstack_ring_buffer_mirror_alloc: memfd_create failed");
+        return NULL;
+    }
+    if (ftruncate(fd, size) < 0){
+        log_error("btstack_ring_buffer_mirror_alloc: ftruncate failed");
+        close(fd);
+        return NULL;
+    }
+
+    // reserve address range, then map file into both halves
+    uint8_t * storage = (uint8_t *) mmap(NULL, 2 * (size_t) size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (storage == MAP_FAILED){
+        log_error("btstack_ring_buffer_mirror_alloc: reserve failed");
+        close(fd);
+        return NULL;
+    }
+    int i;
+    for (i = 0; i < 2; i++){
+        void * mapping = mmap(&storage[i * size], size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        if (mapping == MAP_FAILED){
+            log_error("btstack_ring_buffer_mirror_alloc: map failed");
+            munmap(storage, 2 * (size_t) size);
+            close(fd);
+            return NULL;
+        }
+    }
+
+    // mappings keep the file alive
+    close(fd);
+    return storage;
+}
+
+void btstack_ring_buffer_mirror_free(uint8_t * storage, uint32_t size){
+    if (!storage) return;
+    munmap(storage, 2 * (size_t) size);
+}
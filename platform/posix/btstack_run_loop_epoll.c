@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define __BTSTACK_FILE__ "btstack_run_loop_epoll.c"
+
+/*
+ *  btstack_run_loop_epoll.c
+ *
+ *  Linux run loop based on epoll. In contrast to btstack_run_loop_posix.c, file descriptors
+ *  are registered with the kernel once in add_data_source and only updated when the enabled
+ *  callback types change. epoll_wait only returns the ready data sources, so the cost per
+ *  wakeup does not depend on the number of registered data sources and there is no FD_SETSIZE limit.
+ */
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_epoll.h"
+#include "btstack_linked_list.h"
+#include "btstack_timer_wheel.h"
+#include "btstack_debug.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#ifndef BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS
+#define BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS 16
+#endif
+
+// size of queue for functions to execute on main thread, power of two
+#ifndef BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE
+#define BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE 64
+#endif
+
+#if (BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE & (BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE - 1)) != 0
+#error "BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE must be a power of two"
+#endif
+
+#define MAIN_THREAD_QUEUE_MASK (BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE - 1)
+
+// the run loop
+static btstack_linked_list_t data_sources;
+static int data_sources_modified;
+static btstack_timer_wheel_t timers;
+static int epoll_fd = -1;
+// start time
+static struct timespec init_ts;
+
+// bounded multi-producer single-consumer queue for calls from other threads, same as in btstack_run_loop_posix.c
+// a cell is free for enqueue position pos if sequence == pos and filled if sequence == pos + 1
+typedef struct {
+    uint32_t sequence;
+    void (*fn)(void * context);
+    void * context;
+} main_thread_call_t;
+
+static main_thread_call_t main_thread_queue[BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE];
+static uint32_t main_thread_queue_enqueue_pos;
+static uint32_t main_thread_queue_dequeue_pos;
+static uint32_t main_thread_wakeup_pending;
+static btstack_data_source_t main_thread_wakeup_ds;
+
+static uint32_t btstack_run_loop_epoll_events_for_flags(uint16_t flags){
+    uint32_t events = 0;
+    if (flags & DATA_SOURCE_CALLBACK_READ){
+        events |= EPOLLIN;
+    }
+    if (flags & DATA_SOURCE_CALLBACK_WRITE){
+        events |= EPOLLOUT;
+    }
+    return events;
+}
+
+static int btstack_run_loop_epoll_is_registered(btstack_data_source_t *ds){
+    btstack_linked_item_t *it;
+    for (it = (btstack_linked_item_t *) data_sources; it ; it = it->next){
+        if (it == (btstack_linked_item_t *) ds) return 1;
+    }
+    return 0;
+}
+
+static void btstack_run_loop_epoll_update_fd(btstack_data_source_t *ds, int op){
+    if (ds->fd < 0) return;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events   = btstack_run_loop_epoll_events_for_flags(ds->flags);
+    event.data.ptr = ds;
+    if (epoll_ctl(epoll_fd, op, ds->fd, &event) < 0){
+        // fd might have been closed already, which removes it from the epoll set implicitly
+        if (op == EPOLL_CTL_DEL && (errno == ENOENT || errno == EBADF)) return;
+        log_error("btstack_run_loop_epoll: epoll_ctl(%u) for fd %u failed, errno %u", op, ds->fd, errno);
+    }
+}
+
+/**
+ * Add data_source to run_loop
+ */
+static void btstack_run_loop_epoll_add_data_source(btstack_data_source_t *ds){
+    data_sources_modified = 1;
+    btstack_linked_list_add(&data_sources, (btstack_linked_item_t *) ds);
+    // epoll reports EPOLLERR/EPOLLHUP even for an empty event mask, only register fd if callbacks are enabled
+    if (ds->flags == 0) return;
+    btstack_run_loop_epoll_update_fd(ds, EPOLL_CTL_ADD);
+}
+
+/**
+ * Remove data_source from run loop
+ */
+static int btstack_run_loop_epoll_remove_data_source(btstack_data_source_t *ds){
+    data_sources_modified = 1;
+    int removed = btstack_linked_list_remove(&data_sources, (btstack_linked_item_t *) ds);
+    if ((removed == 0) && (ds->flags != 0)){
+        btstack_run_loop_epoll_update_fd(ds, EPOLL_CTL_DEL);
+    }
+    return removed;
+}
+
+/**
+ * Add timer to run_loop
+ */
+static void btstack_run_loop_epoll_add_timer(btstack_timer_source_t *ts){
+    btstack_timer_wheel_add(&timers, ts);
+}
+
+/**
+ * Remove timer from run loop
+ */
+static int btstack_run_loop_epoll_remove_timer(btstack_timer_source_t *ts){
+    return btstack_timer_wheel_remove(&timers, ts);
+}
+
+static void btstack_run_loop_epoll_dump_timer(void){
+    btstack_timer_wheel_dump(&timers);
+}
+
+static void btstack_run_loop_epoll_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
+    uint16_t old_flags = ds->flags;
+    ds->flags |= callback_types;
+    if (ds->flags == old_flags) return;
+    // not registered yet, fd will be added in add_data_source
+    if (btstack_run_loop_epoll_is_registered(ds) == 0) return;
+    btstack_run_loop_epoll_update_fd(ds, (old_flags == 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+}
+
+static void btstack_run_loop_epoll_disable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
+    uint16_t old_flags = ds->flags;
+    ds->flags &= ~callback_types;
+    if (ds->flags == old_flags) return;
+    if (btstack_run_loop_epoll_is_registered(ds) == 0) return;
+    // remove fd from epoll set if no callbacks are left, as EPOLLERR/EPOLLHUP would be reported anyway
+    btstack_run_loop_epoll_update_fd(ds, (ds->flags == 0) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+}
+
+/**
+ * @brief Queries the current time in ms since start
+ */
+static uint32_t btstack_run_loop_epoll_get_time_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint32_t time_ms = (uint32_t)((ts.tv_sec - init_ts.tv_sec) * 1000) + (ts.tv_nsec / 1000000);
+    return time_ms;
+}
+
+/**
+ * @brief Queries the current time in us since start
+ */
+static uint32_t btstack_run_loop_epoll_get_time_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((ts.tv_sec - init_ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/**
+ * Queue function call from any thread and wake up run loop via eventfd. Lock-free unless the run loop needs to be woken up
+ */
+static int btstack_run_loop_epoll_execute_on_main_thread(void (*fn)(void * context), void * context){
+    main_thread_call_t * cell;
+    uint32_t pos = __atomic_load_n(&main_thread_queue_enqueue_pos, __ATOMIC_RELAXED);
+    while (1){
+        cell = &main_thread_queue[pos & MAIN_THREAD_QUEUE_MASK];
+        uint32_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t) (sequence - pos);
+        if (diff == 0){
+            if (__atomic_compare_exchange_n(&main_thread_queue_enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0){
+            // queue full
+            return -1;
+        } else {
+            pos = __atomic_load_n(&main_thread_queue_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    cell->fn      = fn;
+    cell->context = context;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    // only the first call after the run loop started to process the queue needs to wake it up.
+    // the run loop clears the flag with an exchange as well, so either it sees this call or we see the cleared flag
+    if (__atomic_exchange_n(&main_thread_wakeup_pending, 1, __ATOMIC_SEQ_CST) == 0){
+        uint64_t value = 1;
+        if (write(main_thread_wakeup_ds.fd, &value, sizeof(value)) < 0){
+            log_error("btstack_run_loop_epoll: wakeup failed, errno %u", errno);
+        }
+    }
+    return 0;
+}
+
+static void btstack_run_loop_epoll_process_main_thread_queue(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type){
+    (void) callback_type;
+    uint64_t value;
+    if (read(ds->fd, &value, sizeof(value)) < 0 && errno != EAGAIN){
+        log_error("btstack_run_loop_epoll: reading wakeup fd failed, errno %u", errno);
+    }
+    __atomic_exchange_n(&main_thread_wakeup_pending, 0, __ATOMIC_SEQ_CST);
+
+    while (1){
+        main_thread_call_t * cell = &main_thread_queue[main_thread_queue_dequeue_pos & MAIN_THREAD_QUEUE_MASK];
+        uint32_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        if (sequence != main_thread_queue_dequeue_pos + 1) break;
+        void (*fn)(void * context) = cell->fn;
+        void * context = cell->context;
+        __atomic_store_n(&cell->sequence, main_thread_queue_dequeue_pos + BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE, __ATOMIC_RELEASE);
+        main_thread_queue_dequeue_pos++;
+        (*fn)(context);
+    }
+}
+
+static void btstack_run_loop_epoll_main_thread_queue_init(void){
+    int i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_EPOLL_MAIN_THREAD_QUEUE_SIZE; i++){
+        main_thread_queue[i].sequence = i;
+    }
+    main_thread_queue_enqueue_pos = 0;
+    main_thread_queue_dequeue_pos = 0;
+    main_thread_wakeup_pending = 0;
+
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0){
+        log_error("btstack_run_loop_epoll: cannot create wakeup fd, errno %u", errno);
+        return;
+    }
+    btstack_run_loop_set_data_source_fd(&main_thread_wakeup_ds, fd);
+    btstack_run_loop_set_data_source_handler(&main_thread_wakeup_ds, &btstack_run_loop_epoll_process_main_thread_queue);
+    main_thread_wakeup_ds.flags = DATA_SOURCE_CALLBACK_READ;
+    btstack_run_loop_epoll_add_data_source(&main_thread_wakeup_ds);
+}
+
+/**
+ * Execute run_loop
+ */
+static void btstack_run_loop_epoll_execute(void) {
+    struct epoll_event events[BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS];
+    uint32_t now_ms;
+    int i;
+
+    while (1) {
+
+        // get next timeout
+        now_ms = btstack_run_loop_epoll_get_time_ms();
+        int timeout_ms = btstack_timer_wheel_get_timeout(&timers, now_ms);
+        log_debug("btstack_run_loop_execute next timeout in %d ms", timeout_ms);
+
+        // wait for ready FDs
+        int nr_events = epoll_wait(epoll_fd, events, BTSTACK_RUN_LOOP_EPOLL_MAX_EVENTS, timeout_ms);
+        if (nr_events < 0){
+            if (errno != EINTR){
+                log_error("btstack_run_loop_epoll: epoll_wait failed, errno %u", errno);
+            }
+            nr_events = 0;
+        }
+
+        // process ready data sources. events are level-triggered, so if a data source gets removed
+        // while processing, we stop here and get the remaining events in the next iteration
+        data_sources_modified = 0;
+        for (i = 0; i < nr_events && !data_sources_modified; i++){
+            btstack_data_source_t *ds = (btstack_data_source_t *) events[i].data.ptr;
+            uint32_t ready = events[i].events;
+            // report errors and hangups as readable, the following read() returns the error
+            if (ready & (EPOLLERR | EPOLLHUP)){
+                ready |= EPOLLIN;
+            }
+            if ((ready & EPOLLIN) && (ds->flags & DATA_SOURCE_CALLBACK_READ)){
+                log_debug("btstack_run_loop_epoll_execute: process read ds %p with fd %u\n", ds, ds->fd);
+                ds->process(ds, DATA_SOURCE_CALLBACK_READ);
+            }
+            if (data_sources_modified) break;
+            if ((ready & EPOLLOUT) && (ds->flags & DATA_SOURCE_CALLBACK_WRITE)){
+                log_debug("btstack_run_loop_epoll_execute: process write ds %p with fd %u\n", ds, ds->fd);
+                ds->process(ds, DATA_SOURCE_CALLBACK_WRITE);
+            }
+        }
+
+        // process timers
+        now_ms = btstack_run_loop_epoll_get_time_ms();
+        btstack_timer_wheel_process(&timers, now_ms);
+    }
+}
+
+// set timer
+static void btstack_run_loop_epoll_set_timer(btstack_timer_source_t *a, uint32_t timeout_in_ms){
+    uint32_t time_ms = btstack_run_loop_epoll_get_time_ms();
+    a->timeout = time_ms + timeout_in_ms;
+    log_debug("btstack_run_loop_epoll_set_timer to %u ms (now %u, timeout %u)", a->timeout, time_ms, timeout_in_ms);
+}
+
+static void btstack_run_loop_epoll_init(void){
+    data_sources = NULL;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0){
+        log_error("btstack_run_loop_epoll: epoll_create1 failed, errno %u", errno);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &init_ts);
+    init_ts.tv_nsec = 0;
+    btstack_timer_wheel_init(&timers, btstack_run_loop_epoll_get_time_ms());
+    btstack_run_loop_epoll_main_thread_queue_init();
+    log_debug("btstack_run_loop_epoll_init at %u/%u", (int) init_ts.tv_sec, 0);
+}
+
+static const btstack_run_loop_t btstack_run_loop_epoll = {
+    &btstack_run_loop_epoll_init,
+    &btstack_run_loop_epoll_add_data_source,
+    &btstack_run_loop_epoll_remove_data_source,
+    &btstack_run_loop_epoll_enable_data_source_callbacks,
+    &btstack_run_loop_epoll_disable_data_source_callbacks,
+    &btstack_run_loop_epoll_set_timer,
+    &btstack_run_loop_epoll_add_timer,
+    &btstack_run_loop_epoll_remove_timer,
+    &btstack_run_loop_epoll_execute,
+    &btstack_run_loop_epoll_dump_timer,
+    &btstack_run_loop_epoll_get_time_ms,
+    &btstack_run_loop_epoll_get_time_us,
+    &btstack_run_loop_epoll_execute_on_main_thread,
+};
+
+/**
+ * Provide btstack_run_loop_epoll instance
+ */
+const btstack_run_loop_t * btstack_run_loop_epoll_get_instance(void){
+    return &btstack_run_loop_epoll;
+}
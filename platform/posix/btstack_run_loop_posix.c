@@ -46,6 +46,7 @@
 #include "btstack_run_loop.h"
 #include "btstack_run_loop_posix.h"
 #include "btstack_linked_list.h"
+#include "btstack_timer_wheel.h"
 #include "btstack_debug.h"
 
 #ifdef _WIN32
@@ -54,19 +55,53 @@
 #include <sys/select.h>
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+// size of queue for functions to execute on main thread, power of two
+#ifndef BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE
+#define BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE 64
+#endif
+
+#if (BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE & (BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE - 1)) != 0
+#error "BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE must be a power of two"
+#endif
+
+#define MAIN_THREAD_QUEUE_MASK (BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE - 1)
 
 static void btstack_run_loop_posix_dump_timer(void);
 
 // the run loop
 static btstack_linked_list_t data_sources;
 static int data_sources_modified;
-static btstack_linked_list_t timers;
+static btstack_timer_wheel_t timers;
 // start time. tv_usec = 0
 static struct timeval init_tv;
 
+// bounded multi-producer single-consumer queue for calls from other threads
+// a cell is free for enqueue position pos if sequence == pos and filled if sequence == pos + 1
+typedef struct {
+    uint32_t sequence;
+    void (*fn)(void * context);
+    void * context;
+} main_thread_call_t;
+
+static main_thread_call_t main_thread_queue[BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE];
+static uint32_t main_thread_queue_enqueue_pos;
+static uint32_t main_thread_queue_dequeue_pos;
+static uint32_t main_thread_wakeup_pending;
+static btstack_data_source_t main_thread_wakeup_ds;
+static int main_thread_wakeup_write_fd = -1;
+
 /**
  * Add data_source to run_loop
  */
@@ -86,42 +121,21 @@ static int btstack_run_loop_posix_remove_data_source(btstack_data_source_t *ds){
 }
 
 /**
- * Add timer to run_loop (keep list sorted)
+ * Add timer to run_loop
  */
 static void btstack_run_loop_posix_add_timer(btstack_timer_source_t *ts){
-    btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) &timers; it->next ; it = it->next){
-        btstack_timer_source_t * next = (btstack_timer_source_t *) it->next;
-        if (next == ts){
-            log_error( "btstack_run_loop_timer_add error: timer to add already in list!");
-            return;
-        }
-        if (next->timeout > ts->timeout) {
-            break;
-        }
-    }
-    ts->item.next = it->next;
-    it->next = (btstack_linked_item_t *) ts;
-    log_debug("Added timer %p at %u\n", ts, ts->timeout);
-    // btstack_run_loop_posix_dump_timer();
+    btstack_timer_wheel_add(&timers, ts);
 }
 
 /**
  * Remove timer from run loop
  */
 static int btstack_run_loop_posix_remove_timer(btstack_timer_source_t *ts){
-    // log_info("Removed timer %x at %u\n", (int) ts, (unsigned int) ts->timeout.tv_sec);
-    // btstack_run_loop_posix_dump_timer();
-    return btstack_linked_list_remove(&timers, (btstack_linked_item_t *) ts);
+    return btstack_timer_wheel_remove(&timers, ts);
 }
 
 static void btstack_run_loop_posix_dump_timer(void){
-    btstack_linked_item_t *it;
-    int i = 0;
-    for (it = (btstack_linked_item_t *) timers; it ; it = it->next){
-        btstack_timer_source_t *ts = (btstack_timer_source_t*) it;
-        log_info("timer %u, timeout %u\n", i, ts->timeout);
-    }
+    btstack_timer_wheel_dump(&timers);
 }
 
 static void btstack_run_loop_posix_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
@@ -132,17 +146,126 @@ static void btstack_run_loop_posix_disable_data_source_callbacks(btstack_data_so
     ds->flags &= ~callback_types;
 }
 
+// monotonic time, not affected by changes of the system time
+static void btstack_run_loop_posix_get_time(struct timeval * tv){
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    tv->tv_sec  = ts.tv_sec;
+    tv->tv_usec = ts.tv_nsec / 1000;
+#else
+    gettimeofday(tv, NULL);
+#endif
+}
+
 /**
  * @brief Queries the current time in ms since start
  */
 static uint32_t btstack_run_loop_posix_get_time_ms(void){
     struct timeval tv;
-    gettimeofday(&tv, NULL);
+    btstack_run_loop_posix_get_time(&tv);
     uint32_t time_ms = (uint32_t)((tv.tv_sec  - init_tv.tv_sec) * 1000) + (tv.tv_usec / 1000);
     log_debug("btstack_run_loop_posix_get_time_ms: %u <- %u / %u", time_ms, (int) tv.tv_sec, (int) tv.tv_usec);
     return time_ms;
 }
 
+/**
+ * @brief Queries the current time in us since start
+ */
+static uint32_t btstack_run_loop_posix_get_time_us(void){
+    struct timeval tv;
+    btstack_run_loop_posix_get_time(&tv);
+    return (uint32_t)((tv.tv_sec  - init_tv.tv_sec) * 1000000) + tv.tv_usec;
+}
+
+/**
+ * Queue function call from any thread and wake up run loop. Lock-free unless the run loop needs to be woken up
+ */
+static int btstack_run_loop_posix_execute_on_main_thread(void (*fn)(void * context), void * context){
+    main_thread_call_t * cell;
+    uint32_t pos = __atomic_load_n(&main_thread_queue_enqueue_pos, __ATOMIC_RELAXED);
+    while (1){
+        cell = &main_thread_queue[pos & MAIN_THREAD_QUEUE_MASK];
+        uint32_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t) (sequence - pos);
+        if (diff == 0){
+            if (__atomic_compare_exchange_n(&main_thread_queue_enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0){
+            // queue full
+            return -1;
+        } else {
+            pos = __atomic_load_n(&main_thread_queue_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    cell->fn      = fn;
+    cell->context = context;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    // only the first call after the run loop started to process the queue needs to wake it up.
+    // the run loop clears the flag with an exchange as well, so either it sees this call or we see the cleared flag
+    if (__atomic_exchange_n(&main_thread_wakeup_pending, 1, __ATOMIC_SEQ_CST) == 0){
+#ifdef __linux__
+        uint64_t value = 1;
+#else
+        uint8_t value = 1;
+#endif
+        if (write(main_thread_wakeup_write_fd, &value, sizeof(value)) < 0){
+            log_error("btstack_run_loop_posix: wakeup failed, errno %u", errno);
+        }
+    }
+    return 0;
+}
+
+static void btstack_run_loop_posix_process_main_thread_queue(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type){
+    (void) callback_type;
+    uint8_t buffer[8];
+    while (read(ds->fd, buffer, sizeof(buffer)) > 0);
+    __atomic_exchange_n(&main_thread_wakeup_pending, 0, __ATOMIC_SEQ_CST);
+
+    while (1){
+        main_thread_call_t * cell = &main_thread_queue[main_thread_queue_dequeue_pos & MAIN_THREAD_QUEUE_MASK];
+        uint32_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        if (sequence != main_thread_queue_dequeue_pos + 1) break;
+        void (*fn)(void * context) = cell->fn;
+        void * context = cell->context;
+        __atomic_store_n(&cell->sequence, main_thread_queue_dequeue_pos + BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE, __ATOMIC_RELEASE);
+        main_thread_queue_dequeue_pos++;
+        (*fn)(context);
+    }
+}
+
+static void btstack_run_loop_posix_main_thread_queue_init(void){
+    int i;
+    for (i = 0; i < BTSTACK_RUN_LOOP_POSIX_MAIN_THREAD_QUEUE_SIZE; i++){
+        main_thread_queue[i].sequence = i;
+    }
+    main_thread_queue_enqueue_pos = 0;
+    main_thread_queue_dequeue_pos = 0;
+    main_thread_wakeup_pending = 0;
+
+    int read_fd;
+#ifdef __linux__
+    read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    main_thread_wakeup_write_fd = read_fd;
+#else
+    int fds[2];
+    read_fd = -1;
+    if (pipe(fds) == 0){
+        read_fd = fds[0];
+        main_thread_wakeup_write_fd = fds[1];
+        fcntl(read_fd, F_SETFL, fcntl(read_fd, F_GETFL) | O_NONBLOCK);
+    }
+#endif
+    if (read_fd < 0){
+        log_error("btstack_run_loop_posix: cannot create wakeup fd, errno %u", errno);
+        return;
+    }
+    btstack_run_loop_set_data_source_fd(&main_thread_wakeup_ds, read_fd);
+    btstack_run_loop_set_data_source_handler(&main_thread_wakeup_ds, &btstack_run_loop_posix_process_main_thread_queue);
+    main_thread_wakeup_ds.flags = DATA_SOURCE_CALLBACK_READ;
+    btstack_run_loop_posix_add_data_source(&main_thread_wakeup_ds);
+}
+
 /**
  * Execute run_loop
  */
@@ -150,7 +273,6 @@ static void btstack_run_loop_posix_execute(void) {
     fd_set descriptors_read;
     fd_set descriptors_write;
     
-    btstack_timer_source_t       *ts;
     btstack_linked_list_iterator_t it;
     struct timeval * timeout;
     struct timeval tv;
@@ -183,14 +305,10 @@ static void btstack_run_loop_posix_execute(void) {
         
         // get next timeout
         timeout = NULL;
-        if (timers) {
-            ts = (btstack_timer_source_t *) timers;
+        now_ms = btstack_run_loop_posix_get_time_ms();
+        int32_t delta = btstack_timer_wheel_get_timeout(&timers, now_ms);
+        if (delta >= 0) {
             timeout = &tv;
-            now_ms = btstack_run_loop_posix_get_time_ms();
-            int delta = ts->timeout - now_ms;
-            if (delta < 0){
-                delta = 0;
-            }
             tv.tv_sec  = delta / 1000;
             tv.tv_usec = (int) (delta - (tv.tv_sec * 1000)) * 1000;
             log_debug("btstack_run_loop_execute next timeout in %u ms", delta);
@@ -218,15 +336,7 @@ static void btstack_run_loop_posix_execute(void) {
         
         // process timers
         now_ms = btstack_run_loop_posix_get_time_ms();
-        while (timers) {
-            ts = (btstack_timer_source_t *) timers;
-            if (ts->timeout > now_ms) break;
-            log_debug("btstack_run_loop_posix_execute: process timer %p\n", ts);
-            
-            // remove timer before processing it to allow handler to re-register with run loop
-            btstack_run_loop_posix_remove_timer(ts);
-            ts->process(ts);
-        }
+        btstack_timer_wheel_process(&timers, now_ms);
     }
 }
 
@@ -239,10 +349,11 @@ static void btstack_run_loop_posix_set_timer(btstack_timer_source_t *a, uint32_t
 
 static void btstack_run_loop_posix_init(void){
     data_sources = NULL;
-    timers = NULL;
     // just assume that we started at tv_usec == 0
-    gettimeofday(&init_tv, NULL);
+    btstack_run_loop_posix_get_time(&init_tv);
     init_tv.tv_usec = 0;
+    btstack_timer_wheel_init(&timers, btstack_run_loop_posix_get_time_ms());
+    btstack_run_loop_posix_main_thread_queue_init();
     log_debug("btstack_run_loop_posix_init at %u/%u", (int) init_tv.tv_sec, 0);
 }
 
@@ -259,6 +370,8 @@ static const btstack_run_loop_t btstack_run_loop_posix = {
     &btstack_run_loop_posix_execute,
     &btstack_run_loop_posix_dump_timer,
     &btstack_run_loop_posix_get_time_ms,
+    &btstack_run_loop_posix_get_time_us,
+    &btstack_run_loop_posix_execute_on_main_thread,
 };
 
 /**
@@ -57,6 +57,9 @@
 #include "btstack_memory.h"
 #include "btstack_run_loop.h"
 #include "btstack_run_loop_posix.h"
+#ifdef __linux__
+#include "btstack_run_loop_epoll.h"
+#endif
 #include "hal_led.h"
 #include "hci.h"
 #include "hci_dump.h"
@@ -124,7 +127,11 @@ int main(int argc, const char * argv[]){
 
 	/// GET STARTED with BTstack ///
 	btstack_memory_init();
+#ifdef __linux__
+    btstack_run_loop_init(btstack_run_loop_epoll_get_instance());
+#else
     btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+#endif
 	    
     if (usb_path_len){
         hci_transport_usb_set_path(usb_path_len, usb_path);
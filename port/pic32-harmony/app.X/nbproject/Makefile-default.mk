@@ -45,17 +45,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=../src/system_config/bt_audio_dk/system_init.c ../src/system_config/bt_audio_dk/system_tasks.c ../src/btstack_port.c ../src/app_debug.c ../src/app.c ../src/main.c ../../../example/spp_and_le_counter.c ../../../3rd-party/bluedroid/decoder/srce/alloc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc-sbc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc.c ../../../3rd-party/bluedroid/decoder/srce/bitstream-decode.c ../../../3rd-party/bluedroid/decoder/srce/decoder-oina.c ../../../3rd-party/bluedroid/decoder/srce/decoder-private.c ../../../3rd-party/bluedroid/decoder/srce/decoder-sbc.c ../../../3rd-party/bluedroid/decoder/srce/dequant.c ../../../3rd-party/bluedroid/decoder/srce/framing-sbc.c ../../../3rd-party/bluedroid/decoder/srce/framing.c ../../../3rd-party/bluedroid/decoder/srce/oi_codec_version.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-8-generated.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-dct8.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-sbc.c ../../../3rd-party/bluedroid/encoder/srce/sbc_analysis.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_mono.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_ste.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_encoder.c ../../../3rd-party/bluedroid/encoder/srce/sbc_packing.c ../../../3rd-party/micro-ecc/uECC.c ../../../src/ble/att_db.c ../../../src/ble/att_dispatch.c ../../../src/ble/att_server.c ../../../src/ble/le_device_db_memory.c ../../../src/ble/sm.c ../../../chipset/csr/btstack_chipset_csr.c ../../../platform/embedded/btstack_run_loop_embedded.c ../../../platform/embedded/btstack_uart_block_embedded.c ../../../src/btstack_memory.c ../../../src/hci.c ../../../src/hci_cmd.c ../../../src/hci_dump.c ../../../src/l2cap.c ../../../src/l2cap_signaling.c ../../../src/btstack_linked_list.c ../../../src/btstack_memory_pool.c ../../../src/classic/btstack_link_key_db_memory.c ../../../src/classic/rfcomm.c ../../../src/btstack_run_loop.c ../../../src/classic/sdp_server.c ../../../src/classic/sdp_client.c ../../../src/classic/sdp_client_rfcomm.c ../../../src/classic/sdp_util.c ../../../src/btstack_util.c ../../../src/classic/spp_server.c ../../../src/hci_transport_h4.c ../../../src/hci_transport_h5.c ../../../src/btstack_slip.c ../../../src/ad_parser.c ../../../../driver/tmr/src/dynamic/drv_tmr.c ../../../../system/clk/src/sys_clk.c ../../../../system/clk/src/sys_clk_pic32mx.c ../../../../system/devcon/src/sys_devcon.c ../../../../system/devcon/src/sys_devcon_pic32mx.c ../../../../system/int/src/sys_int_pic32.c ../../../../system/ports/src/sys_ports.c
+SOURCEFILES_QUOTED_IF_SPACED=../src/system_config/bt_audio_dk/system_init.c ../src/system_config/bt_audio_dk/system_tasks.c ../src/btstack_port.c ../src/app_debug.c ../src/app.c ../src/main.c ../../../example/spp_and_le_counter.c ../../../3rd-party/bluedroid/decoder/srce/alloc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc-sbc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc.c ../../../3rd-party/bluedroid/decoder/srce/bitstream-decode.c ../../../3rd-party/bluedroid/decoder/srce/decoder-oina.c ../../../3rd-party/bluedroid/decoder/srce/decoder-private.c ../../../3rd-party/bluedroid/decoder/srce/decoder-sbc.c ../../../3rd-party/bluedroid/decoder/srce/dequant.c ../../../3rd-party/bluedroid/decoder/srce/framing-sbc.c ../../../3rd-party/bluedroid/decoder/srce/framing.c ../../../3rd-party/bluedroid/decoder/srce/oi_codec_version.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-8-generated.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-dct8.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-sbc.c ../../../3rd-party/bluedroid/encoder/srce/sbc_analysis.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_mono.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_ste.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_encoder.c ../../../3rd-party/bluedroid/encoder/srce/sbc_packing.c ../../../3rd-party/micro-ecc/uECC.c ../../../src/ble/att_db.c ../../../src/ble/att_dispatch.c ../../../src/ble/att_server.c ../../../src/ble/le_device_db_memory.c ../../../src/ble/sm.c ../../../chipset/csr/btstack_chipset_csr.c ../../../platform/embedded/btstack_run_loop_embedded.c ../../../platform/embedded/btstack_uart_block_embedded.c ../../../src/btstack_memory.c ../../../src/hci.c ../../../src/hci_cmd.c ../../../src/hci_dump.c ../../../src/l2cap.c ../../../src/l2cap_signaling.c ../../../src/btstack_linked_list.c ../../../src/btstack_memory_pool.c ../../../src/btstack_crc.c ../../../src/btstack_keyed_index.c ../../../src/btstack_timer_wheel.c ../../../src/classic/btstack_link_key_db_memory.c ../../../src/classic/rfcomm.c ../../../src/btstack_run_loop.c ../../../src/classic/sdp_server.c ../../../src/classic/sdp_client.c ../../../src/classic/sdp_client_rfcomm.c ../../../src/classic/sdp_util.c ../../../src/btstack_util.c ../../../src/classic/spp_server.c ../../../src/hci_transport_h4.c ../../../src/hci_transport_h5.c ../../../src/btstack_slip.c ../../../src/ad_parser.c ../../../../driver/tmr/src/dynamic/drv_tmr.c ../../../../system/clk/src/sys_clk.c ../../../../system/clk/src/sys_clk_pic32mx.c ../../../../system/devcon/src/sys_devcon.c ../../../../system/devcon/src/sys_devcon_pic32mx.c ../../../../system/int/src/sys_int_pic32.c ../../../../system/ports/src/sys_ports.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/_ext/101891878/system_init.o ${OBJECTDIR}/_ext/101891878/system_tasks.o ${OBJECTDIR}/_ext/1360937237/btstack_port.o ${OBJECTDIR}/_ext/1360937237/app_debug.o ${OBJECTDIR}/_ext/1360937237/app.o ${OBJECTDIR}/_ext/1360937237/main.o ${OBJECTDIR}/_ext/97075643/spp_and_le_counter.o ${OBJECTDIR}/_ext/770672057/alloc.o ${OBJECTDIR}/_ext/770672057/bitalloc-sbc.o ${OBJECTDIR}/_ext/770672057/bitalloc.o ${OBJECTDIR}/_ext/770672057/bitstream-decode.o ${OBJECTDIR}/_ext/770672057/decoder-oina.o ${OBJECTDIR}/_ext/770672057/decoder-private.o ${OBJECTDIR}/_ext/770672057/decoder-sbc.o ${OBJECTDIR}/_ext/770672057/dequant.o ${OBJECTDIR}/_ext/770672057/framing-sbc.o ${OBJECTDIR}/_ext/770672057/framing.o ${OBJECTDIR}/_ext/770672057/oi_codec_version.o ${OBJECTDIR}/_ext/770672057/synthesis-8-generated.o ${OBJECTDIR}/_ext/770672057/synthesis-dct8.o ${OBJECTDIR}/_ext/770672057/synthesis-sbc.o ${OBJECTDIR}/_ext/1907061729/sbc_analysis.o ${OBJECTDIR}/_ext/1907061729/sbc_dct.o ${OBJECTDIR}/_ext/1907061729/sbc_dct_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_mono.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_ste.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_encoder.o ${OBJECTDIR}/_ext/1907061729/sbc_packing.o ${OBJECTDIR}/_ext/34712644/uECC.o ${OBJECTDIR}/_ext/534563071/att_db.o ${OBJECTDIR}/_ext/534563071/att_dispatch.o ${OBJECTDIR}/_ext/534563071/att_server.o ${OBJECTDIR}/_ext/534563071/le_device_db_memory.o ${OBJECTDIR}/_ext/534563071/sm.o ${OBJECTDIR}/_ext/1768064806/btstack_chipset_csr.o ${OBJECTDIR}/_ext/993942601/btstack_run_loop_embedded.o ${OBJECTDIR}/_ext/993942601/btstack_uart_block_embedded.o ${OBJECTDIR}/_ext/1386528437/btstack_memory.o ${OBJECTDIR}/_ext/1386528437/hci.o ${OBJECTDIR}/_ext/1386528437/hci_cmd.o ${OBJECTDIR}/_ext/1386528437/hci_dump.o ${OBJECTDIR}/_ext/1386528437/l2cap.o ${OBJECTDIR}/_ext/1386528437/l2cap_signaling.o ${OBJECTDIR}/_ext/1386528437/btstack_linked_list.o ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o ${OBJECTDIR}/_ext/1386327864/rfcomm.o ${OBJECTDIR}/_ext/1386528437/btstack_run_loop.o ${OBJECTDIR}/_ext/1386327864/sdp_server.o ${OBJECTDIR}/_ext/1386327864/sdp_client.o ${OBJECTDIR}/_ext/1386327864/sdp_client_rfcomm.o ${OBJECTDIR}/_ext/1386327864/sdp_util.o ${OBJECTDIR}/_ext/1386528437/btstack_util.o ${OBJECTDIR}/_ext/1386327864/spp_server.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h4.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h5.o ${OBJECTDIR}/_ext/1386528437/btstack_slip.o ${OBJECTDIR}/_ext/1386528437/ad_parser.o ${OBJECTDIR}/_ext/1880736137/drv_tmr.o ${OBJECTDIR}/_ext/1112166103/sys_clk.o ${OBJECTDIR}/_ext/1112166103/sys_clk_pic32mx.o ${OBJECTDIR}/_ext/1510368962/sys_devcon.o ${OBJECTDIR}/_ext/1510368962/sys_devcon_pic32mx.o ${OBJECTDIR}/_ext/2087176412/sys_int_pic32.o ${OBJECTDIR}/_ext/2147153351/sys_ports.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/_ext/101891878/system_init.o.d ${OBJECTDIR}/_ext/101891878/system_tasks.o.d ${OBJECTDIR}/_ext/1360937237/btstack_port.o.d ${OBJECTDIR}/_ext/1360937237/app_debug.o.d ${OBJECTDIR}/_ext/1360937237/app.o.d ${OBJECTDIR}/_ext/1360937237/main.o.d ${OBJECTDIR}/_ext/97075643/spp_and_le_counter.o.d ${OBJECTDIR}/_ext/770672057/alloc.o.d ${OBJECTDIR}/_ext/770672057/bitalloc-sbc.o.d ${OBJECTDIR}/_ext/770672057/bitalloc.o.d ${OBJECTDIR}/_ext/770672057/bitstream-decode.o.d ${OBJECTDIR}/_ext/770672057/decoder-oina.o.d ${OBJECTDIR}/_ext/770672057/decoder-private.o.d ${OBJECTDIR}/_ext/770672057/decoder-sbc.o.d ${OBJECTDIR}/_ext/770672057/dequant.o.d ${OBJECTDIR}/_ext/770672057/framing-sbc.o.d ${OBJECTDIR}/_ext/770672057/framing.o.d ${OBJECTDIR}/_ext/770672057/oi_codec_version.o.d ${OBJECTDIR}/_ext/770672057/synthesis-8-generated.o.d ${OBJECTDIR}/_ext/770672057/synthesis-dct8.o.d ${OBJECTDIR}/_ext/770672057/synthesis-sbc.o.d ${OBJECTDIR}/_ext/1907061729/sbc_analysis.o.d ${OBJECTDIR}/_ext/1907061729/sbc_dct.o.d ${OBJECTDIR}/_ext/1907061729/sbc_dct_coeffs.o.d ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_mono.o.d ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_ste.o.d ${OBJECTDIR}/_ext/1907061729/sbc_enc_coeffs.o.d ${OBJECTDIR}/_ext/1907061729/sbc_encoder.o.d ${OBJECTDIR}/_ext/1907061729/sbc_packing.o.d ${OBJECTDIR}/_ext/34712644/uECC.o.d ${OBJECTDIR}/_ext/534563071/att_db.o.d ${OBJECTDIR}/_ext/534563071/att_dispatch.o.d ${OBJECTDIR}/_ext/534563071/att_server.o.d ${OBJECTDIR}/_ext/534563071/le_device_db_memory.o.d ${OBJECTDIR}/_ext/534563071/sm.o.d ${OBJECTDIR}/_ext/1768064806/btstack_chipset_csr.o.d ${OBJECTDIR}/_ext/993942601/btstack_run_loop_embedded.o.d ${OBJECTDIR}/_ext/993942601/btstack_uart_block_embedded.o.d ${OBJECTDIR}/_ext/1386528437/btstack_memory.o.d ${OBJECTDIR}/_ext/1386528437/hci.o.d ${OBJECTDIR}/_ext/1386528437/hci_cmd.o.d ${OBJECTDIR}/_ext/1386528437/hci_dump.o.d ${OBJECTDIR}/_ext/1386528437/l2cap.o.d ${OBJECTDIR}/_ext/1386528437/l2cap_signaling.o.d ${OBJECTDIR}/_ext/1386528437/btstack_linked_list.o.d ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o.d ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o.d ${OBJECTDIR}/_ext/1386327864/rfcomm.o.d ${OBJECTDIR}/_ext/1386528437/btstack_run_loop.o.d ${OBJECTDIR}/_ext/1386327864/sdp_server.o.d ${OBJECTDIR}/_ext/1386327864/sdp_client.o.d ${OBJECTDIR}/_ext/1386327864/sdp_client_rfcomm.o.d ${OBJECTDIR}/_ext/1386327864/sdp_util.o.d ${OBJECTDIR}/_ext/1386528437/btstack_util.o.d ${OBJECTDIR}/_ext/1386327864/spp_server.o.d ${OBJECTDIR}/_ext/1386528437/hci_transport_h4.o.d ${OBJECTDIR}/_ext/1386528437/hci_transport_h5.o.d ${OBJECTDIR}/_ext/1386528437/btstack_slip.o.d ${OBJECTDIR}/_ext/1386528437/ad_parser.o.d ${OBJECTDIR}/_ext/1880736137/drv_tmr.o.d ${OBJECTDIR}/_ext/1112166103/sys_clk.o.d ${OBJECTDIR}/_ext/1112166103/sys_clk_pic32mx.o.d ${OBJECTDIR}/_ext/1510368962/sys_devcon.o.d ${OBJECTDIR}/_ext/1510368962/sys_devcon_pic32mx.o.d ${OBJECTDIR}/_ext/2087176412/sys_int_pic32.o.d ${OBJECTDIR}/_ext/2147153351/sys_ports.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/_ext/101891878/system_init.o ${OBJECTDIR}/_ext/101891878/system_tasks.o ${OBJECTDIR}/_ext/1360937237/btstack_port.o ${OBJECTDIR}/_ext/1360937237/app_debug.o ${OBJECTDIR}/_ext/1360937237/app.o ${OBJECTDIR}/_ext/1360937237/main.o ${OBJECTDIR}/_ext/97075643/spp_and_le_counter.o ${OBJECTDIR}/_ext/770672057/alloc.o ${OBJECTDIR}/_ext/770672057/bitalloc-sbc.o ${OBJECTDIR}/_ext/770672057/bitalloc.o ${OBJECTDIR}/_ext/770672057/bitstream-decode.o ${OBJECTDIR}/_ext/770672057/decoder-oina.o ${OBJECTDIR}/_ext/770672057/decoder-private.o ${OBJECTDIR}/_ext/770672057/decoder-sbc.o ${OBJECTDIR}/_ext/770672057/dequant.o ${OBJECTDIR}/_ext/770672057/framing-sbc.o ${OBJECTDIR}/_ext/770672057/framing.o ${OBJECTDIR}/_ext/770672057/oi_codec_version.o ${OBJECTDIR}/_ext/770672057/synthesis-8-generated.o ${OBJECTDIR}/_ext/770672057/synthesis-dct8.o ${OBJECTDIR}/_ext/770672057/synthesis-sbc.o ${OBJECTDIR}/_ext/1907061729/sbc_analysis.o ${OBJECTDIR}/_ext/1907061729/sbc_dct.o ${OBJECTDIR}/_ext/1907061729/sbc_dct_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_mono.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_ste.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_encoder.o ${OBJECTDIR}/_ext/1907061729/sbc_packing.o ${OBJECTDIR}/_ext/34712644/uECC.o ${OBJECTDIR}/_ext/534563071/att_db.o ${OBJECTDIR}/_ext/534563071/att_dispatch.o ${OBJECTDIR}/_ext/534563071/att_server.o ${OBJECTDIR}/_ext/534563071/le_device_db_memory.o ${OBJECTDIR}/_ext/534563071/sm.o ${OBJECTDIR}/_ext/1768064806/btstack_chipset_csr.o ${OBJECTDIR}/_ext/993942601/btstack_run_loop_embedded.o ${OBJECTDIR}/_ext/993942601/btstack_uart_block_embedded.o ${OBJECTDIR}/_ext/1386528437/btstack_memory.o ${OBJECTDIR}/_ext/1386528437/hci.o ${OBJECTDIR}/_ext/1386528437/hci_cmd.o ${OBJECTDIR}/_ext/1386528437/hci_dump.o ${OBJECTDIR}/_ext/1386528437/l2cap.o ${OBJECTDIR}/_ext/1386528437/l2cap_signaling.o ${OBJECTDIR}/_ext/1386528437/btstack_linked_list.o ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o ${OBJECTDIR}/_ext/1386528437/btstack_crc.o ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o ${OBJECTDIR}/_ext/1386327864/rfcomm.o ${OBJECTDIR}/_ext/1386528437/btstack_run_loop.o ${OBJECTDIR}/_ext/1386327864/sdp_server.o ${OBJECTDIR}/_ext/1386327864/sdp_client.o ${OBJECTDIR}/_ext/1386327864/sdp_client_rfcomm.o ${OBJECTDIR}/_ext/1386327864/sdp_util.o ${OBJECTDIR}/_ext/1386528437/btstack_util.o ${OBJECTDIR}/_ext/1386327864/spp_server.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h4.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h5.o ${OBJECTDIR}/_ext/1386528437/btstack_slip.o ${OBJECTDIR}/_ext/1386528437/ad_parser.o ${OBJECTDIR}/_ext/1880736137/drv_tmr.o ${OBJECTDIR}/_ext/1112166103/sys_clk.o ${OBJECTDIR}/_ext/1112166103/sys_clk_pic32mx.o ${OBJECTDIR}/_ext/1510368962/sys_devcon.o ${OBJECTDIR}/_ext/1510368962/sys_devcon_pic32mx.o ${OBJECTDIR}/_ext/2087176412/sys_int_pic32.o ${OBJECTDIR}/_ext/2147153351/sys_ports.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/_ext/101891878/system_init.o.d ${OBJECTDIR}/_ext/101891878/system_tasks.o.d ${OBJECTDIR}/_ext/1360937237/btstack_port.o.d ${OBJECTDIR}/_ext/1360937237/app_debug.o.d ${OBJECTDIR}/_ext/1360937237/app.o.d ${OBJECTDIR}/_ext/1360937237/main.o.d ${OBJECTDIR}/_ext/97075643/spp_and_le_counter.o.d ${OBJECTDIR}/_ext/770672057/alloc.o.d ${OBJECTDIR}/_ext/770672057/bitalloc-sbc.o.d ${OBJECTDIR}/_ext/770672057/bitalloc.o.d ${OBJECTDIR}/_ext/770672057/bitstream-decode.o.d ${OBJECTDIR}/_ext/770672057/decoder-oina.o.d ${OBJECTDIR}/_ext/770672057/decoder-private.o.d ${OBJECTDIR}/_ext/770672057/decoder-sbc.o.d ${OBJECTDIR}/_ext/770672057/dequant.o.d ${OBJECTDIR}/_ext/770672057/framing-sbc.o.d ${OBJECTDIR}/_ext/770672057/framing.o.d ${OBJECTDIR}/_ext/770672057/oi_codec_version.o.d ${OBJECTDIR}/_ext/770672057/synthesis-8-generated.o.d ${OBJECTDIR}/_ext/770672057/synthesis-dct8.o.d ${OBJECTDIR}/_ext/770672057/synthesis-sbc.o.d ${OBJECTDIR}/_ext/1907061729/sbc_analysis.o.d ${OBJECTDIR}/_ext/1907061729/sbc_dct.o.d ${OBJECTDIR}/_ext/1907061729/sbc_dct_coeffs.o.d ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_mono.o.d ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_ste.o.d ${OBJECTDIR}/_ext/1907061729/sbc_enc_coeffs.o.d ${OBJECTDIR}/_ext/1907061729/sbc_encoder.o.d ${OBJECTDIR}/_ext/1907061729/sbc_packing.o.d ${OBJECTDIR}/_ext/34712644/uECC.o.d ${OBJECTDIR}/_ext/534563071/att_db.o.d ${OBJECTDIR}/_ext/534563071/att_dispatch.o.d ${OBJECTDIR}/_ext/534563071/att_server.o.d ${OBJECTDIR}/_ext/534563071/le_device_db_memory.o.d ${OBJECTDIR}/_ext/534563071/sm.o.d ${OBJECTDIR}/_ext/1768064806/btstack_chipset_csr.o.d ${OBJECTDIR}/_ext/993942601/btstack_run_loop_embedded.o.d ${OBJECTDIR}/_ext/993942601/btstack_uart_block_embedded.o.d ${OBJECTDIR}/_ext/1386528437/btstack_memory.o.d ${OBJECTDIR}/_ext/1386528437/hci.o.d ${OBJECTDIR}/_ext/1386528437/hci_cmd.o.d ${OBJECTDIR}/_ext/1386528437/hci_dump.o.d ${OBJECTDIR}/_ext/1386528437/l2cap.o.d ${OBJECTDIR}/_ext/1386528437/l2cap_signaling.o.d ${OBJECTDIR}/_ext/1386528437/btstack_linked_list.o.d ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o.d ${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o.d ${OBJECTDIR}/_ext/1386327864/rfcomm.o.d ${OBJECTDIR}/_ext/1386528437/btstack_run_loop.o.d ${OBJECTDIR}/_ext/1386327864/sdp_server.o.d ${OBJECTDIR}/_ext/1386327864/sdp_client.o.d ${OBJECTDIR}/_ext/1386327864/sdp_client_rfcomm.o.d ${OBJECTDIR}/_ext/1386327864/sdp_util.o.d ${OBJECTDIR}/_ext/1386528437/btstack_util.o.d ${OBJECTDIR}/_ext/1386327864/spp_server.o.d ${OBJECTDIR}/_ext/1386528437/hci_transport_h4.o.d ${OBJECTDIR}/_ext/1386528437/hci_transport_h5.o.d ${OBJECTDIR}/_ext/1386528437/btstack_slip.o.d ${OBJECTDIR}/_ext/1386528437/ad_parser.o.d ${OBJECTDIR}/_ext/1880736137/drv_tmr.o.d ${OBJECTDIR}/_ext/1112166103/sys_clk.o.d ${OBJECTDIR}/_ext/1112166103/sys_clk_pic32mx.o.d ${OBJECTDIR}/_ext/1510368962/sys_devcon.o.d ${OBJECTDIR}/_ext/1510368962/sys_devcon_pic32mx.o.d ${OBJECTDIR}/_ext/2087176412/sys_int_pic32.o.d ${OBJECTDIR}/_ext/2147153351/sys_ports.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/_ext/101891878/system_init.o ${OBJECTDIR}/_ext/101891878/system_tasks.o ${OBJECTDIR}/_ext/1360937237/btstack_port.o ${OBJECTDIR}/_ext/1360937237/app_debug.o ${OBJECTDIR}/_ext/1360937237/app.o ${OBJECTDIR}/_ext/1360937237/main.o ${OBJECTDIR}/_ext/97075643/spp_and_le_counter.o ${OBJECTDIR}/_ext/770672057/alloc.o ${OBJECTDIR}/_ext/770672057/bitalloc-sbc.o ${OBJECTDIR}/_ext/770672057/bitalloc.o ${OBJECTDIR}/_ext/770672057/bitstream-decode.o ${OBJECTDIR}/_ext/770672057/decoder-oina.o ${OBJECTDIR}/_ext/770672057/decoder-private.o ${OBJECTDIR}/_ext/770672057/decoder-sbc.o ${OBJECTDIR}/_ext/770672057/dequant.o ${OBJECTDIR}/_ext/770672057/framing-sbc.o ${OBJECTDIR}/_ext/770672057/framing.o ${OBJECTDIR}/_ext/770672057/oi_codec_version.o ${OBJECTDIR}/_ext/770672057/synthesis-8-generated.o ${OBJECTDIR}/_ext/770672057/synthesis-dct8.o ${OBJECTDIR}/_ext/770672057/synthesis-sbc.o ${OBJECTDIR}/_ext/1907061729/sbc_analysis.o ${OBJECTDIR}/_ext/1907061729/sbc_dct.o ${OBJECTDIR}/_ext/1907061729/sbc_dct_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_mono.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_ste.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_encoder.o ${OBJECTDIR}/_ext/1907061729/sbc_packing.o ${OBJECTDIR}/_ext/34712644/uECC.o ${OBJECTDIR}/_ext/534563071/att_db.o ${OBJECTDIR}/_ext/534563071/att_dispatch.o ${OBJECTDIR}/_ext/534563071/att_server.o ${OBJECTDIR}/_ext/534563071/le_device_db_memory.o ${OBJECTDIR}/_ext/534563071/sm.o ${OBJECTDIR}/_ext/1768064806/btstack_chipset_csr.o ${OBJECTDIR}/_ext/993942601/btstack_run_loop_embedded.o ${OBJECTDIR}/_ext/993942601/btstack_uart_block_embedded.o ${OBJECTDIR}/_ext/1386528437/btstack_memory.o ${OBJECTDIR}/_ext/1386528437/hci.o ${OBJECTDIR}/_ext/1386528437/hci_cmd.o ${OBJECTDIR}/_ext/1386528437/hci_dump.o ${OBJECTDIR}/_ext/1386528437/l2cap.o ${OBJECTDIR}/_ext/1386528437/l2cap_signaling.o ${OBJECTDIR}/_ext/1386528437/btstack_linked_list.o ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o ${OBJECTDIR}/_ext/1386327864/rfcomm.o ${OBJECTDIR}/_ext/1386528437/btstack_run_loop.o ${OBJECTDIR}/_ext/1386327864/sdp_server.o ${OBJECTDIR}/_ext/1386327864/sdp_client.o ${OBJECTDIR}/_ext/1386327864/sdp_client_rfcomm.o ${OBJECTDIR}/_ext/1386327864/sdp_util.o ${OBJECTDIR}/_ext/1386528437/btstack_util.o ${OBJECTDIR}/_ext/1386327864/spp_server.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h4.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h5.o ${OBJECTDIR}/_ext/1386528437/btstack_slip.o ${OBJECTDIR}/_ext/1386528437/ad_parser.o ${OBJECTDIR}/_ext/1880736137/drv_tmr.o ${OBJECTDIR}/_ext/1112166103/sys_clk.o ${OBJECTDIR}/_ext/1112166103/sys_clk_pic32mx.o ${OBJECTDIR}/_ext/1510368962/sys_devcon.o ${OBJECTDIR}/_ext/1510368962/sys_devcon_pic32mx.o ${OBJECTDIR}/_ext/2087176412/sys_int_pic32.o ${OBJECTDIR}/_ext/2147153351/sys_ports.o
+OBJECTFILES=${OBJECTDIR}/_ext/101891878/system_init.o ${OBJECTDIR}/_ext/101891878/system_tasks.o ${OBJECTDIR}/_ext/1360937237/btstack_port.o ${OBJECTDIR}/_ext/1360937237/app_debug.o ${OBJECTDIR}/_ext/1360937237/app.o ${OBJECTDIR}/_ext/1360937237/main.o ${OBJECTDIR}/_ext/97075643/spp_and_le_counter.o ${OBJECTDIR}/_ext/770672057/alloc.o ${OBJECTDIR}/_ext/770672057/bitalloc-sbc.o ${OBJECTDIR}/_ext/770672057/bitalloc.o ${OBJECTDIR}/_ext/770672057/bitstream-decode.o ${OBJECTDIR}/_ext/770672057/decoder-oina.o ${OBJECTDIR}/_ext/770672057/decoder-private.o ${OBJECTDIR}/_ext/770672057/decoder-sbc.o ${OBJECTDIR}/_ext/770672057/dequant.o ${OBJECTDIR}/_ext/770672057/framing-sbc.o ${OBJECTDIR}/_ext/770672057/framing.o ${OBJECTDIR}/_ext/770672057/oi_codec_version.o ${OBJECTDIR}/_ext/770672057/synthesis-8-generated.o ${OBJECTDIR}/_ext/770672057/synthesis-dct8.o ${OBJECTDIR}/_ext/770672057/synthesis-sbc.o ${OBJECTDIR}/_ext/1907061729/sbc_analysis.o ${OBJECTDIR}/_ext/1907061729/sbc_dct.o ${OBJECTDIR}/_ext/1907061729/sbc_dct_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_mono.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_bit_alloc_ste.o ${OBJECTDIR}/_ext/1907061729/sbc_enc_coeffs.o ${OBJECTDIR}/_ext/1907061729/sbc_encoder.o ${OBJECTDIR}/_ext/1907061729/sbc_packing.o ${OBJECTDIR}/_ext/34712644/uECC.o ${OBJECTDIR}/_ext/534563071/att_db.o ${OBJECTDIR}/_ext/534563071/att_dispatch.o ${OBJECTDIR}/_ext/534563071/att_server.o ${OBJECTDIR}/_ext/534563071/le_device_db_memory.o ${OBJECTDIR}/_ext/534563071/sm.o ${OBJECTDIR}/_ext/1768064806/btstack_chipset_csr.o ${OBJECTDIR}/_ext/993942601/btstack_run_loop_embedded.o ${OBJECTDIR}/_ext/993942601/btstack_uart_block_embedded.o ${OBJECTDIR}/_ext/1386528437/btstack_memory.o ${OBJECTDIR}/_ext/1386528437/hci.o ${OBJECTDIR}/_ext/1386528437/hci_cmd.o ${OBJECTDIR}/_ext/1386528437/hci_dump.o ${OBJECTDIR}/_ext/1386528437/l2cap.o ${OBJECTDIR}/_ext/1386528437/l2cap_signaling.o ${OBJECTDIR}/_ext/1386528437/btstack_linked_list.o ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o ${OBJECTDIR}/_ext/1386528437/btstack_crc.o ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o ${OBJECTDIR}/_ext/1386327864/rfcomm.o ${OBJECTDIR}/_ext/1386528437/btstack_run_loop.o ${OBJECTDIR}/_ext/1386327864/sdp_server.o ${OBJECTDIR}/_ext/1386327864/sdp_client.o ${OBJECTDIR}/_ext/1386327864/sdp_client_rfcomm.o ${OBJECTDIR}/_ext/1386327864/sdp_util.o ${OBJECTDIR}/_ext/1386528437/btstack_util.o ${OBJECTDIR}/_ext/1386327864/spp_server.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h4.o ${OBJECTDIR}/_ext/1386528437/hci_transport_h5.o ${OBJECTDIR}/_ext/1386528437/btstack_slip.o ${OBJECTDIR}/_ext/1386528437/ad_parser.o ${OBJECTDIR}/_ext/1880736137/drv_tmr.o ${OBJECTDIR}/_ext/1112166103/sys_clk.o ${OBJECTDIR}/_ext/1112166103/sys_clk_pic32mx.o ${OBJECTDIR}/_ext/1510368962/sys_devcon.o ${OBJECTDIR}/_ext/1510368962/sys_devcon_pic32mx.o ${OBJECTDIR}/_ext/2087176412/sys_int_pic32.o ${OBJECTDIR}/_ext/2147153351/sys_ports.o
 
 # Source Files
-SOURCEFILES=../src/system_config/bt_audio_dk/system_init.c ../src/system_config/bt_audio_dk/system_tasks.c ../src/btstack_port.c ../src/app_debug.c ../src/app.c ../src/main.c ../../../example/spp_and_le_counter.c ../../../3rd-party/bluedroid/decoder/srce/alloc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc-sbc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc.c ../../../3rd-party/bluedroid/decoder/srce/bitstream-decode.c ../../../3rd-party/bluedroid/decoder/srce/decoder-oina.c ../../../3rd-party/bluedroid/decoder/srce/decoder-private.c ../../../3rd-party/bluedroid/decoder/srce/decoder-sbc.c ../../../3rd-party/bluedroid/decoder/srce/dequant.c ../../../3rd-party/bluedroid/decoder/srce/framing-sbc.c ../../../3rd-party/bluedroid/decoder/srce/framing.c ../../../3rd-party/bluedroid/decoder/srce/oi_codec_version.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-8-generated.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-dct8.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-sbc.c ../../../3rd-party/bluedroid/encoder/srce/sbc_analysis.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_mono.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_ste.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_encoder.c ../../../3rd-party/bluedroid/encoder/srce/sbc_packing.c ../../../3rd-party/micro-ecc/uECC.c ../../../src/ble/att_db.c ../../../src/ble/att_dispatch.c ../../../src/ble/att_server.c ../../../src/ble/le_device_db_memory.c ../../../src/ble/sm.c ../../../chipset/csr/btstack_chipset_csr.c ../../../platform/embedded/btstack_run_loop_embedded.c ../../../platform/embedded/btstack_uart_block_embedded.c ../../../src/btstack_memory.c ../../../src/hci.c ../../../src/hci_cmd.c ../../../src/hci_dump.c ../../../src/l2cap.c ../../../src/l2cap_signaling.c ../../../src/btstack_linked_list.c ../../../src/btstack_memory_pool.c ../../../src/classic/btstack_link_key_db_memory.c ../../../src/classic/rfcomm.c ../../../src/btstack_run_loop.c ../../../src/classic/sdp_server.c ../../../src/classic/sdp_client.c ../../../src/classic/sdp_client_rfcomm.c ../../../src/classic/sdp_util.c ../../../src/btstack_util.c ../../../src/classic/spp_server.c ../../../src/hci_transport_h4.c ../../../src/hci_transport_h5.c ../../../src/btstack_slip.c ../../../src/ad_parser.c ../../../../driver/tmr/src/dynamic/drv_tmr.c ../../../../system/clk/src/sys_clk.c ../../../../system/clk/src/sys_clk_pic32mx.c ../../../../system/devcon/src/sys_devcon.c ../../../../system/devcon/src/sys_devcon_pic32mx.c ../../../../system/int/src/sys_int_pic32.c ../../../../system/ports/src/sys_ports.c
+SOURCEFILES=../src/system_config/bt_audio_dk/system_init.c ../src/system_config/bt_audio_dk/system_tasks.c ../src/btstack_port.c ../src/app_debug.c ../src/app.c ../src/main.c ../../../example/spp_and_le_counter.c ../../../3rd-party/bluedroid/decoder/srce/alloc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc-sbc.c ../../../3rd-party/bluedroid/decoder/srce/bitalloc.c ../../../3rd-party/bluedroid/decoder/srce/bitstream-decode.c ../../../3rd-party/bluedroid/decoder/srce/decoder-oina.c ../../../3rd-party/bluedroid/decoder/srce/decoder-private.c ../../../3rd-party/bluedroid/decoder/srce/decoder-sbc.c ../../../3rd-party/bluedroid/decoder/srce/dequant.c ../../../3rd-party/bluedroid/decoder/srce/framing-sbc.c ../../../3rd-party/bluedroid/decoder/srce/framing.c ../../../3rd-party/bluedroid/decoder/srce/oi_codec_version.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-8-generated.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-dct8.c ../../../3rd-party/bluedroid/decoder/srce/synthesis-sbc.c ../../../3rd-party/bluedroid/encoder/srce/sbc_analysis.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct.c ../../../3rd-party/bluedroid/encoder/srce/sbc_dct_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_mono.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_bit_alloc_ste.c ../../../3rd-party/bluedroid/encoder/srce/sbc_enc_coeffs.c ../../../3rd-party/bluedroid/encoder/srce/sbc_encoder.c ../../../3rd-party/bluedroid/encoder/srce/sbc_packing.c ../../../3rd-party/micro-ecc/uECC.c ../../../src/ble/att_db.c ../../../src/ble/att_dispatch.c ../../../src/ble/att_server.c ../../../src/ble/le_device_db_memory.c ../../../src/ble/sm.c ../../../chipset/csr/btstack_chipset_csr.c ../../../platform/embedded/btstack_run_loop_embedded.c ../../../platform/embedded/btstack_uart_block_embedded.c ../../../src/btstack_memory.c ../../../src/hci.c ../../../src/hci_cmd.c ../../../src/hci_dump.c ../../../src/l2cap.c ../../../src/l2cap_signaling.c ../../../src/btstack_linked_list.c ../../../src/btstack_memory_pool.c ../../../src/btstack_crc.c ../../../src/btstack_keyed_index.c ../../../src/btstack_timer_wheel.c ../../../src/classic/btstack_link_key_db_memory.c ../../../src/classic/rfcomm.c ../../../src/btstack_run_loop.c ../../../src/classic/sdp_server.c ../../../src/classic/sdp_client.c ../../../src/classic/sdp_client_rfcomm.c ../../../src/classic/sdp_util.c ../../../src/btstack_util.c ../../../src/classic/spp_server.c ../../../src/hci_transport_h4.c ../../../src/hci_transport_h5.c ../../../src/btstack_slip.c ../../../src/ad_parser.c ../../../../driver/tmr/src/dynamic/drv_tmr.c ../../../../system/clk/src/sys_clk.c ../../../../system/clk/src/sys_clk_pic32mx.c ../../../../system/devcon/src/sys_devcon.c ../../../../system/devcon/src/sys_devcon_pic32mx.c ../../../../system/int/src/sys_int_pic32.c ../../../../system/ports/src/sys_ports.c
 
 
 CFLAGS=
@@ -370,6 +370,24 @@ ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o: ../../../src/btstack_memory_
 	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o 
 	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o ../../../src/btstack_memory_pool.c     
 	
+${OBJECTDIR}/_ext/1386528437/btstack_crc.o: ../../../src/btstack_crc.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1386528437" 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_crc.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_crc.o ../../../src/btstack_crc.c     
+	
+${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o: ../../../src/btstack_keyed_index.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1386528437" 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o ../../../src/btstack_keyed_index.c     
+	
+${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o: ../../../src/btstack_timer_wheel.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1386528437" 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1 -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o ../../../src/btstack_timer_wheel.c     
+	
 ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o: ../../../src/classic/btstack_link_key_db_memory.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} "${OBJECTDIR}/_ext/1386327864" 
 	@${RM} ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o.d 
@@ -767,6 +785,24 @@ ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o: ../../../src/btstack_memory_
 	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o 
 	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_memory_pool.o ../../../src/btstack_memory_pool.c     
 	
+${OBJECTDIR}/_ext/1386528437/btstack_crc.o: ../../../src/btstack_crc.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1386528437" 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_crc.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_crc.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_crc.o ../../../src/btstack_crc.c     
+	
+${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o: ../../../src/btstack_keyed_index.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1386528437" 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_keyed_index.o ../../../src/btstack_keyed_index.c     
+	
+${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o: ../../../src/btstack_timer_wheel.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} "${OBJECTDIR}/_ext/1386528437" 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d 
+	@${RM} ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o 
+	@${FIXDEPS} "${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d" $(SILENT) -rsi ${MP_CC_DIR}../  -c ${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -Os -I"." -I"../../../.." -I"../src" -I"../src/system_config/bt_audio_dk" -I"../../../src" -I"../../../chipset/csr" -I"../../../platform/embedded" -I"../../../3rd-party/micro-ecc" -I"../../../3rd-party/bluedroid/decoder/include" -I"../../../3rd-party/bluedroid/encoder/include" -MMD -MF "${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o.d" -o ${OBJECTDIR}/_ext/1386528437/btstack_timer_wheel.o ../../../src/btstack_timer_wheel.c     
+	
 ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o: ../../../src/classic/btstack_link_key_db_memory.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} "${OBJECTDIR}/_ext/1386327864" 
 	@${RM} ${OBJECTDIR}/_ext/1386327864/btstack_link_key_db_memory.o.d 
@@ -150,11 +150,14 @@ CSRCS += \
 	${BTSTACK_ROOT_CONFIG}/src/ble/gatt_client.c \
 	${BTSTACK_ROOT_CONFIG}/src/ble/le_device_db_memory.c \
 	${BTSTACK_ROOT_CONFIG}/src/ble/sm.c \
+	${BTSTACK_ROOT_CONFIG}/src/btstack_keyed_index.c \
+	${BTSTACK_ROOT_CONFIG}/src/btstack_crc.c \
 	${BTSTACK_ROOT_CONFIG}/src/btstack_linked_list.c \
 	${BTSTACK_ROOT_CONFIG}/src/btstack_memory.c \
 	${BTSTACK_ROOT_CONFIG}/src/btstack_memory_pool.c \
 	${BTSTACK_ROOT_CONFIG}/src/btstack_ring_buffer.c \
 	${BTSTACK_ROOT_CONFIG}/src/btstack_run_loop.c \
+	${BTSTACK_ROOT_CONFIG}/src/btstack_timer_wheel.c \
 	${BTSTACK_ROOT_CONFIG}/src/btstack_util.c \
 	${BTSTACK_ROOT_CONFIG}/src/classic/a2dp_sink.c  		\
 	${BTSTACK_ROOT_CONFIG}/src/classic/a2dp_source.c 		\
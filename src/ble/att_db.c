@@ -77,6 +77,8 @@ static btstack_linked_list_t service_handlers;
 typedef struct att_iterator {
     // private
     uint8_t const * att_ptr;
+    uint16_t index_uuid16;  // if set, only attributes with this UUID16 are visited using the ATT DB index
+    uint16_t index_pos;     // next position in UUID16 order
     // public
     uint16_t size;
     uint16_t flags;
@@ -86,14 +88,69 @@ typedef struct att_iterator {
     uint8_t  const * value;
 } att_iterator_t;
 
+// ATT DB Index
+static att_db_index_entry_t * att_db_index_storage;
+static uint16_t att_db_index_storage_size;
+static att_db_index_entry_t const * att_db_index_table;
+static uint16_t att_db_index_table_size;
+static att_db_index_entry_t const * att_db_index_entries;  // storage or table
+static uint16_t att_db_index_count;       // 0 if index is not used
+static uint16_t att_db_index_end_offset;  // offset of end marker
+
 static void att_iterator_init(att_iterator_t *it){
     it->att_ptr = att_db;
+    it->index_uuid16 = 0;
 }
 
 static int att_iterator_has_next(att_iterator_t *it){
     return it->att_ptr != NULL;
 }
 
+// returns position of first attribute with handle >= given handle
+static uint16_t att_db_index_lower_bound_handle(uint16_t handle){
+    uint16_t low  = 0;
+    uint16_t high = att_db_index_count;
+    while (low < high){
+        uint16_t mid = (low + high) >> 1;
+        if (att_db_index_entries[mid].handle < handle){
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// returns position in UUID16 order of first attribute with given UUID16 and handle >= given handle
+static uint16_t att_db_index_lower_bound_uuid16(uint16_t uuid16, uint16_t handle){
+    uint32_t key  = ((uint32_t) uuid16 << 16) | handle;
+    uint16_t low  = 0;
+    uint16_t high = att_db_index_count;
+    while (low < high){
+        uint16_t mid = (low + high) >> 1;
+        const att_db_index_entry_t * entry = &att_db_index_entries[att_db_index_entries[mid].uuid16_order];
+        if ((((uint32_t) entry->uuid16 << 16) | entry->handle) < key){
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// point iterator to next attribute with UUID16 or stop
+static void att_iterator_index_advance(att_iterator_t *it){
+    if (it->index_pos < att_db_index_count){
+        const att_db_index_entry_t * entry = &att_db_index_entries[att_db_index_entries[it->index_pos].uuid16_order];
+        if (entry->uuid16 == it->index_uuid16){
+            it->att_ptr = &att_db[entry->offset];
+            it->index_pos++;
+            return;
+        }
+    }
+    it->att_ptr = NULL;
+}
+
 static void att_iterator_fetch_next(att_iterator_t *it){
     it->size   = little_endian_read_16(it->att_ptr, 0);
     if (it->size == 0){
@@ -118,6 +175,9 @@ static void att_iterator_fetch_next(att_iterator_t *it){
     }
     // advance AFTER setting values
     it->att_ptr += it->size;
+    if (it->index_uuid16){
+        att_iterator_index_advance(it);
+    }
 }
 
 static int att_iterator_match_uuid16(att_iterator_t *it, uint16_t uuid){
@@ -145,8 +205,43 @@ static int att_iterator_match_uuid(att_iterator_t *it, uint8_t *uuid, uint16_t u
 }
 
 
+// start iteration at first attribute with handle >= start_handle
+static void att_iterator_init_from_handle(att_iterator_t *it, uint16_t start_handle){
+    att_iterator_init(it);
+    if (att_db_index_count == 0) return;
+    uint16_t pos = att_db_index_lower_bound_handle(start_handle);
+    if (pos < att_db_index_count){
+        it->att_ptr = &att_db[att_db_index_entries[pos].offset];
+    } else {
+        it->att_ptr = &att_db[att_db_index_end_offset];
+    }
+}
+
+// only visit attributes with given UUID16 and handle >= start_handle. Visits all attributes from start_handle without index
+static void att_iterator_init_uuid16(att_iterator_t *it, uint16_t start_handle, uint16_t uuid16){
+    att_iterator_init_from_handle(it, start_handle);
+    if (att_db_index_count == 0) return;
+    if (uuid16 == 0) return;
+    it->index_uuid16 = uuid16;
+    it->index_pos = att_db_index_lower_bound_uuid16(uuid16, start_handle);
+    att_iterator_index_advance(it);
+}
+
+static void att_iterator_init_index_entry(att_iterator_t *it, const att_db_index_entry_t * entry){
+    att_iterator_init(it);
+    it->att_ptr = &att_db[entry->offset];
+}
+
 static int att_find_handle(att_iterator_t *it, uint16_t handle){
     if (handle == 0) return 0;
+    if (att_db_index_count){
+        uint16_t pos = att_db_index_lower_bound_handle(handle);
+        if (pos == att_db_index_count) return 0;
+        if (att_db_index_entries[pos].handle != handle) return 0;
+        att_iterator_init_index_entry(it, &att_db_index_entries[pos]);
+        att_iterator_fetch_next(it);
+        return 1;
+    }
     att_iterator_init(it);
     while (att_iterator_has_next(it)){
         att_iterator_fetch_next(it);
@@ -217,8 +312,135 @@ static int att_copy_value(att_iterator_t *it, uint16_t offset, uint8_t * buffer,
     return bytes_to_copy;
 }
 
+static void att_db_index_build(void){
+    uint16_t count = 0;
+    uint16_t service_pos = 0;
+    int in_service = 0;
+    att_iterator_t it;
+    att_iterator_init(&it);
+    while (att_iterator_has_next(&it)){
+        uint32_t offset = it.att_ptr - att_db;
+        if (offset > 0xffff){
+            log_error("att_db_index: ATT DB larger than 64 kB");
+            return;
+        }
+        att_iterator_fetch_next(&it);
+        if (it.handle == 0) {
+            att_db_index_end_offset = offset;
+            break;
+        }
+        if (count == att_db_index_storage_size){
+            log_info("att_db_index: more than %u attributes, index not used", att_db_index_storage_size);
+            return;
+        }
+        if (count && it.handle <= att_db_index_storage[count-1].handle){
+            log_error("att_db_index: handle 0x%04x not in ascending order, index not used", it.handle);
+            return;
+        }
+        att_db_index_entry_t * entry = &att_db_index_storage[count];
+        entry->handle = it.handle;
+        entry->offset = offset;
+        if (it.flags & ATT_PROPERTY_UUID128){
+            entry->uuid16 = uuid16_from_uuid(16, (uint8_t *) it.uuid);
+        } else {
+            entry->uuid16 = little_endian_read_16(it.uuid, 0);
+        }
+        entry->group_end = 0;
+        // service groups end before next service declaration or at end of ATT DB
+        if (entry->uuid16 == GATT_PRIMARY_SERVICE_UUID || entry->uuid16 == GATT_SECONDARY_SERVICE_UUID){
+            if (in_service){
+                att_db_index_storage[service_pos].group_end = count - 1;
+            }
+            service_pos = count;
+            in_service = 1;
+        }
+        count++;
+    }
+    if (in_service){
+        att_db_index_storage[service_pos].group_end = count - 1;
+    }
+
+    // sort by UUID16, stable insertion sort keeps attributes with same UUID16 in handle order
+    uint16_t i;
+    for (i = 0; i < count; i++){
+        uint16_t uuid16 = att_db_index_storage[i].uuid16;
+        uint16_t pos = i;
+        while (pos > 0 && att_db_index_storage[att_db_index_storage[pos-1].uuid16_order].uuid16 > uuid16){
+            att_db_index_storage[pos].uuid16_order = att_db_index_storage[pos-1].uuid16_order;
+            pos--;
+        }
+        att_db_index_storage[pos].uuid16_order = i;
+    }
+
+    att_db_index_entries = att_db_index_storage;
+    att_db_index_count   = count;
+    log_info("att_db_index: %u attributes", count);
+}
+
+// precomputed index has to match ATT DB
+static void att_db_index_use_table(void){
+    uint16_t offset = 0;
+    uint16_t pos;
+    for (pos = 0; pos < att_db_index_table_size; pos++){
+        const att_db_index_entry_t * entry = &att_db_index_table[pos];
+        uint16_t size = little_endian_read_16(att_db, offset);
+        if (size == 0 || entry->offset != offset || little_endian_read_16(att_db, offset + 4) != entry->handle
+        || (pos && entry->handle <= att_db_index_table[pos-1].handle)
+        || entry->group_end >= att_db_index_table_size || entry->uuid16_order >= att_db_index_table_size){
+            log_error("att_db_index: table does not match ATT DB at handle 0x%04x, index not used", entry->handle);
+            return;
+        }
+        offset += size;
+    }
+    if (little_endian_read_16(att_db, offset) != 0){
+        log_error("att_db_index: table does not match ATT DB, index not used");
+        return;
+    }
+    att_db_index_entries    = att_db_index_table;
+    att_db_index_count      = att_db_index_table_size;
+    att_db_index_end_offset = offset;
+    log_info("att_db_index: %u attributes from table", att_db_index_count);
+}
+
+static void att_db_index_update(void){
+    att_db_index_count = 0;
+    if (att_db == NULL) return;
+    if (att_db_index_table){
+        att_db_index_use_table();
+    } else if (att_db_index_storage){
+        att_db_index_build();
+    }
+}
+
 void att_set_db(uint8_t const * db){
     att_db = db;
+    att_db_index_update();
+}
+
+void att_set_db_index(att_db_index_entry_t * entries, uint16_t num_entries){
+    att_db_index_storage      = entries;
+    att_db_index_storage_size = num_entries;
+    att_db_index_table        = NULL;
+    att_db_index_update();
+}
+
+void att_set_db_index_table(att_db_index_entry_t const * table, uint16_t num_entries){
+    att_db_index_table      = table;
+    att_db_index_table_size = num_entries;
+    att_db_index_update();
+}
+
+uint16_t att_db_get_num_attributes(void){
+    if (att_db_index_count) return att_db_index_count;
+    uint16_t count = 0;
+    att_iterator_t it;
+    att_iterator_init(&it);
+    while (att_iterator_has_next(&it)){
+        att_iterator_fetch_next(&it);
+        if (it.handle == 0) break;
+        count++;
+    }
+    return count;
 }
 
 void att_set_read_callback(att_read_callback_t callback){
@@ -363,7 +585,7 @@ static uint16_t handle_find_information_request2(att_connection_t * att_connecti
     uint16_t uuid_len = 0;
     
     att_iterator_t it;
-    att_iterator_init(&it);
+    att_iterator_init_from_handle(&it, start_handle);
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
         if (!it.handle) break;
@@ -445,7 +667,7 @@ static uint16_t handle_find_by_type_value_request2(att_connection_t * att_connec
     uint16_t prev_handle = 0;
     
     att_iterator_t it;
-    att_iterator_init(&it);
+    att_iterator_init_from_handle(&it, start_handle);
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
         
@@ -513,9 +735,12 @@ static uint16_t handle_read_by_type_request2(att_connection_t * att_connection,
     uint16_t pair_len = 0;
 
     att_iterator_t it;
-    att_iterator_init(&it);
+    att_iterator_init_uuid16(&it, start_handle, uuid16_from_uuid(attribute_type_len, attribute_type));
     uint8_t error_code = 0;
     uint16_t first_matching_but_unreadable_handle = 0;
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    int read_request_pending = 0;
+#endif
 
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
@@ -540,6 +765,14 @@ static uint16_t handle_read_by_type_request2(att_connection_t * att_connection,
         if (error_code) break;
 
         att_update_value_len(&it, att_connection->con_handle);
+
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+        // request all pending values, response is created when all are available
+        if (it.value_len == ATT_READ_RESPONSE_PENDING){
+            read_request_pending = 1;
+        }
+        if (read_request_pending) continue;
+#endif
         
         // check if value has same len as last one
         uint16_t this_pair_len = 2 + it.value_len;
@@ -569,6 +802,10 @@ static uint16_t handle_read_by_type_request2(att_connection_t * att_connection,
         uint16_t bytes_copied = att_copy_value(&it, 0, response_buffer + offset, it.value_len, att_connection->con_handle);
         offset += bytes_copied;
     }
+
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    if (read_request_pending) return ATT_READ_RESPONSE_PENDING;
+#endif
     
     // at least one attribute could be read
     if (offset > 1){
@@ -628,6 +865,10 @@ static uint16_t handle_read_request2(att_connection_t * att_connection, uint8_t
 
     att_update_value_len(&it, att_connection->con_handle);
 
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    if (it.value_len == ATT_READ_RESPONSE_PENDING) return ATT_READ_RESPONSE_PENDING;
+#endif
+
     uint16_t offset   = 1;
     // limit data
     if (offset + it.value_len > response_buffer_size) {
@@ -674,6 +915,10 @@ static uint16_t handle_read_blob_request2(att_connection_t * att_connection, uin
 
     att_update_value_len(&it, att_connection->con_handle);
 
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    if (it.value_len == ATT_READ_RESPONSE_PENDING) return ATT_READ_RESPONSE_PENDING;
+#endif
+
     if (value_offset > it.value_len){
         return setup_error_invalid_offset(response_buffer, request_type, handle);
     }
@@ -715,6 +960,9 @@ static uint16_t handle_read_multiple_request2(att_connection_t * att_connection,
     int i;
     uint8_t error_code = 0;
     uint16_t handle = 0;
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    int read_request_pending = 0;
+#endif
     for (i=0;i<num_handles;i++){
         handle = little_endian_read_16(handles, i << 1);
         
@@ -740,6 +988,14 @@ static uint16_t handle_read_multiple_request2(att_connection_t * att_connection,
         if (error_code) break;
 
         att_update_value_len(&it, att_connection->con_handle);
+
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+        // request all pending values, response is created when all are available
+        if (it.value_len == ATT_READ_RESPONSE_PENDING){
+            read_request_pending = 1;
+        }
+        if (read_request_pending) continue;
+#endif
         
         // limit data
         if (offset + it.value_len > response_buffer_size) {
@@ -754,6 +1010,10 @@ static uint16_t handle_read_multiple_request2(att_connection_t * att_connection,
     if (error_code){
         return setup_error(response_buffer, request_type, handle, error_code);
     }
+
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    if (read_request_pending) return ATT_READ_RESPONSE_PENDING;
+#endif
     
     response_buffer[0] = ATT_READ_MULTIPLE_RESPONSE;
     return offset;
@@ -764,6 +1024,57 @@ static uint16_t handle_read_multiple_request(att_connection_t * att_connection,
     return handle_read_multiple_request2(att_connection, response_buffer, response_buffer_size, num_handles, &request_buffer[1]);
 }
 
+// returns offset in response buffer after adding all service groups that start within handle range.
+// As with the linear search below, a group is only reported if it ends within the handle range and
+// if it is followed by another attribute within the handle range or by the end of the ATT DB
+static uint16_t att_db_index_read_by_group_type(uint8_t * response_buffer, uint16_t response_buffer_size,
+                                                uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
+    uint16_t offset   = 1;
+    uint16_t pair_len = 0;
+    uint16_t pos;
+    for (pos = att_db_index_lower_bound_uuid16(uuid16, start_handle); pos < att_db_index_count; pos++){
+        const att_db_index_entry_t * service = &att_db_index_entries[att_db_index_entries[pos].uuid16_order];
+        if (service->uuid16 != uuid16) break;
+        if (service->handle > end_handle) break;
+
+        att_iterator_t it;
+        att_iterator_init_index_entry(&it, service);
+        att_iterator_fetch_next(&it);
+
+        // check if value has same len as last one
+        uint16_t this_pair_len = 4 + it.value_len;
+        if (offset > 1){
+            if (this_pair_len != pair_len) {
+                break;
+            }
+        }
+
+        // first
+        if (offset == 1) {
+            pair_len = this_pair_len;
+            response_buffer[offset] = this_pair_len;
+            offset++;
+        }
+
+        uint16_t group_end = service->group_end;
+        if (att_db_index_entries[group_end].handle > end_handle) break;
+        if ((group_end + 1 < att_db_index_count) && (att_db_index_entries[group_end + 1].handle > end_handle)) break;
+
+        little_endian_store_16(response_buffer, offset, service->handle);
+        offset += 2;
+        little_endian_store_16(response_buffer, offset, att_db_index_entries[group_end].handle);
+        offset += 2;
+        memcpy(response_buffer + offset, it.value, it.value_len);
+        offset += it.value_len;
+
+        // check if space for another handle pair available
+        if (offset + pair_len > response_buffer_size){
+            break;
+        }
+    }
+    return offset;
+}
+
 //
 // MARK: ATT_READ_BY_GROUP_TYPE_REQUEST 0x10
 //
@@ -800,6 +1111,16 @@ static uint16_t handle_read_by_group_type_request2(att_connection_t * att_connec
         return setup_error(response_buffer, request_type, start_handle, ATT_ERROR_UNSUPPORTED_GROUP_TYPE);
     }
 
+    // use service group ranges from ATT DB index
+    if (att_db_index_count){
+        uint16_t offset = att_db_index_read_by_group_type(response_buffer, response_buffer_size, start_handle, end_handle, uuid16);
+        if (offset == 1){
+            return setup_error_atribute_not_found(response_buffer, request_type, start_handle);
+        }
+        response_buffer[0] = ATT_READ_BY_GROUP_TYPE_RESPONSE;
+        return offset;
+    }
+
     uint16_t offset   = 1;
     uint16_t pair_len = 0;
     uint16_t in_group = 0;
@@ -808,7 +1129,7 @@ static uint16_t handle_read_by_group_type_request2(att_connection_t * att_connec
     uint16_t prev_handle = 0;
 
     att_iterator_t it;
-    att_iterator_init(&it);
+    att_iterator_init_from_handle(&it, start_handle);
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
         
@@ -914,7 +1235,11 @@ static uint16_t handle_write_request(att_connection_t * att_connection, uint8_t
     if (error_code) {
         return setup_error(response_buffer, request_type, handle, error_code);
     }
-    error_code = (*callback)(att_connection->con_handle, handle, ATT_TRANSACTION_MODE_NONE, 0, request_buffer + 3, request_len - 3);
+    int result = (*callback)(att_connection->con_handle, handle, ATT_TRANSACTION_MODE_NONE, 0, request_buffer + 3, request_len - 3);
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    if (result == ATT_ERROR_WRITE_RESPONSE_PENDING) return ATT_INTERNAL_WRITE_RESPONSE_PENDING;
+#endif
+    error_code = result;
     if (error_code) {
         return setup_error(response_buffer, request_type, handle, error_code);
     }
@@ -954,7 +1279,11 @@ static uint16_t handle_prepare_write_request(att_connection_t * att_connection,
         return setup_error(response_buffer, request_type, handle, error_code);
     }
 
-    error_code = (*callback)(att_connection->con_handle, handle, ATT_TRANSACTION_MODE_ACTIVE, offset, request_buffer + 5, request_len - 5);
+    int result = (*callback)(att_connection->con_handle, handle, ATT_TRANSACTION_MODE_ACTIVE, offset, request_buffer + 5, request_len - 5);
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    if (result == ATT_ERROR_WRITE_RESPONSE_PENDING) return ATT_INTERNAL_WRITE_RESPONSE_PENDING;
+#endif
+    error_code = result;
     switch (error_code){
         case 0:
             break;
@@ -1158,6 +1487,26 @@ int gatt_server_get_get_handle_range_for_service_with_uuid16(uint16_t uuid16, ui
     little_endian_store_16(attribute_value, 0, uuid16);
 
     att_iterator_t it;
+
+    // check service declarations only
+    if (att_db_index_count){
+        uint16_t pos;
+        for (pos = 0; pos < att_db_index_count; pos++){
+            const att_db_index_entry_t * entry = &att_db_index_entries[pos];
+            if (entry->uuid16 != GATT_PRIMARY_SERVICE_UUID && entry->uuid16 != GATT_SECONDARY_SERVICE_UUID) continue;
+            att_iterator_init_index_entry(&it, entry);
+            att_iterator_fetch_next(&it);
+            if (attribute_len == it.value_len && memcmp(attribute_value, it.value, it.value_len) == 0){
+                *start_handle = entry->handle;
+                *end_handle   = att_db_index_entries[entry->group_end].handle;
+                return 1;
+            }
+            // skip to next service
+            pos = entry->group_end;
+        }
+        return 0;
+    }
+
     att_iterator_init(&it);
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
@@ -1185,7 +1534,7 @@ int gatt_server_get_get_handle_range_for_service_with_uuid16(uint16_t uuid16, ui
 // returns 0 if not found
 uint16_t gatt_server_get_value_handle_for_characteristic_with_uuid16(uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
     att_iterator_t it;
-    att_iterator_init(&it);
+    att_iterator_init_uuid16(&it, start_handle, uuid16);
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
         if (it.handle && it.handle < start_handle) continue;
@@ -1199,7 +1548,7 @@ uint16_t gatt_server_get_value_handle_for_characteristic_with_uuid16(uint16_t st
 // returns 0 if not found
 uint16_t gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
     att_iterator_t it;
-    att_iterator_init(&it);
+    att_iterator_init_from_handle(&it, start_handle);
     int characteristic_found = 0;
     while (att_iterator_has_next(&it)){
         att_iterator_fetch_next(&it);
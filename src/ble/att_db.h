@@ -53,6 +53,14 @@ extern "C" {
 // custom BTstack ATT error codes
 #define ATT_ERROR_DATA_MISMATCH                    0x7e
 #define ATT_ERROR_TIMEOUT                          0x7F
+
+// delayed response with ENABLE_ATT_DELAYED_RESPONSE, see att_server_response_ready
+// - returned by read callback if value is not available yet
+#define ATT_READ_RESPONSE_PENDING                  0xffff
+// - returned by write callback if write has not completed yet
+#define ATT_ERROR_WRITE_RESPONSE_PENDING           0x100
+// - returned by att_handle_request if write callback returned ATT_ERROR_WRITE_RESPONSE_PENDING
+#define ATT_INTERNAL_WRITE_RESPONSE_PENDING        0xfffe
     
 typedef struct att_connection {
     hci_con_handle_t con_handle;
@@ -66,6 +74,7 @@ typedef struct att_connection {
 // ATT Client Read Callback for Dynamic Data
 // - if buffer == NULL, don't copy data, just return size of value
 // - if buffer != NULL, copy data and return number bytes copied
+// - with ENABLE_ATT_DELAYED_RESPONSE, return ATT_READ_RESPONSE_PENDING if buffer == NULL and value is not available yet
 // @param con_handle of hci le connection
 // @param attribute_handle to be read
 // @param offset defines start of attribute value
@@ -82,6 +91,8 @@ typedef uint16_t (*att_read_callback_t)(hci_con_handle_t con_handle, uint16_t at
 // @param buffer_size
 // @param signature used for signed write commmands
 // @returns 0 if write was ok, ATT_ERROR_PREPARE_QUEUE_FULL if no space in queue, ATT_ERROR_INVALID_OFFSET if offset is larger than max buffer
+//          with ENABLE_ATT_DELAYED_RESPONSE, ATT_ERROR_WRITE_RESPONSE_PENDING if write has not completed yet.
+//          ATT_TRANSACTION_MODE_EXECUTE cannot be delayed: its result is ignored and the Execute Write Response is sent right away
 typedef int (*att_write_callback_t)(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size);
 
 
@@ -94,6 +105,15 @@ typedef struct att_service_handler {
   att_write_callback_t write_callback;
 } att_service_handler_t;
 
+// Index entry for ATT DB, see att_set_db_index
+typedef struct {
+  uint16_t handle;
+  uint16_t offset;        // offset of attribute in ATT DB
+  uint16_t uuid16;        // 16-bit UUID, 0 for 128-bit UUIDs not based on the Bluetooth Base UUID
+  uint16_t group_end;     // service declaration: position of last attribute of service
+  uint16_t uuid16_order;  // position of the attribute that is at this position when sorted by UUID16 and handle
+} att_db_index_entry_t;
+
 // MARK: ATT Operations
 
 /*
@@ -101,6 +121,29 @@ typedef struct att_service_handler {
  */
 void att_set_db(uint8_t const * db);
 
+/*
+ * @brief provide storage for an index of the ATT DB, which is then used to find attributes
+ *        by handle, by 16-bit UUID and to find the end of services without walking the ATT DB
+ * @note the index is not used if the ATT DB has more than num_entries attributes or if it is not sorted by handle
+ * @param entries or NULL to disable index
+ * @param num_entries, see att_db_get_num_attributes
+ */
+void att_set_db_index(att_db_index_entry_t * entries, uint16_t num_entries);
+
+/*
+ * @brief use precomputed index of the ATT DB instead of building it in RAM, e.g. profile_data_index
+ *        created by compile_gatt.py. The table is checked against the ATT DB when either is set.
+ * @param table or NULL to stop using it
+ * @param num_entries in table
+ */
+void att_set_db_index_table(att_db_index_entry_t const * table, uint16_t num_entries);
+
+/*
+ * @brief get number of attributes in ATT DB
+ * @returns number of attributes
+ */
+uint16_t att_db_get_num_attributes(void);
+
 /*
  * @brief set callback for read of dynamic attributes
  * @param callback
@@ -123,7 +166,8 @@ void att_dump_attributes(void);
  * @param att_connection used for mtu and security properties
  * @param request_buffer, request_len: ATT request from clinet
  * @param response_buffer for result
- * @returns len of data in response buffer. 0 = no response
+ * @returns len of data in response buffer. 0 = no response,
+ *          ATT_READ_RESPONSE_PENDING or ATT_INTERNAL_WRITE_RESPONSE_PENDING if a callback delayed the response
  */
 uint16_t att_handle_request(att_connection_t * att_connection,
                             uint8_t * request_buffer,
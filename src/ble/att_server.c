@@ -127,6 +127,59 @@ static void att_emit_can_send_now_event(void){
     (*att_client_packet_handler)(HCI_EVENT_PACKET, 0, &event[0], sizeof(event));
 }
 
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+static void att_server_notification_queue_reset(att_server_t * att_server){
+    att_server->notification_queue_len = 0;
+    att_server->notification_queue_count = 0;
+}
+
+// send queued notifications as long as possible, returns 1 if notifications are left
+static int att_server_send_queued_notifications(att_server_t * att_server){
+    hci_con_handle_t con_handle = att_server->connection.con_handle;
+    uint8_t * queue = att_server->notification_queue;
+    while (att_server->notification_queue_len){
+        if (!att_dispatch_server_can_send_now(con_handle)) return 1;
+
+        l2cap_reserve_packet_buffer();
+        uint8_t * packet_buffer = l2cap_get_outgoing_buffer();
+
+        // collect notifications that fit into a single Multiple Handle Value Notification
+        uint16_t queue_pos = 0;
+        uint16_t num_notifications = 0;
+        uint16_t size = 1;
+        if (att_server->multiple_notifications_enabled){
+            while (queue_pos < att_server->notification_queue_len){
+                uint16_t entry_size = 4 + little_endian_read_16(queue, queue_pos + 2);
+                if (size + entry_size > att_server->connection.mtu) break;
+                size += entry_size;
+                queue_pos += entry_size;
+                num_notifications++;
+            }
+        }
+
+        if (num_notifications > 1){
+            packet_buffer[0] = ATT_MULTIPLE_HANDLE_VALUE_NOTIFICATION;
+            memcpy(&packet_buffer[1], queue, queue_pos);
+        } else {
+            uint16_t value_len = little_endian_read_16(queue, 2);
+            queue_pos = 4 + value_len;
+            num_notifications = 1;
+            size = att_prepare_handle_value_notification(&att_server->connection, little_endian_read_16(queue, 0), &queue[4], value_len, packet_buffer);
+        }
+
+        // remove from queue
+        att_server->notification_queue_len   -= queue_pos;
+        att_server->notification_queue_count -= num_notifications;
+        memmove(queue, &queue[queue_pos], att_server->notification_queue_len);
+
+        att_server->notifications_sent += num_notifications;
+        att_server->notification_packets_sent++;
+        l2cap_send_prepared_connectionless(con_handle, L2CAP_CID_ATTRIBUTE_PROTOCOL, size);
+    }
+    return 0;
+}
+#endif
+
 static void att_handle_value_indication_timeout(btstack_timer_source_t *ts){
     void * context = btstack_run_loop_get_timer_context(ts);
     hci_con_handle_t con_handle = (hci_con_handle_t) (uintptr_t) context;
@@ -170,6 +223,14 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                             att_server->connection.authenticated = 0;
 		                	att_server->connection.authorized = 0;
                             att_server->ir_le_device_db_index = -1;
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+                            att_server_notification_queue_reset(att_server);
+                            att_server->notification_queue_count_max = 0;
+                            att_server->multiple_notifications_enabled = 0;
+                            att_server->notifications_sent = 0;
+                            att_server->notification_packets_sent = 0;
+                            att_server->notifications_dropped = 0;
+#endif
                             break;
 
                         default:
@@ -196,6 +257,9 @@ static void att_event_packet_handler (uint8_t packet_type, uint16_t channel, uin
                     att_server->connection.con_handle = 0;
                     att_server->value_indication_handle = 0; // reset error state
                     att_server->state = ATT_SERVER_IDLE;
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+                    att_server_notification_queue_reset(att_server);
+#endif
                     break;
                     
                 case SM_EVENT_IDENTITY_RESOLVING_STARTED:
@@ -263,6 +327,73 @@ static void att_signed_write_handle_cmac_result(uint8_t hash[8]){
 }
 #endif
 
+// intercept "insufficient authorization" for authenticated connections to allow for user authorization
+// returns: 1 if request has to be processed again after authorization
+static int att_server_authorization_required(att_server_t * att_server, const uint8_t * att_response_buffer, uint16_t att_response_size){
+    if (att_response_size < 4) return 0;
+    if (att_response_buffer[0] != ATT_ERROR_RESPONSE) return 0;
+    if (att_response_buffer[4] != ATT_ERROR_INSUFFICIENT_AUTHORIZATION) return 0;
+    if (!att_server->connection.authenticated) return 0;
+
+    switch (sm_authorization_state(att_server->connection.con_handle)){
+        case AUTHORIZATION_UNKNOWN:
+            sm_request_pairing(att_server->connection.con_handle);
+            return 1;
+        case AUTHORIZATION_PENDING:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+
+// pre: att_server->state == ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED
+// prepare response in per-connection response buffer, does not require can send now
+static void att_server_prepare_response(att_server_t * att_server){
+
+    uint16_t att_response_size = att_handle_request(&att_server->connection, att_server->request_buffer, att_server->request_size, att_server->response_buffer);
+
+    switch (att_response_size){
+        case ATT_READ_RESPONSE_PENDING:
+        case ATT_INTERNAL_WRITE_RESPONSE_PENDING:
+            log_info("att_server_prepare_response: response pending for con_handle 0x%04x", att_server->connection.con_handle);
+            att_server->state = ATT_SERVER_RESPONSE_PENDING;
+            return;
+        case 0:
+            att_server->state = ATT_SERVER_IDLE;
+            return;
+        default:
+            break;
+    }
+
+    if (att_server_authorization_required(att_server, att_server->response_buffer, att_response_size)) return;
+
+    att_server->response_size = att_response_size;
+    att_server->state = ATT_SERVER_RESPONSE_READY;
+}
+
+// pre: att_server->state == ATT_SERVER_RESPONSE_READY
+// pre: can send now
+// returns: 1 if packet was sent
+static int att_server_send_prepared_response(att_server_t * att_server){
+
+    att_server->state = ATT_SERVER_IDLE;
+    int status = l2cap_send_connectionless(att_server->connection.con_handle, L2CAP_CID_ATTRIBUTE_PROTOCOL, att_server->response_buffer, att_server->response_size);
+    if (status) {
+        log_error("att_server_send_prepared_response: sending response failed, status 0x%02x", status);
+        return 0;
+    }
+
+    // notify client about MTU exchange result
+    if (att_server->response_buffer[0] == ATT_EXCHANGE_MTU_RESPONSE){
+        att_emit_mtu_event(att_server->connection.con_handle, att_server->connection.mtu);
+    }
+    return 1;
+}
+
+#else
+
 // pre: att_server->state == ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED
 // pre: can send now
 // returns: 1 if packet was sent
@@ -272,23 +403,9 @@ static int att_server_process_validated_request(att_server_t * att_server){
     uint8_t * att_response_buffer = l2cap_get_outgoing_buffer();
     uint16_t  att_response_size   = att_handle_request(&att_server->connection, att_server->request_buffer, att_server->request_size, att_response_buffer);
 
-    // intercept "insufficient authorization" for authenticated connections to allow for user authorization
-    if ((att_response_size     >= 4)
-    && (att_response_buffer[0] == ATT_ERROR_RESPONSE)
-    && (att_response_buffer[4] == ATT_ERROR_INSUFFICIENT_AUTHORIZATION)
-    && (att_server->connection.authenticated)){
-
-        switch (sm_authorization_state(att_server->connection.con_handle)){
-            case AUTHORIZATION_UNKNOWN:
-                l2cap_release_packet_buffer();
-                sm_request_pairing(att_server->connection.con_handle);
-                return 0;
-            case AUTHORIZATION_PENDING:
-                l2cap_release_packet_buffer();
-                return 0;
-            default:
-                break;
-        }
+    if (att_server_authorization_required(att_server, att_response_buffer, att_response_size)){
+        l2cap_release_packet_buffer();
+        return 0;
     }
 
     att_server->state = ATT_SERVER_IDLE;
@@ -306,6 +423,8 @@ static int att_server_process_validated_request(att_server_t * att_server){
     return 1;
 }
 
+#endif
+
 static void att_run_for_context(att_server_t * att_server){
     switch (att_server->state){
         case ATT_SERVER_REQUEST_RECEIVED:
@@ -354,6 +473,11 @@ static void att_run_for_context(att_server_t * att_server){
 #endif
             // move on
             att_server->state = ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED;
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+            // process request right away, response is sent on can send now
+            att_server_prepare_response(att_server);
+            if (att_server->state != ATT_SERVER_RESPONSE_READY) break;
+#endif
             att_dispatch_server_request_can_send_now_event(att_server->connection.con_handle);
             break;
 
@@ -371,8 +495,20 @@ static void att_server_handle_can_send_now(void){
     while(btstack_linked_list_iterator_has_next(&it)){
         hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
         att_server_t * att_server = &connection->att_server;
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+        if (att_server->state == ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED){
+            att_server_prepare_response(att_server);
+        }
+        if (att_server->state == ATT_SERVER_RESPONSE_READY){
+            if (!att_dispatch_server_can_send_now(att_server->connection.con_handle)){
+                att_dispatch_server_request_can_send_now_event(att_server->connection.con_handle);
+                return;
+            }
+            int sent = att_server_send_prepared_response(att_server);
+#else
         if (att_server->state == ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED){
             int sent = att_server_process_validated_request(att_server);
+#endif
             if (sent && (att_client_waiting_for_can_send || !btstack_linked_list_empty(&can_send_now_clients))){
                 att_dispatch_server_request_can_send_now_event(att_server->connection.con_handle);
                 return;
@@ -380,6 +516,21 @@ static void att_server_handle_can_send_now(void){
         }
     }
 
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+    // serve all connections, others might still be able to send
+    int notifications_pending = 0;
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        att_server_t * att_server = &connection->att_server;
+        if (att_server_send_queued_notifications(att_server)){
+            att_dispatch_server_request_can_send_now_event(att_server->connection.con_handle);
+            notifications_pending = 1;
+        }
+    }
+    if (notifications_pending) return;
+#endif
+
     while (!btstack_linked_list_empty(&can_send_now_clients)){
         // handle first client
         btstack_context_callback_registration_t * client = (btstack_context_callback_registration_t*) can_send_now_clients;
@@ -513,6 +664,80 @@ int att_server_notify(hci_con_handle_t con_handle, uint16_t attribute_handle, ui
 	return l2cap_send_prepared_connectionless(att_server->connection.con_handle, L2CAP_CID_ATTRIBUTE_PROTOCOL, size);
 }
 
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+int att_server_queue_notification(hci_con_handle_t con_handle, uint16_t attribute_handle, uint8_t *value, uint16_t value_len){
+    att_server_t * att_server = att_server_for_handle(con_handle);
+    if (!att_server) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+
+    // limit to single notification
+    if (value_len > att_server->connection.mtu - 3){
+        value_len = att_server->connection.mtu - 3;
+    }
+
+    uint16_t entry_size = 4 + value_len;
+    if (att_server->notification_queue_len + entry_size > ATT_SERVER_NOTIFICATION_QUEUE_SIZE){
+        att_server->notifications_dropped++;
+        log_info("att_server_queue_notification: queue full, dropping notification for handle 0x%04x", attribute_handle);
+        return BTSTACK_MEMORY_ALLOC_FAILED;
+    }
+
+    uint8_t * entry = &att_server->notification_queue[att_server->notification_queue_len];
+    little_endian_store_16(entry, 0, attribute_handle);
+    little_endian_store_16(entry, 2, value_len);
+    memcpy(&entry[4], value, value_len);
+    att_server->notification_queue_len += entry_size;
+    att_server->notification_queue_count++;
+    if (att_server->notification_queue_count > att_server->notification_queue_count_max){
+        att_server->notification_queue_count_max = att_server->notification_queue_count;
+    }
+
+    att_dispatch_server_request_can_send_now_event(con_handle);
+    return 0;
+}
+
+void att_server_enable_multiple_handle_value_notifications(hci_con_handle_t con_handle, int enabled){
+    att_server_t * att_server = att_server_for_handle(con_handle);
+    if (!att_server) return;
+    att_server->multiple_notifications_enabled = enabled;
+}
+
+void att_server_request_notification_queue_statistics_event(hci_con_handle_t con_handle){
+    att_server_t * att_server = att_server_for_handle(con_handle);
+    if (!att_server) return;
+    if (!att_client_packet_handler) return;
+
+    uint8_t event[20];
+    int pos = 0;
+    event[pos++] = ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS;
+    event[pos++] = sizeof(event) - 2;
+    little_endian_store_16(event, pos, con_handle);
+    pos += 2;
+    little_endian_store_16(event, pos, att_server->notification_queue_count);
+    pos += 2;
+    little_endian_store_16(event, pos, att_server->notification_queue_count_max);
+    pos += 2;
+    little_endian_store_32(event, pos, att_server->notifications_sent);
+    pos += 4;
+    little_endian_store_32(event, pos, att_server->notification_packets_sent);
+    pos += 4;
+    little_endian_store_32(event, pos, att_server->notifications_dropped);
+    (*att_client_packet_handler)(HCI_EVENT_PACKET, 0, &event[0], sizeof(event));
+}
+#endif
+
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+int att_server_response_ready(hci_con_handle_t con_handle){
+    att_server_t * att_server = att_server_for_handle(con_handle);
+    if (!att_server) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    if (att_server->state != ATT_SERVER_RESPONSE_PENDING) return ERROR_CODE_COMMAND_DISALLOWED;
+
+    // process request again on can send now
+    att_server->state = ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED;
+    att_dispatch_server_request_can_send_now_event(con_handle);
+    return 0;
+}
+#endif
+
 int att_server_indicate(hci_con_handle_t con_handle, uint16_t attribute_handle, uint8_t *value, uint16_t value_len){
     att_server_t * att_server = att_server_for_handle(con_handle);
     if (!att_server) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
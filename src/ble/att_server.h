@@ -59,6 +59,7 @@ void att_server_init(uint8_t const * db, att_read_callback_t read_callback, att_
  *        - ATT_EVENT_CAN_SEND_NOW
  *        - ATT_EVENT_HANDLE_VALUE_INDICATION_COMPLETE
  *        - ATT_EVENT_MTU_EXCHANGE_COMPLETE 
+ *        - ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
  * @param handler
  */
 void att_server_register_packet_handler(btstack_packet_handler_t handler);
@@ -106,6 +107,45 @@ int att_server_notify(hci_con_handle_t con_handle, uint16_t attribute_handle, ui
  */
 int att_server_indicate(hci_con_handle_t con_handle, uint16_t attribute_handle, uint8_t *value, uint16_t value_len);
 
+/*
+ * @brief queue notification, queued notifications are sent in order as soon as possible, without ATT_EVENT_CAN_SEND_NOW.
+ *        If enabled, several notifications are combined into a single Multiple Handle Value Notification
+ * @note requires ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+ * @param con_handle
+ * @param attribute_handle
+ * @param value
+ * @param value_len
+ * @return 0 if ok, BTSTACK_MEMORY_ALLOC_FAILED if queue is full
+ */
+int att_server_queue_notification(hci_con_handle_t con_handle, uint16_t attribute_handle, uint8_t *value, uint16_t value_len);
+
+/*
+ * @brief allow to send queued notifications as Multiple Handle Value Notifications. Only enable if the client
+ *        has indicated support for it in the Client Supported Features characteristic
+ * @note requires ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+ * @param con_handle
+ * @param enabled
+ */
+void att_server_enable_multiple_handle_value_notifications(hci_con_handle_t con_handle, int enabled);
+
+/*
+ * @brief emit ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS with queue depth, sent, and dropped notifications
+ * @note requires ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+ * @param con_handle
+ */
+void att_server_request_notification_queue_statistics_event(hci_con_handle_t con_handle);
+
+/*
+ * @brief complete request for which a read callback returned ATT_READ_RESPONSE_PENDING or a write callback
+ *        returned ATT_ERROR_WRITE_RESPONSE_PENDING. The request is processed again and the callbacks are called
+ *        with the same parameters, now they have to provide the value or the result of the write.
+ *        Requests from other connections are processed in the meantime.
+ * @note requires ENABLE_ATT_DELAYED_RESPONSE
+ * @param con_handle
+ * @return 0 if ok, ERROR_CODE_COMMAND_DISALLOWED if no response is pending
+ */
+int att_server_response_ready(hci_con_handle_t con_handle);
+
 /* API_END */
 
 #if defined __cplusplus
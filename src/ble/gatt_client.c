@@ -145,7 +145,7 @@ static gatt_client_t * provide_context_for_conn_handle(hci_con_handle_t con_hand
     gatt_client_t * context = get_gatt_client_context_for_handle(con_handle);
     if (context) return  context;
 
-    context = btstack_memory_gatt_client_get();
+    context = btstack_memory_gatt_client_get_for_connection(con_handle);
     if (!context) return NULL;
     // init state
     memset(context, 0, sizeof(gatt_client_t));
@@ -162,16 +162,117 @@ static gatt_client_t * provide_context_for_conn_handle(hci_con_handle_t con_hand
     return context;
 }
 
-static gatt_client_t * provide_context_for_conn_handle_and_start_timer(hci_con_handle_t con_handle){
+static int is_ready(gatt_client_t * context){
+    return context->gatt_client_state == P_READY;
+}
+
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+// requests issued while busy are set up in this context and then stored in the queued gatt_client_request_t
+static gatt_client_t           gatt_client_request_setup;
+static gatt_client_request_t * gatt_client_request_setup_request;
+
+// add request set up by the last API call to the queue of its gatt client, called by gatt_client_run
+static void gatt_client_request_queue_add_setup_request(void){
+    gatt_client_request_t * request = gatt_client_request_setup_request;
+    if (!request) return;
+    gatt_client_request_setup_request = NULL;
+
+    gatt_client_t * context = get_gatt_client_context_for_handle(gatt_client_request_setup.con_handle);
+    if (!context){
+        btstack_memory_gatt_client_request_free(request);
+        return;
+    }
+
+    // store request parameters
+    gatt_client_t * setup = &gatt_client_request_setup;
+    request->gatt_client_state = setup->gatt_client_state;
+    request->callback = setup->callback;
+    request->uuid16 = setup->uuid16;
+    memcpy(request->uuid128, setup->uuid128, 16);
+    request->start_group_handle = setup->start_group_handle;
+    request->end_group_handle = setup->end_group_handle;
+    request->query_start_handle = setup->query_start_handle;
+    request->query_end_handle = setup->query_end_handle;
+    request->characteristic_start_handle = setup->characteristic_start_handle;
+    request->attribute_handle = setup->attribute_handle;
+    request->attribute_offset = setup->attribute_offset;
+    request->attribute_length = setup->attribute_length;
+    request->attribute_value = setup->attribute_value;
+    request->read_multiple_handle_count = setup->read_multiple_handle_count;
+    request->read_multiple_handles = setup->read_multiple_handles;
+    memcpy(request->client_characteristic_configuration_value, setup->client_characteristic_configuration_value, 2);
+    request->filter_with_uuid = setup->filter_with_uuid;
+    request->le_device_index = setup->le_device_index;
+    btstack_linked_list_add_tail(&context->request_queue, (btstack_linked_item_t *) request);
+}
+#endif
+
+// @returns context to set up the request in: the gatt client if it is ready,
+// or, with ENABLE_GATT_CLIENT_REQUEST_QUEUE, the setup context for a new queued request.
+// All API functions call gatt_client_run after the setup, which adds the queued request.
+static gatt_client_t * provide_context_for_request(hci_con_handle_t con_handle, uint8_t * status){
     gatt_client_t * context = provide_context_for_conn_handle(con_handle);
-    if (!context) return NULL;
+    if (!context) {
+        *status = BTSTACK_MEMORY_ALLOC_FAILED;
+        return NULL;
+    }
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+    // queue request if busy or if other requests are queued already to keep order
+    if (!is_ready(context) || !btstack_linked_list_empty(&context->request_queue)){
+        gatt_client_request_t * request = btstack_memory_gatt_client_request_get_for_connection(con_handle);
+        if (!request) {
+            log_info("provide_context_for_request: no memory to queue request for handle 0x%04x", con_handle);
+            *status = BTSTACK_MEMORY_ALLOC_FAILED;
+            return NULL;
+        }
+        memset(request, 0, sizeof(gatt_client_request_t));
+        gatt_client_request_setup_request = request;
+        memset(&gatt_client_request_setup, 0, sizeof(gatt_client_t));
+        gatt_client_request_setup.con_handle = con_handle;
+        return &gatt_client_request_setup;
+    }
+#else
+    if (!is_ready(context)) {
+        *status = GATT_CLIENT_IN_WRONG_STATE;
+        return NULL;
+    }
+#endif
     gatt_client_timeout_start(context);
     return context;
 }
 
-static int is_ready(gatt_client_t * context){
-    return context->gatt_client_state == P_READY;
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+// start next queued request if ready, the request is sent by gatt_client_run
+static void gatt_client_request_queue_start_next(gatt_client_t * peripheral){
+    if (!is_ready(peripheral)) return;
+    gatt_client_request_t * request = (gatt_client_request_t *) btstack_linked_list_pop(&peripheral->request_queue);
+    if (!request) return;
+
+    // copy request parameters
+    peripheral->gatt_client_state = request->gatt_client_state;
+    peripheral->callback = request->callback;
+    peripheral->uuid16 = request->uuid16;
+    memcpy(peripheral->uuid128, request->uuid128, 16);
+    peripheral->start_group_handle = request->start_group_handle;
+    peripheral->end_group_handle = request->end_group_handle;
+    peripheral->query_start_handle = request->query_start_handle;
+    peripheral->query_end_handle = request->query_end_handle;
+    peripheral->characteristic_start_handle = request->characteristic_start_handle;
+    peripheral->attribute_handle = request->attribute_handle;
+    peripheral->attribute_offset = request->attribute_offset;
+    peripheral->attribute_length = request->attribute_length;
+    peripheral->attribute_value = request->attribute_value;
+    peripheral->read_multiple_handle_count = request->read_multiple_handle_count;
+    peripheral->read_multiple_handles = request->read_multiple_handles;
+    memcpy(peripheral->client_characteristic_configuration_value, request->client_characteristic_configuration_value, 2);
+    peripheral->filter_with_uuid = request->filter_with_uuid;
+    peripheral->le_device_index = request->le_device_index;
+    btstack_memory_gatt_client_request_free(request);
+
+    log_info("gatt_client_request_queue_start_next: handle 0x%04x, state %u", peripheral->con_handle, peripheral->gatt_client_state);
+    gatt_client_timeout_start(peripheral);
 }
+#endif
 
 int gatt_client_is_ready(hci_con_handle_t con_handle){
     gatt_client_t * context = provide_context_for_conn_handle(con_handle);
@@ -457,6 +558,14 @@ static void gatt_client_handle_transaction_complete(gatt_client_t * peripheral){
     gatt_client_timeout_stop(peripheral);
 }
 
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+// request can send now to start next queued request if transaction was completed by gatt_client_run
+static void gatt_client_request_queue_trigger(gatt_client_t * peripheral){
+    if (btstack_linked_list_empty(&peripheral->request_queue)) return;
+    att_dispatch_client_request_can_send_now_event(peripheral->con_handle);
+}
+#endif
+
 static void emit_event_new(btstack_packet_handler_t callback, uint8_t * packet, uint16_t size){
     if (!callback) return;
     hci_dump_packet(HCI_EVENT_PACKET, 0, packet, size);
@@ -485,14 +594,18 @@ static void emit_event_to_registered_listeners(hci_con_handle_t con_handle, uint
     } 
 }
 
-static void emit_gatt_complete_event(gatt_client_t * peripheral, uint8_t status){
+static void emit_gatt_complete_event_for_callback(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint8_t status){
     // @format H1
     uint8_t packet[5];
     packet[0] = GATT_EVENT_QUERY_COMPLETE;
     packet[1] = 3;
-    little_endian_store_16(packet, 2, peripheral->con_handle);
+    little_endian_store_16(packet, 2, con_handle);
     packet[4] = status;
-    emit_event_new(peripheral->callback, packet, sizeof(packet));
+    emit_event_new(callback, packet, sizeof(packet));
+}
+
+static void emit_gatt_complete_event(gatt_client_t * peripheral, uint8_t status){
+    emit_gatt_complete_event_for_callback(peripheral->callback, peripheral->con_handle, status);
 }
 
 static void emit_gatt_service_query_result_event(gatt_client_t * peripheral, uint16_t start_group_handle, uint16_t end_group_handle, uint8_t * uuid128){
@@ -803,11 +916,19 @@ static int is_value_valid(gatt_client_t *peripheral, uint8_t *packet, uint16_t s
 
 static void gatt_client_run(void){
 
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+    gatt_client_request_queue_add_setup_request();
+#endif
+
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) gatt_client_connections; it ; it = it->next){
 
         gatt_client_t * peripheral = (gatt_client_t *) it;
 
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+        gatt_client_request_queue_start_next(peripheral);
+#endif
+
         if (!att_dispatch_client_can_send_now(peripheral->con_handle)) {
             att_dispatch_client_request_can_send_now_event(peripheral->con_handle);
             return;
@@ -841,6 +962,9 @@ static void gatt_client_run(void){
                 log_error("gatt_client_run: value len %u > MTU %u - 3\n", peripheral->attribute_length, peripheral_mtu(peripheral));
                 gatt_client_handle_transaction_complete(peripheral);
                 emit_gatt_complete_event(peripheral, ATT_ERROR_INVALID_ATTRIBUTE_VALUE_LENGTH);
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+                gatt_client_request_queue_trigger(peripheral);
+#endif
                 return;
             default:
                 break;
@@ -994,6 +1118,9 @@ static void gatt_client_run(void){
                 peripheral->gatt_client_state = P_READY;
                 // finally, notifiy client that write is complete
                 gatt_client_handle_transaction_complete(peripheral);
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+                gatt_client_request_queue_trigger(peripheral);
+#endif
                 return;
             }
 #endif
@@ -1006,9 +1133,22 @@ static void gatt_client_run(void){
 }
 
 static void gatt_client_report_error_if_pending(gatt_client_t *peripheral, uint8_t error_code) {
-    if (is_ready(peripheral)) return;
-    gatt_client_handle_transaction_complete(peripheral);
-    emit_gatt_complete_event(peripheral, error_code);
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+    // no further requests after disconnect or timeout
+    btstack_linked_list_t request_queue = peripheral->request_queue;
+    peripheral->request_queue = NULL;
+#endif
+    if (!is_ready(peripheral)) {
+        gatt_client_handle_transaction_complete(peripheral);
+        emit_gatt_complete_event(peripheral, error_code);
+    }
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+    while (!btstack_linked_list_empty(&request_queue)){
+        gatt_client_request_t * request = (gatt_client_request_t *) btstack_linked_list_pop(&request_queue);
+        emit_gatt_complete_event_for_callback(request->callback, peripheral->con_handle, error_code);
+        btstack_memory_gatt_client_request_free(request);
+    }
+#endif
 }
 
 static void gatt_client_hci_event_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
@@ -1379,11 +1519,14 @@ static void att_signed_write_handle_cmac_result(uint8_t hash[8]){
 }
 
 uint8_t gatt_client_signed_write_without_response(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t handle, uint16_t message_len, uint8_t * message){
-    gatt_client_t * peripheral = provide_context_for_conn_handle(con_handle);
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
-    peripheral->le_device_index = sm_le_device_index(con_handle);
-    if (peripheral->le_device_index < 0) return GATT_CLIENT_IN_WRONG_STATE; // device lookup not done / no stored bonding information
+    int le_device_index = sm_le_device_index(con_handle);
+    if (le_device_index < 0) return GATT_CLIENT_IN_WRONG_STATE; // device lookup not done / no stored bonding information
+
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
 
+    peripheral->le_device_index = le_device_index;
     peripheral->callback = callback;
     peripheral->attribute_handle = handle;
     peripheral->attribute_length = message_len;
@@ -1396,9 +1539,9 @@ uint8_t gatt_client_signed_write_without_response(btstack_packet_handler_t callb
 #endif
 
 uint8_t gatt_client_discover_primary_services(btstack_packet_handler_t callback, hci_con_handle_t con_handle){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
 
     peripheral->callback = callback;
     peripheral->start_group_handle = 0x0001;
@@ -1411,10 +1554,9 @@ uint8_t gatt_client_discover_primary_services(btstack_packet_handler_t callback,
 
 
 uint8_t gatt_client_discover_primary_services_by_uuid16(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t uuid16){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
 
     peripheral->callback = callback;
     peripheral->start_group_handle = 0x0001;
@@ -1427,10 +1569,9 @@ uint8_t gatt_client_discover_primary_services_by_uuid16(btstack_packet_handler_t
 }
 
 uint8_t gatt_client_discover_primary_services_by_uuid128(btstack_packet_handler_t callback, hci_con_handle_t con_handle, const uint8_t * uuid128){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
 
     peripheral->callback = callback;
     peripheral->start_group_handle = 0x0001;
@@ -1443,10 +1584,9 @@ uint8_t gatt_client_discover_primary_services_by_uuid128(btstack_packet_handler_
 }
 
 uint8_t gatt_client_discover_characteristics_for_service(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_service_t *service){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
 
     peripheral->callback = callback;
     peripheral->start_group_handle = service->start_group_handle;
@@ -1459,10 +1599,9 @@ uint8_t gatt_client_discover_characteristics_for_service(btstack_packet_handler_
 }
 
 uint8_t gatt_client_find_included_services_for_service(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_service_t *service){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->start_group_handle = service->start_group_handle;
@@ -1474,10 +1613,9 @@ uint8_t gatt_client_find_included_services_for_service(btstack_packet_handler_t
 }
 
 uint8_t gatt_client_discover_characteristics_for_handle_range_by_uuid16(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->start_group_handle = start_handle;
@@ -1493,10 +1631,9 @@ uint8_t gatt_client_discover_characteristics_for_handle_range_by_uuid16(btstack_
 }
 
 uint8_t gatt_client_discover_characteristics_for_handle_range_by_uuid128(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle, uint8_t * uuid128){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->start_group_handle = start_handle;
@@ -1521,15 +1658,21 @@ uint8_t gatt_client_discover_characteristics_for_service_by_uuid128(btstack_pack
 }
 
 uint8_t gatt_client_discover_characteristic_descriptors(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_characteristic_t *characteristic){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
-    
+    // no descriptors, complete without query
     if (characteristic->value_handle == characteristic->end_handle){
-        emit_gatt_complete_event(peripheral, 0);
+        gatt_client_t * context = provide_context_for_conn_handle(con_handle);
+        if (!context) return BTSTACK_MEMORY_ALLOC_FAILED;
+#ifndef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+        if (!is_ready(context)) return GATT_CLIENT_IN_WRONG_STATE;
+#endif
+        emit_gatt_complete_event_for_callback(callback, con_handle, 0);
         return 0;
     }
+
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
+
     peripheral->callback = callback;
     peripheral->start_group_handle = characteristic->value_handle + 1;
     peripheral->end_group_handle   = characteristic->end_handle;
@@ -1540,10 +1683,9 @@ uint8_t gatt_client_discover_characteristic_descriptors(btstack_packet_handler_t
 }
 
 uint8_t gatt_client_read_value_of_characteristic_using_value_handle(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t value_handle){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = value_handle;
@@ -1554,10 +1696,9 @@ uint8_t gatt_client_read_value_of_characteristic_using_value_handle(btstack_pack
 }
 
 uint8_t gatt_client_read_value_of_characteristics_by_uuid16(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->start_group_handle = start_handle;
@@ -1572,10 +1713,9 @@ uint8_t gatt_client_read_value_of_characteristics_by_uuid16(btstack_packet_handl
 }
 
 uint8_t gatt_client_read_value_of_characteristics_by_uuid128(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t start_handle, uint16_t end_handle, uint8_t * uuid128){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->start_group_handle = start_handle;
@@ -1595,10 +1735,9 @@ uint8_t gatt_client_read_value_of_characteristic(btstack_packet_handler_t callba
 }
 
 uint8_t gatt_client_read_long_value_of_characteristic_using_value_handle_with_offset(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t characteristic_value_handle, uint16_t offset){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = characteristic_value_handle;
@@ -1617,10 +1756,9 @@ uint8_t gatt_client_read_long_value_of_characteristic(btstack_packet_handler_t c
 }
 
 uint8_t gatt_client_read_multiple_characteristic_values(btstack_packet_handler_t callback, hci_con_handle_t con_handle, int num_value_handles, uint16_t * value_handles){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->read_multiple_handle_count = num_value_handles;
@@ -1634,7 +1772,9 @@ uint8_t gatt_client_write_value_of_characteristic_without_response(hci_con_handl
     gatt_client_t * peripheral = provide_context_for_conn_handle(con_handle);
     
     if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
+#ifndef ENABLE_GATT_CLIENT_REQUEST_QUEUE
     if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+#endif
     
     if (value_length > peripheral_mtu(peripheral) - 3) return GATT_CLIENT_VALUE_TOO_LONG;
     if (!att_dispatch_client_can_send_now(peripheral->con_handle)) return GATT_CLIENT_BUSY;
@@ -1644,10 +1784,9 @@ uint8_t gatt_client_write_value_of_characteristic_without_response(hci_con_handl
 }
 
 uint8_t gatt_client_write_value_of_characteristic(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t value_handle, uint16_t value_length, uint8_t * data){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = value_handle;
@@ -1659,10 +1798,9 @@ uint8_t gatt_client_write_value_of_characteristic(btstack_packet_handler_t callb
 }
 
 uint8_t gatt_client_write_long_value_of_characteristic_with_offset(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t value_handle, uint16_t offset, uint16_t value_length, uint8_t  * data){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = value_handle;
@@ -1679,10 +1817,9 @@ uint8_t gatt_client_write_long_value_of_characteristic(btstack_packet_handler_t
 }
 
 uint8_t gatt_client_reliable_write_long_value_of_characteristic(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t value_handle, uint16_t value_length, uint8_t * value){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = value_handle;
@@ -1695,11 +1832,6 @@ uint8_t gatt_client_reliable_write_long_value_of_characteristic(btstack_packet_h
 }
 
 uint8_t gatt_client_write_client_characteristic_configuration(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_characteristic_t * characteristic, uint16_t configuration){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
-    
     if ( (configuration & GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION) &&
         (characteristic->properties & ATT_PROPERTY_NOTIFY) == 0) {
         log_info("gatt_client_write_client_characteristic_configuration: GATT_CLIENT_CHARACTERISTIC_NOTIFICATION_NOT_SUPPORTED");
@@ -1709,6 +1841,10 @@ uint8_t gatt_client_write_client_characteristic_configuration(btstack_packet_han
         log_info("gatt_client_write_client_characteristic_configuration: GATT_CLIENT_CHARACTERISTIC_INDICATION_NOT_SUPPORTED");
         return GATT_CLIENT_CHARACTERISTIC_INDICATION_NOT_SUPPORTED;
     }
+
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->start_group_handle = characteristic->value_handle;
@@ -1721,10 +1857,9 @@ uint8_t gatt_client_write_client_characteristic_configuration(btstack_packet_han
 }
 
 uint8_t gatt_client_read_characteristic_descriptor_using_descriptor_handle(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t descriptor_handle){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = descriptor_handle;
@@ -1739,10 +1874,9 @@ uint8_t gatt_client_read_characteristic_descriptor(btstack_packet_handler_t call
 }
 
 uint8_t gatt_client_read_long_characteristic_descriptor_using_descriptor_handle_with_offset(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t descriptor_handle, uint16_t offset){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = descriptor_handle;
@@ -1761,10 +1895,9 @@ uint8_t gatt_client_read_long_characteristic_descriptor(btstack_packet_handler_t
 }
 
 uint8_t gatt_client_write_characteristic_descriptor_using_descriptor_handle(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t descriptor_handle, uint16_t length, uint8_t  * data){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = descriptor_handle;
@@ -1781,10 +1914,9 @@ uint8_t gatt_client_write_characteristic_descriptor(btstack_packet_handler_t cal
 }
 
 uint8_t gatt_client_write_long_characteristic_descriptor_using_descriptor_handle_with_offset(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t descriptor_handle, uint16_t offset, uint16_t length, uint8_t  * data){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = descriptor_handle;
@@ -1808,10 +1940,9 @@ uint8_t gatt_client_write_long_characteristic_descriptor(btstack_packet_handler_
  * @brief -> gatt complete event
  */
 uint8_t gatt_client_prepare_write(btstack_packet_handler_t callback, hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint16_t length, uint8_t * data){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->attribute_handle = attribute_handle;
@@ -1827,10 +1958,9 @@ uint8_t gatt_client_prepare_write(btstack_packet_handler_t callback, hci_con_han
  * @brief -> gatt complete event
  */
 uint8_t gatt_client_execute_write(btstack_packet_handler_t callback, hci_con_handle_t con_handle){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->gatt_client_state = P_W2_EXECUTE_PREPARED_WRITE;
@@ -1842,10 +1972,9 @@ uint8_t gatt_client_execute_write(btstack_packet_handler_t callback, hci_con_han
  * @brief -> gatt complete event
  */
 uint8_t gatt_client_cancel_write(btstack_packet_handler_t callback, hci_con_handle_t con_handle){
-    gatt_client_t * peripheral = provide_context_for_conn_handle_and_start_timer(con_handle);
-    
-    if (!peripheral) return BTSTACK_MEMORY_ALLOC_FAILED; 
-    if (!is_ready(peripheral)) return GATT_CLIENT_IN_WRONG_STATE;
+    uint8_t status;
+    gatt_client_t * peripheral = provide_context_for_request(con_handle, &status);
+    if (!peripheral) return status;
     
     peripheral->callback = callback;
     peripheral->gatt_client_state = P_W2_CANCEL_PREPARED_WRITE;
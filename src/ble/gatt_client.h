@@ -175,8 +175,43 @@ typedef struct gatt_client{
     uint8_t  cmac[8];
 
     btstack_timer_source_t gc_timeout;
+
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+    // requests issued while busy, see gatt_client_request_t
+    btstack_linked_list_t request_queue;
+#endif
 } gatt_client_t;
 
+// query parameters of a request queued with ENABLE_GATT_CLIENT_REQUEST_QUEUE
+typedef struct {
+    btstack_linked_item_t    item;
+    gatt_client_state_t gatt_client_state;
+    btstack_packet_handler_t callback;
+
+    uint16_t uuid16;
+    uint8_t  uuid128[16];
+
+    uint16_t start_group_handle;
+    uint16_t end_group_handle;
+
+    uint16_t query_start_handle;
+    uint16_t query_end_handle;
+
+    uint16_t characteristic_start_handle;
+
+    uint16_t attribute_handle;
+    uint16_t attribute_offset;
+    uint16_t attribute_length;
+    uint8_t* attribute_value;
+
+    uint16_t    read_multiple_handle_count;
+    uint16_t  * read_multiple_handles;
+
+    uint8_t  client_characteristic_configuration_value[2];
+    uint8_t  filter_with_uuid;
+    int      le_device_index;
+} gatt_client_request_t;
+
 typedef struct gatt_client_notification {
     btstack_linked_item_t    item;
     btstack_packet_handler_t callback;
@@ -254,6 +289,7 @@ uint8_t gatt_client_discover_characteristics_for_service_by_uuid128(btstack_pack
 
 /** 
  * @brief Discovers attribute handle and UUID of a characteristic descriptor within the specified characteristic. For each found descriptor, an le_characteristic_descriptor_event_t with type set to GATT_EVENT_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY_RESULT will be generated and passed to the registered callback. The gatt_complete_event_t with type set to GATT_EVENT_QUERY_COMPLETE, marks the end of discovery.
+ * @note If the characteristic has no descriptors, GATT_EVENT_QUERY_COMPLETE is emitted right away without a query, also if other queries are queued.
  */
 uint8_t gatt_client_discover_characteristic_descriptors(btstack_packet_handler_t callback, hci_con_handle_t con_handle, gatt_client_characteristic_t  *characteristic);
 
@@ -285,6 +321,7 @@ uint8_t gatt_client_read_multiple_characteristic_values(btstack_packet_handler_t
 
 /** 
  * @brief Writes the characteristic value using the characteristic's value handle without an acknowledgment that the write was successfully performed.
+ * @note With ENABLE_GATT_CLIENT_REQUEST_QUEUE, writes can be sent while a query is active. Returns GATT_CLIENT_BUSY if there are no free ACL buffers.
  */
 uint8_t gatt_client_write_value_of_characteristic_without_response(hci_con_handle_t con_handle, uint16_t characteristic_value_handle, uint16_t length, uint8_t  * data);
 
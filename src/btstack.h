@@ -56,8 +56,11 @@
 #include "btstack_debug.h"
 #include "btstack_defines.h"
 #include "btstack_event.h"
+#include "btstack_crc.h"
+#include "btstack_keyed_index.h"
 #include "btstack_linked_list.h"
 #include "btstack_memory.h"
+#include "btstack_memory_arena.h"
 #include "btstack_memory_pool.h"
 #include "btstack_run_loop.h"
 #include "btstack_stdin.h"
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ *  btstack_crc.h
+ *
+ *  CRC calculations shared by L2CAP ERTM (FCS), RFCOMM (FCS) and the H5 transport (Data Integrity Check).
+ *  All CRCs are processed LSB first. By default, a single (small) lookup table is used per CRC.
+ *  With ENABLE_BTSTACK_CRC_SLICING_BY_8, eight bytes are processed per step using 8 tables per CRC
+ *  (4 kB for each CRC-16, 2 kB for CRC-8), which is considerably faster for larger packets.
+ */
+
+#ifndef __BTSTACK_CRC_H
+#define __BTSTACK_CRC_H
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* API_START */
+
+/**
+ * @brief Update CRC-16 with polynomial x^16 + x^15 + x^2 + 1 as used for L2CAP FCS
+ * @param crc current value
+ * @param data
+ * @param len
+ * @returns updated crc
+ */
+uint16_t btstack_crc16_update(uint16_t crc, const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Calculate L2CAP FCS, CRC-16 with initial value 0
+ * @param data
+ * @param len
+ * @returns crc
+ */
+uint16_t btstack_crc16_calc(const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Update CRC-16-CCITT with polynomial x^16 + x^12 + x^5 + 1 as used for H5 Data Integrity Check
+ * @param crc current value, 0xffff for first call
+ * @param data
+ * @param len
+ * @returns updated crc
+ */
+uint16_t btstack_crc16_ccitt_update(uint16_t crc, const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Update CRC-8 with polynomial x^8 + x^2 + x + 1 as used for RFCOMM FCS
+ * @param crc current value, 0xff for first call
+ * @param data
+ * @param len
+ * @returns updated crc
+ */
+uint8_t btstack_crc8_update(uint8_t crc, const uint8_t * data, uint16_t len);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __BTSTACK_CRC_H
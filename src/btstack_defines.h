@@ -401,6 +401,32 @@ typedef uint8_t sm_key_t[16];
  */
 #define HCI_EVENT_TRANSPORT_SLEEP_MODE                     0x69
 
+/**
+ * @brief ACL statistics for connection, see hci_request_acl_scheduler_statistics_event
+ * @format H1214444
+ * @param handle
+ * @param priority
+ * @param weight
+ * @param num_packets_outstanding
+ * @param packets_sent
+ * @param bytes_sent
+ * @param packets_completed
+ * @param packets_deferred
+ */
+#define HCI_EVENT_ACL_SCHEDULER_STATISTICS                 0x6A
+
+/**
+ * @brief Usage of memory type, see btstack_memory_dump_stats
+ * @format 122224
+ * @param type
+ * @param size
+ * @param count
+ * @param in_use
+ * @param max_in_use
+ * @param failures
+ */
+#define HCI_EVENT_MEMORY_STATISTICS                        0x6B
+
 /**
  * @brief Outgoing packet 
  */
@@ -521,6 +547,27 @@ typedef uint8_t sm_key_t[16];
  */
 #define L2CAP_EVENT_LE_PACKET_SENT                         0x7d
 
+/**
+ * @brief Credit statistics for LE Data Channel, see l2cap_le_request_channel_statistics_event
+ * @format 22222444
+ * @param local_cid
+ * @param credits_incoming
+ * @param credits_outgoing
+ * @param receive_buffers_count
+ * @param receive_buffers_free
+ * @param incoming_credits_exhausted
+ * @param outgoing_credits_exhausted
+ * @param incoming_sdus_dropped
+ */
+#define L2CAP_EVENT_LE_CHANNEL_STATISTICS                  0x7e
+
+/**
+ * @brief Queued SDU was not sent as the channel got closed, emitted for each dropped SDU in queue order
+ * @format 2
+ * @param local_cid
+ */
+#define L2CAP_EVENT_LE_PACKET_DROPPED                      0x7f
+
 
 // RFCOMM EVENTS
 
@@ -737,6 +784,17 @@ typedef uint8_t sm_key_t[16];
  */
 #define ATT_EVENT_CAN_SEND_NOW                                   0xB7
 
+/**
+ * @format H22444
+ * @param handle
+ * @param queued_notifications
+ * @param queued_notifications_max
+ * @param notifications_sent
+ * @param notification_packets_sent
+ * @param notifications_dropped
+ */
+#define ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS                  0xB8
+
 // TODO: daemon only event
 
 /**
@@ -1011,6 +1011,134 @@ static inline uint8_t hci_event_transport_sleep_mode_get_active(const uint8_t *
     return event[2];
 }
 
+/**
+ * @brief Get field handle from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t hci_event_acl_scheduler_statistics_get_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field priority from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return priority
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_event_acl_scheduler_statistics_get_priority(const uint8_t * event){
+    return event[4];
+}
+/**
+ * @brief Get field weight from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return weight
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_event_acl_scheduler_statistics_get_weight(const uint8_t * event){
+    return little_endian_read_16(event, 5);
+}
+/**
+ * @brief Get field num_packets_outstanding from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return num_packets_outstanding
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_event_acl_scheduler_statistics_get_num_packets_outstanding(const uint8_t * event){
+    return event[7];
+}
+/**
+ * @brief Get field packets_sent from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return packets_sent
+ * @note: btstack_type 4
+ */
+static inline uint32_t hci_event_acl_scheduler_statistics_get_packets_sent(const uint8_t * event){
+    return little_endian_read_32(event, 8);
+}
+/**
+ * @brief Get field bytes_sent from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return bytes_sent
+ * @note: btstack_type 4
+ */
+static inline uint32_t hci_event_acl_scheduler_statistics_get_bytes_sent(const uint8_t * event){
+    return little_endian_read_32(event, 12);
+}
+/**
+ * @brief Get field packets_completed from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return packets_completed
+ * @note: btstack_type 4
+ */
+static inline uint32_t hci_event_acl_scheduler_statistics_get_packets_completed(const uint8_t * event){
+    return little_endian_read_32(event, 16);
+}
+/**
+ * @brief Get field packets_deferred from event HCI_EVENT_ACL_SCHEDULER_STATISTICS
+ * @param event packet
+ * @return packets_deferred
+ * @note: btstack_type 4
+ */
+static inline uint32_t hci_event_acl_scheduler_statistics_get_packets_deferred(const uint8_t * event){
+    return little_endian_read_32(event, 20);
+}
+
+/**
+ * @brief Get field type from event HCI_EVENT_MEMORY_STATISTICS
+ * @param event packet
+ * @return type
+ * @note: btstack_type 1
+ */
+static inline uint8_t hci_event_memory_statistics_get_type(const uint8_t * event){
+    return event[2];
+}
+/**
+ * @brief Get field size from event HCI_EVENT_MEMORY_STATISTICS
+ * @param event packet
+ * @return size
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_event_memory_statistics_get_size(const uint8_t * event){
+    return little_endian_read_16(event, 3);
+}
+/**
+ * @brief Get field count from event HCI_EVENT_MEMORY_STATISTICS
+ * @param event packet
+ * @return count
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_event_memory_statistics_get_count(const uint8_t * event){
+    return little_endian_read_16(event, 5);
+}
+/**
+ * @brief Get field in_use from event HCI_EVENT_MEMORY_STATISTICS
+ * @param event packet
+ * @return in_use
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_event_memory_statistics_get_in_use(const uint8_t * event){
+    return little_endian_read_16(event, 7);
+}
+/**
+ * @brief Get field max_in_use from event HCI_EVENT_MEMORY_STATISTICS
+ * @param event packet
+ * @return max_in_use
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_event_memory_statistics_get_max_in_use(const uint8_t * event){
+    return little_endian_read_16(event, 9);
+}
+/**
+ * @brief Get field failures from event HCI_EVENT_MEMORY_STATISTICS
+ * @param event packet
+ * @return failures
+ * @note: btstack_type 4
+ */
+static inline uint32_t hci_event_memory_statistics_get_failures(const uint8_t * event){
+    return little_endian_read_32(event, 11);
+}
+
 /**
  * @brief Get field handle from event HCI_EVENT_SCO_CAN_SEND_NOW
  * @param event packet
@@ -1428,6 +1556,89 @@ static inline uint16_t l2cap_event_le_packet_sent_get_local_cid(const uint8_t *
     return little_endian_read_16(event, 2);
 }
 
+/**
+ * @brief Get field local_cid from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return local_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t l2cap_event_le_channel_statistics_get_local_cid(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field credits_incoming from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return credits_incoming
+ * @note: btstack_type 2
+ */
+static inline uint16_t l2cap_event_le_channel_statistics_get_credits_incoming(const uint8_t * event){
+    return little_endian_read_16(event, 4);
+}
+/**
+ * @brief Get field credits_outgoing from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return credits_outgoing
+ * @note: btstack_type 2
+ */
+static inline uint16_t l2cap_event_le_channel_statistics_get_credits_outgoing(const uint8_t * event){
+    return little_endian_read_16(event, 6);
+}
+/**
+ * @brief Get field receive_buffers_count from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return receive_buffers_count
+ * @note: btstack_type 2
+ */
+static inline uint16_t l2cap_event_le_channel_statistics_get_receive_buffers_count(const uint8_t * event){
+    return little_endian_read_16(event, 8);
+}
+/**
+ * @brief Get field receive_buffers_free from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return receive_buffers_free
+ * @note: btstack_type 2
+ */
+static inline uint16_t l2cap_event_le_channel_statistics_get_receive_buffers_free(const uint8_t * event){
+    return little_endian_read_16(event, 10);
+}
+/**
+ * @brief Get field incoming_credits_exhausted from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return incoming_credits_exhausted
+ * @note: btstack_type 4
+ */
+static inline uint32_t l2cap_event_le_channel_statistics_get_incoming_credits_exhausted(const uint8_t * event){
+    return little_endian_read_32(event, 12);
+}
+/**
+ * @brief Get field outgoing_credits_exhausted from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return outgoing_credits_exhausted
+ * @note: btstack_type 4
+ */
+static inline uint32_t l2cap_event_le_channel_statistics_get_outgoing_credits_exhausted(const uint8_t * event){
+    return little_endian_read_32(event, 16);
+}
+/**
+ * @brief Get field incoming_sdus_dropped from event L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param event packet
+ * @return incoming_sdus_dropped
+ * @note: btstack_type 4
+ */
+static inline uint32_t l2cap_event_le_channel_statistics_get_incoming_sdus_dropped(const uint8_t * event){
+    return little_endian_read_32(event, 20);
+}
+
+/**
+ * @brief Get field local_cid from event L2CAP_EVENT_LE_PACKET_DROPPED
+ * @param event packet
+ * @return local_cid
+ * @note: btstack_type 2
+ */
+static inline uint16_t l2cap_event_le_packet_dropped_get_local_cid(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+
 /**
  * @brief Get field status from event RFCOMM_EVENT_CHANNEL_OPENED
  * @param event packet
@@ -2143,6 +2354,61 @@ static inline uint16_t att_event_handle_value_indication_complete_get_attribute_
     return little_endian_read_16(event, 5);
 }
 
+/**
+ * @brief Get field handle from event ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
+ * @param event packet
+ * @return handle
+ * @note: btstack_type H
+ */
+static inline hci_con_handle_t att_event_notification_queue_statistics_get_handle(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field queued_notifications from event ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
+ * @param event packet
+ * @return queued_notifications
+ * @note: btstack_type 2
+ */
+static inline uint16_t att_event_notification_queue_statistics_get_queued_notifications(const uint8_t * event){
+    return little_endian_read_16(event, 4);
+}
+/**
+ * @brief Get field queued_notifications_max from event ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
+ * @param event packet
+ * @return queued_notifications_max
+ * @note: btstack_type 2
+ */
+static inline uint16_t att_event_notification_queue_statistics_get_queued_notifications_max(const uint8_t * event){
+    return little_endian_read_16(event, 6);
+}
+/**
+ * @brief Get field notifications_sent from event ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
+ * @param event packet
+ * @return notifications_sent
+ * @note: btstack_type 4
+ */
+static inline uint32_t att_event_notification_queue_statistics_get_notifications_sent(const uint8_t * event){
+    return little_endian_read_32(event, 8);
+}
+/**
+ * @brief Get field notification_packets_sent from event ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
+ * @param event packet
+ * @return notification_packets_sent
+ * @note: btstack_type 4
+ */
+static inline uint32_t att_event_notification_queue_statistics_get_notification_packets_sent(const uint8_t * event){
+    return little_endian_read_32(event, 12);
+}
+/**
+ * @brief Get field notifications_dropped from event ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS
+ * @param event packet
+ * @return notifications_dropped
+ * @note: btstack_type 4
+ */
+static inline uint32_t att_event_notification_queue_statistics_get_notifications_dropped(const uint8_t * event){
+    return little_endian_read_32(event, 16);
+}
+
 
 /**
  * @brief Get field status from event BNEP_EVENT_SERVICE_REGISTERED
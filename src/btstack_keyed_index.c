@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define __BTSTACK_FILE__ "btstack_keyed_index.c"
+
+/*
+ *  btstack_keyed_index.c
+ */
+
+#include "btstack_keyed_index.h"
+#include "btstack_debug.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static uint16_t btstack_keyed_index_home(btstack_keyed_index_t * index, uint32_t key){
+    // Fibonacci hashing spreads sequentially assigned CIDs
+    return (uint16_t) ((key * 2654435761u) >> 16) & index->mask;
+}
+
+void btstack_keyed_index_init(btstack_keyed_index_t * index, btstack_keyed_index_entry_t * entries, uint16_t size){
+    if (size & (size - 1)){
+        log_error("btstack_keyed_index_init: size %u not a power of two", size);
+    }
+    index->entries = entries;
+    index->mask    = size - 1;
+    btstack_keyed_index_clear(index);
+}
+
+void btstack_keyed_index_clear(btstack_keyed_index_t * index){
+    memset(index->entries, 0, (index->mask + 1) * sizeof(btstack_keyed_index_entry_t));
+    index->count = 0;
+    index->incomplete = 0;
+}
+
+int btstack_keyed_index_add(btstack_keyed_index_t * index, uint32_t key, void * value){
+    // keep at least one free entry to terminate probing
+    if (index->count >= index->mask){
+        if (!index->incomplete){
+            log_info("btstack_keyed_index_add: index %p full, fall back to linear search", index);
+            index->incomplete = 1;
+        }
+        return -1;
+    }
+    uint16_t pos = btstack_keyed_index_home(index, key);
+    while (index->entries[pos].value){
+        pos = (pos + 1) & index->mask;
+    }
+    index->entries[pos].key   = key;
+    index->entries[pos].value = value;
+    index->count++;
+    return 0;
+}
+
+int btstack_keyed_index_remove(btstack_keyed_index_t * index, uint32_t key, void * value){
+    uint16_t pos = btstack_keyed_index_home(index, key);
+    while (index->entries[pos].value != value || index->entries[pos].key != key){
+        if (index->entries[pos].value == NULL) return -1;
+        pos = (pos + 1) & index->mask;
+    }
+    index->entries[pos].value = NULL;
+    index->count--;
+    // backward shift deletion: move following entries of the cluster into the gap if their home allows it
+    uint16_t gap = pos;
+    pos = (pos + 1) & index->mask;
+    while (index->entries[pos].value){
+        uint16_t home = btstack_keyed_index_home(index, index->entries[pos].key);
+        // entry can be moved if its home is not in the cyclic range (gap, pos]
+        uint16_t distance_home = (pos - home) & index->mask;
+        uint16_t distance_gap  = (pos - gap)  & index->mask;
+        if (distance_home >= distance_gap){
+            index->entries[gap] = index->entries[pos];
+            index->entries[pos].value = NULL;
+            gap = pos;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return 0;
+}
+
+void * btstack_keyed_index_get(btstack_keyed_index_t * index, uint32_t key){
+    uint16_t pos = btstack_keyed_index_home(index, key);
+    while (index->entries[pos].value){
+        if (index->entries[pos].key == key) return index->entries[pos].value;
+        pos = (pos + 1) & index->mask;
+    }
+    return NULL;
+}
+
+int btstack_keyed_index_is_complete(btstack_keyed_index_t * index){
+    return !index->incomplete;
+}
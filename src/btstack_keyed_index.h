@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ *  btstack_keyed_index.h
+ *
+ *  Fixed-size hash index (open addressing, linear probing) that maps 32-bit keys to objects,
+ *  e.g. to find the channel for a L2CAP or RFCOMM CID without walking the list of all channels.
+ *  The entries are provided by the user, no dynamic memory is used.
+ *
+ *  If an entry cannot be added as the index is full, the index is marked as incomplete and
+ *  lookups need to fall back to a linear search until the index gets cleared.
+ */
+
+#ifndef __BTSTACK_KEYED_INDEX_H
+#define __BTSTACK_KEYED_INDEX_H
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/* API_START */
+
+// size of index for given number of objects: power of two with a load factor at or below 50%
+#define BTSTACK_KEYED_INDEX_SIZE_FOR(num_objects) \
+    ((num_objects) <= 2 ? 4 : (num_objects) <= 4 ? 8 : (num_objects) <= 8 ? 16 : (num_objects) <= 16 ? 32 : (num_objects) <= 32 ? 64 : 128)
+
+typedef struct {
+    uint32_t key;
+    void *   value;     // NULL for empty entry
+} btstack_keyed_index_entry_t;
+
+typedef struct {
+    btstack_keyed_index_entry_t * entries;
+    uint16_t mask;
+    uint16_t count;
+    uint8_t  incomplete;
+} btstack_keyed_index_t;
+
+/**
+ * @brief Init index with given entries
+ * @param index
+ * @param entries
+ * @param size number of entries, must be a power of two
+ */
+void btstack_keyed_index_init(btstack_keyed_index_t * index, btstack_keyed_index_entry_t * entries, uint16_t size);
+
+/**
+ * @brief Remove all entries and mark index as complete
+ * @param index
+ */
+void btstack_keyed_index_clear(btstack_keyed_index_t * index);
+
+/**
+ * @brief Add value for key. If index is full, it's marked as incomplete
+ * @param index
+ * @param key
+ * @param value
+ * @return 0 if added, -1 if index is full
+ */
+int btstack_keyed_index_add(btstack_keyed_index_t * index, uint32_t key, void * value);
+
+/**
+ * @brief Remove value for key
+ * @param index
+ * @param key
+ * @param value
+ * @return 0 if removed, -1 if not found
+ */
+int btstack_keyed_index_remove(btstack_keyed_index_t * index, uint32_t key, void * value);
+
+/**
+ * @brief Get value for key
+ * @param index
+ * @param key
+ * @return value or NULL if not found
+ */
+void * btstack_keyed_index_get(btstack_keyed_index_t * index, uint32_t key);
+
+/**
+ * @brief Check if all added values are in the index
+ * @param index
+ * @return 1 if lookup via btstack_keyed_index_get is sufficient
+ */
+int btstack_keyed_index_is_complete(btstack_keyed_index_t * index);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __BTSTACK_KEYED_INDEX_H
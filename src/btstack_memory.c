@@ -49,9 +49,48 @@
 
 #include "btstack_memory.h"
 #include "btstack_memory_pool.h"
+#include "btstack_memory_arena.h"
+#include "btstack_debug.h"
+#include "hci_dump.h"
 
 #include <stdlib.h>
+#include <string.h>
 
+#if defined(ENABLE_BTSTACK_MEMORY_ARENA) && !defined(HAVE_MALLOC)
+#error "ENABLE_BTSTACK_MEMORY_ARENA requires HAVE_MALLOC"
+#endif
+
+#ifdef HAVE_MALLOC
+// usage of types allocated via malloc, inline as not all types might use it
+typedef struct {
+    uint16_t in_use;
+    uint16_t max_in_use;
+    uint32_t failures;
+} btstack_memory_usage_t;
+
+static inline void * btstack_memory_usage_track_get(btstack_memory_usage_t * usage, void * object){
+    if (!object){
+        usage->failures++;
+        return NULL;
+    }
+    usage->in_use++;
+    if (usage->in_use > usage->max_in_use){
+        usage->max_in_use = usage->in_use;
+    }
+    return object;
+}
+
+static inline void btstack_memory_usage_track_free(btstack_memory_usage_t * usage, void * object){
+    if (!object) return;
+    usage->in_use--;
+}
+
+static inline void btstack_memory_usage_get_stats(btstack_memory_usage_t * usage, btstack_memory_stats_t * stats){
+    stats->in_use     = usage->in_use;
+    stats->max_in_use = usage->max_in_use;
+    stats->failures   = usage->failures;
+}
+#endif
 
 
 // MARK: hci_connection_t
@@ -73,22 +112,38 @@ hci_connection_t * btstack_memory_hci_connection_get(void){
 void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
     btstack_memory_pool_free(&hci_connection_pool, hci_connection);
 }
+static void btstack_memory_hci_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_HCI_CONNECTIONS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&hci_connection_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&hci_connection_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&hci_connection_pool);
+}
 #else
+static uint32_t hci_connection_failures;
 hci_connection_t * btstack_memory_hci_connection_get(void){
+    hci_connection_failures++;
     return NULL;
 }
 void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
     // silence compiler warning about unused parameter in a portable way
     (void) hci_connection;
 };
+static void btstack_memory_hci_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = hci_connection_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t hci_connection_usage;
 hci_connection_t * btstack_memory_hci_connection_get(void){
-    return (hci_connection_t*) malloc(sizeof(hci_connection_t));
+    return (hci_connection_t*) btstack_memory_usage_track_get(&hci_connection_usage, malloc(sizeof(hci_connection_t)));
 }
 void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
+    btstack_memory_usage_track_free(&hci_connection_usage, hci_connection);
     free(hci_connection);
 }
+static void btstack_memory_hci_connection_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&hci_connection_usage, stats);
+}
 #endif
 
 
@@ -112,22 +167,38 @@ l2cap_service_t * btstack_memory_l2cap_service_get(void){
 void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
     btstack_memory_pool_free(&l2cap_service_pool, l2cap_service);
 }
+static void btstack_memory_l2cap_service_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_L2CAP_SERVICES;
+    stats->in_use     = btstack_memory_pool_get_in_use(&l2cap_service_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&l2cap_service_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&l2cap_service_pool);
+}
 #else
+static uint32_t l2cap_service_failures;
 l2cap_service_t * btstack_memory_l2cap_service_get(void){
+    l2cap_service_failures++;
     return NULL;
 }
 void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
     // silence compiler warning about unused parameter in a portable way
     (void) l2cap_service;
 };
+static void btstack_memory_l2cap_service_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = l2cap_service_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t l2cap_service_usage;
 l2cap_service_t * btstack_memory_l2cap_service_get(void){
-    return (l2cap_service_t*) malloc(sizeof(l2cap_service_t));
+    return (l2cap_service_t*) btstack_memory_usage_track_get(&l2cap_service_usage, malloc(sizeof(l2cap_service_t)));
 }
 void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
+    btstack_memory_usage_track_free(&l2cap_service_usage, l2cap_service);
     free(l2cap_service);
 }
+static void btstack_memory_l2cap_service_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&l2cap_service_usage, stats);
+}
 #endif
 
 
@@ -150,23 +221,59 @@ l2cap_channel_t * btstack_memory_l2cap_channel_get(void){
 void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
     btstack_memory_pool_free(&l2cap_channel_pool, l2cap_channel);
 }
+static void btstack_memory_l2cap_channel_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_L2CAP_CHANNELS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&l2cap_channel_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&l2cap_channel_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&l2cap_channel_pool);
+}
 #else
+static uint32_t l2cap_channel_failures;
 l2cap_channel_t * btstack_memory_l2cap_channel_get(void){
+    l2cap_channel_failures++;
     return NULL;
 }
 void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
     // silence compiler warning about unused parameter in a portable way
     (void) l2cap_channel;
 };
+static void btstack_memory_l2cap_channel_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = l2cap_channel_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t l2cap_channel_usage;
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+l2cap_channel_t * btstack_memory_l2cap_channel_get(void){
+    return btstack_memory_l2cap_channel_get_for_connection(HCI_CON_HANDLE_INVALID);
+}
+l2cap_channel_t * btstack_memory_l2cap_channel_get_for_connection(hci_con_handle_t con_handle){
+    void * object = btstack_memory_arena_alloc(hci_connection_get_memory_arena(con_handle), sizeof(l2cap_channel_t));
+    return (l2cap_channel_t*) btstack_memory_usage_track_get(&l2cap_channel_usage, object);
+}
+void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
+    btstack_memory_usage_track_free(&l2cap_channel_usage, l2cap_channel);
+    btstack_memory_arena_free(l2cap_channel);
+}
+#else
 l2cap_channel_t * btstack_memory_l2cap_channel_get(void){
-    return (l2cap_channel_t*) malloc(sizeof(l2cap_channel_t));
+    return (l2cap_channel_t*) btstack_memory_usage_track_get(&l2cap_channel_usage, malloc(sizeof(l2cap_channel_t)));
 }
 void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
+    btstack_memory_usage_track_free(&l2cap_channel_usage, l2cap_channel);
     free(l2cap_channel);
 }
 #endif
+static void btstack_memory_l2cap_channel_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&l2cap_channel_usage, stats);
+}
+#endif
+#if !defined(ENABLE_BTSTACK_MEMORY_ARENA) || defined(MAX_NR_L2CAP_CHANNELS)
+l2cap_channel_t * btstack_memory_l2cap_channel_get_for_connection(hci_con_handle_t con_handle){
+    (void) con_handle;
+    return btstack_memory_l2cap_channel_get();
+}
+#endif
 
 
 
@@ -189,22 +296,38 @@ rfcomm_multiplexer_t * btstack_memory_rfcomm_multiplexer_get(void){
 void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multiplexer){
     btstack_memory_pool_free(&rfcomm_multiplexer_pool, rfcomm_multiplexer);
 }
+static void btstack_memory_rfcomm_multiplexer_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_RFCOMM_MULTIPLEXERS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&rfcomm_multiplexer_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&rfcomm_multiplexer_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&rfcomm_multiplexer_pool);
+}
 #else
+static uint32_t rfcomm_multiplexer_failures;
 rfcomm_multiplexer_t * btstack_memory_rfcomm_multiplexer_get(void){
+    rfcomm_multiplexer_failures++;
     return NULL;
 }
 void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multiplexer){
     // silence compiler warning about unused parameter in a portable way
     (void) rfcomm_multiplexer;
 };
+static void btstack_memory_rfcomm_multiplexer_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = rfcomm_multiplexer_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t rfcomm_multiplexer_usage;
 rfcomm_multiplexer_t * btstack_memory_rfcomm_multiplexer_get(void){
-    return (rfcomm_multiplexer_t*) malloc(sizeof(rfcomm_multiplexer_t));
+    return (rfcomm_multiplexer_t*) btstack_memory_usage_track_get(&rfcomm_multiplexer_usage, malloc(sizeof(rfcomm_multiplexer_t)));
 }
 void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multiplexer){
+    btstack_memory_usage_track_free(&rfcomm_multiplexer_usage, rfcomm_multiplexer);
     free(rfcomm_multiplexer);
 }
+static void btstack_memory_rfcomm_multiplexer_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&rfcomm_multiplexer_usage, stats);
+}
 #endif
 
 
@@ -227,22 +350,38 @@ rfcomm_service_t * btstack_memory_rfcomm_service_get(void){
 void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
     btstack_memory_pool_free(&rfcomm_service_pool, rfcomm_service);
 }
+static void btstack_memory_rfcomm_service_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_RFCOMM_SERVICES;
+    stats->in_use     = btstack_memory_pool_get_in_use(&rfcomm_service_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&rfcomm_service_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&rfcomm_service_pool);
+}
 #else
+static uint32_t rfcomm_service_failures;
 rfcomm_service_t * btstack_memory_rfcomm_service_get(void){
+    rfcomm_service_failures++;
     return NULL;
 }
 void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
     // silence compiler warning about unused parameter in a portable way
     (void) rfcomm_service;
 };
+static void btstack_memory_rfcomm_service_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = rfcomm_service_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t rfcomm_service_usage;
 rfcomm_service_t * btstack_memory_rfcomm_service_get(void){
-    return (rfcomm_service_t*) malloc(sizeof(rfcomm_service_t));
+    return (rfcomm_service_t*) btstack_memory_usage_track_get(&rfcomm_service_usage, malloc(sizeof(rfcomm_service_t)));
 }
 void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
+    btstack_memory_usage_track_free(&rfcomm_service_usage, rfcomm_service);
     free(rfcomm_service);
 }
+static void btstack_memory_rfcomm_service_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&rfcomm_service_usage, stats);
+}
 #endif
 
 
@@ -265,23 +404,59 @@ rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void){
 void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
     btstack_memory_pool_free(&rfcomm_channel_pool, rfcomm_channel);
 }
+static void btstack_memory_rfcomm_channel_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_RFCOMM_CHANNELS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&rfcomm_channel_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&rfcomm_channel_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&rfcomm_channel_pool);
+}
 #else
+static uint32_t rfcomm_channel_failures;
 rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void){
+    rfcomm_channel_failures++;
     return NULL;
 }
 void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
     // silence compiler warning about unused parameter in a portable way
     (void) rfcomm_channel;
 };
+static void btstack_memory_rfcomm_channel_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = rfcomm_channel_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t rfcomm_channel_usage;
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
 rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void){
-    return (rfcomm_channel_t*) malloc(sizeof(rfcomm_channel_t));
+    return btstack_memory_rfcomm_channel_get_for_connection(HCI_CON_HANDLE_INVALID);
+}
+rfcomm_channel_t * btstack_memory_rfcomm_channel_get_for_connection(hci_con_handle_t con_handle){
+    void * object = btstack_memory_arena_alloc(hci_connection_get_memory_arena(con_handle), sizeof(rfcomm_channel_t));
+    return (rfcomm_channel_t*) btstack_memory_usage_track_get(&rfcomm_channel_usage, object);
 }
 void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
+    btstack_memory_usage_track_free(&rfcomm_channel_usage, rfcomm_channel);
+    btstack_memory_arena_free(rfcomm_channel);
+}
+#else
+rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void){
+    return (rfcomm_channel_t*) btstack_memory_usage_track_get(&rfcomm_channel_usage, malloc(sizeof(rfcomm_channel_t)));
+}
+void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
+    btstack_memory_usage_track_free(&rfcomm_channel_usage, rfcomm_channel);
     free(rfcomm_channel);
 }
 #endif
+static void btstack_memory_rfcomm_channel_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&rfcomm_channel_usage, stats);
+}
+#endif
+#if !defined(ENABLE_BTSTACK_MEMORY_ARENA) || defined(MAX_NR_RFCOMM_CHANNELS)
+rfcomm_channel_t * btstack_memory_rfcomm_channel_get_for_connection(hci_con_handle_t con_handle){
+    (void) con_handle;
+    return btstack_memory_rfcomm_channel_get();
+}
+#endif
 
 
 
@@ -304,22 +479,38 @@ btstack_link_key_db_memory_entry_t * btstack_memory_btstack_link_key_db_memory_e
 void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_memory_entry_t *btstack_link_key_db_memory_entry){
     btstack_memory_pool_free(&btstack_link_key_db_memory_entry_pool, btstack_link_key_db_memory_entry);
 }
+static void btstack_memory_btstack_link_key_db_memory_entry_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES;
+    stats->in_use     = btstack_memory_pool_get_in_use(&btstack_link_key_db_memory_entry_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&btstack_link_key_db_memory_entry_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&btstack_link_key_db_memory_entry_pool);
+}
 #else
+static uint32_t btstack_link_key_db_memory_entry_failures;
 btstack_link_key_db_memory_entry_t * btstack_memory_btstack_link_key_db_memory_entry_get(void){
+    btstack_link_key_db_memory_entry_failures++;
     return NULL;
 }
 void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_memory_entry_t *btstack_link_key_db_memory_entry){
     // silence compiler warning about unused parameter in a portable way
     (void) btstack_link_key_db_memory_entry;
 };
+static void btstack_memory_btstack_link_key_db_memory_entry_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = btstack_link_key_db_memory_entry_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t btstack_link_key_db_memory_entry_usage;
 btstack_link_key_db_memory_entry_t * btstack_memory_btstack_link_key_db_memory_entry_get(void){
-    return (btstack_link_key_db_memory_entry_t*) malloc(sizeof(btstack_link_key_db_memory_entry_t));
+    return (btstack_link_key_db_memory_entry_t*) btstack_memory_usage_track_get(&btstack_link_key_db_memory_entry_usage, malloc(sizeof(btstack_link_key_db_memory_entry_t)));
 }
 void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_memory_entry_t *btstack_link_key_db_memory_entry){
+    btstack_memory_usage_track_free(&btstack_link_key_db_memory_entry_usage, btstack_link_key_db_memory_entry);
     free(btstack_link_key_db_memory_entry);
 }
+static void btstack_memory_btstack_link_key_db_memory_entry_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&btstack_link_key_db_memory_entry_usage, stats);
+}
 #endif
 
 
@@ -343,22 +534,38 @@ bnep_service_t * btstack_memory_bnep_service_get(void){
 void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
     btstack_memory_pool_free(&bnep_service_pool, bnep_service);
 }
+static void btstack_memory_bnep_service_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_BNEP_SERVICES;
+    stats->in_use     = btstack_memory_pool_get_in_use(&bnep_service_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&bnep_service_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&bnep_service_pool);
+}
 #else
+static uint32_t bnep_service_failures;
 bnep_service_t * btstack_memory_bnep_service_get(void){
+    bnep_service_failures++;
     return NULL;
 }
 void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
     // silence compiler warning about unused parameter in a portable way
     (void) bnep_service;
 };
+static void btstack_memory_bnep_service_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = bnep_service_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t bnep_service_usage;
 bnep_service_t * btstack_memory_bnep_service_get(void){
-    return (bnep_service_t*) malloc(sizeof(bnep_service_t));
+    return (bnep_service_t*) btstack_memory_usage_track_get(&bnep_service_usage, malloc(sizeof(bnep_service_t)));
 }
 void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
+    btstack_memory_usage_track_free(&bnep_service_usage, bnep_service);
     free(bnep_service);
 }
+static void btstack_memory_bnep_service_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&bnep_service_usage, stats);
+}
 #endif
 
 
@@ -381,22 +588,38 @@ bnep_channel_t * btstack_memory_bnep_channel_get(void){
 void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
     btstack_memory_pool_free(&bnep_channel_pool, bnep_channel);
 }
+static void btstack_memory_bnep_channel_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_BNEP_CHANNELS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&bnep_channel_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&bnep_channel_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&bnep_channel_pool);
+}
 #else
+static uint32_t bnep_channel_failures;
 bnep_channel_t * btstack_memory_bnep_channel_get(void){
+    bnep_channel_failures++;
     return NULL;
 }
 void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
     // silence compiler warning about unused parameter in a portable way
     (void) bnep_channel;
 };
+static void btstack_memory_bnep_channel_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = bnep_channel_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t bnep_channel_usage;
 bnep_channel_t * btstack_memory_bnep_channel_get(void){
-    return (bnep_channel_t*) malloc(sizeof(bnep_channel_t));
+    return (bnep_channel_t*) btstack_memory_usage_track_get(&bnep_channel_usage, malloc(sizeof(bnep_channel_t)));
 }
 void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
+    btstack_memory_usage_track_free(&bnep_channel_usage, bnep_channel);
     free(bnep_channel);
 }
+static void btstack_memory_bnep_channel_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&bnep_channel_usage, stats);
+}
 #endif
 
 
@@ -420,22 +643,38 @@ hfp_connection_t * btstack_memory_hfp_connection_get(void){
 void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
     btstack_memory_pool_free(&hfp_connection_pool, hfp_connection);
 }
+static void btstack_memory_hfp_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_HFP_CONNECTIONS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&hfp_connection_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&hfp_connection_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&hfp_connection_pool);
+}
 #else
+static uint32_t hfp_connection_failures;
 hfp_connection_t * btstack_memory_hfp_connection_get(void){
+    hfp_connection_failures++;
     return NULL;
 }
 void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
     // silence compiler warning about unused parameter in a portable way
     (void) hfp_connection;
 };
+static void btstack_memory_hfp_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = hfp_connection_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t hfp_connection_usage;
 hfp_connection_t * btstack_memory_hfp_connection_get(void){
-    return (hfp_connection_t*) malloc(sizeof(hfp_connection_t));
+    return (hfp_connection_t*) btstack_memory_usage_track_get(&hfp_connection_usage, malloc(sizeof(hfp_connection_t)));
 }
 void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
+    btstack_memory_usage_track_free(&hfp_connection_usage, hfp_connection);
     free(hfp_connection);
 }
+static void btstack_memory_hfp_connection_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&hfp_connection_usage, stats);
+}
 #endif
 
 
@@ -459,22 +698,38 @@ service_record_item_t * btstack_memory_service_record_item_get(void){
 void btstack_memory_service_record_item_free(service_record_item_t *service_record_item){
     btstack_memory_pool_free(&service_record_item_pool, service_record_item);
 }
+static void btstack_memory_service_record_item_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_SERVICE_RECORD_ITEMS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&service_record_item_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&service_record_item_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&service_record_item_pool);
+}
 #else
+static uint32_t service_record_item_failures;
 service_record_item_t * btstack_memory_service_record_item_get(void){
+    service_record_item_failures++;
     return NULL;
 }
 void btstack_memory_service_record_item_free(service_record_item_t *service_record_item){
     // silence compiler warning about unused parameter in a portable way
     (void) service_record_item;
 };
+static void btstack_memory_service_record_item_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = service_record_item_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t service_record_item_usage;
 service_record_item_t * btstack_memory_service_record_item_get(void){
-    return (service_record_item_t*) malloc(sizeof(service_record_item_t));
+    return (service_record_item_t*) btstack_memory_usage_track_get(&service_record_item_usage, malloc(sizeof(service_record_item_t)));
 }
 void btstack_memory_service_record_item_free(service_record_item_t *service_record_item){
+    btstack_memory_usage_track_free(&service_record_item_usage, service_record_item);
     free(service_record_item);
 }
+static void btstack_memory_service_record_item_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&service_record_item_usage, stats);
+}
 #endif
 
 
@@ -498,22 +753,38 @@ avdtp_stream_endpoint_t * btstack_memory_avdtp_stream_endpoint_get(void){
 void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_stream_endpoint){
     btstack_memory_pool_free(&avdtp_stream_endpoint_pool, avdtp_stream_endpoint);
 }
+static void btstack_memory_avdtp_stream_endpoint_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_AVDTP_STREAM_ENDPOINTS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&avdtp_stream_endpoint_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&avdtp_stream_endpoint_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&avdtp_stream_endpoint_pool);
+}
 #else
+static uint32_t avdtp_stream_endpoint_failures;
 avdtp_stream_endpoint_t * btstack_memory_avdtp_stream_endpoint_get(void){
+    avdtp_stream_endpoint_failures++;
     return NULL;
 }
 void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_stream_endpoint){
     // silence compiler warning about unused parameter in a portable way
     (void) avdtp_stream_endpoint;
 };
+static void btstack_memory_avdtp_stream_endpoint_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = avdtp_stream_endpoint_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t avdtp_stream_endpoint_usage;
 avdtp_stream_endpoint_t * btstack_memory_avdtp_stream_endpoint_get(void){
-    return (avdtp_stream_endpoint_t*) malloc(sizeof(avdtp_stream_endpoint_t));
+    return (avdtp_stream_endpoint_t*) btstack_memory_usage_track_get(&avdtp_stream_endpoint_usage, malloc(sizeof(avdtp_stream_endpoint_t)));
 }
 void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_stream_endpoint){
+    btstack_memory_usage_track_free(&avdtp_stream_endpoint_usage, avdtp_stream_endpoint);
     free(avdtp_stream_endpoint);
 }
+static void btstack_memory_avdtp_stream_endpoint_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&avdtp_stream_endpoint_usage, stats);
+}
 #endif
 
 
@@ -537,22 +808,38 @@ avdtp_connection_t * btstack_memory_avdtp_connection_get(void){
 void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
     btstack_memory_pool_free(&avdtp_connection_pool, avdtp_connection);
 }
+static void btstack_memory_avdtp_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_AVDTP_CONNECTIONS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&avdtp_connection_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&avdtp_connection_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&avdtp_connection_pool);
+}
 #else
+static uint32_t avdtp_connection_failures;
 avdtp_connection_t * btstack_memory_avdtp_connection_get(void){
+    avdtp_connection_failures++;
     return NULL;
 }
 void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
     // silence compiler warning about unused parameter in a portable way
     (void) avdtp_connection;
 };
+static void btstack_memory_avdtp_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = avdtp_connection_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t avdtp_connection_usage;
 avdtp_connection_t * btstack_memory_avdtp_connection_get(void){
-    return (avdtp_connection_t*) malloc(sizeof(avdtp_connection_t));
+    return (avdtp_connection_t*) btstack_memory_usage_track_get(&avdtp_connection_usage, malloc(sizeof(avdtp_connection_t)));
 }
 void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
+    btstack_memory_usage_track_free(&avdtp_connection_usage, avdtp_connection);
     free(avdtp_connection);
 }
+static void btstack_memory_avdtp_connection_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&avdtp_connection_usage, stats);
+}
 #endif
 
 
@@ -576,22 +863,38 @@ avrcp_connection_t * btstack_memory_avrcp_connection_get(void){
 void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
     btstack_memory_pool_free(&avrcp_connection_pool, avrcp_connection);
 }
+static void btstack_memory_avrcp_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_AVRCP_CONNECTIONS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&avrcp_connection_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&avrcp_connection_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&avrcp_connection_pool);
+}
 #else
+static uint32_t avrcp_connection_failures;
 avrcp_connection_t * btstack_memory_avrcp_connection_get(void){
+    avrcp_connection_failures++;
     return NULL;
 }
 void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
     // silence compiler warning about unused parameter in a portable way
     (void) avrcp_connection;
 };
+static void btstack_memory_avrcp_connection_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = avrcp_connection_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t avrcp_connection_usage;
 avrcp_connection_t * btstack_memory_avrcp_connection_get(void){
-    return (avrcp_connection_t*) malloc(sizeof(avrcp_connection_t));
+    return (avrcp_connection_t*) btstack_memory_usage_track_get(&avrcp_connection_usage, malloc(sizeof(avrcp_connection_t)));
 }
 void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
+    btstack_memory_usage_track_free(&avrcp_connection_usage, avrcp_connection);
     free(avrcp_connection);
 }
+static void btstack_memory_avrcp_connection_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&avrcp_connection_usage, stats);
+}
 #endif
 
 
@@ -616,23 +919,59 @@ gatt_client_t * btstack_memory_gatt_client_get(void){
 void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
     btstack_memory_pool_free(&gatt_client_pool, gatt_client);
 }
+static void btstack_memory_gatt_client_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_GATT_CLIENTS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&gatt_client_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&gatt_client_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&gatt_client_pool);
+}
 #else
+static uint32_t gatt_client_failures;
 gatt_client_t * btstack_memory_gatt_client_get(void){
+    gatt_client_failures++;
     return NULL;
 }
 void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
     // silence compiler warning about unused parameter in a portable way
     (void) gatt_client;
 };
+static void btstack_memory_gatt_client_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = gatt_client_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t gatt_client_usage;
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
 gatt_client_t * btstack_memory_gatt_client_get(void){
-    return (gatt_client_t*) malloc(sizeof(gatt_client_t));
+    return btstack_memory_gatt_client_get_for_connection(HCI_CON_HANDLE_INVALID);
+}
+gatt_client_t * btstack_memory_gatt_client_get_for_connection(hci_con_handle_t con_handle){
+    void * object = btstack_memory_arena_alloc(hci_connection_get_memory_arena(con_handle), sizeof(gatt_client_t));
+    return (gatt_client_t*) btstack_memory_usage_track_get(&gatt_client_usage, object);
 }
 void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
+    btstack_memory_usage_track_free(&gatt_client_usage, gatt_client);
+    btstack_memory_arena_free(gatt_client);
+}
+#else
+gatt_client_t * btstack_memory_gatt_client_get(void){
+    return (gatt_client_t*) btstack_memory_usage_track_get(&gatt_client_usage, malloc(sizeof(gatt_client_t)));
+}
+void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
+    btstack_memory_usage_track_free(&gatt_client_usage, gatt_client);
     free(gatt_client);
 }
 #endif
+static void btstack_memory_gatt_client_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&gatt_client_usage, stats);
+}
+#endif
+#if !defined(ENABLE_BTSTACK_MEMORY_ARENA) || defined(MAX_NR_GATT_CLIENTS)
+gatt_client_t * btstack_memory_gatt_client_get_for_connection(hci_con_handle_t con_handle){
+    (void) con_handle;
+    return btstack_memory_gatt_client_get();
+}
+#endif
 
 
 // MARK: whitelist_entry_t
@@ -654,22 +993,38 @@ whitelist_entry_t * btstack_memory_whitelist_entry_get(void){
 void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
     btstack_memory_pool_free(&whitelist_entry_pool, whitelist_entry);
 }
+static void btstack_memory_whitelist_entry_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_WHITELIST_ENTRIES;
+    stats->in_use     = btstack_memory_pool_get_in_use(&whitelist_entry_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&whitelist_entry_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&whitelist_entry_pool);
+}
 #else
+static uint32_t whitelist_entry_failures;
 whitelist_entry_t * btstack_memory_whitelist_entry_get(void){
+    whitelist_entry_failures++;
     return NULL;
 }
 void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
     // silence compiler warning about unused parameter in a portable way
     (void) whitelist_entry;
 };
+static void btstack_memory_whitelist_entry_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = whitelist_entry_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t whitelist_entry_usage;
 whitelist_entry_t * btstack_memory_whitelist_entry_get(void){
-    return (whitelist_entry_t*) malloc(sizeof(whitelist_entry_t));
+    return (whitelist_entry_t*) btstack_memory_usage_track_get(&whitelist_entry_usage, malloc(sizeof(whitelist_entry_t)));
 }
 void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
+    btstack_memory_usage_track_free(&whitelist_entry_usage, whitelist_entry);
     free(whitelist_entry);
 }
+static void btstack_memory_whitelist_entry_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&whitelist_entry_usage, stats);
+}
 #endif
 
 
@@ -692,22 +1047,112 @@ sm_lookup_entry_t * btstack_memory_sm_lookup_entry_get(void){
 void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
     btstack_memory_pool_free(&sm_lookup_entry_pool, sm_lookup_entry);
 }
+static void btstack_memory_sm_lookup_entry_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_SM_LOOKUP_ENTRIES;
+    stats->in_use     = btstack_memory_pool_get_in_use(&sm_lookup_entry_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&sm_lookup_entry_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&sm_lookup_entry_pool);
+}
 #else
+static uint32_t sm_lookup_entry_failures;
 sm_lookup_entry_t * btstack_memory_sm_lookup_entry_get(void){
+    sm_lookup_entry_failures++;
     return NULL;
 }
 void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
     // silence compiler warning about unused parameter in a portable way
     (void) sm_lookup_entry;
 };
+static void btstack_memory_sm_lookup_entry_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = sm_lookup_entry_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t sm_lookup_entry_usage;
 sm_lookup_entry_t * btstack_memory_sm_lookup_entry_get(void){
-    return (sm_lookup_entry_t*) malloc(sizeof(sm_lookup_entry_t));
+    return (sm_lookup_entry_t*) btstack_memory_usage_track_get(&sm_lookup_entry_usage, malloc(sizeof(sm_lookup_entry_t)));
 }
 void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
+    btstack_memory_usage_track_free(&sm_lookup_entry_usage, sm_lookup_entry);
     free(sm_lookup_entry);
 }
+static void btstack_memory_sm_lookup_entry_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&sm_lookup_entry_usage, stats);
+}
+#endif
+
+
+// MARK: gatt_client_request_t
+#if !defined(HAVE_MALLOC) && !defined(MAX_NR_GATT_CLIENT_REQUESTS)
+    #if defined(MAX_NO_GATT_CLIENT_REQUESTS)
+        #error "Deprecated MAX_NO_GATT_CLIENT_REQUESTS defined instead of MAX_NR_GATT_CLIENT_REQUESTS. Please update your btstack_config.h to use MAX_NR_GATT_CLIENT_REQUESTS."
+    #else
+        #define MAX_NR_GATT_CLIENT_REQUESTS 0
+    #endif
+#endif
+
+#ifdef MAX_NR_GATT_CLIENT_REQUESTS
+#if MAX_NR_GATT_CLIENT_REQUESTS > 0
+static gatt_client_request_t gatt_client_request_storage[MAX_NR_GATT_CLIENT_REQUESTS];
+static btstack_memory_pool_t gatt_client_request_pool;
+gatt_client_request_t * btstack_memory_gatt_client_request_get(void){
+    return (gatt_client_request_t *) btstack_memory_pool_get(&gatt_client_request_pool);
+}
+void btstack_memory_gatt_client_request_free(gatt_client_request_t *gatt_client_request){
+    btstack_memory_pool_free(&gatt_client_request_pool, gatt_client_request);
+}
+static void btstack_memory_gatt_client_request_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = MAX_NR_GATT_CLIENT_REQUESTS;
+    stats->in_use     = btstack_memory_pool_get_in_use(&gatt_client_request_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&gatt_client_request_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&gatt_client_request_pool);
+}
+#else
+static uint32_t gatt_client_request_failures;
+gatt_client_request_t * btstack_memory_gatt_client_request_get(void){
+    gatt_client_request_failures++;
+    return NULL;
+}
+void btstack_memory_gatt_client_request_free(gatt_client_request_t *gatt_client_request){
+    // silence compiler warning about unused parameter in a portable way
+    (void) gatt_client_request;
+};
+static void btstack_memory_gatt_client_request_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = gatt_client_request_failures;
+}
+#endif
+#elif defined(HAVE_MALLOC)
+static btstack_memory_usage_t gatt_client_request_usage;
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+gatt_client_request_t * btstack_memory_gatt_client_request_get(void){
+    return btstack_memory_gatt_client_request_get_for_connection(HCI_CON_HANDLE_INVALID);
+}
+gatt_client_request_t * btstack_memory_gatt_client_request_get_for_connection(hci_con_handle_t con_handle){
+    void * object = btstack_memory_arena_alloc(hci_connection_get_memory_arena(con_handle), sizeof(gatt_client_request_t));
+    return (gatt_client_request_t*) btstack_memory_usage_track_get(&gatt_client_request_usage, object);
+}
+void btstack_memory_gatt_client_request_free(gatt_client_request_t *gatt_client_request){
+    btstack_memory_usage_track_free(&gatt_client_request_usage, gatt_client_request);
+    btstack_memory_arena_free(gatt_client_request);
+}
+#else
+gatt_client_request_t * btstack_memory_gatt_client_request_get(void){
+    return (gatt_client_request_t*) btstack_memory_usage_track_get(&gatt_client_request_usage, malloc(sizeof(gatt_client_request_t)));
+}
+void btstack_memory_gatt_client_request_free(gatt_client_request_t *gatt_client_request){
+    btstack_memory_usage_track_free(&gatt_client_request_usage, gatt_client_request);
+    free(gatt_client_request);
+}
+#endif
+static void btstack_memory_gatt_client_request_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&gatt_client_request_usage, stats);
+}
+#endif
+#if !defined(ENABLE_BTSTACK_MEMORY_ARENA) || defined(MAX_NR_GATT_CLIENT_REQUESTS)
+gatt_client_request_t * btstack_memory_gatt_client_request_get_for_connection(hci_con_handle_t con_handle){
+    (void) con_handle;
+    return btstack_memory_gatt_client_request_get();
+}
 #endif
 
 
@@ -766,5 +1211,128 @@ void btstack_memory_init(void){
 #if MAX_NR_SM_LOOKUP_ENTRIES > 0
     btstack_memory_pool_create(&sm_lookup_entry_pool, sm_lookup_entry_storage, MAX_NR_SM_LOOKUP_ENTRIES, sizeof(sm_lookup_entry_t));
 #endif
-#endif
+#if MAX_NR_GATT_CLIENT_REQUESTS > 0
+    btstack_memory_pool_create(&gatt_client_request_pool, gatt_client_request_storage, MAX_NR_GATT_CLIENT_REQUESTS, sizeof(gatt_client_request_t));
+#endif
+#endif
+}
+
+int btstack_memory_get_stats(btstack_memory_type_t type, btstack_memory_stats_t * stats){
+    memset(stats, 0, sizeof(btstack_memory_stats_t));
+    switch (type){
+        case BTSTACK_MEMORY_TYPE_HCI_CONNECTION:
+            stats->name = "hci_connection";
+            stats->size = sizeof(hci_connection_t);
+            btstack_memory_hci_connection_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_L2CAP_SERVICE:
+            stats->name = "l2cap_service";
+            stats->size = sizeof(l2cap_service_t);
+            btstack_memory_l2cap_service_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_L2CAP_CHANNEL:
+            stats->name = "l2cap_channel";
+            stats->size = sizeof(l2cap_channel_t);
+            btstack_memory_l2cap_channel_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_RFCOMM_MULTIPLEXER:
+            stats->name = "rfcomm_multiplexer";
+            stats->size = sizeof(rfcomm_multiplexer_t);
+            btstack_memory_rfcomm_multiplexer_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_RFCOMM_SERVICE:
+            stats->name = "rfcomm_service";
+            stats->size = sizeof(rfcomm_service_t);
+            btstack_memory_rfcomm_service_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_RFCOMM_CHANNEL:
+            stats->name = "rfcomm_channel";
+            stats->size = sizeof(rfcomm_channel_t);
+            btstack_memory_rfcomm_channel_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_BTSTACK_LINK_KEY_DB_MEMORY_ENTRY:
+            stats->name = "btstack_link_key_db_memory_entry";
+            stats->size = sizeof(btstack_link_key_db_memory_entry_t);
+            btstack_memory_btstack_link_key_db_memory_entry_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_BNEP_SERVICE:
+            stats->name = "bnep_service";
+            stats->size = sizeof(bnep_service_t);
+            btstack_memory_bnep_service_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_BNEP_CHANNEL:
+            stats->name = "bnep_channel";
+            stats->size = sizeof(bnep_channel_t);
+            btstack_memory_bnep_channel_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_HFP_CONNECTION:
+            stats->name = "hfp_connection";
+            stats->size = sizeof(hfp_connection_t);
+            btstack_memory_hfp_connection_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_SERVICE_RECORD_ITEM:
+            stats->name = "service_record_item";
+            stats->size = sizeof(service_record_item_t);
+            btstack_memory_service_record_item_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_AVDTP_STREAM_ENDPOINT:
+            stats->name = "avdtp_stream_endpoint";
+            stats->size = sizeof(avdtp_stream_endpoint_t);
+            btstack_memory_avdtp_stream_endpoint_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_AVDTP_CONNECTION:
+            stats->name = "avdtp_connection";
+            stats->size = sizeof(avdtp_connection_t);
+            btstack_memory_avdtp_connection_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_AVRCP_CONNECTION:
+            stats->name = "avrcp_connection";
+            stats->size = sizeof(avrcp_connection_t);
+            btstack_memory_avrcp_connection_get_stats(stats);
+            return 0;
+#ifdef ENABLE_BLE
+        case BTSTACK_MEMORY_TYPE_GATT_CLIENT:
+            stats->name = "gatt_client";
+            stats->size = sizeof(gatt_client_t);
+            btstack_memory_gatt_client_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_WHITELIST_ENTRY:
+            stats->name = "whitelist_entry";
+            stats->size = sizeof(whitelist_entry_t);
+            btstack_memory_whitelist_entry_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_SM_LOOKUP_ENTRY:
+            stats->name = "sm_lookup_entry";
+            stats->size = sizeof(sm_lookup_entry_t);
+            btstack_memory_sm_lookup_entry_get_stats(stats);
+            return 0;
+        case BTSTACK_MEMORY_TYPE_GATT_CLIENT_REQUEST:
+            stats->name = "gatt_client_request";
+            stats->size = sizeof(gatt_client_request_t);
+            btstack_memory_gatt_client_request_get_stats(stats);
+            return 0;
+#endif
+        default:
+            return -1;
+    }
+}
+
+void btstack_memory_dump_stats(void){
+    btstack_memory_stats_t stats;
+    uint8_t event[15];
+    int type;
+    for (type = 0; type < BTSTACK_MEMORY_TYPE_NUM; type++){
+        if (btstack_memory_get_stats((btstack_memory_type_t) type, &stats)) continue;
+        log_info("%s: size %u, count %u, in use %u, max in use %u, failures %u", stats.name, stats.size,
+            stats.count, stats.in_use, stats.max_in_use, (unsigned int) stats.failures);
+        event[0] = HCI_EVENT_MEMORY_STATISTICS;
+        event[1] = sizeof(event) - 2;
+        event[2] = type;
+        little_endian_store_16(event,  3, stats.size);
+        little_endian_store_16(event,  5, stats.count);
+        little_endian_store_16(event,  7, stats.in_use);
+        little_endian_store_16(event,  9, stats.max_in_use);
+        little_endian_store_32(event, 11, stats.failures);
+        hci_dump_packet(HCI_EVENT_PACKET, 1, event, sizeof(event));
+    }
 }
@@ -74,13 +74,60 @@ extern "C" {
 #include "ble/sm.h"
 #endif
 
+typedef enum {
+    BTSTACK_MEMORY_TYPE_HCI_CONNECTION,
+    BTSTACK_MEMORY_TYPE_L2CAP_SERVICE,
+    BTSTACK_MEMORY_TYPE_L2CAP_CHANNEL,
+    BTSTACK_MEMORY_TYPE_RFCOMM_MULTIPLEXER,
+    BTSTACK_MEMORY_TYPE_RFCOMM_SERVICE,
+    BTSTACK_MEMORY_TYPE_RFCOMM_CHANNEL,
+    BTSTACK_MEMORY_TYPE_BTSTACK_LINK_KEY_DB_MEMORY_ENTRY,
+    BTSTACK_MEMORY_TYPE_BNEP_SERVICE,
+    BTSTACK_MEMORY_TYPE_BNEP_CHANNEL,
+    BTSTACK_MEMORY_TYPE_HFP_CONNECTION,
+    BTSTACK_MEMORY_TYPE_SERVICE_RECORD_ITEM,
+    BTSTACK_MEMORY_TYPE_AVDTP_STREAM_ENDPOINT,
+    BTSTACK_MEMORY_TYPE_AVDTP_CONNECTION,
+    BTSTACK_MEMORY_TYPE_AVRCP_CONNECTION,
+    BTSTACK_MEMORY_TYPE_GATT_CLIENT,
+    BTSTACK_MEMORY_TYPE_WHITELIST_ENTRY,
+    BTSTACK_MEMORY_TYPE_SM_LOOKUP_ENTRY,
+    BTSTACK_MEMORY_TYPE_GATT_CLIENT_REQUEST,
+    BTSTACK_MEMORY_TYPE_NUM
+} btstack_memory_type_t;
+
 /* API_START */
 
+/**
+ * @brief Usage of a memory type
+ */
+typedef struct {
+    const char * name;
+    uint16_t size;          // size of single object
+    uint16_t count;         // size of memory pool, 0 if allocated via malloc
+    uint16_t in_use;
+    uint16_t max_in_use;
+    uint32_t failures;      // failed allocations
+} btstack_memory_stats_t;
+
 /**
  * @brief Initializes BTstack memory pools.
  */
 void btstack_memory_init(void);
 
+/**
+ * @brief Get usage of memory type
+ * @param type
+ * @param stats
+ * @return 0 if ok, -1 if type is not available
+ */
+int btstack_memory_get_stats(btstack_memory_type_t type, btstack_memory_stats_t * stats);
+
+/**
+ * @brief Log usage of all memory types and add HCI_EVENT_MEMORY_STATISTICS event for each to the packet log
+ */
+void btstack_memory_dump_stats(void);
+
 /* API_END */
 
 // hci_connection
@@ -92,6 +139,7 @@ l2cap_service_t * btstack_memory_l2cap_service_get(void);
 void   btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service);
 l2cap_channel_t * btstack_memory_l2cap_channel_get(void);
 void   btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel);
+l2cap_channel_t * btstack_memory_l2cap_channel_get_for_connection(hci_con_handle_t con_handle);
 
 // rfcomm_multiplexer, rfcomm_service, rfcomm_channel
 rfcomm_multiplexer_t * btstack_memory_rfcomm_multiplexer_get(void);
@@ -100,6 +148,7 @@ rfcomm_service_t * btstack_memory_rfcomm_service_get(void);
 void   btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service);
 rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void);
 void   btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel);
+rfcomm_channel_t * btstack_memory_rfcomm_channel_get_for_connection(hci_con_handle_t con_handle);
 
 // btstack_link_key_db_memory_entry
 btstack_link_key_db_memory_entry_t * btstack_memory_btstack_link_key_db_memory_entry_get(void);
@@ -132,13 +181,17 @@ avrcp_connection_t * btstack_memory_avrcp_connection_get(void);
 void   btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection);
 
 #ifdef ENABLE_BLE
-// gatt_client, whitelist_entry, sm_lookup_entry
+// gatt_client, whitelist_entry, sm_lookup_entry, gatt_client_request
 gatt_client_t * btstack_memory_gatt_client_get(void);
 void   btstack_memory_gatt_client_free(gatt_client_t *gatt_client);
+gatt_client_t * btstack_memory_gatt_client_get_for_connection(hci_con_handle_t con_handle);
 whitelist_entry_t * btstack_memory_whitelist_entry_get(void);
 void   btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry);
 sm_lookup_entry_t * btstack_memory_sm_lookup_entry_get(void);
 void   btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry);
+gatt_client_request_t * btstack_memory_gatt_client_request_get(void);
+void   btstack_memory_gatt_client_request_free(gatt_client_request_t *gatt_client_request);
+gatt_client_request_t * btstack_memory_gatt_client_request_get_for_connection(hci_con_handle_t con_handle);
 #endif
 
 #if defined __cplusplus
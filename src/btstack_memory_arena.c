@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define __BTSTACK_FILE__ "btstack_memory_arena.c"
+
+/*
+ *  btstack_memory_arena.c
+ *
+ *  Each object is preceded by a header that points to its arena. Free objects are kept in a singly linked list.
+ */
+
+#include "btstack_memory_arena.h"
+#include "btstack_debug.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef HAVE_MALLOC
+
+#define BTSTACK_MEMORY_ARENA_ALIGNMENT 8
+#define BTSTACK_MEMORY_ARENA_ALIGN(size) (((size) + BTSTACK_MEMORY_ARENA_ALIGNMENT - 1) & ~(BTSTACK_MEMORY_ARENA_ALIGNMENT - 1))
+
+typedef struct btstack_memory_arena_chunk {
+    struct btstack_memory_arena_chunk * next;
+} btstack_memory_arena_chunk_t;
+
+typedef struct btstack_memory_arena_header {
+    // NULL if allocated from heap
+    btstack_memory_arena_t * arena;
+    // next free object in arena
+    struct btstack_memory_arena_header * next;
+    uint16_t size;
+} btstack_memory_arena_header_t;
+
+struct btstack_memory_arena {
+    btstack_memory_arena_chunk_t  * chunks;
+    btstack_memory_arena_header_t * free_objects;
+    // unused space in current chunk
+    uint8_t * unused_pos;
+    uint32_t  unused_len;
+    uint16_t  in_use;
+    // owner is gone, destroy when last object is freed
+    uint8_t   released;
+};
+
+#define BTSTACK_MEMORY_ARENA_HEADER_SIZE BTSTACK_MEMORY_ARENA_ALIGN(sizeof(btstack_memory_arena_header_t))
+#define BTSTACK_MEMORY_ARENA_CHUNK_HEADER_SIZE BTSTACK_MEMORY_ARENA_ALIGN(sizeof(btstack_memory_arena_chunk_t))
+
+static void btstack_memory_arena_destroy(btstack_memory_arena_t * arena){
+    btstack_memory_arena_chunk_t * chunk = arena->chunks;
+    while (chunk){
+        btstack_memory_arena_chunk_t * next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+static int btstack_memory_arena_add_chunk(btstack_memory_arena_t * arena, uint32_t object_len){
+    uint32_t chunk_len = BTSTACK_MEMORY_ARENA_CHUNK_HEADER_SIZE + object_len;
+    if (chunk_len < BTSTACK_MEMORY_ARENA_CHUNK_SIZE){
+        chunk_len = BTSTACK_MEMORY_ARENA_CHUNK_SIZE;
+    }
+    btstack_memory_arena_chunk_t * chunk = (btstack_memory_arena_chunk_t *) malloc(chunk_len);
+    if (!chunk) return -1;
+    chunk->next   = arena->chunks;
+    arena->chunks = chunk;
+    arena->unused_pos = ((uint8_t *) chunk) + BTSTACK_MEMORY_ARENA_CHUNK_HEADER_SIZE;
+    arena->unused_len = chunk_len - BTSTACK_MEMORY_ARENA_CHUNK_HEADER_SIZE;
+    return 0;
+}
+
+btstack_memory_arena_t * btstack_memory_arena_create(void){
+    btstack_memory_arena_t * arena = (btstack_memory_arena_t *) malloc(sizeof(btstack_memory_arena_t));
+    if (!arena) return NULL;
+    arena->chunks       = NULL;
+    arena->free_objects = NULL;
+    arena->unused_pos   = NULL;
+    arena->unused_len   = 0;
+    arena->in_use       = 0;
+    arena->released     = 0;
+    return arena;
+}
+
+void * btstack_memory_arena_alloc(btstack_memory_arena_t * arena, uint16_t size){
+    btstack_memory_arena_header_t * header;
+
+    if (!arena){
+        header = (btstack_memory_arena_header_t *) malloc(BTSTACK_MEMORY_ARENA_HEADER_SIZE + size);
+        if (!header) return NULL;
+        header->arena = NULL;
+        header->size  = size;
+        return ((uint8_t *) header) + BTSTACK_MEMORY_ARENA_HEADER_SIZE;
+    }
+
+    // reuse free object of same size
+    btstack_memory_arena_header_t ** it;
+    for (it = &arena->free_objects; *it ; it = &(*it)->next){
+        if ((*it)->size != size) continue;
+        header = *it;
+        *it = header->next;
+        arena->in_use++;
+        return ((uint8_t *) header) + BTSTACK_MEMORY_ARENA_HEADER_SIZE;
+    }
+
+    // take from current chunk
+    uint32_t object_len = BTSTACK_MEMORY_ARENA_HEADER_SIZE + BTSTACK_MEMORY_ARENA_ALIGN(size);
+    if (arena->unused_len < object_len){
+        if (btstack_memory_arena_add_chunk(arena, object_len)) return NULL;
+    }
+    header = (btstack_memory_arena_header_t *) arena->unused_pos;
+    arena->unused_pos += object_len;
+    arena->unused_len -= object_len;
+    header->arena = arena;
+    header->size  = size;
+    arena->in_use++;
+    return ((uint8_t *) header) + BTSTACK_MEMORY_ARENA_HEADER_SIZE;
+}
+
+void btstack_memory_arena_free(void * object){
+    if (!object) return;
+    btstack_memory_arena_header_t * header = (btstack_memory_arena_header_t *) (((uint8_t *) object) - BTSTACK_MEMORY_ARENA_HEADER_SIZE);
+    btstack_memory_arena_t * arena = header->arena;
+    if (!arena){
+        free(header);
+        return;
+    }
+    header->next = arena->free_objects;
+    arena->free_objects = header;
+    arena->in_use--;
+    if (arena->released && arena->in_use == 0){
+        btstack_memory_arena_destroy(arena);
+    }
+}
+
+void btstack_memory_arena_release(btstack_memory_arena_t * arena){
+    if (!arena) return;
+    if (arena->in_use){
+        log_info("btstack_memory_arena_release: %u objects still in use, release when freed", arena->in_use);
+        arena->released = 1;
+        return;
+    }
+    btstack_memory_arena_destroy(arena);
+}
+
+uint16_t btstack_memory_arena_get_in_use(btstack_memory_arena_t * arena){
+    return arena->in_use;
+}
+
+#endif
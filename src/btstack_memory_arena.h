@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ *  btstack_memory_arena.h
+ *
+ *  @brief Arena allocator for objects that belong to a single HCI connection
+ *
+ *  Objects are allocated from larger chunks owned by the arena. Freed objects are kept by the arena
+ *  and reused for objects of the same size. All chunks are released together with the arena.
+ *  If objects are still in use when the arena is released, the chunks are kept until the last
+ *  object has been freed.
+ *
+ *  Requires HAVE_MALLOC
+ */
+
+#ifndef __BTSTACK_MEMORY_ARENA_H
+#define __BTSTACK_MEMORY_ARENA_H
+
+#include <stdint.h>
+
+#include "btstack_config.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// size of chunks allocated by an arena
+#ifndef BTSTACK_MEMORY_ARENA_CHUNK_SIZE
+#define BTSTACK_MEMORY_ARENA_CHUNK_SIZE 1024
+#endif
+
+typedef struct btstack_memory_arena btstack_memory_arena_t;
+
+/**
+ * @brief Create arena
+ * @return arena or NULL if no memory
+ */
+btstack_memory_arena_t * btstack_memory_arena_create(void);
+
+/**
+ * @brief Allocate object from arena
+ * @param arena or NULL to allocate object from heap
+ * @param size of object
+ * @return object or NULL if no memory
+ */
+void * btstack_memory_arena_alloc(btstack_memory_arena_t * arena, uint16_t size);
+
+/**
+ * @brief Free object allocated with btstack_memory_arena_alloc
+ * @param object
+ */
+void btstack_memory_arena_free(void * object);
+
+/**
+ * @brief Release arena and all its chunks
+ * @param arena
+ */
+void btstack_memory_arena_release(btstack_memory_arena_t * arena);
+
+/**
+ * @brief Get number of objects in use
+ * @param arena
+ */
+uint16_t btstack_memory_arena_get_in_use(btstack_memory_arena_t * arena);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __BTSTACK_MEMORY_ARENA_H
@@ -53,47 +53,115 @@
 
 typedef struct node {
     struct node * next;
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+    uintptr_t     tag;
+#endif
 } node_t;
 
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+#define BTSTACK_MEMORY_POOL_FREE_TAG 0x46524545u    // 'FREE'
+
+static uintptr_t btstack_memory_pool_free_tag(btstack_memory_pool_t *pool){
+    return ((uintptr_t) pool) ^ BTSTACK_MEMORY_POOL_FREE_TAG;
+}
+
+// @returns 1 if block can be returned to pool
+static int btstack_memory_pool_block_valid(btstack_memory_pool_t *pool, void * block){
+    uint8_t * ptr = (uint8_t *) block;
+    if (ptr < pool->storage || ptr >= pool->storage + (pool->count * pool->block_size)){
+        log_error("btstack_memory_pool_free: block %p not part of pool %p", block, pool);
+        return 0;
+    }
+    if (((ptr - pool->storage) % pool->block_size) != 0){
+        log_error("btstack_memory_pool_free: block %p not aligned for pool %p", block, pool);
+        return 0;
+    }
+    if (pool->tag_free_blocks && ((node_t *) block)->tag == btstack_memory_pool_free_tag(pool)){
+        log_error("btstack_memory_pool_free: block %p freed twice for pool %p", block, pool);
+        return 0;
+    }
+    return 1;
+}
+#endif
+
+static void btstack_memory_pool_add(btstack_memory_pool_t *pool, node_t * node){
+    node->next = (node_t *) pool->free_blocks;
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+    if (pool->tag_free_blocks){
+        node->tag = btstack_memory_pool_free_tag(pool);
+    }
+#endif
+    pool->free_blocks = node;
+}
+
 void btstack_memory_pool_create(btstack_memory_pool_t *pool, void * storage, int count, int block_size){
-    node_t *free_blocks = (node_t*) pool;
     char   *mem_ptr = (char *) storage;
     int i;
-    
+
+    pool->free_blocks = NULL;
+    pool->count       = count;
+    pool->in_use      = 0;
+    pool->max_in_use  = 0;
+    pool->failures    = 0;
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+    pool->storage     = (uint8_t *) storage;
+    pool->block_size  = block_size;
+    pool->tag_free_blocks = block_size >= (int) sizeof(node_t);
+#endif
+
     // create singly linked list of all available blocks
-    free_blocks->next = NULL;
     for (i = 0 ; i < count ; i++){
-        btstack_memory_pool_free(pool, mem_ptr);
+        btstack_memory_pool_add(pool, (node_t *) mem_ptr);
         mem_ptr += block_size;
     }
 }
 
 void * btstack_memory_pool_get(btstack_memory_pool_t *pool){
-    node_t *free_blocks = (node_t*) pool;
-    
-    if (!free_blocks->next) return NULL;
-    
+    node_t *node = (node_t *) pool->free_blocks;
+
+    if (!node) {
+        pool->failures++;
+        return NULL;
+    }
+
     // remove first
-    node_t *node      = free_blocks->next;
-    free_blocks->next = node->next;
-    
+    pool->free_blocks = node->next;
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+    if (pool->tag_free_blocks){
+        node->tag = 0;
+    }
+#endif
+
+    pool->in_use++;
+    if (pool->in_use > pool->max_in_use){
+        pool->max_in_use = pool->in_use;
+    }
     return (void*) node;
 }
 
 void btstack_memory_pool_free(btstack_memory_pool_t *pool, void * block){
-    node_t *free_blocks = (node_t*) pool;
-    node_t *node        = (node_t*) block;
-
-    // raise error and abort if node already in list
-    node_t * it;
-    for (it = free_blocks->next; it ; it = it->next){
-        if (it == node) {
-            log_error("btstack_memory_pool_free: block %p freed twice for pool %p", block, pool);
-            return;
-        }
-    }
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+    // raise error and abort if block is not in use
+    if (!btstack_memory_pool_block_valid(pool, block)) return;
+#endif
 
     // add block as node to list
-    node->next          = free_blocks->next;
-    free_blocks->next   = node;
+    btstack_memory_pool_add(pool, (node_t *) block);
+    pool->in_use--;
+}
+
+uint16_t btstack_memory_pool_get_count(btstack_memory_pool_t *pool){
+    return pool->count;
+}
+
+uint16_t btstack_memory_pool_get_in_use(btstack_memory_pool_t *pool){
+    return pool->in_use;
+}
+
+uint16_t btstack_memory_pool_get_max_in_use(btstack_memory_pool_t *pool){
+    return pool->max_in_use;
+}
+
+uint32_t btstack_memory_pool_get_failures(btstack_memory_pool_t *pool){
+    return pool->failures;
 }
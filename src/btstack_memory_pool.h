@@ -43,17 +43,36 @@
  *  @Assumption block_size >= sizeof(void *)
  *  @Assumption size of storage >= count * block_size
  *
- *  @Note minimal implementation, no error checking/handling
+ *  @Note get and free are O(1). With ENABLE_BTSTACK_MEMORY_POOL_DEBUG, blocks passed to free
+ *        are checked to be part of the pool and not already free.
  */
 
 #ifndef __btstack_memory_pool_H
 #define __btstack_memory_pool_H
 
+#include <stdint.h>
+
+#include "btstack_config.h"
+
 #if defined __cplusplus
 extern "C" {
 #endif
 
-typedef void * btstack_memory_pool_t;
+typedef struct {
+    // singly linked list of free blocks
+    void *   free_blocks;
+#ifdef ENABLE_BTSTACK_MEMORY_POOL_DEBUG
+    uint8_t * storage;
+    uint16_t  block_size;
+    // free blocks are tagged if block_size allows for it
+    uint8_t   tag_free_blocks;
+#endif
+    // statistics
+    uint16_t count;
+    uint16_t in_use;
+    uint16_t max_in_use;
+    uint32_t failures;
+} btstack_memory_pool_t;
 
 // initialize memory pool with with given storage, block size and count
 void   btstack_memory_pool_create(btstack_memory_pool_t *pool, void * storage, int count, int block_size);
@@ -64,6 +83,18 @@ void * btstack_memory_pool_get(btstack_memory_pool_t *pool);
 // return previously reserved block to memory pool
 void   btstack_memory_pool_free(btstack_memory_pool_t *pool, void * block);
 
+// @returns number of blocks in pool
+uint16_t btstack_memory_pool_get_count(btstack_memory_pool_t *pool);
+
+// @returns number of blocks currently in use
+uint16_t btstack_memory_pool_get_in_use(btstack_memory_pool_t *pool);
+
+// @returns max number of blocks in use at the same time
+uint16_t btstack_memory_pool_get_max_in_use(btstack_memory_pool_t *pool);
+
+// @returns number of failed calls to btstack_memory_pool_get
+uint32_t btstack_memory_pool_get_failures(btstack_memory_pool_t *pool);
+
 #if defined __cplusplus
 }
 #endif
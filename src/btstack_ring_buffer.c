@@ -51,6 +51,28 @@
 
 #define ERROR_CODE_MEMORY_CAPACITY_EXCEEDED 0x07
 
+// index access for single producer / single consumer ring buffer
+#ifdef __GNUC__
+#define RING_BUFFER_SPSC_LOAD(index)        __atomic_load_n(index, __ATOMIC_ACQUIRE)
+#define RING_BUFFER_SPSC_STORE(index, value) __atomic_store_n(index, value, __ATOMIC_RELEASE)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+// aligned 32-bit access is atomic on supported MCUs, volatile prevents caching in registers,
+// fences order index access with the memcpy of the data
+#include <stdatomic.h>
+static inline uint32_t btstack_ring_buffer_spsc_load(uint32_t * index){
+    uint32_t value = *(volatile uint32_t *) index;
+    atomic_thread_fence(memory_order_acquire);
+    return value;
+}
+static inline void btstack_ring_buffer_spsc_store(uint32_t * index, uint32_t value){
+    atomic_thread_fence(memory_order_release);
+    *(volatile uint32_t *) index = value;
+}
+#define RING_BUFFER_SPSC_LOAD(index)        btstack_ring_buffer_spsc_load(index)
+#define RING_BUFFER_SPSC_STORE(index, value) btstack_ring_buffer_spsc_store(index, value)
+#else
+#error "btstack_ring_buffer_spsc requires GCC/Clang __atomic builtins or C11 atomics"
+#endif
 
 // init ring buffer
 void btstack_ring_buffer_init(btstack_ring_buffer_t * ring_buffer, uint8_t * storage, uint32_t storage_size){
@@ -59,6 +81,12 @@ void btstack_ring_buffer_init(btstack_ring_buffer_t * ring_buffer, uint8_t * sto
     ring_buffer->last_read_index = 0;
     ring_buffer->last_written_index = 0;   
     ring_buffer->full = 0;
+    ring_buffer->mirrored = 0;
+}
+
+void btstack_ring_buffer_init_mirrored(btstack_ring_buffer_t * ring_buffer, uint8_t * storage, uint32_t storage_size){
+    btstack_ring_buffer_init(ring_buffer, storage, storage_size);
+    ring_buffer->mirrored = 1;
 }
 
 uint32_t btstack_ring_buffer_bytes_available(btstack_ring_buffer_t * ring_buffer){
@@ -78,6 +106,34 @@ uint32_t btstack_ring_buffer_bytes_free(btstack_ring_buffer_t * ring_buffer){
     return ring_buffer->size - btstack_ring_buffer_bytes_available(ring_buffer);
 }
 
+uint32_t btstack_ring_buffer_bytes_free_contiguous(btstack_ring_buffer_t * ring_buffer){
+    uint32_t bytes_free = btstack_ring_buffer_bytes_free(ring_buffer);
+    if (ring_buffer->mirrored) return bytes_free;
+    return btstack_min(bytes_free, ring_buffer->size - ring_buffer->last_written_index);
+}
+
+static void btstack_ring_buffer_advance_write(btstack_ring_buffer_t * ring_buffer, uint32_t length){
+    if (length == 0) return;
+    ring_buffer->last_written_index += length;
+    if (ring_buffer->last_written_index >= ring_buffer->size){
+        ring_buffer->last_written_index -= ring_buffer->size;
+    }
+    // mark buffer as full
+    if (ring_buffer->last_written_index == ring_buffer->last_read_index){
+        ring_buffer->full = 1;
+    }
+}
+
+static void btstack_ring_buffer_advance_read(btstack_ring_buffer_t * ring_buffer, uint32_t length){
+    if (length == 0) return;
+    ring_buffer->last_read_index += length;
+    if (ring_buffer->last_read_index >= ring_buffer->size){
+        ring_buffer->last_read_index -= ring_buffer->size;
+    }
+    // clear full flag
+    ring_buffer->full = 0;
+}
+
 // add byte block to ring buffer, 
 int btstack_ring_buffer_write(btstack_ring_buffer_t * ring_buffer, uint8_t * data, uint32_t data_length){
     if (btstack_ring_buffer_bytes_free(ring_buffer) < data_length){
@@ -91,25 +147,13 @@ int btstack_ring_buffer_write(btstack_ring_buffer_t * ring_buffer, uint8_t * dat
     unsigned int bytes_until_end = ring_buffer->size - ring_buffer->last_written_index;
     unsigned int bytes_to_copy = btstack_min(bytes_until_end, data_length);
     memcpy(&ring_buffer->storage[ring_buffer->last_written_index], data, bytes_to_copy);
-    data_length -= bytes_to_copy;
-    data += bytes_to_copy;
-
-    // update last written index
-    ring_buffer->last_written_index += bytes_to_copy;
-    if (ring_buffer->last_written_index == ring_buffer->size){
-        ring_buffer->last_written_index = 0;
-    }
 
     // copy second chunk
-    if (data_length) {
-        memcpy(&ring_buffer->storage[0], data, data_length);
-        ring_buffer->last_written_index += data_length;
+    if (data_length > bytes_to_copy) {
+        memcpy(&ring_buffer->storage[0], &data[bytes_to_copy], data_length - bytes_to_copy);
     }
 
-    // mark buffer as full
-    if (ring_buffer->last_written_index == ring_buffer->last_read_index){
-        ring_buffer->full = 1;
-    }
+    btstack_ring_buffer_advance_write(ring_buffer, data_length);
     return 0;
 } 
 
@@ -126,22 +170,114 @@ void btstack_ring_buffer_read(btstack_ring_buffer_t * ring_buffer, uint8_t * dat
     unsigned int bytes_until_end = ring_buffer->size - ring_buffer->last_read_index;
     unsigned int bytes_to_copy = btstack_min(bytes_until_end, data_length);
     memcpy(data, &ring_buffer->storage[ring_buffer->last_read_index], bytes_to_copy);
-    data_length -= bytes_to_copy;
-    data += bytes_to_copy;
-
-    // update last read index
-    ring_buffer->last_read_index += bytes_to_copy;
-    if (ring_buffer->last_read_index == ring_buffer->size){
-        ring_buffer->last_read_index = 0;
-    }
 
     // copy second chunk
-    if (data_length) {
-        memcpy(data, &ring_buffer->storage[0], data_length);
-        ring_buffer->last_read_index += data_length;
+    if (data_length > bytes_to_copy) {
+        memcpy(&data[bytes_to_copy], &ring_buffer->storage[0], data_length - bytes_to_copy);
     }
 
-    // clear full flag
-    ring_buffer->full = 0;
+    btstack_ring_buffer_advance_read(ring_buffer, data_length);
 } 
 
+uint8_t * btstack_ring_buffer_reserve(btstack_ring_buffer_t * ring_buffer, uint32_t length){
+    if (btstack_ring_buffer_bytes_free_contiguous(ring_buffer) < length) return NULL;
+    return &ring_buffer->storage[ring_buffer->last_written_index];
+}
+
+void btstack_ring_buffer_commit(btstack_ring_buffer_t * ring_buffer, uint32_t length){
+    btstack_ring_buffer_advance_write(ring_buffer, btstack_min(length, btstack_ring_buffer_bytes_free(ring_buffer)));
+}
+
+uint8_t * btstack_ring_buffer_peek_contiguous(btstack_ring_buffer_t * ring_buffer, uint32_t * length){
+    uint32_t bytes_available = btstack_ring_buffer_bytes_available(ring_buffer);
+    if (!ring_buffer->mirrored){
+        bytes_available = btstack_min(bytes_available, ring_buffer->size - ring_buffer->last_read_index);
+    }
+    *length = bytes_available;
+    return &ring_buffer->storage[ring_buffer->last_read_index];
+}
+
+void btstack_ring_buffer_consume(btstack_ring_buffer_t * ring_buffer, uint32_t length){
+    btstack_ring_buffer_advance_read(ring_buffer, btstack_min(length, btstack_ring_buffer_bytes_available(ring_buffer)));
+}
+
+// single producer / single consumer: producer only writes write_index, consumer only writes read_index
+
+int btstack_ring_buffer_spsc_init(btstack_ring_buffer_spsc_t * ring_buffer, uint8_t * storage, uint32_t storage_size){
+    if (storage_size == 0 || (storage_size & (storage_size - 1))) return -1;
+    ring_buffer->storage = storage;
+    ring_buffer->size = storage_size;
+    ring_buffer->read_index = 0;
+    ring_buffer->write_index = 0;
+    return 0;
+}
+
+uint32_t btstack_ring_buffer_spsc_bytes_available(btstack_ring_buffer_spsc_t * ring_buffer){
+    uint32_t read_index = RING_BUFFER_SPSC_LOAD(&ring_buffer->read_index);
+    return RING_BUFFER_SPSC_LOAD(&ring_buffer->write_index) - read_index;
+}
+
+uint32_t btstack_ring_buffer_spsc_bytes_free(btstack_ring_buffer_spsc_t * ring_buffer){
+    uint32_t write_index = RING_BUFFER_SPSC_LOAD(&ring_buffer->write_index);
+    return ring_buffer->size - (write_index - RING_BUFFER_SPSC_LOAD(&ring_buffer->read_index));
+}
+
+int btstack_ring_buffer_spsc_write(btstack_ring_buffer_spsc_t * ring_buffer, const uint8_t * data, uint32_t data_length){
+    uint32_t write_index = ring_buffer->write_index;
+    uint32_t bytes_free  = ring_buffer->size - (write_index - RING_BUFFER_SPSC_LOAD(&ring_buffer->read_index));
+    if (bytes_free < data_length){
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    uint32_t offset = write_index & (ring_buffer->size - 1);
+    uint32_t bytes_to_copy = btstack_min(ring_buffer->size - offset, data_length);
+    memcpy(&ring_buffer->storage[offset], data, bytes_to_copy);
+    if (data_length > bytes_to_copy){
+        memcpy(&ring_buffer->storage[0], &data[bytes_to_copy], data_length - bytes_to_copy);
+    }
+
+    // publish data
+    RING_BUFFER_SPSC_STORE(&ring_buffer->write_index, write_index + data_length);
+    return 0;
+}
+
+void btstack_ring_buffer_spsc_read(btstack_ring_buffer_spsc_t * ring_buffer, uint8_t * data, uint32_t data_length, uint32_t * number_of_bytes_read){
+    uint32_t read_index = ring_buffer->read_index;
+    data_length = btstack_min(data_length, RING_BUFFER_SPSC_LOAD(&ring_buffer->write_index) - read_index);
+    *number_of_bytes_read = data_length;
+    if (data_length == 0) return;
+
+    uint32_t offset = read_index & (ring_buffer->size - 1);
+    uint32_t bytes_to_copy = btstack_min(ring_buffer->size - offset, data_length);
+    memcpy(data, &ring_buffer->storage[offset], bytes_to_copy);
+    if (data_length > bytes_to_copy){
+        memcpy(&data[bytes_to_copy], &ring_buffer->storage[0], data_length - bytes_to_copy);
+    }
+
+    // release space
+    RING_BUFFER_SPSC_STORE(&ring_buffer->read_index, read_index + data_length);
+}
+
+uint8_t * btstack_ring_buffer_spsc_reserve(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t length){
+    uint32_t write_index = ring_buffer->write_index;
+    uint32_t bytes_free  = ring_buffer->size - (write_index - RING_BUFFER_SPSC_LOAD(&ring_buffer->read_index));
+    uint32_t offset = write_index & (ring_buffer->size - 1);
+    if (btstack_min(bytes_free, ring_buffer->size - offset) < length) return NULL;
+    return &ring_buffer->storage[offset];
+}
+
+void btstack_ring_buffer_spsc_commit(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t length){
+    RING_BUFFER_SPSC_STORE(&ring_buffer->write_index, ring_buffer->write_index + length);
+}
+
+uint8_t * btstack_ring_buffer_spsc_peek_contiguous(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t * length){
+    uint32_t read_index = ring_buffer->read_index;
+    uint32_t bytes_available = RING_BUFFER_SPSC_LOAD(&ring_buffer->write_index) - read_index;
+    uint32_t offset = read_index & (ring_buffer->size - 1);
+    *length = btstack_min(bytes_available, ring_buffer->size - offset);
+    return &ring_buffer->storage[offset];
+}
+
+void btstack_ring_buffer_spsc_consume(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t length){
+    RING_BUFFER_SPSC_STORE(&ring_buffer->read_index, ring_buffer->read_index + length);
+}
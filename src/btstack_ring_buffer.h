@@ -54,8 +54,17 @@ typedef struct btstack_ring_buffer {
     uint32_t last_read_index;
     uint32_t last_written_index;
     uint8_t  full;
+    uint8_t  mirrored;
 } btstack_ring_buffer_t;
 
+// lock-free ring buffer for one producer and one consumer thread, indices are free running
+typedef struct btstack_ring_buffer_spsc {
+    uint8_t  * storage;
+    uint32_t size;
+    uint32_t read_index;
+    uint32_t write_index;
+} btstack_ring_buffer_spsc_t;
+
 /**
  * Init ring buffer
  * @param ring_buffer object
@@ -64,6 +73,15 @@ typedef struct btstack_ring_buffer {
  */
 void btstack_ring_buffer_init(btstack_ring_buffer_t * ring_buffer, uint8_t * storage, uint32_t storage_size);
 
+/**
+ * Init ring buffer with mirrored storage: storage_size bytes following the storage map to the same memory,
+ * e.g. provided by btstack_ring_buffer_mirror_alloc on Linux. Reserved and peeked data is then always contiguous
+ * @param ring_buffer object
+ * @param storage
+ * @param storage_size in bytes
+ */
+void btstack_ring_buffer_init_mirrored(btstack_ring_buffer_t * ring_buffer, uint8_t * storage, uint32_t storage_size);
+
 /**
  * Check if ring buffer is empty
  * @param ring_buffer object
@@ -85,6 +103,13 @@ uint32_t btstack_ring_buffer_bytes_available(btstack_ring_buffer_t * ring_buffer
  */
 uint32_t btstack_ring_buffer_bytes_free(btstack_ring_buffer_t * ring_buffer);
 
+/**
+ * Get free space that can be written at once after btstack_ring_buffer_reserve
+ * @param ring_buffer object
+ * @return number of contiguous bytes available for write
+ */
+uint32_t btstack_ring_buffer_bytes_free_contiguous(btstack_ring_buffer_t * ring_buffer);
+
 /**
  * Write bytes into ring buffer
  * @param ring_buffer object
@@ -103,6 +128,107 @@ int btstack_ring_buffer_write(btstack_ring_buffer_t * ring_buffer, uint8_t * dat
  */
 void btstack_ring_buffer_read(btstack_ring_buffer_t * ring_buffer, uint8_t * buffer, uint32_t length, uint32_t * number_of_bytes_read); 
 
+/**
+ * Get pointer to contiguous free space to write data without copy
+ * @param ring_buffer object
+ * @param length to reserve
+ * @return pointer to free space or NULL if less than length contiguous bytes are free
+ */
+uint8_t * btstack_ring_buffer_reserve(btstack_ring_buffer_t * ring_buffer, uint32_t length);
+
+/**
+ * Mark bytes written into reserved space as available for read
+ * @param ring_buffer object
+ * @param length written, at most length of reserved space
+ */
+void btstack_ring_buffer_commit(btstack_ring_buffer_t * ring_buffer, uint32_t length);
+
+/**
+ * Get pointer to contiguous data to process it without copy
+ * @param ring_buffer object
+ * @param length of contiguous data
+ * @return pointer to data
+ */
+uint8_t * btstack_ring_buffer_peek_contiguous(btstack_ring_buffer_t * ring_buffer, uint32_t * length);
+
+/**
+ * Drop processed data
+ * @param ring_buffer object
+ * @param length to drop, at most number of bytes available
+ */
+void btstack_ring_buffer_consume(btstack_ring_buffer_t * ring_buffer, uint32_t length);
+
+/**
+ * Init lock-free ring buffer for a single producer and a single consumer
+ * @param ring_buffer object
+ * @param storage
+ * @param storage_size in bytes, must be a power of two
+ * @return 0 if ok, -1 if storage_size is not a power of two
+ */
+int btstack_ring_buffer_spsc_init(btstack_ring_buffer_spsc_t * ring_buffer, uint8_t * storage, uint32_t storage_size);
+
+/**
+ * Get number of bytes available for read. Exact for consumer, lower bound for producer
+ * @param ring_buffer object
+ * @return number of bytes available for read
+ */
+uint32_t btstack_ring_buffer_spsc_bytes_available(btstack_ring_buffer_spsc_t * ring_buffer);
+
+/**
+ * Get free space available for write. Exact for producer, lower bound for consumer
+ * @param ring_buffer object
+ * @return number of bytes available for write
+ */
+uint32_t btstack_ring_buffer_spsc_bytes_free(btstack_ring_buffer_spsc_t * ring_buffer);
+
+/**
+ * Write bytes into ring buffer, producer only
+ * @param ring_buffer object
+ * @param data to store
+ * @param data_length
+ * @return 0 if ok, ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if not enough space in buffer
+ */
+int btstack_ring_buffer_spsc_write(btstack_ring_buffer_spsc_t * ring_buffer, const uint8_t * data, uint32_t data_length);
+
+/**
+ * Read from ring buffer, consumer only
+ * @param ring_buffer object
+ * @param buffer to store read data
+ * @param length to read
+ * @param number_of_bytes_read
+ */
+void btstack_ring_buffer_spsc_read(btstack_ring_buffer_spsc_t * ring_buffer, uint8_t * buffer, uint32_t length, uint32_t * number_of_bytes_read);
+
+/**
+ * Get pointer to contiguous free space, producer only
+ * @param ring_buffer object
+ * @param length to reserve
+ * @return pointer to free space or NULL if less than length contiguous bytes are free
+ */
+uint8_t * btstack_ring_buffer_spsc_reserve(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t length);
+
+/**
+ * Publish bytes written into reserved space, producer only
+ * @param ring_buffer object
+ * @param length written
+ */
+void btstack_ring_buffer_spsc_commit(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t length);
+
+/**
+ * Get pointer to contiguous data, consumer only
+ * @param ring_buffer object
+ * @param length of contiguous data
+ * @return pointer to data
+ */
+uint8_t * btstack_ring_buffer_spsc_peek_contiguous(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t * length);
+
+/**
+ * Release processed data to producer, consumer only
+ * @param ring_buffer object
+ * @param length to drop
+ */
+void btstack_ring_buffer_spsc_consume(btstack_ring_buffer_spsc_t * ring_buffer, uint32_t length);
+
 #if defined __cplusplus
 }
 #endif
@@ -167,6 +167,25 @@ uint32_t btstack_run_loop_get_time_ms(void){
     return the_run_loop->get_time_ms();
 }
 
+/**
+ * @brief Get current time in us
+ */
+uint32_t btstack_run_loop_get_time_us(void){
+    btstack_run_loop_assert();
+    if (the_run_loop->get_time_us){
+        return the_run_loop->get_time_us();
+    }
+    return the_run_loop->get_time_ms() * 1000;
+}
+
+int btstack_run_loop_execute_on_main_thread(void (*fn)(void * context), void * context){
+    btstack_run_loop_assert();
+    if (the_run_loop->execute_on_main_thread){
+        return the_run_loop->execute_on_main_thread(fn, context);
+    }
+    log_error("btstack_run_loop_execute_on_main_thread not implemented");
+    return -1;
+}
 
 void btstack_run_loop_timer_dump(void){
     btstack_run_loop_assert();
@@ -91,6 +91,8 @@ typedef struct btstack_timer_source {
     // will be called when timer fired
     void  (*process)(struct btstack_timer_source *ts); 
     void * context;
+    // list index used by btstack_timer_wheel
+    uint16_t wheel_list;
 } btstack_timer_source_t;
 
 typedef struct btstack_run_loop {
@@ -105,6 +107,8 @@ typedef struct btstack_run_loop {
 	void (*execute)(void);
 	void (*dump_timer)(void);
 	uint32_t (*get_time_ms)(void);
+	uint32_t (*get_time_us)(void);
+	int  (*execute_on_main_thread)(void (*fn)(void * context), void * context);
 } btstack_run_loop_t;
 
 void btstack_run_loop_timer_dump(void);
@@ -154,6 +158,12 @@ int  btstack_run_loop_remove_timer(btstack_timer_source_t * timer);
  */
 uint32_t btstack_run_loop_get_time_ms(void);
 
+/**
+ * @brief Get current time in us
+ * @note 32-bit us counter will overflow after approx. 71 minutes. Resolution of ms if not supported by run loop
+ */
+uint32_t btstack_run_loop_get_time_us(void);
+
 /**
  * @brief Set data source callback.
  */
@@ -199,6 +209,14 @@ void btstack_run_loop_add_data_source(btstack_data_source_t * data_source);
  */
 int btstack_run_loop_remove_data_source(btstack_data_source_t * data_source);
 
+/**
+ * @brief Execute function on run loop thread. Can be called from any thread
+ * @param fn to call on run loop thread
+ * @param context passed to fn
+ * @returns 0 if queued, -1 if queue is full or not supported by run loop
+ */
+int btstack_run_loop_execute_on_main_thread(void (*fn)(void * context), void * context);
+
 /**
  * @brief Execute configured run loop. This function does not return.
  */
@@ -42,6 +42,8 @@
  *  SLIP encoder/decoder
  */
 
+#include <string.h>
+
 #include "btstack_slip.h"
 #include "btstack_debug.h"
 
@@ -73,6 +75,17 @@ static uint16_t  decoder_max_size;
 static uint16_t  decoder_pos;
 
 
+// @returns number of bytes that don't need escaping
+static uint16_t btstack_slip_plain_len(const uint8_t * data, uint16_t len){
+	uint16_t pos = 0;
+	while (pos < len){
+		uint8_t value = data[pos];
+		if (value == BTSTACK_SLIP_SOF || value == 0xdb) break;
+		pos++;
+	}
+	return pos;
+}
+
 // ENCODER
 
 /**
@@ -128,6 +141,32 @@ uint8_t btstack_slip_encoder_get_byte(void){
 	}
 }
 
+/** 
+ * @brief Get next bytes from encoder
+ * @param buffer to store encoded data
+ * @param max_len of buffer
+ * @return Number of bytes stored in buffer
+ */
+uint16_t btstack_slip_encoder_get_bytes(uint8_t * buffer, uint16_t max_len){
+	uint16_t pos = 0;
+	while ((pos < max_len) && btstack_slip_encoder_has_data()){
+		if (encoder_state == SLIP_ENCODER_DEFAULT){
+			// copy bytes that don't need escaping in one go
+			uint16_t len = encoder_len < (max_len - pos) ? encoder_len : (max_len - pos);
+			uint16_t plain_len = btstack_slip_plain_len(encoder_data, len);
+			if (plain_len){
+				memcpy(&buffer[pos], encoder_data, plain_len);
+				encoder_data += plain_len;
+				encoder_len  -= plain_len;
+				pos          += plain_len;
+				continue;
+			}
+		}
+		buffer[pos++] = btstack_slip_encoder_get_byte();
+	}
+	return pos;
+}
+
 // Decoder
 
 static void btstack_slip_decoder_reset(void){
@@ -231,3 +270,33 @@ uint16_t btstack_slip_decoder_frame_size(void){
 			return 0;
 	}
 }
+
+/**
+ * @brief Process received bytes until frame is complete
+ * @param data
+ * @param len
+ * @return Number of bytes processed. If less than len, frame is complete
+ */
+uint16_t btstack_slip_decoder_process_bytes(const uint8_t * data, uint16_t len){
+	uint16_t pos = 0;
+	while (pos < len){
+		if (decoder_state == SLIP_DECODER_ACTIVE){
+			// store bytes that are not escaped in one go
+			uint16_t plain_len = btstack_slip_plain_len(&data[pos], len - pos);
+			if (plain_len){
+				if (decoder_pos + plain_len > decoder_max_size){
+					log_error("btstack_slip_decoder_process_bytes: packet to long");
+					btstack_slip_decoder_reset();
+				} else {
+					memcpy(&decoder_buffer[decoder_pos], &data[pos], plain_len);
+					decoder_pos += plain_len;
+				}
+				pos += plain_len;
+				continue;
+			}
+		}
+		btstack_slip_decoder_process(data[pos++]);
+		if (decoder_state == SLIP_DECODER_COMPLETE) break;
+	}
+	return pos;
+}
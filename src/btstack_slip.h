@@ -72,6 +72,14 @@ int  btstack_slip_encoder_has_data(void);
  */
 uint8_t btstack_slip_encoder_get_byte(void);
 
+/** 
+ * @brief Get next bytes from encoder
+ * @param buffer to store encoded data
+ * @param max_len of buffer
+ * @return Number of bytes stored in buffer
+ */
+uint16_t btstack_slip_encoder_get_bytes(uint8_t * buffer, uint16_t max_len);
+
 // DECODER
 
 /**
@@ -88,6 +96,14 @@ void btstack_slip_decoder_init(uint8_t * buffer, uint16_t max_size);
 
 void btstack_slip_decoder_process(uint8_t input);
 
+/**
+ * @brief Process received bytes until frame is complete
+ * @param data
+ * @param len
+ * @return Number of bytes processed. If less than len, frame is complete
+ */
+uint16_t btstack_slip_decoder_process_bytes(const uint8_t * data, uint16_t len);
+
 /**
  * @brief Get size of decoded frame
  * @return size of frame. Size = 0 => frame not complete
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define __BTSTACK_FILE__ "btstack_timer_wheel.c"
+
+/*
+ *  btstack_timer_wheel.c
+ *
+ *  Hierarchical timer wheel
+ *
+ *  Each timer stores the index of the list it is stored in, so remove only needs
+ *  to look at a single slot. The index is validated before use and the slot is
+ *  searched for the timer, so calling remove on a timer that was never added is safe.
+ */
+
+#include "btstack_timer_wheel.h"
+#include "btstack_debug.h"
+
+#include <stddef.h>
+
+#define SLOT_MASK (BTSTACK_TIMER_WHEEL_NUM_SLOTS - 1)
+#define EXPIRED_LIST (BTSTACK_TIMER_WHEEL_NUM_LISTS - 1)
+
+// returns distance from start to next set bit in bitmap (with wrap around) or -1 if none is set
+static int btstack_timer_wheel_next_slot(uint64_t bitmap, int start){
+    if (bitmap == 0) return -1;
+    if (start){
+        bitmap = (bitmap >> start) | (bitmap << (BTSTACK_TIMER_WHEEL_NUM_SLOTS - start));
+    }
+#ifdef __GNUC__
+    return __builtin_ctzll(bitmap);
+#else
+    int distance = 0;
+    while ((bitmap & 1) == 0){
+        bitmap >>= 1;
+        distance++;
+    }
+    return distance;
+#endif
+}
+
+static void btstack_timer_wheel_insert(btstack_timer_wheel_t * wheel, btstack_timer_source_t * ts){
+    int level = 0;
+    uint32_t slot;
+    int32_t delta = (int32_t) (ts->timeout - wheel->now);
+    if (delta < 0){
+        // already expired, process right away
+        ts->wheel_list = EXPIRED_LIST;
+        btstack_linked_list_add_tail(&wheel->lists[EXPIRED_LIST], (btstack_linked_item_t *) ts);
+        return;
+    }
+    while ((level < BTSTACK_TIMER_WHEEL_NUM_LEVELS - 1) && (((uint32_t) delta >> (BTSTACK_TIMER_WHEEL_SLOT_BITS * (level + 1))) != 0)){
+        level++;
+    }
+    slot = (ts->timeout >> (BTSTACK_TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+    ts->wheel_list = level * BTSTACK_TIMER_WHEEL_NUM_SLOTS + slot;
+    btstack_linked_list_add_tail(&wheel->lists[ts->wheel_list], (btstack_linked_item_t *) ts);
+    wheel->occupied[level] |= ((uint64_t) 1) << slot;
+}
+
+static void btstack_timer_wheel_cascade(btstack_timer_wheel_t * wheel, int level, uint32_t slot){
+    btstack_linked_list_t * list = &wheel->lists[level * BTSTACK_TIMER_WHEEL_NUM_SLOTS + slot];
+    btstack_linked_item_t * it = *list;
+    *list = NULL;
+    wheel->occupied[level] &= ~(((uint64_t) 1) << slot);
+    while (it){
+        btstack_timer_source_t * ts = (btstack_timer_source_t *) it;
+        it = it->next;
+        btstack_timer_wheel_insert(wheel, ts);
+    }
+}
+
+void btstack_timer_wheel_init(btstack_timer_wheel_t * wheel, uint32_t now){
+    int i;
+    for (i = 0; i < BTSTACK_TIMER_WHEEL_NUM_LISTS; i++){
+        wheel->lists[i] = NULL;
+    }
+    for (i = 0; i < BTSTACK_TIMER_WHEEL_NUM_LEVELS; i++){
+        wheel->occupied[i] = 0;
+    }
+    wheel->now = now;
+}
+
+void btstack_timer_wheel_add(btstack_timer_wheel_t * wheel, btstack_timer_source_t * ts){
+    if (ts->wheel_list < BTSTACK_TIMER_WHEEL_NUM_LISTS){
+        btstack_linked_item_t * it;
+        for (it = wheel->lists[ts->wheel_list]; it ; it = it->next){
+            if (it == (btstack_linked_item_t *) ts){
+                log_error( "btstack_run_loop_timer_add error: timer to add already in list!");
+                return;
+            }
+        }
+    }
+    btstack_timer_wheel_insert(wheel, ts);
+    log_debug("Added timer %p at %u\n", ts, ts->timeout);
+}
+
+int btstack_timer_wheel_remove(btstack_timer_wheel_t * wheel, btstack_timer_source_t * ts){
+    uint16_t list_index = ts->wheel_list;
+    if (list_index >= BTSTACK_TIMER_WHEEL_NUM_LISTS) return -1;
+    int err = btstack_linked_list_remove(&wheel->lists[list_index], (btstack_linked_item_t *) ts);
+    if (err) return err;
+    ts->wheel_list = BTSTACK_TIMER_WHEEL_NUM_LISTS;
+    if (list_index != EXPIRED_LIST && wheel->lists[list_index] == NULL){
+        wheel->occupied[list_index / BTSTACK_TIMER_WHEEL_NUM_SLOTS] &= ~(((uint64_t) 1) << (list_index & SLOT_MASK));
+    }
+    return 0;
+}
+
+// timers are removed before processing them to allow handler to re-register with run loop
+static void btstack_timer_wheel_process_expired(btstack_timer_wheel_t * wheel){
+    while (wheel->lists[EXPIRED_LIST]){
+        btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_linked_list_pop(&wheel->lists[EXPIRED_LIST]);
+        ts->wheel_list = BTSTACK_TIMER_WHEEL_NUM_LISTS;
+        log_debug("btstack_timer_wheel_process: process timer %p\n", ts);
+        ts->process(ts);
+    }
+}
+
+void btstack_timer_wheel_process(btstack_timer_wheel_t * wheel, uint32_t now){
+    btstack_timer_wheel_process_expired(wheel);
+    while ((int32_t) (now - wheel->now) >= 0){
+        uint32_t index = wheel->now & SLOT_MASK;
+
+        // cascade timers from higher levels on slot boundaries
+        if (index == 0){
+            int level;
+            for (level = 1; level < BTSTACK_TIMER_WHEEL_NUM_LEVELS; level++){
+                uint32_t slot = (wheel->now >> (BTSTACK_TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+                btstack_timer_wheel_cascade(wheel, level, slot);
+                if (slot) break;
+            }
+        }
+
+        // move expired timers to separate list, so that handlers can still remove them
+        if (wheel->lists[index]){
+            btstack_linked_item_t * it;
+            wheel->lists[EXPIRED_LIST] = wheel->lists[index];
+            wheel->lists[index] = NULL;
+            wheel->occupied[0] &= ~(((uint64_t) 1) << index);
+            for (it = wheel->lists[EXPIRED_LIST]; it ; it = it->next){
+                ((btstack_timer_source_t *) it)->wheel_list = EXPIRED_LIST;
+            }
+        }
+        wheel->now++;
+        btstack_timer_wheel_process_expired(wheel);
+
+        // skip empty slots up to the next occupied slot or the next slot boundary
+        index = wheel->now & SLOT_MASK;
+        if (index == 0) continue;
+        uint32_t step = BTSTACK_TIMER_WHEEL_NUM_SLOTS - index;
+        uint64_t remaining = wheel->occupied[0] >> index;
+        if (remaining){
+            int distance = btstack_timer_wheel_next_slot(remaining, 0);
+            step = distance;
+        }
+        if ((int32_t) (now - (wheel->now + step)) < 0){
+            wheel->now = now + 1;
+            break;
+        }
+        wheel->now += step;
+    }
+}
+
+int32_t btstack_timer_wheel_get_timeout(btstack_timer_wheel_t * wheel, uint32_t now){
+    if (wheel->lists[EXPIRED_LIST]) return 0;
+
+    uint64_t next = 0;
+    int found = 0;
+    int level;
+    for (level = 0; level < BTSTACK_TIMER_WHEEL_NUM_LEVELS; level++){
+        if (wheel->occupied[level] == 0) continue;
+        // slots of level n are processed, resp. cascaded, every 64^n time units
+        int shift = BTSTACK_TIMER_WHEEL_SLOT_BITS * level;
+        uint64_t period = ((uint64_t) 1) << shift;
+        uint64_t remainder = wheel->now & (period - 1);
+        uint32_t first_slot = (wheel->now >> shift) & SLOT_MASK;
+        uint64_t first_time = 0;
+        if (remainder){
+            first_slot = (first_slot + 1) & SLOT_MASK;
+            first_time = period - remainder;
+        }
+        int distance = btstack_timer_wheel_next_slot(wheel->occupied[level], first_slot);
+        uint64_t time = first_time + distance * period;
+        if (!found || time < next){
+            next = time;
+            found = 1;
+        }
+    }
+    if (!found) return -1;
+
+    // relative to now
+    int64_t timeout = (int64_t) next - (int32_t) (now - wheel->now);
+    if (timeout < 0) return 0;
+    if (timeout > INT32_MAX) return INT32_MAX;
+    return (int32_t) timeout;
+}
+
+void btstack_timer_wheel_dump(btstack_timer_wheel_t * wheel){
+#ifdef ENABLE_LOG_INFO
+    int i;
+    int nr_timers = 0;
+    for (i = 0; i < BTSTACK_TIMER_WHEEL_NUM_LISTS; i++){
+        btstack_linked_item_t * it;
+        for (it = wheel->lists[i]; it ; it = it->next){
+            btstack_timer_source_t *ts = (btstack_timer_source_t*) it;
+            log_info("timer %u, list %u, timeout %u\n", nr_timers++, i, (unsigned int) ts->timeout);
+        }
+    }
+#else
+    (void) wheel;
+#endif
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+/*
+ *  btstack_timer_wheel.h
+ *
+ *  @Brief Hierarchical timer wheel for run loop implementations
+ *
+ *  Timers are kept in 6 levels of 64 slots each. Level n holds timers that expire
+ *  less than 64^(n+1) time units from now. Adding a timer only appends it to a
+ *  slot, and slots of higher levels are cascaded down when the wheel passes their
+ *  boundary. The time unit is defined by the run loop, e.g. milliseconds or ticks.
+ */
+
+#ifndef __BTSTACK_TIMER_WHEEL_H
+#define __BTSTACK_TIMER_WHEEL_H
+
+#include "btstack_run_loop.h"
+#include "btstack_linked_list.h"
+
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define BTSTACK_TIMER_WHEEL_SLOT_BITS 6
+#define BTSTACK_TIMER_WHEEL_NUM_SLOTS (1 << BTSTACK_TIMER_WHEEL_SLOT_BITS)
+#define BTSTACK_TIMER_WHEEL_NUM_LEVELS 6
+
+// wheel slots plus one list for timers that are currently being processed
+#define BTSTACK_TIMER_WHEEL_NUM_LISTS (BTSTACK_TIMER_WHEEL_NUM_LEVELS * BTSTACK_TIMER_WHEEL_NUM_SLOTS + 1)
+
+typedef struct {
+    btstack_linked_list_t lists[BTSTACK_TIMER_WHEEL_NUM_LISTS];
+    // bitmap of non-empty slots per level
+    uint64_t occupied[BTSTACK_TIMER_WHEEL_NUM_LEVELS];
+    // all timers with timeout before this time have been processed
+    uint32_t now;
+} btstack_timer_wheel_t;
+
+/* API_START */
+
+/**
+ * @brief Init timer wheel
+ * @param wheel
+ * @param now current time
+ */
+void btstack_timer_wheel_init(btstack_timer_wheel_t * wheel, uint32_t now);
+
+/**
+ * @brief Add timer, ts->timeout has to be set before
+ * @param wheel
+ * @param ts
+ */
+void btstack_timer_wheel_add(btstack_timer_wheel_t * wheel, btstack_timer_source_t * ts);
+
+/**
+ * @brief Remove timer
+ * @param wheel
+ * @param ts
+ * @returns 0 if timer was removed, -1 if it wasn't part of the wheel
+ */
+int  btstack_timer_wheel_remove(btstack_timer_wheel_t * wheel, btstack_timer_source_t * ts);
+
+/**
+ * @brief Call process handler for all timers with timeout <= now
+ * @note timers are removed before their handler is called and can be re-added from it
+ * @param wheel
+ * @param now current time
+ */
+void btstack_timer_wheel_process(btstack_timer_wheel_t * wheel, uint32_t now);
+
+/**
+ * @brief Get time until btstack_timer_wheel_process needs to be called next
+ * @note might be earlier than the next timeout when timers of a higher level need to be cascaded
+ * @param wheel
+ * @param now current time
+ * @returns time until next processing, or -1 if no timers are active
+ */
+int32_t btstack_timer_wheel_get_timeout(btstack_timer_wheel_t * wheel, uint32_t now);
+
+/**
+ * @brief Log all active timers
+ */
+void btstack_timer_wheel_dump(btstack_timer_wheel_t * wheel);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __BTSTACK_TIMER_WHEEL_H
@@ -143,6 +143,19 @@ typedef struct {
      */
     void (*set_wakeup_handler)(void (*wakeup_handler)(void));
 
+    // support for stream receive - optional
+
+    /**
+     * set callback for data received by receive_stream. NULL disables callback
+     */
+    void (*set_stream_received)(void (*stream_handler)(uint16_t len));
+
+    /**
+     * receive stream - read all bytes that are available, but at most len, into buffer.
+     * Stream received callback is called with number of bytes read as soon as at least one byte was received
+     */
+    void (*receive_stream)(uint8_t *buffer, uint16_t len);
+
 } btstack_uart_block_t;
 
 // common implementations
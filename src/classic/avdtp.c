@@ -318,6 +318,8 @@ static void stream_endpoint_state_machine(avdtp_connection_t * connection, avdtp
                         stream_endpoint->connection = connection;
                         stream_endpoint->l2cap_media_cid = l2cap_event_channel_opened_get_local_cid(packet);
                         stream_endpoint->media_con_handle = l2cap_event_channel_opened_get_handle(packet);
+                        // media packets are time critical
+                        hci_set_acl_priority(stream_endpoint->media_con_handle, HCI_ACL_PRIORITY_HIGH);
 
                         // log_info(" -> AVDTP_STREAM_ENDPOINT_OPENED, avdtp cid 0x%02x, l2cap_media_cid 0x%02x, local seid %d, remote seid %d", connection->avdtp_cid, stream_endpoint->l2cap_media_cid, avdtp_local_seid(stream_endpoint), avdtp_remote_seid(stream_endpoint));
                         avdtp_streaming_emit_connection_established(context->avdtp_callback, connection->avdtp_cid, avdtp_local_seid(stream_endpoint), avdtp_remote_seid(stream_endpoint), 0);
@@ -327,6 +329,7 @@ static void stream_endpoint_state_machine(avdtp_connection_t * connection, avdtp
                 case L2CAP_EVENT_CHANNEL_CLOSED:
                     local_cid = l2cap_event_channel_closed_get_local_cid(packet);
                     if (stream_endpoint->l2cap_media_cid == local_cid){
+                        hci_set_acl_priority(stream_endpoint->media_con_handle, HCI_ACL_PRIORITY_NORMAL);
                         avdtp_streaming_emit_connection_released(context->avdtp_callback, stream_endpoint->connection->avdtp_cid, avdtp_local_seid(stream_endpoint));
                         stream_endpoint->l2cap_media_cid = 0;
                         stream_endpoint->state = AVDTP_STREAM_ENDPOINT_IDLE;
@@ -573,6 +576,7 @@ void avdtp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet
                     if (connection->l2cap_signaling_cid == 0) {
                         if (connection->state != AVDTP_SIGNALING_CONNECTION_W4_L2CAP_CONNECTED) break;
                         connection->l2cap_signaling_cid = local_cid;
+                        btstack_keyed_index_add(&context->connection_index, local_cid, connection);
                         connection->local_seid = 0;
                         connection->state = AVDTP_SIGNALING_CONNECTION_OPENED;
                         log_info(" -> AVDTP_SIGNALING_CONNECTION_OPENED, connection %p, avdtp_cid 0x%02x", connection, connection->avdtp_cid);
@@ -601,6 +605,10 @@ void avdtp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet
                     if (connection){
                         avdtp_signaling_emit_connection_released(context->avdtp_callback, connection->avdtp_cid);
                         btstack_linked_list_remove(avdtp_connections, (btstack_linked_item_t*) connection); 
+                        btstack_keyed_index_remove(&context->connection_index, connection->l2cap_signaling_cid, connection);
+                        if (btstack_linked_list_empty(avdtp_connections)){
+                            btstack_keyed_index_clear(&context->connection_index);
+                        }
                         btstack_linked_list_iterator_t it;    
                         btstack_linked_list_iterator_init(&it, stream_endpoints);
                         while (btstack_linked_list_iterator_has_next(&it)){
@@ -54,6 +54,7 @@
 #include "hci.h"
 #include "classic/btstack_sbc.h"
 #include "btstack_ring_buffer.h"
+#include "btstack_keyed_index.h"
 
 #if defined __cplusplus
 extern "C" {
@@ -62,6 +63,11 @@ extern "C" {
 #define MAX_NUM_SEPS 10
 #define MAX_CSRC_NUM 15
 
+// size of index to find connection by l2cap signaling cid
+#ifndef AVDTP_CONNECTION_INDEX_SIZE
+#define AVDTP_CONNECTION_INDEX_SIZE 8
+#endif
+
 // Supported Features
 #define AVDTP_SOURCE_SF_Player      0x0001
 #define AVDTP_SOURCE_SF_Microphone  0x0002
@@ -495,6 +501,9 @@ typedef struct {
 
 typedef struct {
     btstack_linked_list_t connections;
+    // connections by l2cap_signaling_cid
+    btstack_keyed_index_t connection_index;
+    btstack_keyed_index_entry_t connection_index_entries[AVDTP_CONNECTION_INDEX_SIZE];
     btstack_linked_list_t stream_endpoints;
     uint16_t stream_endpoints_id_counter;
     uint16_t initiator_transaction_id_counter;
@@ -559,6 +559,7 @@ void avdtp_acceptor_stream_config_subsm_run(avdtp_connection_t * connection, avd
             log_info("ACP: DONE ");
             log_info("    -> AVDTP_STREAM_ENDPOINT_STREAMING ");
             stream_endpoint->state = AVDTP_STREAM_ENDPOINT_STREAMING;
+            avdtp_set_media_channel_priority(stream_endpoint, L2CAP_CHANNEL_PRIORITY_HIGH);
             avdtp_acceptor_send_accept_response(cid, trid, AVDTP_SI_START);
             break;
         case AVDTP_ACCEPTOR_W2_ANSWER_CLOSE_STREAM:
@@ -567,11 +568,13 @@ void avdtp_acceptor_stream_config_subsm_run(avdtp_connection_t * connection, avd
             break;
         case AVDTP_ACCEPTOR_W2_ANSWER_ABORT_STREAM:
             log_info("ACP: DONE");
+            avdtp_set_media_channel_priority(stream_endpoint, L2CAP_CHANNEL_PRIORITY_NORMAL);
             avdtp_acceptor_send_accept_response(cid, trid, AVDTP_SI_ABORT);
             break;
         case AVDTP_ACCEPTOR_W2_ANSWER_SUSPEND_STREAM:
             log_info("ACP: DONE");
             stream_endpoint->state = AVDTP_STREAM_ENDPOINT_OPENED;
+            avdtp_set_media_channel_priority(stream_endpoint, L2CAP_CHANNEL_PRIORITY_NORMAL);
             avdtp_acceptor_send_accept_response(cid, trid, AVDTP_SI_SUSPEND);
             break;
         case AVDTP_ACCEPTOR_W2_REJECT_UNKNOWN_CMD:
@@ -197,6 +197,7 @@ void avdtp_initiator_stream_config_subsm(avdtp_connection_t * connection, uint8_
                         return;
                     }
                     stream_endpoint->state = AVDTP_STREAM_ENDPOINT_STREAMING;
+                    avdtp_set_media_channel_priority(stream_endpoint, L2CAP_CHANNEL_PRIORITY_HIGH);
                     break;
                 case AVDTP_SI_SUSPEND:
                     if (stream_endpoint->state != AVDTP_STREAM_ENDPOINT_STREAMING) {
@@ -204,12 +205,14 @@ void avdtp_initiator_stream_config_subsm(avdtp_connection_t * connection, uint8_
                         return;
                     }
                     stream_endpoint->state = AVDTP_STREAM_ENDPOINT_OPENED;
+                    avdtp_set_media_channel_priority(stream_endpoint, L2CAP_CHANNEL_PRIORITY_NORMAL);
                     break;
                 case AVDTP_SI_CLOSE:
                     stream_endpoint->state = AVDTP_STREAM_ENDPOINT_CLOSING;
                     break;
                 case AVDTP_SI_ABORT:
                     stream_endpoint->state = AVDTP_STREAM_ENDPOINT_ABORTING;
+                    avdtp_set_media_channel_priority(stream_endpoint, L2CAP_CHANNEL_PRIORITY_NORMAL);
                     break;
                 default:
                     log_info("    AVDTP_RESPONSE_ACCEPT_MSG, signal %d not implemented", connection->signaling_packet.signal_identifier);
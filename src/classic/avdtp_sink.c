@@ -115,6 +115,7 @@ void avdtp_sink_init(avdtp_context_t * avdtp_context){
     avdtp_sink_context = avdtp_context;
     avdtp_sink_context->stream_endpoints = NULL;
     avdtp_sink_context->connections = NULL;
+    btstack_keyed_index_init(&avdtp_sink_context->connection_index, avdtp_sink_context->connection_index_entries, AVDTP_CONNECTION_INDEX_SIZE);
     avdtp_sink_context->stream_endpoints_id_counter = 0;
     avdtp_sink_context->packet_handler = packet_handler;
 
@@ -169,6 +169,7 @@ void avdtp_source_init(avdtp_context_t * avdtp_context){
     avdtp_source_context = avdtp_context;
     avdtp_source_context->stream_endpoints = NULL;
     avdtp_source_context->connections = NULL;
+    btstack_keyed_index_init(&avdtp_source_context->connection_index, avdtp_source_context->connection_index_entries, AVDTP_CONNECTION_INDEX_SIZE);
     avdtp_source_context->stream_endpoints_id_counter = 0;
     avdtp_source_context->packet_handler = packet_handler;
 
@@ -116,6 +116,9 @@ avdtp_connection_t * avdtp_connection_for_avdtp_cid(uint16_t avdtp_cid, avdtp_co
 }
 
 avdtp_connection_t * avdtp_connection_for_l2cap_signaling_cid(uint16_t l2cap_cid, avdtp_context_t * context){
+    if (btstack_keyed_index_is_complete(&context->connection_index)){
+        return (avdtp_connection_t *) btstack_keyed_index_get(&context->connection_index, l2cap_cid);
+    }
     btstack_linked_list_iterator_t it;    
     btstack_linked_list_iterator_init(&it, &context->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -858,3 +861,8 @@ uint8_t avdtp_remote_seid(avdtp_stream_endpoint_t * stream_endpoint){
     if (!stream_endpoint->connection) return 0;
     return stream_endpoint->connection->remote_seps[stream_endpoint->remote_sep_index].seid;
 }
+
+void avdtp_set_media_channel_priority(avdtp_stream_endpoint_t * stream_endpoint, l2cap_channel_priority_t priority){
+    if (!stream_endpoint->l2cap_media_cid) return;
+    l2cap_set_channel_priority(stream_endpoint->l2cap_media_cid, priority);
+}
@@ -47,6 +47,7 @@
 
 #include <stdint.h>
 #include "avdtp.h"
+#include "l2cap.h"
 
 #if defined __cplusplus
 extern "C" {
@@ -105,6 +106,9 @@ uint8_t avdtp_get_index_of_remote_stream_endpoint_with_seid(avdtp_stream_endpoin
 void avdtp_initialize_stream_endpoint(avdtp_stream_endpoint_t * stream_endpoint);
 uint8_t avdtp_find_remote_sep(avdtp_connection_t * connection, uint8_t remote_seid);
 
+// media channel gets high priority while streaming, see l2cap_set_channel_priority
+void avdtp_set_media_channel_priority(avdtp_stream_endpoint_t * stream_endpoint, l2cap_channel_priority_t priority);
+
 // uint16_t avdtp_cid(avdtp_stream_endpoint_t * stream_endpoint);
 uint8_t  avdtp_local_seid(avdtp_stream_endpoint_t * stream_endpoint);
 uint8_t  avdtp_remote_seid(avdtp_stream_endpoint_t * stream_endpoint);
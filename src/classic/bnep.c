@@ -52,6 +52,7 @@
 #include "bluetooth_sdp.h"
 #include "btstack_debug.h"
 #include "btstack_event.h"
+#include "btstack_keyed_index.h"
 #include "btstack_memory.h"
 #include "btstack_util.h"
 #include "classic/core.h"
@@ -64,9 +65,22 @@
 #define BNEP_CONNECTION_TIMEOUT_MS 10000
 #define BNEP_CONNECTION_MAX_RETRIES 1
 
+// size of index to find channel by l2cap cid, linear search is used if more channels are open
+#ifndef BNEP_CHANNEL_INDEX_SIZE
+#if !defined(HAVE_MALLOC) && defined(MAX_NR_BNEP_CHANNELS)
+#define BNEP_CHANNEL_INDEX_SIZE BTSTACK_KEYED_INDEX_SIZE_FOR(MAX_NR_BNEP_CHANNELS)
+#else
+#define BNEP_CHANNEL_INDEX_SIZE 16
+#endif
+#endif
+
 static btstack_linked_list_t bnep_services = NULL;
 static btstack_linked_list_t bnep_channels = NULL;
 
+// index of bnep_channels by l2cap_cid, channels are added when l2cap_cid is known
+static btstack_keyed_index_t       bnep_channel_index;
+static btstack_keyed_index_entry_t bnep_channel_index_entries[BNEP_CHANNEL_INDEX_SIZE];
+
 static gap_security_level_t bnep_security_level;
 
 static bnep_channel_t * bnep_channel_for_l2cap_cid(uint16_t l2cap_cid);
@@ -735,6 +749,9 @@ static bnep_channel_t* bnep_channel_for_addr(bd_addr_t addr)
 
 static bnep_channel_t * bnep_channel_for_l2cap_cid(uint16_t l2cap_cid)
 {
+    if (btstack_keyed_index_is_complete(&bnep_channel_index)){
+        return (bnep_channel_t *) btstack_keyed_index_get(&bnep_channel_index, l2cap_cid);
+    }
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) bnep_channels; it ; it = it->next){
         bnep_channel_t *channel = ((bnep_channel_t *) it);
@@ -760,6 +777,10 @@ static bnep_service_t * bnep_service_for_uuid(uint16_t uuid)
 static void bnep_channel_free(bnep_channel_t *channel)
 {
     btstack_linked_list_remove( &bnep_channels, (btstack_linked_item_t *) channel);
+    btstack_keyed_index_remove(&bnep_channel_index, channel->l2cap_cid, channel);
+    if (bnep_channels == NULL){
+        btstack_keyed_index_clear(&bnep_channel_index);
+    }
     btstack_memory_bnep_channel_free(channel);
 }
 
@@ -1213,6 +1234,7 @@ static int bnep_hci_event_handler(uint8_t *packet, uint16_t size)
             /* Assign connection handle and l2cap cid */
             channel->con_handle = con_handle;
             channel->l2cap_cid = l2cap_cid;
+            btstack_keyed_index_add(&bnep_channel_index, l2cap_cid, channel);
 
             /* Set channel into accept state */
             channel->state = BNEP_CHANNEL_STATE_WAIT_FOR_CONNECTION_REQUEST;
@@ -1263,6 +1285,7 @@ static int bnep_hci_event_handler(uint8_t *packet, uint16_t size)
                     /* Assign connection handle and l2cap cid */
                     channel->l2cap_cid  = l2cap_cid;
                     channel->con_handle = con_handle;
+                    btstack_keyed_index_add(&bnep_channel_index, l2cap_cid, channel);
 
                     /* Initiate the connection request */
                     channel->state = BNEP_CHANNEL_STATE_WAIT_FOR_CONNECTION_RESPONSE;
@@ -1538,6 +1561,7 @@ static void bnep_handle_can_send_now(uint16_t l2cap_cid){
 void bnep_init(void)
 {
     bnep_security_level = LEVEL_0;
+    btstack_keyed_index_init(&bnep_channel_index, bnep_channel_index_entries, BNEP_CHANNEL_INDEX_SIZE);
 }
 
 void bnep_set_required_security_level(gap_security_level_t security_level)
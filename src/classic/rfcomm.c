@@ -47,8 +47,10 @@
 #include <stdint.h>
 
 #include "bluetooth_sdp.h"
+#include "btstack_crc.h"
 #include "btstack_debug.h"
 #include "btstack_event.h"
+#include "btstack_keyed_index.h"
 #include "btstack_memory.h"
 #include "btstack_util.h"
 #include "classic/core.h"
@@ -71,6 +73,15 @@
 
 #define RFCOMM_CREDITS 10
 
+// size of index to find channel by rfcomm cid, linear search is used if more channels are open
+#ifndef RFCOMM_CHANNEL_INDEX_SIZE
+#if !defined(HAVE_MALLOC) && defined(MAX_NR_RFCOMM_CHANNELS)
+#define RFCOMM_CHANNEL_INDEX_SIZE BTSTACK_KEYED_INDEX_SIZE_FOR(MAX_NR_RFCOMM_CHANNELS)
+#else
+#define RFCOMM_CHANNEL_INDEX_SIZE 32
+#endif
+#endif
+
 // FCS calc 
 #define BT_RFCOMM_CODE_WORD         0xE0 // pol = x8+x2+x1+1
 #define BT_RFCOMM_CRC_CHECK_LEN     3
@@ -132,6 +143,10 @@ static btstack_linked_list_t rfcomm_multiplexers = NULL;
 static btstack_linked_list_t rfcomm_channels = NULL;
 static btstack_linked_list_t rfcomm_services = NULL;
 
+// index of rfcomm_channels by rfcomm_cid
+static btstack_keyed_index_t       rfcomm_channel_index;
+static btstack_keyed_index_entry_t rfcomm_channel_index_entries[RFCOMM_CHANNEL_INDEX_SIZE];
+
 static gap_security_level_t rfcomm_security_level;
 
 static int  rfcomm_channel_can_send(rfcomm_channel_t * channel);
@@ -407,8 +422,12 @@ static rfcomm_channel_t * rfcomm_channel_create(rfcomm_multiplexer_t * multiplex
     log_info("rfcomm_channel_create for service %p, channel %u --- list of channels:", service, server_channel);
     rfcomm_dump_channels();
 
-    // alloc structure 
-    rfcomm_channel_t * channel = btstack_memory_rfcomm_channel_get();
+    // alloc structure, from memory of connection if multiplexer is open
+    hci_con_handle_t con_handle = HCI_CON_HANDLE_INVALID;
+    if (multiplexer->state == RFCOMM_MULTIPLEXER_OPEN){
+        con_handle = multiplexer->con_handle;
+    }
+    rfcomm_channel_t * channel = btstack_memory_rfcomm_channel_get_for_connection(con_handle);
     if (!channel) return NULL;
     
     // fill in 
@@ -416,6 +435,7 @@ static rfcomm_channel_t * rfcomm_channel_create(rfcomm_multiplexer_t * multiplex
     
     // add to services list
     btstack_linked_list_add(&rfcomm_channels, (btstack_linked_item_t *) channel);
+    btstack_keyed_index_add(&rfcomm_channel_index, channel->rfcomm_cid, channel);
     
     return channel;
 }
@@ -433,7 +453,18 @@ static void rfcomm_notify_channel_can_send(void){
     }
 }
 
+// call after channel was removed from rfcomm_channels
+static void rfcomm_channel_index_remove(rfcomm_channel_t * channel){
+    btstack_keyed_index_remove(&rfcomm_channel_index, channel->rfcomm_cid, channel);
+    if (rfcomm_channels == NULL){
+        btstack_keyed_index_clear(&rfcomm_channel_index);
+    }
+}
+
 static rfcomm_channel_t * rfcomm_channel_for_rfcomm_cid(uint16_t rfcomm_cid){
+    if (btstack_keyed_index_is_complete(&rfcomm_channel_index)){
+        return (rfcomm_channel_t *) btstack_keyed_index_get(&rfcomm_channel_index, rfcomm_cid);
+    }
     btstack_linked_item_t *it;
     for (it = (btstack_linked_item_t *) rfcomm_channels; it ; it = it->next){
         rfcomm_channel_t * channel = ((rfcomm_channel_t *) it);
@@ -786,6 +817,7 @@ static void rfcomm_multiplexer_finalize(rfcomm_multiplexer_t * multiplexer){
             }
             // remove from list
             it->next = it->next->next;
+            rfcomm_channel_index_remove(channel);
             // free channel struct
             btstack_memory_rfcomm_channel_free(channel);
         } else {
@@ -988,6 +1020,7 @@ static int rfcomm_hci_event_handler(uint8_t *packet, uint16_t size){
                     if (channel->multiplexer == multiplexer){
                         rfcomm_emit_channel_opened(channel, status);
                         it->next = it->next->next;
+                        rfcomm_channel_index_remove(channel);
                         btstack_memory_rfcomm_channel_free(channel);
                     } else {
                         it = it->next;
@@ -1341,6 +1374,7 @@ static void rfcomm_channel_finalize(rfcomm_channel_t *channel){
 
     // remove from list
     btstack_linked_list_remove( &rfcomm_channels, (btstack_linked_item_t *) channel);
+    rfcomm_channel_index_remove(channel);
 
     // free channel
     btstack_memory_rfcomm_channel_free(channel);
@@ -2021,6 +2055,7 @@ void rfcomm_init(void){
     rfcomm_multiplexers = NULL;
     rfcomm_services     = NULL;
     rfcomm_channels     = NULL;
+    btstack_keyed_index_init(&rfcomm_channel_index, rfcomm_channel_index_entries, RFCOMM_CHANNEL_INDEX_SIZE);
     rfcomm_security_level = LEVEL_2;
 }
 
@@ -2392,38 +2427,12 @@ void rfcomm_grant_credits(uint16_t rfcomm_cid, uint8_t credits){
 }
 
 
-/*  
- * CRC (reversed crc) lookup table as calculated by the table generator in ETSI TS 101 369 V6.3.0.
- */
-static const uint8_t crc8table[256] = {    /* reversed, 8-bit, poly=0x07 */
-    0x00, 0x91, 0xE3, 0x72, 0x07, 0x96, 0xE4, 0x75, 0x0E, 0x9F, 0xED, 0x7C, 0x09, 0x98, 0xEA, 0x7B,
-    0x1C, 0x8D, 0xFF, 0x6E, 0x1B, 0x8A, 0xF8, 0x69, 0x12, 0x83, 0xF1, 0x60, 0x15, 0x84, 0xF6, 0x67,
-    0x38, 0xA9, 0xDB, 0x4A, 0x3F, 0xAE, 0xDC, 0x4D, 0x36, 0xA7, 0xD5, 0x44, 0x31, 0xA0, 0xD2, 0x43,
-    0x24, 0xB5, 0xC7, 0x56, 0x23, 0xB2, 0xC0, 0x51, 0x2A, 0xBB, 0xC9, 0x58, 0x2D, 0xBC, 0xCE, 0x5F,
-    0x70, 0xE1, 0x93, 0x02, 0x77, 0xE6, 0x94, 0x05, 0x7E, 0xEF, 0x9D, 0x0C, 0x79, 0xE8, 0x9A, 0x0B,
-    0x6C, 0xFD, 0x8F, 0x1E, 0x6B, 0xFA, 0x88, 0x19, 0x62, 0xF3, 0x81, 0x10, 0x65, 0xF4, 0x86, 0x17,
-    0x48, 0xD9, 0xAB, 0x3A, 0x4F, 0xDE, 0xAC, 0x3D, 0x46, 0xD7, 0xA5, 0x34, 0x41, 0xD0, 0xA2, 0x33,
-    0x54, 0xC5, 0xB7, 0x26, 0x53, 0xC2, 0xB0, 0x21, 0x5A, 0xCB, 0xB9, 0x28, 0x5D, 0xCC, 0xBE, 0x2F,
-    0xE0, 0x71, 0x03, 0x92, 0xE7, 0x76, 0x04, 0x95, 0xEE, 0x7F, 0x0D, 0x9C, 0xE9, 0x78, 0x0A, 0x9B,
-    0xFC, 0x6D, 0x1F, 0x8E, 0xFB, 0x6A, 0x18, 0x89, 0xF2, 0x63, 0x11, 0x80, 0xF5, 0x64, 0x16, 0x87,
-    0xD8, 0x49, 0x3B, 0xAA, 0xDF, 0x4E, 0x3C, 0xAD, 0xD6, 0x47, 0x35, 0xA4, 0xD1, 0x40, 0x32, 0xA3,
-    0xC4, 0x55, 0x27, 0xB6, 0xC3, 0x52, 0x20, 0xB1, 0xCA, 0x5B, 0x29, 0xB8, 0xCD, 0x5C, 0x2E, 0xBF,
-    0x90, 0x01, 0x73, 0xE2, 0x97, 0x06, 0x74, 0xE5, 0x9E, 0x0F, 0x7D, 0xEC, 0x99, 0x08, 0x7A, 0xEB,
-    0x8C, 0x1D, 0x6F, 0xFE, 0x8B, 0x1A, 0x68, 0xF9, 0x82, 0x13, 0x61, 0xF0, 0x85, 0x14, 0x66, 0xF7,
-    0xA8, 0x39, 0x4B, 0xDA, 0xAF, 0x3E, 0x4C, 0xDD, 0xA6, 0x37, 0x45, 0xD4, 0xA1, 0x30, 0x42, 0xD3,
-    0xB4, 0x25, 0x57, 0xC6, 0xB3, 0x22, 0x50, 0xC1, 0xBA, 0x2B, 0x59, 0xC8, 0xBD, 0x2C, 0x5E, 0xCF
-};
-
 #define CRC8_INIT  0xFF          // Initial FCS value 
 #define CRC8_OK    0xCF          // Good final FCS value 
 /*-----------------------------------------------------------------------------------*/
 static uint8_t crc8(uint8_t *data, uint16_t len)
 {
-    uint16_t count;
-    uint8_t crc = CRC8_INIT;
-    for (count = 0; count < len; count++)
-        crc = crc8table[crc ^ data[count]];
-    return crc;
+    return btstack_crc8_update(CRC8_INIT, data, len);
 }
 
 /*-----------------------------------------------------------------------------------*/
@@ -2433,7 +2442,7 @@ uint8_t crc8_check(uint8_t *data, uint16_t len, uint8_t check_sum)
     
     crc = crc8(data, len);
     
-    crc = crc8table[crc ^ check_sum];
+    crc = btstack_crc8_update(crc, &check_sum, 1);
     if (crc == CRC8_OK) 
         return 0;               /* Valid */
     else 
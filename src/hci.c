@@ -62,6 +62,7 @@
 #endif
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <inttypes.h>
@@ -149,9 +150,13 @@ static void hci_emit_hci_open_failed(void);
 static void hci_emit_dedicated_bonding_result(bd_addr_t address, uint8_t status);
 static void hci_emit_event(uint8_t * event, uint16_t size, int dump);
 static void hci_emit_acl_packet(uint8_t * packet, uint16_t size);
+static void hci_acl_recombination_stop(hci_connection_t * conn);
 static void hci_run(void);
 static int  hci_is_le_connection(hci_connection_t * connection);
 static int  hci_number_free_acl_slots_for_connection_type( bd_addr_type_t address_type);
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+static void hci_acl_tx_queue_flush(hci_connection_t * connection);
+#endif
 
 #ifdef ENABLE_BLE
 #ifdef ENABLE_LE_CENTRAL
@@ -172,6 +177,127 @@ static hci_stack_t * hci_stack = NULL;
 static uint8_t disable_l2cap_timeouts = 0;
 #endif
 
+// connection index
+#define HCI_CONNECTION_INDEX_MASK (HCI_CONNECTION_INDEX_SIZE - 1)
+
+static int hci_connection_index_hash_handle(hci_con_handle_t con_handle){
+    // controllers often assign handles sequentially, Fibonacci hashing spreads them anyway
+    return (int) ((((uint32_t) con_handle) * 2654435761u) >> 16) & HCI_CONNECTION_INDEX_MASK;
+}
+
+static int hci_connection_index_hash_address(const uint8_t * addr, bd_addr_type_t addr_type){
+    // FNV-1a over address and type
+    uint32_t hash = 2166136261u;
+    int i;
+    for (i = 0; i < 6; i++){
+        hash = (hash ^ addr[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint8_t) addr_type) * 16777619u;
+    return (int) (hash ^ (hash >> 16)) & HCI_CONNECTION_INDEX_MASK;
+}
+
+static int hci_connection_index_hash(hci_connection_t ** table, hci_connection_t * conn){
+    if (table == hci_stack->connection_index_handle){
+        return hci_connection_index_hash_handle(conn->con_handle);
+    }
+    return hci_connection_index_hash_address(conn->address, conn->address_type);
+}
+
+// @returns 0 if added, -1 if table is (too) full
+static int hci_connection_index_add(hci_connection_t ** table, uint16_t * count, hci_connection_t * conn){
+    // keep at least one free slot to terminate probing
+    if (*count >= HCI_CONNECTION_INDEX_SIZE - 1) return -1;
+    int pos = hci_connection_index_hash(table, conn);
+    while (table[pos]){
+        pos = (pos + 1) & HCI_CONNECTION_INDEX_MASK;
+    }
+    table[pos] = conn;
+    (*count)++;
+    return 0;
+}
+
+// @returns 0 if removed, -1 if not found
+static int hci_connection_index_remove(hci_connection_t ** table, uint16_t * count, hci_connection_t * conn){
+    int pos = hci_connection_index_hash(table, conn);
+    while (table[pos] != conn){
+        if (table[pos] == NULL) return -1;
+        pos = (pos + 1) & HCI_CONNECTION_INDEX_MASK;
+    }
+    table[pos] = NULL;
+    (*count)--;
+    // backward shift deletion: move following entries of the cluster into the gap if their home slot allows it
+    int gap = pos;
+    pos = (pos + 1) & HCI_CONNECTION_INDEX_MASK;
+    while (table[pos]){
+        int home = hci_connection_index_hash(table, table[pos]);
+        // entry can be moved if its home is not in the cyclic range (gap, pos]
+        int distance_home = (pos - home) & HCI_CONNECTION_INDEX_MASK;
+        int distance_gap  = (pos - gap)  & HCI_CONNECTION_INDEX_MASK;
+        if (distance_home >= distance_gap){
+            table[gap] = table[pos];
+            table[pos] = NULL;
+            gap = pos;
+        }
+        pos = (pos + 1) & HCI_CONNECTION_INDEX_MASK;
+    }
+    return 0;
+}
+
+static void hci_connection_index_reset(void){
+    memset(hci_stack->connection_index_handle,  0, sizeof(hci_stack->connection_index_handle));
+    memset(hci_stack->connection_index_address, 0, sizeof(hci_stack->connection_index_address));
+    hci_stack->connection_index_handle_count  = 0;
+    hci_stack->connection_index_address_count = 0;
+    hci_stack->connection_index_overflow = 0;
+}
+
+static void hci_connection_index_overflow(void){
+    if (hci_stack->connection_index_overflow) return;
+    log_info("connection index full, fall back to linear search");
+    hci_stack->connection_index_overflow = 1;
+}
+
+static void hci_connection_index_add_address(hci_connection_t * conn){
+    if (hci_connection_index_add(hci_stack->connection_index_address, &hci_stack->connection_index_address_count, conn) == 0) return;
+    hci_connection_index_overflow();
+}
+
+static void hci_connection_index_add_handle(hci_connection_t * conn){
+    if (hci_connection_index_add(hci_stack->connection_index_handle, &hci_stack->connection_index_handle_count, conn) == 0) return;
+    hci_connection_index_overflow();
+}
+
+static void hci_connection_set_con_handle(hci_connection_t * conn, hci_con_handle_t con_handle){
+    if (conn->con_handle != HCI_CON_HANDLE_INVALID){
+        hci_connection_index_remove(hci_stack->connection_index_handle, &hci_stack->connection_index_handle_count, conn);
+    }
+    conn->con_handle = con_handle;
+    if (conn->con_handle != HCI_CON_HANDLE_INVALID){
+        hci_connection_index_add_handle(conn);
+    }
+}
+
+// remove connection from connections list and index, and free it
+static void hci_connection_free(hci_connection_t * conn){
+    if (conn->con_handle != HCI_CON_HANDLE_INVALID){
+        hci_connection_index_remove(hci_stack->connection_index_handle, &hci_stack->connection_index_handle_count, conn);
+    }
+    hci_connection_index_remove(hci_stack->connection_index_address, &hci_stack->connection_index_address_count, conn);
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    hci_acl_tx_queue_flush(conn);
+#endif
+    hci_acl_recombination_stop(conn);
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+    btstack_memory_arena_release(conn->memory_arena);
+#endif
+    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+    btstack_memory_hci_connection_free( conn );
+    // index is complete again after all connections are gone
+    if (hci_stack->connections == NULL){
+        hci_connection_index_reset();
+    }
+}
+
 /**
  * create connection for given address
  *
@@ -184,7 +310,7 @@ static hci_connection_t * create_connection_for_bd_addr_and_type(bd_addr_t addr,
     memset(conn, 0, sizeof(hci_connection_t));
     bd_addr_copy(conn->address, addr);
     conn->address_type = addr_type;
-    conn->con_handle = 0xffff;
+    conn->con_handle = HCI_CON_HANDLE_INVALID;
     conn->authentication_flags = AUTH_FLAGS_NONE;
     conn->bonding_flags = 0;
     conn->requested_security_level = LEVEL_0;
@@ -195,10 +321,14 @@ static hci_connection_t * create_connection_for_bd_addr_and_type(bd_addr_t addr,
 #endif
     conn->acl_recombination_length = 0;
     conn->acl_recombination_pos = 0;
+    conn->acl_recombination_buffer = NULL;
     conn->num_acl_packets_sent = 0;
     conn->num_sco_packets_sent = 0;
     conn->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
+    conn->acl_priority = HCI_ACL_PRIORITY_NORMAL;
+    conn->acl_weight = 1;
     btstack_linked_list_add(&hci_stack->connections, (btstack_linked_item_t *) conn);
+    hci_connection_index_add_address(conn);
     return conn;
 }
 
@@ -237,6 +367,16 @@ void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
  * @return connection OR NULL, if not found
  */
 hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+    // connections without handle are not indexed
+    if (!hci_stack->connection_index_overflow && con_handle != HCI_CON_HANDLE_INVALID){
+        int pos = hci_connection_index_hash_handle(con_handle);
+        hci_connection_t * item;
+        while ((item = hci_stack->connection_index_handle[pos]) != NULL){
+            if (item->con_handle == con_handle) return item;
+            pos = (pos + 1) & HCI_CONNECTION_INDEX_MASK;
+        }
+        return NULL;
+    }
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &hci_stack->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -254,6 +394,15 @@ hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
  * @return connection OR NULL, if not found
  */
 hci_connection_t * hci_connection_for_bd_addr_and_type(bd_addr_t  addr, bd_addr_type_t addr_type){
+    if (!hci_stack->connection_index_overflow){
+        int pos = hci_connection_index_hash_address(addr, addr_type);
+        hci_connection_t * connection;
+        while ((connection = hci_stack->connection_index_address[pos]) != NULL){
+            if (connection->address_type == addr_type && memcmp(addr, connection->address, 6) == 0) return connection;
+            pos = (pos + 1) & HCI_CONNECTION_INDEX_MASK;
+        }
+        return NULL;
+    }
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &hci_stack->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
@@ -447,6 +596,111 @@ static int hci_number_free_sco_slots(void){
 }
 #endif
 
+// ACL scheduler
+
+// bytes per round and weight for deficit round robin
+static int32_t hci_acl_scheduler_quantum(hci_connection_t * connection){
+    int32_t quantum = hci_stack->acl_data_packet_length;
+    if (hci_is_le_connection(connection) && hci_stack->le_data_packets_length > 0){
+        quantum = hci_stack->le_data_packets_length;
+    }
+    if (quantum == 0){
+        quantum = HCI_ACL_PAYLOAD_SIZE;
+    }
+    return quantum * connection->acl_weight;
+}
+
+// get first ready connection of given priority, starting after the connection that sent last
+static hci_connection_t * hci_acl_scheduler_next_ready(uint8_t priority, int with_deficit){
+    hci_connection_t * first_ready = NULL;
+    int after_last = 0;
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+        hci_connection_t * connection = (hci_connection_t *) it;
+        if (connection->acl_scheduler_ready && connection->acl_priority == priority && (!with_deficit || connection->acl_deficit > 0)){
+            if (after_last) return connection;
+            if (!first_ready){
+                first_ready = connection;
+            }
+        }
+        if (connection->con_handle == hci_stack->acl_scheduler_last_handle){
+            after_last = 1;
+        }
+    }
+    // wrap around
+    return first_ready;
+}
+
+hci_connection_t * hci_acl_scheduler_select(int (*is_ready)(hci_connection_t * connection, void * context), void * context){
+    // find ready connections and highest priority among them
+    int num_ready = 0;
+    uint8_t priority = HCI_ACL_PRIORITY_NORMAL;
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+        hci_connection_t * connection = (hci_connection_t *) it;
+        connection->acl_scheduler_ready = (*is_ready)(connection, context) ? 1 : 0;
+        if (!connection->acl_scheduler_ready){
+            // idle connections don't accumulate deficit
+            if (connection->acl_deficit > 0){
+                connection->acl_deficit = 0;
+            }
+            continue;
+        }
+        if (num_ready == 0 || connection->acl_priority > priority){
+            priority = connection->acl_priority;
+        }
+        num_ready++;
+    }
+    if (num_ready == 0) return NULL;
+
+    hci_connection_t * selected = NULL;
+    switch (hci_stack->acl_scheduler){
+        case HCI_ACL_SCHEDULER_ROUND_ROBIN:
+            selected = hci_acl_scheduler_next_ready(priority, 0);
+            break;
+        case HCI_ACL_SCHEDULER_DEFICIT_ROUND_ROBIN:
+            while (1){
+                selected = hci_acl_scheduler_next_ready(priority, 1);
+                if (selected) break;
+                // new round: add quantum to all ready connections
+                for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+                    hci_connection_t * connection = (hci_connection_t *) it;
+                    if (!connection->acl_scheduler_ready) continue;
+                    if (connection->acl_priority != priority) continue;
+                    connection->acl_deficit += hci_acl_scheduler_quantum(connection);
+                }
+            }
+            break;
+        default:
+            for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+                hci_connection_t * connection = (hci_connection_t *) it;
+                if (!connection->acl_scheduler_ready) continue;
+                if (connection->acl_priority != priority) continue;
+                selected = connection;
+                break;
+            }
+            break;
+    }
+
+    // count ready connections that have to wait
+    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+        hci_connection_t * connection = (hci_connection_t *) it;
+        if (connection->acl_scheduler_ready && connection != selected){
+            connection->acl_scheduler_deferred++;
+        }
+        connection->acl_scheduler_ready = 0;
+    }
+    return selected;
+}
+
+// track ACL packet of given size, before fragmentation
+static void hci_acl_scheduler_packet_sent(hci_connection_t * connection, uint16_t size){
+    hci_stack->acl_scheduler_last_handle = connection->con_handle;
+    if (hci_stack->acl_scheduler == HCI_ACL_SCHEDULER_DEFICIT_ROUND_ROBIN){
+        connection->acl_deficit -= size;
+    }
+}
+
 // only used to send HCI Host Number Completed Packets
 static int hci_can_send_comand_packet_transport(void){
     if (hci_stack->hci_packet_buffer_reserved) return 0;
@@ -472,19 +726,64 @@ static int hci_transport_can_send_prepared_packet_now(uint8_t packet_type){
     return hci_stack->hci_transport->can_send_packet_now(packet_type);
 }
 
-static int hci_can_send_prepared_acl_packet_for_address_type(bd_addr_type_t address_type){
+// check if controller can take next ACL packet/fragment for given handle
+static int hci_controller_can_send_acl_packet_now(hci_con_handle_t con_handle){
+    if (!hci_transport_can_send_prepared_packet_now(HCI_ACL_DATA_PACKET)) return 0;
+    return hci_number_free_acl_slots_for_handle(con_handle) > 0;
+}
+
+// check if controller can take next ACL packet/fragment for connections of given type
+static int hci_controller_can_send_acl_packet_for_address_type(bd_addr_type_t address_type){
     if (!hci_transport_can_send_prepared_packet_now(HCI_ACL_DATA_PACKET)) return 0;
     return hci_number_free_acl_slots_for_connection_type(address_type) > 0;
 }
 
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+// packet can be sent directly if it doesn't overtake queued packets
+static int hci_acl_tx_can_send_direct(hci_connection_t * connection){
+    if (hci_stack->acl_tx_buffer_active) return 0;
+    if (connection->acl_tx_queue) return 0;
+    return hci_controller_can_send_acl_packet_now(connection->con_handle);
+}
+
+// packet for any connection of given type can be sent directly if it doesn't overtake queued packets
+static int hci_acl_tx_can_send_direct_for_address_type(bd_addr_type_t address_type){
+    if (hci_stack->acl_tx_buffer_active) return 0;
+    if (address_type == BD_ADDR_TYPE_CLASSIC){
+        if (hci_stack->acl_tx_num_queued_classic) return 0;
+    } else {
+        if (hci_stack->acl_tx_num_queued_le) return 0;
+    }
+    return hci_controller_can_send_acl_packet_for_address_type(address_type);
+}
+#endif
+
+// same checks as hci_can_send_prepared_acl_packet_now, used if connection is not known
+static int hci_can_send_prepared_acl_packet_for_address_type(bd_addr_type_t address_type){
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // packet gets queued
+    if (hci_stack->acl_tx_buffers_free) return 1;
+    return hci_acl_tx_can_send_direct_for_address_type(address_type);
+#else
+    return hci_controller_can_send_acl_packet_for_address_type(address_type);
+#endif
+}
+
 int hci_can_send_acl_le_packet_now(void){
     if (hci_stack->hci_packet_buffer_reserved) return 0;
     return hci_can_send_prepared_acl_packet_for_address_type(BD_ADDR_TYPE_LE_PUBLIC);
 }
 
 int hci_can_send_prepared_acl_packet_now(hci_con_handle_t con_handle) {
-    if (!hci_transport_can_send_prepared_packet_now(HCI_ACL_DATA_PACKET)) return 0;
-    return hci_number_free_acl_slots_for_handle(con_handle) > 0;
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // packet gets queued
+    if (hci_stack->acl_tx_buffers_free) return 1;
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) return 0;
+    return hci_acl_tx_can_send_direct(connection);
+#else
+    return hci_controller_can_send_acl_packet_now(con_handle);
+#endif
 }
 
 int hci_can_send_acl_packet_now(hci_con_handle_t con_handle){
@@ -534,6 +833,89 @@ void hci_release_packet_buffer(void){
     hci_stack->hci_packet_buffer_reserved = 0;
 }
 
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+static hci_acl_tx_buffer_t * hci_acl_tx_buffer_for_packet(uint8_t * packet){
+    return (hci_acl_tx_buffer_t *) (packet - HCI_OUTGOING_PRE_BUFFER_SIZE - offsetof(hci_acl_tx_buffer_t, data));
+}
+
+static void hci_acl_tx_buffers_init(void){
+    int i;
+    hci_stack->acl_tx_buffers_free = NULL;
+    for (i = 0; i < HCI_ACL_TX_BUFFERS; i++){
+        btstack_linked_list_add(&hci_stack->acl_tx_buffers_free, (btstack_linked_item_t *) &hci_stack->acl_tx_buffers[i]);
+    }
+    hci_stack->acl_tx_buffer_active = NULL;
+    hci_stack->acl_tx_buffer_in_transport = 0;
+    hci_stack->acl_tx_num_queued_classic = 0;
+    hci_stack->acl_tx_num_queued_le = 0;
+}
+
+uint8_t * hci_acl_tx_buffer_reserve(void){
+    hci_acl_tx_buffer_t * buffer = (hci_acl_tx_buffer_t *) btstack_linked_list_pop(&hci_stack->acl_tx_buffers_free);
+    if (!buffer) return NULL;
+    return &buffer->data[HCI_OUTGOING_PRE_BUFFER_SIZE];
+}
+
+void hci_acl_tx_buffer_release(uint8_t * packet){
+    btstack_linked_list_add(&hci_stack->acl_tx_buffers_free, (btstack_linked_item_t *) hci_acl_tx_buffer_for_packet(packet));
+}
+
+static void hci_acl_tx_buffer_active_release(void){
+    btstack_linked_list_add(&hci_stack->acl_tx_buffers_free, (btstack_linked_item_t *) hci_stack->acl_tx_buffer_active);
+    hci_stack->acl_tx_buffer_active = NULL;
+}
+
+static void hci_acl_tx_queue_add(hci_connection_t * connection, hci_acl_tx_buffer_t * buffer){
+    btstack_linked_list_add_tail(&connection->acl_tx_queue, (btstack_linked_item_t *) buffer);
+    if (connection->address_type == BD_ADDR_TYPE_CLASSIC){
+        hci_stack->acl_tx_num_queued_classic++;
+    } else {
+        hci_stack->acl_tx_num_queued_le++;
+    }
+}
+
+static hci_acl_tx_buffer_t * hci_acl_tx_queue_pop(hci_connection_t * connection){
+    hci_acl_tx_buffer_t * buffer = (hci_acl_tx_buffer_t *) btstack_linked_list_pop(&connection->acl_tx_queue);
+    if (connection->address_type == BD_ADDR_TYPE_CLASSIC){
+        hci_stack->acl_tx_num_queued_classic--;
+    } else {
+        hci_stack->acl_tx_num_queued_le--;
+    }
+    return buffer;
+}
+
+// drop queued packets of connection
+static void hci_acl_tx_queue_flush(hci_connection_t * connection){
+    while (connection->acl_tx_queue){
+        hci_acl_tx_buffer_t * buffer = hci_acl_tx_queue_pop(connection);
+        btstack_linked_list_add(&hci_stack->acl_tx_buffers_free, (btstack_linked_item_t *) buffer);
+    }
+}
+#endif
+
+// release buffer used for ACL fragmentation after last fragment was sent
+static void hci_acl_fragmentation_release_buffer(void){
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    if (hci_stack->acl_tx_buffer_active){
+        hci_acl_tx_buffer_active_release();
+        return;
+    }
+#endif
+    hci_release_packet_buffer();
+}
+
+// drop remaining fragments, e.g. as connection is gone
+static void hci_acl_fragmentation_drop(void){
+    hci_stack->acl_fragmentation_total_size = 0;
+    hci_stack->acl_fragmentation_pos = 0;
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // if still in transport, it's released on HCI_EVENT_TRANSPORT_PACKET_SENT
+    if (hci_stack->acl_tx_buffer_active && !hci_stack->acl_tx_buffer_in_transport){
+        hci_acl_tx_buffer_active_release();
+    }
+#endif
+}
+
 // assumption: synchronous implementations don't provide can_send_packet_now as they don't keep the buffer after the call
 static int hci_transport_synchronous(void){
     return hci_stack->hci_transport->can_send_packet_now == NULL;
@@ -573,16 +955,18 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
 
         // copy handle_and_flags if not first fragment and update packet boundary flags to be 01 (continuing fragmnent)
         if (acl_header_pos > 0){
-            uint16_t handle_and_flags = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
+            uint16_t handle_and_flags = little_endian_read_16(hci_stack->acl_fragmentation_buffer, 0);
             handle_and_flags = (handle_and_flags & 0xcfff) | (1 << 12);
-            little_endian_store_16(hci_stack->hci_packet_buffer, acl_header_pos, handle_and_flags);
+            little_endian_store_16(hci_stack->acl_fragmentation_buffer, acl_header_pos, handle_and_flags);
         }
 
         // update header len
-        little_endian_store_16(hci_stack->hci_packet_buffer, acl_header_pos + 2, current_acl_data_packet_length);
+        little_endian_store_16(hci_stack->acl_fragmentation_buffer, acl_header_pos + 2, current_acl_data_packet_length);
 
         // count packet
         connection->num_acl_packets_sent++;
+        connection->acl_packets_sent_total++;
+        connection->acl_bytes_sent_total += current_acl_data_packet_length;
         log_debug("hci_send_acl_packet_fragments loop before send (more fragments %d)", more_fragments);
 
         // update state for next fragment (if any) as "transport done" might be sent during send_packet already
@@ -596,9 +980,14 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         }
 
         // send packet
-        uint8_t * packet = &hci_stack->hci_packet_buffer[acl_header_pos];
+        uint8_t * packet = &hci_stack->acl_fragmentation_buffer[acl_header_pos];
         const int size = current_acl_data_packet_length + 4;
         hci_dump_packet(HCI_ACL_DATA_PACKET, 0, packet, size);
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+        if (hci_stack->acl_tx_buffer_active && !hci_transport_synchronous()){
+            hci_stack->acl_tx_buffer_in_transport = 1;
+        }
+#endif
         err = hci_stack->hci_transport->send_packet(HCI_ACL_DATA_PACKET, packet, size);
 
         log_debug("hci_send_acl_packet_fragments loop after send (more fragments %d)", more_fragments);
@@ -607,14 +996,14 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         if (!more_fragments) break;
 
         // can send more?
-        if (!hci_can_send_prepared_acl_packet_now(connection->con_handle)) return err;
+        if (!hci_controller_can_send_acl_packet_now(connection->con_handle)) return err;
     }
 
     log_debug("hci_send_acl_packet_fragments loop over");
 
     // release buffer now for synchronous transport
     if (hci_transport_synchronous()){
-        hci_release_packet_buffer();
+        hci_acl_fragmentation_release_buffer();
         // notify upper stack that it might be possible to send again
         uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
         hci_emit_event(&event[0], sizeof(event), 0);  // don't dump
@@ -636,8 +1025,25 @@ int hci_send_acl_packet_buffer(int size){
     uint8_t * packet = hci_stack->hci_packet_buffer;
     hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(packet);
 
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // send directly if the packet doesn't overtake queued packets and the controller can take it.
+    // otherwise, copy into outgoing ACL buffer and queue it, so that the hci packet buffer is free for the next packet
+    hci_connection_t * queue_connection = hci_connection_for_handle(con_handle);
+    if (queue_connection && !hci_acl_tx_can_send_direct(queue_connection)){
+        uint8_t * acl_buffer = (size <= HCI_ACL_BUFFER_SIZE) ? hci_acl_tx_buffer_reserve() : NULL;
+        if (!acl_buffer){
+            log_error("hci_send_acl_packet_buffer called but no free ACL buffers");
+            hci_release_packet_buffer();
+            return BTSTACK_ACL_BUFFERS_FULL;
+        }
+        memcpy(acl_buffer, packet, size);
+        hci_release_packet_buffer();
+        return hci_acl_tx_buffer_send(acl_buffer, size);
+    }
+#endif
+
     // check for free places on Bluetooth module
-    if (!hci_can_send_prepared_acl_packet_now(con_handle)) {
+    if (!hci_controller_can_send_acl_packet_now(con_handle)) {
         log_error("hci_send_acl_packet_buffer called but no free ACL buffers on controller");
         hci_release_packet_buffer();
         return BTSTACK_ACL_BUFFERS_FULL;
@@ -656,13 +1062,74 @@ int hci_send_acl_packet_buffer(int size){
 
     // hci_dump_packet( HCI_ACL_DATA_PACKET, 0, packet, size);
 
+    hci_acl_scheduler_packet_sent(connection, size);
+
     // setup data
+    hci_stack->acl_fragmentation_buffer = hci_stack->hci_packet_buffer;
     hci_stack->acl_fragmentation_total_size = size;
     hci_stack->acl_fragmentation_pos = 4;   // start of L2CAP packet
 
     return hci_send_acl_packet_fragments(connection);
 }
 
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+static int hci_acl_tx_queue_ready(hci_connection_t * connection, void * context){
+    UNUSED(context);
+    if (!connection->acl_tx_queue) return 0;
+    return hci_controller_can_send_acl_packet_now(connection->con_handle);
+}
+
+// send queued ACL packets. @returns 1 if packet was sent and transport is busy now
+static int hci_acl_tx_queue_run(void){
+    while (1){
+        // only one packet can be fragmented at a time
+        if (hci_stack->acl_tx_buffer_active) return 0;
+        if (hci_stack->acl_fragmentation_total_size) return 0;
+
+        hci_connection_t * connection = hci_acl_scheduler_select(&hci_acl_tx_queue_ready, NULL);
+        if (!connection) return 0;
+
+        hci_acl_tx_buffer_t * buffer = hci_acl_tx_queue_pop(connection);
+        hci_stack->acl_tx_buffer_active = buffer;
+        hci_acl_scheduler_packet_sent(connection, buffer->size);
+
+#ifdef ENABLE_CLASSIC
+        hci_connection_timestamp(connection);
+#endif
+
+        // setup data
+        hci_stack->acl_fragmentation_buffer = &buffer->data[HCI_OUTGOING_PRE_BUFFER_SIZE];
+        hci_stack->acl_fragmentation_total_size = buffer->size;
+        hci_stack->acl_fragmentation_pos = 4;   // start of L2CAP packet
+
+        hci_send_acl_packet_fragments(connection);
+
+        // synchronous transport is ready for next packet
+        if (!hci_transport_synchronous()) return 1;
+    }
+}
+
+int hci_acl_tx_buffer_send(uint8_t * packet, uint16_t size){
+    hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(packet);
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) {
+        log_error("hci_acl_tx_buffer_send called but no connection for handle 0x%04x", con_handle);
+        hci_acl_tx_buffer_release(packet);
+        return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    }
+    if (size > HCI_ACL_BUFFER_SIZE){
+        log_error("hci_acl_tx_buffer_send called with size %u > %u", size, HCI_ACL_BUFFER_SIZE);
+        hci_acl_tx_buffer_release(packet);
+        return BTSTACK_ACL_BUFFERS_FULL;
+    }
+    hci_acl_tx_buffer_t * buffer = hci_acl_tx_buffer_for_packet(packet);
+    buffer->size = size;
+    hci_acl_tx_queue_add(connection, buffer);
+    hci_acl_tx_queue_run();
+    return 0;
+}
+#endif
+
 #ifdef ENABLE_CLASSIC
 // pre: caller has reserved the packet buffer
 int hci_send_sco_packet_buffer(int size){
@@ -711,6 +1178,79 @@ int hci_send_sco_packet_buffer(int size){
 }
 #endif
 
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+static void hci_acl_recombination_buffers_init(void){
+    int i;
+    hci_stack->acl_recombination_buffers_free = NULL;
+    for (i = 0; i < HCI_ACL_RECOMBINATION_BUFFERS; i++){
+        btstack_linked_list_add(&hci_stack->acl_recombination_buffers_free, (btstack_linked_item_t *) &hci_stack->acl_recombination_buffers[i]);
+    }
+}
+#endif
+
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+btstack_memory_arena_t * hci_connection_get_memory_arena(hci_con_handle_t con_handle){
+    hci_connection_t * conn = hci_connection_for_handle(con_handle);
+    if (!conn) return NULL;
+    if (!conn->memory_arena){
+        conn->memory_arena = btstack_memory_arena_create();
+    }
+    return conn->memory_arena;
+}
+#endif
+
+void hci_register_acl_recombination_sink_provider(hci_acl_recombination_sink_provider_t provider){
+    hci_stack->acl_recombination_sink_provider = provider;
+}
+
+// select buffer for fragmented L2CAP PDU, returns 0 if none available
+static int hci_acl_recombination_start(hci_connection_t * conn, uint16_t cid, uint16_t l2cap_length){
+    // prefer sink provided by L2CAP, fragments are stored in their final destination
+    if (hci_stack->acl_recombination_sink_provider){
+        uint16_t buffer_size = 0;
+        uint8_t * buffer = (*hci_stack->acl_recombination_sink_provider)(conn->con_handle, cid, l2cap_length, &buffer_size);
+        if (buffer){
+            if (buffer_size >= HCI_INCOMING_PRE_BUFFER_SIZE + 4 + 4 + l2cap_length){
+                conn->acl_recombination_buffer      = buffer;
+                conn->acl_recombination_buffer_size = buffer_size - HCI_INCOMING_PRE_BUFFER_SIZE - 4;
+                return 1;
+            }
+            log_info("ACL recombination sink for cid 0x%02x too small (%u bytes)", cid, buffer_size);
+        }
+    }
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    hci_acl_recombination_buffer_t * pool_buffer = (hci_acl_recombination_buffer_t *) btstack_linked_list_pop(&hci_stack->acl_recombination_buffers_free);
+    if (!pool_buffer) return 0;
+    conn->acl_recombination_pool_buffer = pool_buffer;
+    conn->acl_recombination_buffer      = pool_buffer->data;
+#else
+    conn->acl_recombination_buffer      = conn->acl_recombination_storage;
+#endif
+    conn->acl_recombination_buffer_size = HCI_ACL_BUFFER_SIZE;
+    return 1;
+}
+
+static void hci_acl_recombination_stop(hci_connection_t * conn){
+    conn->acl_recombination_pos    = 0;
+    conn->acl_recombination_length = 0;
+    conn->acl_recombination_buffer = NULL;
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    if (conn->acl_recombination_pool_buffer){
+        btstack_linked_list_add(&hci_stack->acl_recombination_buffers_free, (btstack_linked_item_t *) conn->acl_recombination_pool_buffer);
+        conn->acl_recombination_pool_buffer = NULL;
+    }
+#endif
+}
+
+void hci_acl_recombination_sink_release(hci_con_handle_t con_handle, uint8_t * buffer){
+    hci_connection_t * conn = hci_connection_for_handle(con_handle);
+    if (!conn) return;
+    if (conn->acl_recombination_pos == 0) return;
+    if (conn->acl_recombination_buffer != buffer) return;
+    log_info("ACL recombination sink released, dropping fragments for handle 0x%02x", con_handle);
+    hci_acl_recombination_stop(conn);
+}
+
 static void acl_handler(uint8_t *packet, int size){
 
     // log_info("acl_handler: size %u", size);
@@ -753,10 +1293,10 @@ static void acl_handler(uint8_t *packet, int size){
                 log_error( "ACL Cont Fragment but no first fragment for handle 0x%02x", con_handle);
                 return;
             }
-            if (conn->acl_recombination_pos + acl_length > 4 + HCI_ACL_BUFFER_SIZE){
+            if (conn->acl_recombination_pos + acl_length > 4 + conn->acl_recombination_buffer_size){
                 log_error( "ACL Cont Fragment to large: combined packet %u > buffer size %u for handle 0x%02x",
-                    conn->acl_recombination_pos + acl_length, 4 + HCI_ACL_BUFFER_SIZE, con_handle);
-                conn->acl_recombination_pos = 0;
+                    conn->acl_recombination_pos + acl_length, 4 + conn->acl_recombination_buffer_size, con_handle);
+                hci_acl_recombination_stop(conn);
                 return;
             }
 
@@ -771,8 +1311,7 @@ static void acl_handler(uint8_t *packet, int size){
             if (conn->acl_recombination_pos >= conn->acl_recombination_length + 4 + 4){ // pos already incl. ACL header
                 hci_emit_acl_packet(&conn->acl_recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE], conn->acl_recombination_pos);
                 // reset recombination buffer
-                conn->acl_recombination_length = 0;
-                conn->acl_recombination_pos = 0;
+                hci_acl_recombination_stop(conn);
             }
             break;
             
@@ -781,7 +1320,7 @@ static void acl_handler(uint8_t *packet, int size){
             // sanity check
             if (conn->acl_recombination_pos) {
                 log_error( "ACL First Fragment but data in buffer for handle 0x%02x, dropping stale fragments", con_handle);
-                conn->acl_recombination_pos = 0;
+                hci_acl_recombination_stop(conn);
             }
 
             // peek into L2CAP packet!
@@ -795,9 +1334,15 @@ static void acl_handler(uint8_t *packet, int size){
                 hci_emit_acl_packet(packet, acl_length + 4);
             } else {
 
-                if (acl_length > HCI_ACL_BUFFER_SIZE){
+                if (!hci_acl_recombination_start(conn, READ_L2CAP_CHANNEL_ID(packet), l2cap_length)){
+                    log_error( "ACL First Fragment but no recombination buffer available for handle 0x%02x, dropping packet", con_handle);
+                    return;
+                }
+
+                if (acl_length > conn->acl_recombination_buffer_size){
                     log_error( "ACL First Fragment to large: fragment %u > buffer size %u for handle 0x%02x",
-                        4 + acl_length, 4 + HCI_ACL_BUFFER_SIZE, con_handle);
+                        4 + acl_length, 4 + conn->acl_recombination_buffer_size, con_handle);
+                    hci_acl_recombination_stop(conn);
                     return;
                 }
 
@@ -830,8 +1375,7 @@ static void hci_shutdown_connection(hci_connection_t *conn){
 
     btstack_run_loop_remove_timer(&conn->timeout);
     
-    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-    btstack_memory_hci_connection_free( conn );
+    hci_connection_free(conn);
     
     // now it's gone
     hci_emit_nr_connections_changed();
@@ -899,6 +1443,46 @@ uint16_t hci_usable_acl_packet_types(void){
 }
 #endif
 
+void hci_set_acl_scheduler(hci_acl_scheduler_t scheduler){
+    hci_stack->acl_scheduler = scheduler;
+}
+
+hci_acl_scheduler_t hci_get_acl_scheduler(void){
+    return hci_stack->acl_scheduler;
+}
+
+uint8_t hci_set_acl_priority(hci_con_handle_t con_handle, hci_acl_priority_t priority){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    connection->acl_priority = priority;
+    return 0;
+}
+
+uint8_t hci_set_acl_weight(hci_con_handle_t con_handle, uint16_t weight){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    connection->acl_weight = weight ? weight : 1;
+    return 0;
+}
+
+uint8_t hci_request_acl_scheduler_statistics_event(hci_con_handle_t con_handle){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    uint8_t event[24];
+    event[0] = HCI_EVENT_ACL_SCHEDULER_STATISTICS;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, con_handle);
+    event[4] = connection->acl_priority;
+    little_endian_store_16(event, 5, connection->acl_weight);
+    event[7] = connection->num_acl_packets_sent;
+    little_endian_store_32(event,  8, connection->acl_packets_sent_total);
+    little_endian_store_32(event, 12, connection->acl_bytes_sent_total);
+    little_endian_store_32(event, 16, connection->acl_packets_completed_total);
+    little_endian_store_32(event, 20, connection->acl_scheduler_deferred);
+    hci_emit_event(event, sizeof(event), 1);
+    return 0;
+}
+
 uint8_t* hci_get_outgoing_packet_buffer(void){
     // hci packet buffer is >= acl data packet length
     return hci_stack->hci_packet_buffer;
@@ -1807,6 +2391,7 @@ static void event_handler(uint8_t *packet, int size){
                     hci_notify_if_sco_can_send_now();
 #endif
                 } else {
+                    conn->acl_packets_completed_total += num_packets;
                     if (conn->num_acl_packets_sent >= num_packets){
                         conn->num_acl_packets_sent -= num_packets;
                     } else {
@@ -1866,7 +2451,7 @@ static void event_handler(uint8_t *packet, int size){
             if (conn) {
                 if (!packet[2]){
                     conn->state = OPEN;
-                    conn->con_handle = little_endian_read_16(packet, 3);
+                    hci_connection_set_con_handle(conn, little_endian_read_16(packet, 3));
                     conn->bonding_flags |= BONDING_REQUEST_REMOTE_FEATURES;
 
                     // restart timer
@@ -1883,8 +2468,7 @@ static void event_handler(uint8_t *packet, int size){
                     memcpy(&bd_address, conn->address, 6);
 
                     // connection failed, remove entry
-                    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-                    btstack_memory_hci_connection_free( conn );
+                    hci_connection_free(conn);
                     
                     // notify client if dedicated bonding
                     if (notify_dedicated_bonding_failed){
@@ -1915,7 +2499,7 @@ static void event_handler(uint8_t *packet, int size){
                 break;
             }
             conn->state = OPEN;
-            conn->con_handle = little_endian_read_16(packet, 3);            
+            hci_connection_set_con_handle(conn, little_endian_read_16(packet, 3));            
 
 #ifdef ENABLE_SCO_OVER_HCI
             // update SCO
@@ -2050,10 +2634,9 @@ static void event_handler(uint8_t *packet, int size){
             handle = little_endian_read_16(packet, 3);
             // drop outgoing ACL fragments if it is for closed connection
             if (hci_stack->acl_fragmentation_total_size > 0) {
-                if (handle == READ_ACL_CONNECTION_HANDLE(hci_stack->hci_packet_buffer)){
+                if (handle == READ_ACL_CONNECTION_HANDLE(hci_stack->acl_fragmentation_buffer)){
                     log_info("hci: drop fragmented ACL data for closed connection");
-                     hci_stack->acl_fragmentation_total_size = 0;
-                     hci_stack->acl_fragmentation_pos = 0;
+                    hci_acl_fragmentation_drop();
                 }
             }
 
@@ -2097,8 +2680,19 @@ static void event_handler(uint8_t *packet, int size){
                 log_error("Synchronous HCI Transport shouldn't send HCI_EVENT_TRANSPORT_PACKET_SENT");
                 return; // instead of break: to avoid re-entering hci_run()
             }
-            if (hci_stack->acl_fragmentation_total_size) break;
-            hci_release_packet_buffer();
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+            if (hci_stack->acl_tx_buffer_in_transport){
+                // outgoing ACL buffer was sent, release it if there are no further fragments
+                hci_stack->acl_tx_buffer_in_transport = 0;
+                if (hci_stack->acl_tx_buffer_active && !hci_stack->acl_fragmentation_total_size){
+                    hci_acl_tx_buffer_active_release();
+                }
+            } else
+#endif
+            {
+                if (hci_stack->acl_fragmentation_total_size) break;
+                hci_release_packet_buffer();
+            }
             
             // L2CAP receives this event via the hci_emit_event below
 
@@ -2149,8 +2743,7 @@ static void event_handler(uint8_t *packet, int size){
                         hci_stack->le_connecting_state = LE_CONNECTING_IDLE;
                         // remove entry
                         if (conn){
-                            btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-                            btstack_memory_hci_connection_free( conn );
+                            hci_connection_free(conn);
                         }
                         break;
                     }
@@ -2180,7 +2773,7 @@ static void event_handler(uint8_t *packet, int size){
                     
                     conn->state = OPEN;
                     conn->role  = packet[6];
-                    conn->con_handle = little_endian_read_16(packet, 4);
+                    hci_connection_set_con_handle(conn, little_endian_read_16(packet, 4));
                     
                     // TODO: store - role, peer address type, conn_interval, conn_latency, supervision timeout, master clock
 
@@ -2302,6 +2895,17 @@ void hci_register_sco_packet_handler(btstack_packet_handler_t handler){
 static void hci_state_reset(void){
     // no connections yet
     hci_stack->connections = NULL;
+    hci_connection_index_reset();
+
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // all outgoing ACL buffers are free
+    hci_acl_tx_buffers_init();
+#endif
+
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    // all incoming ACL buffers are free
+    hci_acl_recombination_buffers_init();
+#endif
 
     // keep discoverable/connectable as this has been requested by the client(s)
     // hci_stack->discoverable = 0;
@@ -2806,21 +3410,25 @@ static void hci_run(void){
 
     // send continuation fragments first, as they block the prepared packet buffer
     if (hci_stack->acl_fragmentation_total_size > 0) {
-        hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(hci_stack->hci_packet_buffer);
+        hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(hci_stack->acl_fragmentation_buffer);
         hci_connection_t *connection = hci_connection_for_handle(con_handle);
         if (connection) {
-            if (hci_can_send_prepared_acl_packet_now(con_handle)){
+            if (hci_controller_can_send_acl_packet_now(con_handle)){
                 hci_send_acl_packet_fragments(connection);
                 return;
             }
         } else {
             // connection gone -> discard further fragments
             log_info("hci_run: fragmented ACL packet no connection -> discard fragment");
-            hci_stack->acl_fragmentation_total_size = 0;
-            hci_stack->acl_fragmentation_pos = 0;
+            hci_acl_fragmentation_drop();
         }
     }
 
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // send queued ACL packets
+    if (hci_acl_tx_queue_run()) return;
+#endif
+
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
     // send host num completed packets next as they don't require num_cmd_packets > 0
     if (!hci_can_send_comand_packet_transport()) return;
@@ -3977,8 +4585,7 @@ uint8_t gap_connect_cancel(void){
         case SEND_CREATE_CONNECTION:
             // skip sending create connection and emit event instead
             hci_emit_le_connection_complete(conn->address_type, conn->address, 0, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
-            btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
-            btstack_memory_hci_connection_free( conn );
+            hci_connection_free(conn);
             break;            
         case SENT_CREATE_CONNECTION:
             // request to send cancel connection
@@ -50,6 +50,7 @@
 #include "btstack_chipset.h"
 #include "btstack_control.h"
 #include "btstack_linked_list.h"
+#include "btstack_memory_arena.h"
 #include "btstack_util.h"
 #include "classic/btstack_link_key_db.h"
 #include "hci_cmd.h"
@@ -124,6 +125,46 @@ extern "C" {
 #endif
 #endif
 
+// size of the hash index for connection lookup by handle and by address, must be a power of two
+// with static memory, it's derived from MAX_NR_HCI_CONNECTIONS to keep the load factor at or below 50%
+#ifndef HCI_CONNECTION_INDEX_SIZE
+#if !defined(HAVE_MALLOC) && defined(MAX_NR_HCI_CONNECTIONS)
+    #if MAX_NR_HCI_CONNECTIONS <= 2
+        #define HCI_CONNECTION_INDEX_SIZE 4
+    #elif MAX_NR_HCI_CONNECTIONS <= 4
+        #define HCI_CONNECTION_INDEX_SIZE 8
+    #elif MAX_NR_HCI_CONNECTIONS <= 8
+        #define HCI_CONNECTION_INDEX_SIZE 16
+    #elif MAX_NR_HCI_CONNECTIONS <= 16
+        #define HCI_CONNECTION_INDEX_SIZE 32
+    #elif MAX_NR_HCI_CONNECTIONS <= 32
+        #define HCI_CONNECTION_INDEX_SIZE 64
+    #else
+        #define HCI_CONNECTION_INDEX_SIZE 128
+    #endif
+#else
+    #define HCI_CONNECTION_INDEX_SIZE 32
+#endif
+#endif
+
+#if (HCI_CONNECTION_INDEX_SIZE & (HCI_CONNECTION_INDEX_SIZE - 1)) != 0
+    #error HCI_CONNECTION_INDEX_SIZE must be a power of two
+#endif
+
+// number of outgoing ACL buffers used to queue ACL packets per connection, see ENABLE_HCI_ACL_TX_QUEUE
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+#ifndef HCI_ACL_TX_BUFFERS
+#define HCI_ACL_TX_BUFFERS 4
+#endif
+#endif
+
+// number of ACL recombination buffers shared by all connections, see ENABLE_HCI_ACL_RECOMBINATION_POOL
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+#ifndef HCI_ACL_RECOMBINATION_BUFFERS
+#define HCI_ACL_RECOMBINATION_BUFFERS 2
+#endif
+#endif
+
 // 
 #define IS_COMMAND(packet, command) (little_endian_read_16(packet,0) == command.opcode)
 
@@ -418,11 +459,22 @@ typedef struct sm_connection {
 #define ATT_REQUEST_BUFFER_SIZE HCI_ACL_PAYLOAD_SIZE
 #endif
 
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+// queued notifications per connection in bytes, each needs 4 bytes plus value
+#ifndef ATT_SERVER_NOTIFICATION_QUEUE_SIZE
+#define ATT_SERVER_NOTIFICATION_QUEUE_SIZE 256
+#endif
+#endif
+
 typedef enum {
     ATT_SERVER_IDLE,
     ATT_SERVER_REQUEST_RECEIVED,
     ATT_SERVER_W4_SIGNED_WRITE_VALIDATION,
     ATT_SERVER_REQUEST_RECEIVED_AND_VALIDATED,
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    ATT_SERVER_RESPONSE_PENDING,
+    ATT_SERVER_RESPONSE_READY,
+#endif
 } att_server_state_t;
 
 typedef struct {
@@ -442,6 +494,24 @@ typedef struct {
     uint16_t                request_size;
     uint8_t                 request_buffer[ATT_REQUEST_BUFFER_SIZE];
 
+#ifdef ENABLE_ATT_DELAYED_RESPONSE
+    // response is prepared here and sent when possible
+    uint16_t                response_size;
+    uint8_t                 response_buffer[ATT_REQUEST_BUFFER_SIZE];
+#endif
+
+#ifdef ENABLE_ATT_SERVER_NOTIFICATION_QUEUE
+    // list of { attribute handle, value len, value } - same as in Multiple Handle Value Notification
+    uint8_t                 notification_queue[ATT_SERVER_NOTIFICATION_QUEUE_SIZE];
+    uint16_t                notification_queue_len;
+    uint16_t                notification_queue_count;
+    uint16_t                notification_queue_count_max;
+    uint8_t                 multiple_notifications_enabled;
+    uint32_t                notifications_sent;
+    uint32_t                notification_packets_sent;
+    uint32_t                notifications_dropped;
+#endif
+
 } att_server_t;
 
 #endif
@@ -453,13 +523,42 @@ typedef enum {
     L2CAP_INFORMATION_STATE_W4_EXTENDED_FEATURE_RESPONSE,
     L2CAP_INFORMATION_STATE_DONE
 } l2cap_information_state_t;
+#endif
 
+#ifdef ENABLE_CLASSIC
 typedef struct {
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     l2cap_information_state_t information_state;
     uint16_t                  extended_feature_mask;
+#endif
+    // Automatic Flush Timeout for connection in 0.625 ms slots, 0 = no automatic flush
+    uint16_t                  automatic_flush_timeout;
+    uint8_t                   send_automatic_flush_timeout;
+    // local cid of channel that received the last scheduled can send now event, channels are served round robin
+    uint16_t                  can_send_now_last_cid;
+    // number of channels waiting for can send now event, indexed by l2cap_channel_priority_t
+    uint16_t                  num_waiting_for_can_send_now[3];
 } l2cap_state_t;
 #endif
 
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+// incoming ACL buffer - PRE_BUFFER + ACL Header + ACL payload
+typedef struct {
+    btstack_linked_item_t item;
+    uint8_t  data[HCI_INCOMING_PRE_BUFFER_SIZE + 4 + HCI_ACL_BUFFER_SIZE];
+} hci_acl_recombination_buffer_t;
+#endif
+
+/**
+ * Provides buffer for reassembly of fragmented L2CAP PDU, see hci_register_acl_recombination_sink_provider
+ * @param con_handle
+ * @param cid from L2CAP header of first fragment
+ * @param l2cap_length from L2CAP header of first fragment
+ * @param buffer_size of returned buffer
+ * @return buffer or NULL, to use default recombination buffer
+ */
+typedef uint8_t * (*hci_acl_recombination_sink_provider_t)(hci_con_handle_t con_handle, uint16_t cid, uint16_t l2cap_length, uint16_t * buffer_size);
+
 //
 typedef struct {
     // linked list - assert: first field
@@ -501,7 +600,14 @@ typedef struct {
     uint32_t timestamp;
 
     // ACL packet recombination - PRE_BUFFER + ACL Header + ACL payload
-    uint8_t  acl_recombination_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + 4 + HCI_ACL_BUFFER_SIZE];
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    hci_acl_recombination_buffer_t * acl_recombination_pool_buffer;
+#else
+    uint8_t  acl_recombination_storage[HCI_INCOMING_PRE_BUFFER_SIZE + 4 + HCI_ACL_BUFFER_SIZE];
+#endif
+    // recombination storage, pool buffer or sink registered by L2CAP, valid while acl_recombination_pos > 0
+    uint8_t * acl_recombination_buffer;
+    uint16_t acl_recombination_buffer_size;     // max size of ACL payload
     uint16_t acl_recombination_pos;
     uint16_t acl_recombination_length;
     
@@ -509,10 +615,32 @@ typedef struct {
     uint8_t num_acl_packets_sent;
     uint8_t num_sco_packets_sent;
 
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // ACL packets waiting for controller buffers - hci_acl_tx_buffer_t
+    btstack_linked_list_t acl_tx_queue;
+#endif
+
+    // ACL scheduler
+    uint8_t  acl_priority;
+    uint8_t  acl_scheduler_ready;
+    uint16_t acl_weight;
+    int32_t  acl_deficit;
+
+    // ACL statistics
+    uint32_t acl_packets_sent_total;
+    uint32_t acl_bytes_sent_total;
+    uint32_t acl_packets_completed_total;
+    uint32_t acl_scheduler_deferred;
+
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
     uint8_t num_packets_completed;
 #endif
 
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+    // objects of upper layers that belong to this connection, see hci_connection_get_memory_arena
+    btstack_memory_arena_t * memory_arena;
+#endif
+
     // LE Connection parameter update
     le_con_parameter_update_state_t le_con_parameter_update_state;
     uint8_t  le_con_param_update_identifier;
@@ -529,7 +657,7 @@ typedef struct {
     att_server_t    att_server;
 #endif
 
-#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+#ifdef ENABLE_CLASSIC
     l2cap_state_t l2cap_state;
 #endif
 
@@ -664,6 +792,28 @@ typedef struct {
     uint8_t        state;   
 } whitelist_entry_t;
 
+// ACL scheduler: order in which connections get to send outgoing ACL packets
+typedef enum {
+    HCI_ACL_SCHEDULER_FIFO = 0,                 // connection list order
+    HCI_ACL_SCHEDULER_ROUND_ROBIN,              // one packet per connection in turn
+    HCI_ACL_SCHEDULER_DEFICIT_ROUND_ROBIN,      // bytes per round according to connection weight
+} hci_acl_scheduler_t;
+
+// connections with higher priority are always served first
+typedef enum {
+    HCI_ACL_PRIORITY_NORMAL = 0,
+    HCI_ACL_PRIORITY_HIGH,                      // e.g. AVDTP media
+} hci_acl_priority_t;
+
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+// outgoing ACL buffer - PRE_BUFFER + ACL Header + ACL payload
+typedef struct {
+    btstack_linked_item_t item;
+    uint16_t size;
+    uint8_t  data[HCI_OUTGOING_PRE_BUFFER_SIZE + HCI_ACL_BUFFER_SIZE];
+} hci_acl_tx_buffer_t;
+#endif
+
 /**
  * main data structure
  */
@@ -684,6 +834,14 @@ typedef struct {
     // list of existing baseband connections
     btstack_linked_list_t     connections;
 
+    // open-addressing index into connections by con handle and by address + type
+    // if an entry cannot be added, lookup falls back to a linear search until all connections are gone
+    hci_connection_t        * connection_index_handle[HCI_CONNECTION_INDEX_SIZE];
+    hci_connection_t        * connection_index_address[HCI_CONNECTION_INDEX_SIZE];
+    uint16_t                  connection_index_handle_count;
+    uint16_t                  connection_index_address_count;
+    uint8_t                   connection_index_overflow;
+
     /* callback to L2CAP layer */
     btstack_packet_handler_t acl_packet_handler;
 
@@ -711,8 +869,32 @@ typedef struct {
     uint8_t   * hci_packet_buffer;
     uint8_t   hci_packet_buffer_data[HCI_OUTGOING_PRE_BUFFER_SIZE + HCI_PACKET_BUFFER_SIZE];
     uint8_t   hci_packet_buffer_reserved;
+    uint8_t * acl_fragmentation_buffer;  // hci_packet_buffer or data of acl_tx_buffer_active
     uint16_t  acl_fragmentation_pos;
     uint16_t  acl_fragmentation_total_size;
+
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+    // outgoing ACL buffers
+    hci_acl_tx_buffer_t   acl_tx_buffers[HCI_ACL_TX_BUFFERS];
+    btstack_linked_list_t acl_tx_buffers_free;
+    // buffer currently sent to controller
+    hci_acl_tx_buffer_t * acl_tx_buffer_active;
+    uint8_t               acl_tx_buffer_in_transport;
+    // number of queued packets for Classic and LE connections
+    uint16_t              acl_tx_num_queued_classic;
+    uint16_t              acl_tx_num_queued_le;
+#endif
+
+#ifdef ENABLE_HCI_ACL_RECOMBINATION_POOL
+    // incoming ACL buffers
+    hci_acl_recombination_buffer_t acl_recombination_buffers[HCI_ACL_RECOMBINATION_BUFFERS];
+    btstack_linked_list_t          acl_recombination_buffers_free;
+#endif
+    hci_acl_recombination_sink_provider_t acl_recombination_sink_provider;
+
+    // ACL scheduler
+    hci_acl_scheduler_t acl_scheduler;
+    hci_con_handle_t    acl_scheduler_last_handle;
      
     /* host to controller flow control */
     uint8_t  num_cmd_packets;
@@ -901,6 +1083,41 @@ void hci_set_sco_voice_setting(uint16_t voice_setting);
  */
 uint16_t hci_get_sco_voice_setting(void);
 
+/**
+ * @brief Set ACL scheduler used to select connection for next outgoing ACL packet. Default: HCI_ACL_SCHEDULER_FIFO
+ * @param scheduler
+ */
+void hci_set_acl_scheduler(hci_acl_scheduler_t scheduler);
+
+/**
+ * @brief Get ACL scheduler
+ * @return scheduler
+ */
+hci_acl_scheduler_t hci_get_acl_scheduler(void);
+
+/**
+ * @brief Set priority class for ACL connection. Connections with higher priority are served first.
+ * @param con_handle
+ * @param priority
+ * @return 0 if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER otherwise
+ */
+uint8_t hci_set_acl_priority(hci_con_handle_t con_handle, hci_acl_priority_t priority);
+
+/**
+ * @brief Set weight for ACL connection used by HCI_ACL_SCHEDULER_DEFICIT_ROUND_ROBIN. Default: 1
+ * @param con_handle
+ * @param weight number of max size ACL packets per round
+ * @return 0 if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER otherwise
+ */
+uint8_t hci_set_acl_weight(hci_con_handle_t con_handle, uint16_t weight);
+
+/**
+ * @brief Request emission of HCI_EVENT_ACL_SCHEDULER_STATISTICS for connection
+ * @param con_handle
+ * @return 0 if ok, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER otherwise
+ */
+uint8_t hci_request_acl_scheduler_statistics_event(hci_con_handle_t con_handle);
+
 /**
  * @brief Set inquiry mode: standard, with RSSI, with RSSI + Extended Inquiry Results. Has to be called before power on.
  * @param inquriy_mode see bluetooth_defines.h
@@ -1055,6 +1272,60 @@ int hci_can_send_prepared_acl_packet_now(hci_con_handle_t con_handle);
  */
 int hci_send_acl_packet_buffer(int size);
 
+/**
+ * Select connection that may send the next ACL packet according to the ACL scheduler. Called by L2CAP
+ * @param is_ready returns true if connection has data to send and can send now
+ * @param context passed to is_ready
+ * @return connection or NULL, if no connection is ready
+ */
+hci_connection_t * hci_acl_scheduler_select(int (*is_ready)(hci_connection_t * connection, void * context), void * context);
+
+#ifdef ENABLE_HCI_ACL_TX_QUEUE
+/**
+ * Reserve an outgoing ACL buffer. Can be used while the hci packet buffer is in use.
+ * @return pointer to ACL packet (header + payload) or NULL, if all buffers are in use
+ */
+uint8_t * hci_acl_tx_buffer_reserve(void);
+
+/**
+ * Queue ACL packet prepared in ACL buffer for the connection given in its header.
+ * Packets are sent in order by hci_run as soon as the controller has free buffers.
+ * @return 0 if queued, error code otherwise. The ACL buffer is released on error.
+ */
+int hci_acl_tx_buffer_send(uint8_t * packet, uint16_t size);
+
+/**
+ * Release ACL buffer without sending it
+ */
+void hci_acl_tx_buffer_release(uint8_t * packet);
+#endif
+
+/**
+ * Register provider for ACL recombination buffers. Called by L2CAP
+ * If a buffer is provided for the first fragment of a L2CAP PDU, all fragments are stored directly in it.
+ * The buffer must have room for HCI_INCOMING_PRE_BUFFER_SIZE + ACL Header (4) + L2CAP Header (4) + L2CAP payload
+ * and stays in use until the complete PDU was emitted or hci_acl_recombination_sink_release was called for it
+ * @param provider
+ */
+void hci_register_acl_recombination_sink_provider(hci_acl_recombination_sink_provider_t provider);
+
+/**
+ * Drop PDU reassembled in given sink buffer, e.g. if the L2CAP channel owning it gets closed
+ * @param con_handle
+ * @param buffer
+ */
+void hci_acl_recombination_sink_release(hci_con_handle_t con_handle, uint8_t * buffer);
+
+#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+/**
+ * Get memory arena for objects that belong to connection. Arena is created on demand and released with the connection
+ * Called by btstack_memory
+ * @param con_handle
+ * @return arena or NULL if connection does not exist
+ */
+btstack_memory_arena_t * hci_connection_get_memory_arena(hci_con_handle_t con_handle);
+#endif
+
 /**
  * Check if authentication is active. It delays automatic disconnect while no L2CAP connection
  * Called by l2cap.
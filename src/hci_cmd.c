@@ -624,6 +624,14 @@ const hci_cmd_t hci_write_class_of_device = {
 OPCODE(OGF_CONTROLLER_BASEBAND, 0x24), "3"
 };
 
+/**
+ * @param handle
+ * @param flush_timeout in 0.625 ms units, 0 = no automatic flush
+ */
+const hci_cmd_t hci_write_automatic_flush_timeout = {
+OPCODE(OGF_CONTROLLER_BASEBAND, 0x28), "H2"
+};
+
 /** 
  */
 const hci_cmd_t hci_read_num_broadcast_retransmissions = {
@@ -64,6 +64,26 @@
 #include <time.h>
 #include <sys/time.h>     // for timestamps
 #include <sys/stat.h>     // for mode flags
+#include <string.h>
+#endif
+
+#ifdef ENABLE_HCI_DUMP_ASYNC
+#ifndef HAVE_POSIX_FILE_IO
+#error "ENABLE_HCI_DUMP_ASYNC requires HAVE_POSIX_FILE_IO"
+#endif
+#include <pthread.h>
+#include <sys/uio.h>      // writev
+
+// size of buffer for records not written to file yet
+#ifndef HCI_DUMP_ASYNC_BUFFER_SIZE
+#define HCI_DUMP_ASYNC_BUFFER_SIZE 65536
+#endif
+
+#if (HCI_DUMP_ASYNC_BUFFER_SIZE & (HCI_DUMP_ASYNC_BUFFER_SIZE - 1)) != 0
+#error "HCI_DUMP_ASYNC_BUFFER_SIZE must be a power of two"
+#endif
+
+#define HCI_DUMP_ASYNC_BUFFER_MASK (HCI_DUMP_ASYNC_BUFFER_SIZE - 1)
 #endif
 
 // BLUEZ hcidump - struct not used directly, but left here as documentation
@@ -97,27 +117,256 @@ static char time_string[40];
 static int  max_nr_packets = -1;
 static int  nr_packets = 0;
 static char log_message_buffer[256];
+
+// size based rotation: filename -> filename.1 -> .. -> filename.(max_files-1)
+static char     dump_filename[256];
+static uint32_t max_file_size;
+static int      max_files;
+static uint32_t file_size;
+#endif
+
+#ifdef ENABLE_HCI_DUMP_ASYNC
+// single producer (BTstack thread), single consumer (writer thread) ring buffer, positions are free running
+static uint8_t   async_buffer[HCI_DUMP_ASYNC_BUFFER_SIZE];
+static uint32_t  async_write_pos;
+static uint32_t  async_read_pos;
+static uint32_t  async_records_dropped;
+static uint32_t  async_records_dropped_reported;
+static int       async_writer_active;
+static int       async_writer_sleeping;
+static int       async_writer_stop;
+// truncate file at given position for hci_dump_set_max_packets, protected by async_writer_mutex
+static int       async_truncate_pending;
+static uint32_t  async_truncate_pos;
+static pthread_t async_writer_thread;
+static pthread_mutex_t async_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  async_writer_cond  = PTHREAD_COND_INITIALIZER;
 #endif
 
 // levels: debug, info, error
 static int log_level_enabled[3] = { 1, 1, 1};
 
+#ifdef HAVE_POSIX_FILE_IO
+// called by thread that writes to file
+static void hci_dump_truncate_file(void){
+    lseek(dump_file, 0, SEEK_SET);
+    ftruncate(dump_file, 0);
+    file_size = 0;
+}
+
+static int hci_dump_open_file(const char * filename){
+    int oflags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef _WIN32
+    oflags |= O_BINARY;
+#endif
+    file_size = 0;
+    return open(filename, oflags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+}
+
+// called by thread that writes to file
+static void hci_dump_rotate_if_needed(void){
+    if (max_file_size == 0) return;
+    if (file_size < max_file_size) return;
+
+    close(dump_file);
+
+    // shift older files, oldest gets overwritten
+    char from[sizeof(dump_filename) + 12];
+    char to[sizeof(dump_filename) + 12];
+    int i;
+    for (i = max_files - 1; i > 0; i--){
+        if (i > 1){
+            snprintf(from, sizeof(from), "%s.%u", dump_filename, i - 1);
+        } else {
+            snprintf(from, sizeof(from), "%s", dump_filename);
+        }
+        snprintf(to, sizeof(to), "%s.%u", dump_filename, i);
+        rename(from, to);
+    }
+
+    dump_file = hci_dump_open_file(dump_filename);
+}
+
+static void hci_dump_write_file(const uint8_t * data, uint32_t len){
+    while (len){
+        int res = write(dump_file, data, len);
+        if (res <= 0) return;
+        data += res;
+        len  -= res;
+        file_size += res;
+    }
+}
+#endif
+
+#ifdef ENABLE_HCI_DUMP_ASYNC
+
+static void hci_dump_async_write_batch(uint32_t read_pos, uint32_t write_pos){
+    uint32_t len    = write_pos - read_pos;
+    uint32_t offset = read_pos & HCI_DUMP_ASYNC_BUFFER_MASK;
+    uint32_t len_1  = HCI_DUMP_ASYNC_BUFFER_SIZE - offset;
+    if (len_1 > len){
+        len_1 = len;
+    }
+    struct iovec iov[2];
+    iov[0].iov_base = &async_buffer[offset];
+    iov[0].iov_len  = len_1;
+    iov[1].iov_base = &async_buffer[0];
+    iov[1].iov_len  = len - len_1;
+    ssize_t res = writev(dump_file, iov, iov[1].iov_len ? 2 : 1);
+    if (res <= 0) return;
+    file_size += res;
+    // finish partial write
+    if ((uint32_t) res < len_1){
+        hci_dump_write_file(&async_buffer[offset + res], len_1 - res);
+        hci_dump_write_file(&async_buffer[0], len - len_1);
+    } else if ((uint32_t) res < len){
+        hci_dump_write_file(&async_buffer[res - len_1], len - res);
+    }
+}
+
+static void * hci_dump_async_writer(void * context){
+    UNUSED(context);
+    while (1){
+        uint32_t read_pos  = async_read_pos;
+        uint32_t write_pos = __atomic_load_n(&async_write_pos, __ATOMIC_ACQUIRE);
+        // records before truncate position are dropped. truncate position is never before read position
+        int truncate = 0;
+        pthread_mutex_lock(&async_writer_mutex);
+        if (async_truncate_pending && (async_truncate_pos - read_pos) <= (write_pos - read_pos)){
+            async_truncate_pending = 0;
+            read_pos = async_truncate_pos;
+            truncate = 1;
+        }
+        pthread_mutex_unlock(&async_writer_mutex);
+        if (truncate){
+            hci_dump_truncate_file();
+            __atomic_store_n(&async_read_pos, read_pos, __ATOMIC_RELEASE);
+        }
+        if (write_pos != read_pos){
+            // write all complete records, rotate between batches
+            hci_dump_async_write_batch(read_pos, write_pos);
+            __atomic_store_n(&async_read_pos, write_pos, __ATOMIC_RELEASE);
+            hci_dump_rotate_if_needed();
+            continue;
+        }
+        if (__atomic_load_n(&async_writer_stop, __ATOMIC_ACQUIRE)) break;
+        // wait for more records
+        pthread_mutex_lock(&async_writer_mutex);
+        __atomic_store_n(&async_writer_sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&async_write_pos, __ATOMIC_SEQ_CST) == read_pos && !__atomic_load_n(&async_writer_stop, __ATOMIC_SEQ_CST)){
+            pthread_cond_wait(&async_writer_cond, &async_writer_mutex);
+        }
+        __atomic_store_n(&async_writer_sleeping, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&async_writer_mutex);
+    }
+    return NULL;
+}
+
+static void hci_dump_async_wakeup_writer(void){
+    if (!__atomic_load_n(&async_writer_sleeping, __ATOMIC_SEQ_CST)) return;
+    pthread_mutex_lock(&async_writer_mutex);
+    pthread_cond_signal(&async_writer_cond);
+    pthread_mutex_unlock(&async_writer_mutex);
+}
+
+static void hci_dump_async_store(uint32_t pos, const uint8_t * data, uint16_t len){
+    uint32_t offset = pos & HCI_DUMP_ASYNC_BUFFER_MASK;
+    uint32_t len_1  = HCI_DUMP_ASYNC_BUFFER_SIZE - offset;
+    if (len_1 > len){
+        len_1 = len;
+    }
+    memcpy(&async_buffer[offset], data, len_1);
+    memcpy(&async_buffer[0], &data[len_1], len - len_1);
+}
+
+// queue record for writer thread, drop if not enough space
+static void hci_dump_async_write_record(const uint8_t * header, uint16_t header_len, const uint8_t * packet, uint16_t len){
+    uint32_t write_pos = async_write_pos;
+    uint32_t read_pos  = __atomic_load_n(&async_read_pos, __ATOMIC_ACQUIRE);
+    uint32_t bytes_free = HCI_DUMP_ASYNC_BUFFER_SIZE - (write_pos - read_pos);
+    if (bytes_free < (uint32_t) header_len + len){
+        async_records_dropped++;
+        return;
+    }
+    hci_dump_async_store(write_pos, header, header_len);
+    hci_dump_async_store(write_pos + header_len, packet, len);
+    __atomic_store_n(&async_write_pos, write_pos + header_len + len, __ATOMIC_SEQ_CST);
+    hci_dump_async_wakeup_writer();
+}
+
+static void hci_dump_async_start(void){
+    async_write_pos = 0;
+    async_read_pos  = 0;
+    async_records_dropped = 0;
+    async_records_dropped_reported = 0;
+    async_writer_stop = 0;
+    async_writer_sleeping = 0;
+    async_truncate_pending = 0;
+    if (pthread_create(&async_writer_thread, NULL, &hci_dump_async_writer, NULL)){
+        printf("hci_dump_open: failed to start writer thread, writing synchronously\n");
+        return;
+    }
+    async_writer_active = 1;
+}
+
+static void hci_dump_async_stop(void){
+    if (!async_writer_active) return;
+    async_writer_active = 0;
+    // writer drains buffer before it stops
+    pthread_mutex_lock(&async_writer_mutex);
+    __atomic_store_n(&async_writer_stop, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_signal(&async_writer_cond);
+    pthread_mutex_unlock(&async_writer_mutex);
+    pthread_join(async_writer_thread, NULL);
+}
+#endif
+
+#ifdef HAVE_POSIX_FILE_IO
+// start new file with next record
+static void hci_dump_truncate(void){
+#ifdef ENABLE_HCI_DUMP_ASYNC
+    if (async_writer_active){
+        // let writer thread truncate file before writing the next record
+        pthread_mutex_lock(&async_writer_mutex);
+        async_truncate_pending = 1;
+        async_truncate_pos = async_write_pos;
+        pthread_mutex_unlock(&async_writer_mutex);
+        return;
+    }
+#endif
+    hci_dump_truncate_file();
+}
+
+static void hci_dump_write_record(const uint8_t * header, uint16_t header_len, const uint8_t * packet, uint16_t len){
+#ifdef ENABLE_HCI_DUMP_ASYNC
+    if (async_writer_active){
+        hci_dump_async_write_record(header, header_len, packet, len);
+        return;
+    }
+#endif
+    hci_dump_write_file(header, header_len);
+    hci_dump_write_file(packet, len);
+    hci_dump_rotate_if_needed();
+}
+#endif
+
 void hci_dump_open(const char *filename, hci_dump_format_t format){
 #ifdef HAVE_POSIX_FILE_IO
     dump_format = format;
     if (dump_format == HCI_DUMP_STDOUT) {
         dump_file = fileno(stdout);
     } else {
-
-        int oflags = O_WRONLY | O_CREAT | O_TRUNC;
-#ifdef _WIN32
-        oflags |= O_BINARY;
-#endif
-
-        dump_file = open(filename, oflags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+        strncpy(dump_filename, filename, sizeof(dump_filename) - 1);
+        dump_filename[sizeof(dump_filename) - 1] = 0;
+        dump_file = hci_dump_open_file(dump_filename);
         if (dump_file < 0){
             printf("hci_dump_open: failed to open file %s\n", filename);
         }
+#ifdef ENABLE_HCI_DUMP_ASYNC
+        if (dump_file >= 0){
+            hci_dump_async_start();
+        }
+#endif
     }
 #else
     UNUSED(filename);
@@ -131,6 +380,19 @@ void hci_dump_open(const char *filename, hci_dump_format_t format){
 void hci_dump_set_max_packets(int packets){
     max_nr_packets = packets;
 }
+
+void hci_dump_set_max_file_size(uint32_t max_size, int num_files){
+    max_file_size = max_size;
+    max_files = num_files;
+}
+
+uint32_t hci_dump_get_dropped_records(void){
+#ifdef ENABLE_HCI_DUMP_ASYNC
+    return async_records_dropped;
+#else
+    return 0;
+#endif
+}
 #endif
 
 static void printf_packet(uint8_t packet_type, uint8_t in, uint8_t * packet, uint16_t len){
@@ -199,11 +461,20 @@ void hci_dump_packet(uint8_t packet_type, uint8_t in, uint8_t *packet, uint16_t
 
 #ifdef HAVE_POSIX_FILE_IO
 
+#ifdef ENABLE_HCI_DUMP_ASYNC
+    // report dropped records as log message
+    if (async_records_dropped != async_records_dropped_reported){
+        async_records_dropped_reported = async_records_dropped;
+        char note[40];
+        int note_len = snprintf(note, sizeof(note), "hci_dump: %u records dropped", (unsigned int) async_records_dropped_reported);
+        hci_dump_packet(LOG_MESSAGE_PACKET, 0, (uint8_t*) note, note_len);
+    }
+#endif
+
     // don't grow bigger than max_nr_packets
     if (dump_format != HCI_DUMP_STDOUT && max_nr_packets > 0){
         if (nr_packets >= max_nr_packets){
-            lseek(dump_file, 0, SEEK_SET);
-            ftruncate(dump_file, 0);
+            hci_dump_truncate();
             nr_packets = 0;
         }
         nr_packets++;
@@ -227,8 +498,7 @@ void hci_dump_packet(uint8_t packet_type, uint8_t in, uint8_t *packet, uint16_t
             little_endian_store_32( header_bluez, 4, (uint32_t) curr_time.tv_sec);
             little_endian_store_32( header_bluez, 8,            curr_time.tv_usec);
             header_bluez[12] = packet_type;
-            write (dump_file, header_bluez, HCIDUMP_HDR_SIZE);
-            write (dump_file, packet, len );
+            hci_dump_write_record(header_bluez, HCIDUMP_HDR_SIZE, packet, len);
             break;
             
         case HCI_DUMP_PACKETLOGGER:
@@ -262,8 +532,7 @@ void hci_dump_packet(uint8_t packet_type, uint8_t in, uint8_t *packet, uint16_t
                 default:
                     return;
             }
-            write (dump_file, &header_packetlogger, PKTLOG_HDR_SIZE);
-            write (dump_file, packet, len );
+            hci_dump_write_record(header_packetlogger, PKTLOG_HDR_SIZE, packet, len);
             break;
             
         default:
@@ -320,6 +589,9 @@ void hci_dump_log_P(int log_level, PGM_P format, ...){
 #endif
 
 void hci_dump_close(void){
+#ifdef ENABLE_HCI_DUMP_ASYNC
+    hci_dump_async_stop();
+#endif
 #ifdef HAVE_POSIX_FILE_IO
     close(dump_file);
 #endif
@@ -75,10 +75,22 @@ typedef enum {
 void hci_dump_open(const char *filename, hci_dump_format_t format);
 
 /*
- * @brief 
+ * @brief Truncate file after given number of packets, also with ENABLE_HCI_DUMP_ASYNC
  */
 void hci_dump_set_max_packets(int packets); // -1 for unlimited
 
+/*
+ * @brief Rotate files when they reach max size: filename -> filename.1 -> .. -> filename.(num_files-1)
+ * @param max_size in bytes, 0 for unlimited
+ * @param num_files including current file
+ */
+void hci_dump_set_max_file_size(uint32_t max_size, int num_files);
+
+/*
+ * @brief Get number of records dropped by asynchronous writer (ENABLE_HCI_DUMP_ASYNC) as buffer was full
+ */
+uint32_t hci_dump_get_dropped_records(void);
+
 /*
  * @brief 
  */
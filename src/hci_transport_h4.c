@@ -143,6 +143,10 @@ static  H4_STATE h4_state;
 static int bytes_to_read;
 static int read_pos;
 
+// stream reader state: bytes received in hci_packet
+static uint8_t  stream_mode;
+static uint16_t stream_fill;
+
 // incoming packet buffer
 static uint8_t hci_packet_with_pre_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + 1 + HCI_PACKET_BUFFER_SIZE]; // packet type + max(acl header + acl payload, event header + event data)
 static uint8_t * hci_packet = &hci_packet_with_pre_buffer[HCI_INCOMING_PRE_BUFFER_SIZE];
@@ -264,6 +268,86 @@ static void hci_transport_h4_block_read(void){
     hci_transport_h4_trigger_next_read();
 }
 
+// stream reader: UART provides all available bytes, complete packets are processed in place
+
+// @returns size of H4 packet incl. packet type, 0 if more data is needed, -1 if invalid
+static int hci_transport_h4_stream_packet_size(const uint8_t * data, uint16_t len){
+    int size;
+    if (len < 1) return 0;
+    switch (data[0]){
+        case HCI_EVENT_PACKET:
+            if (len < 1 + HCI_EVENT_HEADER_SIZE) return 0;
+            size = 1 + HCI_EVENT_HEADER_SIZE + data[2];
+            break;
+        case HCI_ACL_DATA_PACKET:
+            if (len < 1 + HCI_ACL_HEADER_SIZE) return 0;
+            size = 1 + HCI_ACL_HEADER_SIZE + little_endian_read_16(data, 3);
+            break;
+        case HCI_SCO_DATA_PACKET:
+            if (len < 1 + HCI_SCO_HEADER_SIZE) return 0;
+            size = 1 + HCI_SCO_HEADER_SIZE + data[3];
+            break;
+#ifdef ENABLE_EHCILL
+        case EHCILL_GO_TO_SLEEP_IND:
+        case EHCILL_GO_TO_SLEEP_ACK:
+        case EHCILL_WAKE_UP_IND:
+        case EHCILL_WAKE_UP_ACK:
+            return 1;
+#endif
+        default:
+            return -1;
+    }
+    if (size > 1 + HCI_PACKET_BUFFER_SIZE) return -1;
+    return size;
+}
+
+static void hci_transport_h4_trigger_next_stream_read(void){
+    btstack_uart->receive_stream(&hci_packet[stream_fill], 1 + HCI_PACKET_BUFFER_SIZE - stream_fill);
+}
+
+static void hci_transport_h4_stream_received(uint16_t len){
+
+    stream_fill += len;
+
+    // process all complete packets
+    uint16_t pos = 0;
+    while (1){
+        uint8_t * packet = &hci_packet[pos];
+        uint16_t available = stream_fill - pos;
+        int size = hci_transport_h4_stream_packet_size(packet, available);
+        if (size < 0){
+            log_error("hci_transport_h4: invalid packet type 0x%02x or packet too large", packet[0]);
+            // skip byte and try to re-sync
+            pos++;
+            continue;
+        }
+        if (size == 0 || size > available) break;
+        pos += size;
+#ifdef ENABLE_EHCILL
+        if (size == 1){
+            hci_transport_h4_ehcill_handle_command(packet[0]);
+            continue;
+        }
+#endif
+        // hci.c might terminate strings after event data, keep packet type of next packet
+        if (pos < stream_fill){
+            uint8_t next_packet_type = hci_packet[pos];
+            packet_handler(packet[0], &packet[1], size - 1);
+            hci_packet[pos] = next_packet_type;
+        } else {
+            packet_handler(packet[0], &packet[1], size - 1);
+        }
+    }
+
+    // move incomplete packet to start of buffer
+    if (pos){
+        stream_fill -= pos;
+        memmove(hci_packet, &hci_packet[pos], stream_fill);
+    }
+
+    hci_transport_h4_trigger_next_stream_read();
+}
+
 static void hci_transport_h4_block_sent(void){
     switch (tx_state){
         case TX_W4_PACKET_SENT:
@@ -355,6 +439,16 @@ static void hci_transport_h4_init(const void * transport_config){
     btstack_uart->init(&uart_config);
     btstack_uart->set_block_received(&hci_transport_h4_block_read);
     btstack_uart->set_block_sent(&hci_transport_h4_block_sent);
+
+    // use stream reader if supported by UART driver
+    stream_mode = btstack_uart->receive_stream && btstack_uart->set_stream_received;
+#ifdef ENABLE_CC256X_BAUDRATE_CHANGE_FLOWCONTROL_BUG_WORKAROUND
+    // work around requires block reads
+    stream_mode = 0;
+#endif
+    if (stream_mode){
+        btstack_uart->set_stream_received(&hci_transport_h4_stream_received);
+    }
 }
 
 static int hci_transport_h4_open(void){
@@ -362,8 +456,13 @@ static int hci_transport_h4_open(void){
     if (res){
         return res;
     }
-    hci_transport_h4_reset_statemachine();
-    hci_transport_h4_trigger_next_read();
+    if (stream_mode){
+        stream_fill = 0;
+        hci_transport_h4_trigger_next_stream_read();
+    } else {
+        hci_transport_h4_reset_statemachine();
+        hci_transport_h4_trigger_next_read();
+    }
 
     tx_state = TX_IDLE;
 
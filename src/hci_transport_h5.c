@@ -49,6 +49,7 @@
 
 #include "hci.h"
 #include "btstack_slip.h"
+#include "btstack_crc.h"
 #include "btstack_debug.h"
 #include "hci_transport.h"
 #include "btstack_uart_block.h"
@@ -74,8 +75,16 @@ typedef enum {
 
 } hci_transport_link_actions_t;
 
-// Configuration Field. No packet buffers -> sliding window = 1, no OOF flow control, support data integrity check
-#define LINK_CONFIG_SLIDING_WINDOW_SIZE 1
+// Sliding window size = max number of unacknowledged reliable packets, 1..7. Window size > 1 requires buffers for outgoing packets
+#ifndef HCI_TRANSPORT_H5_WINDOW_SIZE
+#define HCI_TRANSPORT_H5_WINDOW_SIZE 1
+#endif
+#if (HCI_TRANSPORT_H5_WINDOW_SIZE < 1) || (HCI_TRANSPORT_H5_WINDOW_SIZE > 7)
+#error HCI_TRANSPORT_H5_WINDOW_SIZE must be in range 1..7
+#endif
+
+// Configuration Field. Sliding window = HCI_TRANSPORT_H5_WINDOW_SIZE, no OOF flow control, support data integrity check
+#define LINK_CONFIG_SLIDING_WINDOW_SIZE HCI_TRANSPORT_H5_WINDOW_SIZE
 #define LINK_CONFIG_OOF_FLOW_CONTROL 0
 #define LINK_CONFIG_DATA_INTEGRITY_CHECK 1
 #define LINK_CONFIG_VERSION_NR 0
@@ -94,6 +103,9 @@ typedef enum {
 // max size of write requests
 #define LINK_SLIP_TX_CHUNK_LEN 64
 
+// max size of read requests if UART driver supports receive stream
+#define LINK_SLIP_RX_CHUNK_LEN 128
+
 // ---
 static const uint8_t link_control_sync[] =   { 0x01, 0x7e};
 static const uint8_t link_control_sync_response[] = { 0x02, 0x7d};
@@ -131,10 +143,26 @@ static uint8_t  link_peer_supports_data_integrity_check;
 static btstack_timer_source_t inactivity_timer;
 static uint16_t link_inactivity_timeout_ms; // auto-sleep if set
 
-// Outgoing packet
-static uint8_t   hci_packet_type;
-static uint16_t  hci_packet_size;
-static uint8_t * hci_packet;
+// Outgoing packets - sent but unacknowledged and queued packets
+typedef struct {
+    uint8_t   packet_type;
+    uint16_t  size;
+    uint8_t * packet;
+} hci_transport_link_tx_frame_t;
+
+static hci_transport_link_tx_frame_t link_tx_frames[HCI_TRANSPORT_H5_WINDOW_SIZE];
+#if HCI_TRANSPORT_H5_WINDOW_SIZE > 1
+static uint8_t  link_tx_frames_storage[HCI_TRANSPORT_H5_WINDOW_SIZE][HCI_PACKET_BUFFER_SIZE];
+#endif
+static uint8_t  link_tx_frames_head;            // oldest frame, has sequence number link_seq_nr
+static uint8_t  link_tx_frames_count;           // number of frames in queue
+static uint8_t  link_tx_frames_sent;            // number of frames sent since last retransmit
+static uint8_t  link_tx_frames_unacked;         // number of frames sent at least once
+static uint8_t  link_tx_window_size;            // negotiated sliding window size
+static uint8_t  link_tx_packet_sent_pending;    // HCI_EVENT_TRANSPORT_PACKET_SENT not emitted yet
+
+// incoming data if UART driver supports receive stream
+static uint8_t  hci_transport_link_read_buffer[LINK_SLIP_RX_CHUNK_LEN];
 
 // hci packet handler
 static  void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
@@ -157,20 +185,7 @@ static void hci_transport_link_run(void);
 static void hci_transport_slip_init(void);
 
 // -----------------------------
-// CRC16-CCITT Calculation - compromise: use 32 byte table - 512 byte table would be faster, but that's too large
-
-static const uint16_t crc16_ccitt_table[] ={
-    0x0000, 0x1081, 0x2102, 0x3183,
-    0x4204, 0x5285, 0x6306, 0x7387,
-    0x8408, 0x9489, 0xa50a, 0xb58b,
-    0xc60c, 0xd68d, 0xe70e, 0xf78f
-};
-
-static uint16_t crc16_ccitt_update (uint16_t crc, uint8_t ch){
-    crc = (crc >> 4) ^ crc16_ccitt_table[(crc ^ ch) & 0x000f];
-    crc = (crc >> 4) ^ crc16_ccitt_table[(crc ^ (ch >> 4)) & 0x000f];
-    return crc;
-}
+// CRC16-CCITT Calculation
 
 static uint16_t btstack_reverse_bits_16(uint16_t value){
     int reverse = 0;
@@ -184,14 +199,8 @@ static uint16_t btstack_reverse_bits_16(uint16_t value){
 }
 
 static uint16_t crc16_calc_for_slip_frame(const uint8_t * header, const uint8_t * payload, uint16_t len){
-    int i;
-    uint16_t crc = 0xffff;
-    for (i=0 ; i < 4 ; i++){
-        crc = crc16_ccitt_update(crc, header[i]);
-    }
-    for (i=0 ; i < len ; i++){
-        crc = crc16_ccitt_update(crc, payload[i]);
-    }
+    uint16_t crc = btstack_crc16_ccitt_update(0xffff, header, 4);
+    crc = btstack_crc16_ccitt_update(crc, payload, len);
     return btstack_reverse_bits_16(crc);
 }
 
@@ -220,8 +229,8 @@ static void hci_transport_inactivity_timer_set(void){
 
 // Fill chunk and write
 static void hci_transport_slip_encode_chunk_and_send(int pos){
-    while (btstack_slip_encoder_has_data() & (pos < LINK_SLIP_TX_CHUNK_LEN)) {
-        slip_outgoing_buffer[pos++] = btstack_slip_encoder_get_byte();
+    if (pos < LINK_SLIP_TX_CHUNK_LEN){
+        pos += btstack_slip_encoder_get_bytes(&slip_outgoing_buffer[pos], LINK_SLIP_TX_CHUNK_LEN - pos);
     }
 
     if (!btstack_slip_encoder_has_data()){
@@ -231,9 +240,7 @@ static void hci_transport_slip_encode_chunk_and_send(int pos){
             uint8_t dic_buffer[2];
             big_endian_store_16(dic_buffer, 0, slip_outgoing_dic);
             btstack_slip_encoder_start(dic_buffer, 2);
-            while (btstack_slip_encoder_has_data()){
-                slip_outgoing_buffer[pos++] = btstack_slip_encoder_get_byte();
-            } 
+            pos += btstack_slip_encoder_get_bytes(&slip_outgoing_buffer[pos], sizeof(slip_outgoing_buffer) - 1 - pos);
         }
         // Start of Frame
         slip_outgoing_buffer[pos++] = BTSTACK_SLIP_SOF;
@@ -262,9 +269,7 @@ static void hci_transport_slip_send_frame(const uint8_t * header, const uint8_t
 
     // Header
     btstack_slip_encoder_start(header, 4);
-    while (btstack_slip_encoder_has_data()){
-        slip_outgoing_buffer[pos++] = btstack_slip_encoder_get_byte();
-    }
+    pos += btstack_slip_encoder_get_bytes(&slip_outgoing_buffer[pos], sizeof(slip_outgoing_buffer) - pos);
 
     // Packet
     btstack_slip_encoder_start(packet, packet_size);
@@ -347,19 +352,31 @@ static void hci_transport_link_send_sleep(void){
     hci_transport_link_send_control(link_control_sleep, sizeof(link_control_sleep));
 }
 
+static hci_transport_link_tx_frame_t * hci_transport_link_get_tx_frame(int index){
+    return &link_tx_frames[(link_tx_frames_head + index) % HCI_TRANSPORT_H5_WINDOW_SIZE];
+}
+
 static void hci_transport_link_send_queued_packet(void){
 
+    // send next frame that wasn't sent since last (re)transmit
+    hci_transport_link_tx_frame_t * frame = hci_transport_link_get_tx_frame(link_tx_frames_sent);
+    uint8_t seq_nr = (link_seq_nr + link_tx_frames_sent) & 0x07;
+    link_tx_frames_sent++;
+    if (link_tx_frames_sent > link_tx_frames_unacked){
+        link_tx_frames_unacked = link_tx_frames_sent;
+    }
+
     uint8_t header[4];
-    hci_transport_link_calc_header(header, link_seq_nr, link_ack_nr, link_peer_supports_data_integrity_check, 1, hci_packet_type, hci_packet_size);
+    hci_transport_link_calc_header(header, seq_nr, link_ack_nr, link_peer_supports_data_integrity_check, 1, frame->packet_type, frame->size);
 
     uint16_t data_integrity_check = 0;
     if (link_peer_supports_data_integrity_check){
-        data_integrity_check = crc16_calc_for_slip_frame(header, hci_packet, hci_packet_size);
+        data_integrity_check = crc16_calc_for_slip_frame(header, frame->packet, frame->size);
     }
-    log_debug("hci_transport_link_send_queued_packet: seq %u, ack %u, size %u. Append dic %u, dic = 0x%04x", link_seq_nr, link_ack_nr, hci_packet_size, link_peer_supports_data_integrity_check, data_integrity_check);
-    log_debug_hexdump(hci_packet, hci_packet_size);
+    log_debug("hci_transport_link_send_queued_packet: seq %u, ack %u, size %u. Append dic %u, dic = 0x%04x", seq_nr, link_ack_nr, frame->size, link_peer_supports_data_integrity_check, data_integrity_check);
+    log_debug_hexdump(frame->packet, frame->size);
 
-    hci_transport_slip_send_frame(header, hci_packet, hci_packet_size, data_integrity_check);
+    hci_transport_slip_send_frame(header, frame->packet, frame->size, data_integrity_check);
 
     // reset inactvitiy timer
     hci_transport_inactivity_timer_set();
@@ -414,11 +431,17 @@ static void hci_transport_link_run(void){
         return;
     }
     if (hci_transport_link_actions & HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET){
-        hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
-        // packet already contains ack, no need to send addtitional one
-        hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_ACK_PACKET;
-        hci_transport_link_send_queued_packet();
-        return;
+        if (link_tx_frames_sent >= link_tx_frames_count){
+            hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
+        } else {
+            // packet already contains ack, no need to send addtitional one
+            hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_ACK_PACKET;
+            hci_transport_link_send_queued_packet();
+            if (link_tx_frames_sent >= link_tx_frames_count){
+                hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
+            }
+            return;
+        }
     }
     if (hci_transport_link_actions & HCI_TRANSPORT_LINK_SEND_ACK_PACKET){
         hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_SEND_ACK_PACKET;
@@ -460,7 +483,8 @@ static void hci_transport_link_timeout_handler(btstack_timer_source_t * timer){
                 hci_transport_link_set_timer(LINK_WAKEUP_MS);
                 return;
             }
-            // resend packet
+            // resend all unacknowledged packets
+            link_tx_frames_sent = 0;
             hci_transport_link_actions |= HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
             hci_transport_link_set_timer(link_resend_timeout_ms);
             break;
@@ -487,18 +511,40 @@ static int hci_transport_link_inc_seq_nr(int seq_nr){
 }
 
 static int hci_transport_link_have_outgoing_packet(void){
-    return hci_packet != 0;
+    return link_tx_frames_count > 0;
 }
 
 static void hci_transport_link_clear_queue(void){
     btstack_run_loop_remove_timer(&link_timer);
-    hci_packet = NULL;
+    link_tx_frames_head  = 0;
+    link_tx_frames_count = 0;
+    link_tx_frames_sent  = 0;
+    link_tx_frames_unacked = 0;
+    link_tx_packet_sent_pending = 0;
 }
 
 static void hci_transport_h5_queue_packet(uint8_t packet_type, uint8_t *packet, int size){
-    hci_packet = packet;
-    hci_packet_type = packet_type;
-    hci_packet_size = size;
+    hci_transport_link_tx_frame_t * frame = hci_transport_link_get_tx_frame(link_tx_frames_count);
+#if HCI_TRANSPORT_H5_WINDOW_SIZE > 1
+    // store copy, packet buffer is released by HCI_EVENT_TRANSPORT_PACKET_SENT before packet gets acknowledged
+    frame->packet = link_tx_frames_storage[frame - link_tx_frames];
+    memcpy(frame->packet, packet, size);
+#else
+    frame->packet = packet;
+#endif
+    frame->packet_type = packet_type;
+    frame->size = size;
+    link_tx_frames_count++;
+    link_tx_packet_sent_pending = 1;
+}
+
+// notify upper stack that it can send again as soon as a frame is available
+static void hci_transport_h5_emit_packet_sent_if_possible(void){
+    if (!link_tx_packet_sent_pending) return;
+    if (link_tx_frames_count >= link_tx_window_size) return;
+    link_tx_packet_sent_pending = 0;
+    uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+    packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
 }
 
 static void hci_transport_h5_emit_sleep_state(int sleep_active){
@@ -606,7 +652,10 @@ static void hci_transport_h5_process_frame(uint16_t frame_size){
             if (memcmp(slip_payload, link_control_config_response, link_control_config_response_prefix_len) == 0){
                 uint8_t config = slip_payload[2];
                 link_peer_supports_data_integrity_check = (config & 0x10) != 0;
-                log_info("link received config response 0x%02x, data integrity check supported %u", config, link_peer_supports_data_integrity_check);
+                link_tx_window_size = config & 0x07;
+                if (link_tx_window_size > HCI_TRANSPORT_H5_WINDOW_SIZE) link_tx_window_size = HCI_TRANSPORT_H5_WINDOW_SIZE;
+                if (link_tx_window_size == 0) link_tx_window_size = 1;
+                log_info("link received config response 0x%02x, data integrity check supported %u, window size %u", config, link_peer_supports_data_integrity_check, link_tx_window_size);
                 link_state = LINK_ACTIVE;
                 btstack_run_loop_remove_timer(&link_timer);
                 log_info("link activated");
@@ -635,16 +684,20 @@ static void hci_transport_h5_process_frame(uint16_t frame_size){
 
             // Process ACKs in reliable packet and explicit ack packets
             if (reliable_packet || link_packet_type == LINK_ACKNOWLEDGEMENT_TYPE){
-                // our packet is good if the remote expects our seq nr + 1
-                int next_seq_nr = hci_transport_link_inc_seq_nr(link_seq_nr);
-                if (hci_transport_link_have_outgoing_packet() && next_seq_nr == ack_nr){
-                    log_debug("outoing packet with seq %u ack'ed", link_seq_nr);
-                    link_seq_nr = next_seq_nr;
-                    hci_transport_link_clear_queue();
-
-                    // notify upper stack that it can send again
-                    uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
-                    packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+                // remote expects seq nr of next packet, all sent packets before are good
+                int num_acked = (ack_nr - link_seq_nr) & 0x07;
+                if (num_acked > 0 && num_acked <= link_tx_frames_unacked){
+                    log_debug("outgoing packets with seq %u..%u ack'ed", link_seq_nr, (link_seq_nr + num_acked - 1) & 0x07);
+                    link_seq_nr = ack_nr;
+                    link_tx_frames_head  = (link_tx_frames_head + num_acked) % HCI_TRANSPORT_H5_WINDOW_SIZE;
+                    link_tx_frames_count -= num_acked;
+                    link_tx_frames_unacked -= num_acked;
+                    link_tx_frames_sent = (link_tx_frames_sent > num_acked) ? (link_tx_frames_sent - num_acked) : 0;
+                    btstack_run_loop_remove_timer(&link_timer);
+                    if (hci_transport_link_have_outgoing_packet()){
+                        hci_transport_link_set_timer(link_resend_timeout_ms);
+                    }
+                    hci_transport_h5_emit_packet_sent_if_possible();
                 }
             } 
 
@@ -729,17 +782,35 @@ static void hci_transport_link_update_resend_timeout(uint32_t baudrate){
 
 static uint8_t hci_transport_link_read_byte;
 
+// read single bytes or, if supported by UART driver, all available data
 static void hci_transport_h5_read_next_byte(void){
+    if (btstack_uart->receive_stream){
+        btstack_uart->receive_stream(hci_transport_link_read_buffer, sizeof(hci_transport_link_read_buffer));
+        return;
+    }
     btstack_uart->receive_block(&hci_transport_link_read_byte, 1);    
 }
 
-static void hci_transport_h5_block_received(){
-    btstack_slip_decoder_process(hci_transport_link_read_byte);
-    uint16_t frame_size = btstack_slip_decoder_frame_size();
-    if (frame_size) {
-        hci_transport_h5_process_frame(frame_size);
-        hci_transport_slip_init();
+static void hci_transport_h5_process_data(const uint8_t * data, uint16_t len){
+    while (len){
+        uint16_t bytes_processed = btstack_slip_decoder_process_bytes(data, len);
+        data += bytes_processed;
+        len  -= bytes_processed;
+        uint16_t frame_size = btstack_slip_decoder_frame_size();
+        if (frame_size) {
+            hci_transport_h5_process_frame(frame_size);
+            hci_transport_slip_init();
+        }
     }
+}
+
+static void hci_transport_h5_block_received(){
+    hci_transport_h5_process_data(&hci_transport_link_read_byte, 1);
+    hci_transport_h5_read_next_byte();
+}
+
+static void hci_transport_h5_stream_received(uint16_t len){
+    hci_transport_h5_process_data(hci_transport_link_read_buffer, len);
     hci_transport_h5_read_next_byte();
 }
 
@@ -754,6 +825,9 @@ static void hci_transport_h5_block_sent(void){
     // done
     slip_write_active = 0;
 
+    // packet copied into window and sent
+    hci_transport_h5_emit_packet_sent_if_possible();
+
     // enter sleep mode after sending sleep message
     if (hci_transport_link_actions & HCI_TRANSPORT_LINK_ENTER_SLEEP){
         hci_transport_link_actions &= ~HCI_TRANSPORT_LINK_ENTER_SLEEP;
@@ -790,6 +864,9 @@ static void hci_transport_h5_init(const void * transport_config){
     btstack_uart->init(&uart_config);
     btstack_uart->set_block_received(&hci_transport_h5_block_received);
     btstack_uart->set_block_sent(&hci_transport_h5_block_sent);
+    if (btstack_uart->set_stream_received){
+        btstack_uart->set_stream_received(&hci_transport_h5_stream_received);
+    }
 }
 
 static int hci_transport_h5_open(void){
@@ -841,7 +918,7 @@ static void hci_transport_h5_register_packet_handler(void (*handler)(uint8_t pac
 }
 
 static int hci_transport_h5_can_send_packet_now(uint8_t packet_type){
-    int res = !hci_transport_link_have_outgoing_packet() && link_state == LINK_ACTIVE;
+    int res = !link_tx_packet_sent_pending && link_tx_frames_count < link_tx_window_size && link_state == LINK_ACTIVE;
     // log_info("can_send_packet_now: %u", res);
     return res;
 }
@@ -853,6 +930,7 @@ static int hci_transport_h5_send_packet(uint8_t packet_type, uint8_t *packet, in
     }
 
     // store request
+    int queue_was_empty = !hci_transport_link_have_outgoing_packet();
     hci_transport_h5_queue_packet(packet_type, packet, size);
 
     // send wakeup first
@@ -863,10 +941,14 @@ static int hci_transport_h5_send_packet(uint8_t packet_type, uint8_t *packet, in
             btstack_uart->set_sleep(BTSTACK_UART_SLEEP_OFF);
         }
         hci_transport_link_actions |= HCI_TRANSPORT_LINK_SEND_WAKEUP;
+        btstack_run_loop_remove_timer(&link_timer);
         hci_transport_link_set_timer(LINK_WAKEUP_MS);
     } else {
         hci_transport_link_actions |= HCI_TRANSPORT_LINK_SEND_QUEUED_PACKET;
-        hci_transport_link_set_timer(link_resend_timeout_ms);
+        // resend timer runs for oldest unacknowledged packet
+        if (queue_was_empty){
+            hci_transport_link_set_timer(link_resend_timeout_ms);
+        }
     }
     hci_transport_link_run();
     return 0;
@@ -49,8 +49,10 @@
 #include "hci.h"
 #include "hci_dump.h"
 #include "bluetooth_sdp.h"
+#include "btstack_crc.h"
 #include "btstack_debug.h"
 #include "btstack_event.h"
+#include "btstack_keyed_index.h"
 #include "btstack_memory.h"
 
 #ifdef ENABLE_LE_DATA_CHANNELS
@@ -72,6 +74,9 @@
 #define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK 5
 #define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT 5
 
+// MPS for incoming PDUs
+#define L2CAP_LE_DATA_CHANNELS_LOCAL_MPS 23
+
 // offsets for L2CAP SIGNALING COMMANDS
 #define L2CAP_SIGNALING_COMMAND_CODE_OFFSET   0
 #define L2CAP_SIGNALING_COMMAND_SIGID_OFFSET  1
@@ -103,20 +108,33 @@ static void l2cap_emit_channel_opened(l2cap_channel_t *channel, uint8_t status);
 static void l2cap_emit_channel_closed(l2cap_channel_t *channel);
 static void l2cap_emit_incoming_connection(l2cap_channel_t *channel);
 static int  l2cap_channel_ready_for_open(l2cap_channel_t *channel);
+static int  l2cap_channel_preempted(l2cap_channel_t * channel);
+static void l2cap_channel_set_waiting_for_can_send_now(l2cap_channel_t * channel, uint8_t waiting);
+static int  l2cap_channel_uses_flush_timeout(l2cap_channel_t * channel);
+static void l2cap_update_automatic_flush_timeout(hci_con_handle_t con_handle);
 #endif
 #ifdef ENABLE_LE_DATA_CHANNELS
 static void l2cap_emit_le_channel_opened(l2cap_channel_t *channel, uint8_t status);
 static void l2cap_emit_le_incoming_connection(l2cap_channel_t *channel);
 static l2cap_channel_t * l2cap_le_get_channel_for_local_cid(uint16_t local_cid);
 static void l2cap_le_notify_channel_can_send(l2cap_channel_t *channel);
+static void l2cap_le_send_pdu(l2cap_channel_t * channel, l2cap_le_sdu_t * sdu);
+static void l2cap_le_drop_queued_sdus(l2cap_channel_t * channel);
+static int  l2cap_le_has_receive_buffer_pool(l2cap_channel_t * channel);
+static int  l2cap_le_get_receive_buffer_index(l2cap_channel_t * channel, uint8_t * buffer);
+static uint16_t l2cap_le_get_initial_credits(l2cap_channel_t * channel);
+static void l2cap_le_update_automatic_credits(l2cap_channel_t * channel);
 static void l2cap_le_finialize_channel_close(l2cap_channel_t *channel);
 static inline l2cap_service_t * l2cap_le_get_service(uint16_t psm);
 #endif
 #ifdef L2CAP_USES_CHANNELS
 static void l2cap_dispatch_to_channel(l2cap_channel_t *channel, uint8_t type, uint8_t * data, uint16_t size);
 static l2cap_channel_t * l2cap_get_channel_for_local_cid(uint16_t local_cid);
+static void l2cap_channel_list_add(btstack_linked_list_t * list, btstack_keyed_index_t * index, l2cap_channel_t * channel);
+static void l2cap_channel_list_remove(btstack_linked_list_t * list, btstack_keyed_index_t * index, l2cap_channel_t * channel);
 static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t packet_handler, bd_addr_t address, bd_addr_type_t address_type, 
-        uint16_t psm, uint16_t local_mtu, gap_security_level_t security_level);
+        uint16_t psm, uint16_t local_mtu, gap_security_level_t security_level, hci_con_handle_t con_handle);
+static uint8_t * l2cap_pdu_sink_provider(hci_con_handle_t con_handle, uint16_t cid, uint16_t l2cap_length, uint16_t * buffer_size);
 #endif
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 static void l2cap_ertm_notify_channel_can_send(l2cap_channel_t * channel);
@@ -133,11 +151,15 @@ typedef struct l2cap_fixed_channel {
 static btstack_linked_list_t l2cap_channels;
 static btstack_linked_list_t l2cap_services;
 static uint8_t require_security_level2_for_outgoing_sdp;
+static btstack_keyed_index_t       l2cap_channel_index;
+static btstack_keyed_index_entry_t l2cap_channel_index_entries[L2CAP_CHANNEL_INDEX_SIZE];
 #endif
 
 #ifdef ENABLE_LE_DATA_CHANNELS
 static btstack_linked_list_t l2cap_le_channels;
 static btstack_linked_list_t l2cap_le_services;
+static btstack_keyed_index_t       l2cap_le_channel_index;
+static btstack_keyed_index_entry_t l2cap_le_channel_index_entries[L2CAP_CHANNEL_INDEX_SIZE];
 #endif
 
 // used to cache l2cap rejects, echo, and informational requests
@@ -154,46 +176,81 @@ static btstack_packet_handler_t l2cap_event_packet_handler;
 
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 
-/*
- * CRC lookup table for generator polynom D^16 + D^15 + D^2 + 1
- */
-static const uint16_t crc16_table[256] = {
-    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
-    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
-    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
-    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641, 0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
-    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240, 0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
-    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41, 0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
-    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41, 0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
-    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640, 0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
-    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240, 0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41, 0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
-    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41, 0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
-    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640, 0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
-    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241, 0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
-    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40, 0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
-    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40, 0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
-    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040, 
-};
-
-static uint16_t crc16_calc(uint8_t * data, uint16_t len){
-    uint16_t crc = 0;   // initial value = 0 
-    while (len--){
-        crc = (crc >> 8) ^ crc16_table[ (crc ^ ((uint16_t) *data++)) & 0x00FF ];
-    }
-    return crc;
-}
-
-static inline uint16_t l2cap_encanced_control_field_for_information_frame(uint8_t tx_seq, int final, uint8_t req_seq, l2cap_segmentation_and_reassembly_t sar){
+// decoded Enhanced (16-bit) or Extended (32-bit) Control Field
+typedef struct {
+    uint8_t  supervisor_frame;
+    uint8_t  poll;
+    uint8_t  final;
+    uint16_t req_seq;
+    uint16_t tx_seq;
+    l2cap_segmentation_and_reassembly_t sar;
+    l2cap_supervisory_function_t supervisory_function;
+} l2cap_ertm_control_t;
+
+static inline uint16_t l2cap_ertm_control_field_size(l2cap_channel_t * channel){
+    return channel->extended_control ? 4 : 2;
+}
+
+static inline uint16_t l2cap_ertm_seq_mask(l2cap_channel_t * channel){
+    return channel->extended_control ? 0x3fff : 0x3f;
+}
+
+static uint32_t l2cap_ertm_control_field_for_information_frame(l2cap_channel_t * channel, uint16_t tx_seq, int final, uint16_t req_seq, l2cap_segmentation_and_reassembly_t sar){
+    if (channel->extended_control){
+        return (((uint32_t) tx_seq) << 18) | (((uint32_t) sar) << 16) | (((uint32_t) req_seq) << 2) | (final << 1) | 0;
+    }
     return (((uint16_t) sar) << 14) | (req_seq << 8) | (final << 7) | (tx_seq << 1) | 0; 
 }
 
-static inline uint16_t l2cap_encanced_control_field_for_supevisor_frame(l2cap_supervisory_function_t supervisory_function, int poll, int final, uint8_t req_seq){
+static uint32_t l2cap_ertm_control_field_for_supervisor_frame(l2cap_channel_t * channel, l2cap_supervisory_function_t supervisory_function, int poll, int final, uint16_t req_seq){
+    if (channel->extended_control){
+        return (((uint32_t) poll) << 18) | (((uint32_t) supervisory_function) << 16) | (((uint32_t) req_seq) << 2) | (final << 1) | 1;
+    }
     return (req_seq << 8) | (final << 7) | (poll << 4) | (((int) supervisory_function) << 2) | 1; 
 }
 
-static int l2cap_next_ertm_seq_nr(int seq_nr){
-    return (seq_nr + 1) & 0x3f;
+static void l2cap_ertm_store_control_field(l2cap_channel_t * channel, uint8_t * buffer, uint16_t pos, uint32_t control){
+    if (channel->extended_control){
+        little_endian_store_32(buffer, pos, control);
+    } else {
+        little_endian_store_16(buffer, pos, (uint16_t) control);
+    }
+}
+
+static void l2cap_ertm_parse_control_field(l2cap_channel_t * channel, const uint8_t * buffer, uint16_t pos, l2cap_ertm_control_t * control){
+    if (channel->extended_control){
+        uint32_t field = little_endian_read_32(buffer, pos);
+        control->supervisor_frame     = field & 1;
+        control->final                = (field >> 1) & 0x01;
+        control->req_seq              = (field >> 2) & 0x3fff;
+        control->sar                  = (l2cap_segmentation_and_reassembly_t) ((field >> 16) & 0x03);
+        control->supervisory_function = (l2cap_supervisory_function_t) ((field >> 16) & 0x03);
+        control->poll                 = (field >> 18) & 0x01;
+        control->tx_seq               = (field >> 18) & 0x3fff;
+    } else {
+        uint16_t field = little_endian_read_16(buffer, pos);
+        control->supervisor_frame     = field & 1;
+        control->tx_seq               = (field >> 1) & 0x3f;
+        control->supervisory_function = (l2cap_supervisory_function_t) ((field >> 2) & 0x03);
+        control->poll                 = (field >> 4) & 0x01;
+        control->final                = (field >> 7) & 0x01;
+        control->req_seq              = (field >> 8) & 0x3f;
+        control->sar                  = (l2cap_segmentation_and_reassembly_t) (field >> 14);
+    }
+}
+
+static uint16_t l2cap_next_ertm_seq_nr(l2cap_channel_t * channel, uint16_t seq_nr){
+    return (seq_nr + 1) & l2cap_ertm_seq_mask(channel);
+}
+
+// number of frames from seq_nr_b to seq_nr_a
+static uint16_t l2cap_ertm_seq_delta(l2cap_channel_t * channel, uint16_t seq_nr_a, uint16_t seq_nr_b){
+    return (seq_nr_a - seq_nr_b) & l2cap_ertm_seq_mask(channel);
+}
+
+// max payload of a single I-Frame, limited by remote MPS and size of local tx buffers
+static uint16_t l2cap_ertm_max_tx_payload(l2cap_channel_t * channel){
+    return btstack_min(channel->remote_mps, channel->local_mps);
 }
 
 static int l2cap_ertm_can_store_packet_now(l2cap_channel_t * channel){
@@ -205,12 +262,13 @@ static int l2cap_ertm_can_store_packet_now(l2cap_channel_t * channel){
     int num_free_tx_buffers = channel->num_tx_buffers - num_tx_buffers_used;
     // calculate num tx buffers for remote MTU
     int num_tx_buffers_for_max_remote_mtu;
-    if (channel->remote_mtu <= channel->remote_mps){
+    uint16_t max_tx_payload = l2cap_ertm_max_tx_payload(channel);
+    if (channel->remote_mtu <= max_tx_payload){
         // MTU fits into single packet
         num_tx_buffers_for_max_remote_mtu = 1;
     } else {
         // include SDU Length
-        num_tx_buffers_for_max_remote_mtu = (channel->remote_mtu + 2 + (channel->remote_mps - 1)) / channel->remote_mps;
+        num_tx_buffers_for_max_remote_mtu = (channel->remote_mtu + 2 + (max_tx_payload - 1)) / max_tx_payload;
     }
     return num_tx_buffers_for_max_remote_mtu <= num_free_tx_buffers;
 }
@@ -296,14 +354,15 @@ static int l2cap_ertm_send_information_frame(l2cap_channel_t * channel, int inde
     l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[index];
     hci_reserve_packet_buffer();
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
-    uint16_t control = l2cap_encanced_control_field_for_information_frame(tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
-    log_info("I-Frame: control 0x%04x", control);
-    little_endian_store_16(acl_buffer, 8, control);
-    memcpy(&acl_buffer[8+2], &channel->tx_packets_data[index * channel->local_mtu], tx_state->len);
+    uint32_t control = l2cap_ertm_control_field_for_information_frame(channel, tx_state->tx_seq, final, channel->req_seq, tx_state->sar);
+    uint16_t control_size = l2cap_ertm_control_field_size(channel);
+    log_info("I-Frame: control 0x%08x", (unsigned int) control);
+    l2cap_ertm_store_control_field(channel, acl_buffer, 8, control);
+    memcpy(&acl_buffer[8+control_size], &channel->tx_packets_data[index * channel->local_mps], tx_state->len);
     // (re-)start retransmission timer on 
     l2cap_ertm_start_retransmission_timer(channel);
     // send
-    return l2cap_send_prepared(channel->local_cid, 2 + tx_state->len);
+    return l2cap_send_prepared(channel->local_cid, control_size + tx_state->len);
 }
 
 static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentation_and_reassembly_t sar, uint16_t sdu_length, uint8_t * data, uint16_t len){
@@ -312,20 +371,21 @@ static void l2cap_ertm_store_fragment(l2cap_channel_t * channel, l2cap_segmentat
 
     l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[index];
     tx_state->tx_seq = channel->next_tx_seq;
-    tx_state->len = len;
     tx_state->sar = sar;
     tx_state->retry_count = 0;
+    tx_state->retransmission_requested = 0;
 
-    uint8_t * tx_packet = &channel->tx_packets_data[index * channel->local_mtu];
+    uint8_t * tx_packet = &channel->tx_packets_data[index * channel->local_mps];
     int pos = 0;
     if (sar == L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU){
         little_endian_store_16(tx_packet, 0, sdu_length);
         pos += 2;
     }
     memcpy(&tx_packet[pos], data, len);
+    tx_state->len = pos + len;
 
     // update
-    channel->next_tx_seq = l2cap_next_ertm_seq_nr(channel->next_tx_seq);
+    channel->next_tx_seq = l2cap_next_ertm_seq_nr(channel, channel->next_tx_seq);
     l2cap_ertm_next_tx_write_index(channel);
 
     log_info("l2cap_ertm_store_fragment: after store, tx_read_index %u, tx_write_index %u", channel->tx_read_index, channel->tx_write_index);
@@ -339,26 +399,29 @@ static int l2cap_ertm_send(l2cap_channel_t * channel, uint8_t * data, uint16_t l
     }
 
     // check if it needs to get fragmented
-    if (len > channel->remote_mps){
+    uint16_t max_tx_payload = l2cap_ertm_max_tx_payload(channel);
+    if (len > max_tx_payload){
         // fragmentation needed.
         l2cap_segmentation_and_reassembly_t sar =  L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU;
         int chunk_len;
         while (len){
             switch (sar){
                 case L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU:
-                    chunk_len = channel->remote_mps - 2;    // sdu_length
+                    chunk_len = max_tx_payload - 2;    // sdu_length
                     l2cap_ertm_store_fragment(channel, sar, len, data, chunk_len);
-                    len -= chunk_len;
+                    data += chunk_len;
+                    len  -= chunk_len;
                     sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU;
                     break;
                 case L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU:
-                    chunk_len = channel->remote_mps;
+                    chunk_len = max_tx_payload;
                     if (chunk_len >= len){
                         sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_END_OF_L2CAP_SDU; 
                         chunk_len = len;                       
                     }
                     l2cap_ertm_store_fragment(channel, sar, len, data, chunk_len);
-                    len -= chunk_len;
+                    data += chunk_len;
+                    len  -= chunk_len;
                     break;
                 default:
                     break;
@@ -375,23 +438,33 @@ static int l2cap_ertm_send(l2cap_channel_t * channel, uint8_t * data, uint16_t l
 }
 
 static uint16_t l2cap_setup_options_ertm(l2cap_channel_t * channel, uint8_t * config_options){
+    // tx window > 63 requires Extended Window Size option and extended control field, if supported by remote
+    // without connection, the remote features are unknown: use standard window size
+    hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
+    if ((channel->num_rx_buffers > 63) && connection && (connection->l2cap_state.extended_feature_mask & 0x0100)){
+        channel->extended_control = 1;
+    }
     config_options[0] = 0x04;   // RETRANSMISSION AND FLOW CONTROL OPTION
     config_options[1] = 9;      // length
     config_options[2] = (uint8_t) channel->mode;
-    config_options[3] = channel->num_rx_buffers;    // == TxWindows size
+    config_options[3] = (uint8_t) btstack_min(channel->num_rx_buffers, 63);    // == TxWindows size
     config_options[4] = channel->local_max_transmit;
     little_endian_store_16( config_options, 5, channel->local_retransmission_timeout_ms); 
     little_endian_store_16( config_options, 7, channel->local_monitor_timeout_ms);
     little_endian_store_16( config_options, 9, channel->local_mps);
-    return 11;
+    if (!channel->extended_control) return 11;
+    config_options[11] = L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE;
+    config_options[12] = 2;     // length
+    little_endian_store_16( config_options, 13, btstack_min(channel->num_rx_buffers, 0x3fff));
+    return 15;
 }
 
-static int l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, uint16_t control){
+static int l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, uint32_t control){
     hci_reserve_packet_buffer();
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
-    log_info("S-Frame: control 0x%04x", control);
-    little_endian_store_16(acl_buffer, 8, control);
-    return l2cap_send_prepared(channel->local_cid, 2);
+    log_info("S-Frame: control 0x%08x", (unsigned int) control);
+    l2cap_ertm_store_control_field(channel, acl_buffer, 8, control);
+    return l2cap_send_prepared(channel->local_cid, l2cap_ertm_control_field_size(channel));
 }
 
 static uint8_t l2cap_ertm_validate_local_config(l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size){
@@ -420,6 +493,10 @@ static uint8_t l2cap_ertm_validate_local_config(l2cap_ertm_config_t * ertm_confi
         log_error("num_rx_buffers must be >= 1");
         result = ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
     }
+    if (ertm_config->num_rx_buffers > 0x3fff){
+        log_error("num_rx_buffers must be <= 16383");
+        result = ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
     if (ertm_config->num_tx_buffers < 1){
         log_error("num_rx_buffers must be >= 1");
         result = ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
@@ -449,6 +526,7 @@ static void l2cap_ertm_configure_channel(l2cap_channel_t * channel, l2cap_ertm_c
     pos += ertm_config->num_rx_buffers * sizeof(l2cap_ertm_rx_packet_state_t);
     channel->tx_packets_state = (l2cap_ertm_tx_packet_state_t *) &buffer[pos];
     pos += ertm_config->num_tx_buffers * sizeof(l2cap_ertm_tx_packet_state_t);
+    memset(buffer, 0, pos);
 
     // setup reassembly buffer
     channel->reassembly_buffer = &buffer[pos];
@@ -456,9 +534,9 @@ static void l2cap_ertm_configure_channel(l2cap_channel_t * channel, l2cap_ertm_c
 
     // divide rest of data equally
     channel->local_mps = (size - pos) / (ertm_config->num_rx_buffers + ertm_config->num_tx_buffers);
-    log_info("Local MPS: %u", channel->local_mtu);
+    log_info("Local MPS: %u", channel->local_mps);
     channel->rx_packets_data = &buffer[pos];
-    pos += ertm_config->num_rx_buffers * channel->local_mtu;
+    pos += ertm_config->num_rx_buffers * channel->local_mps;
     channel->tx_packets_data = &buffer[pos];
 }
 
@@ -471,7 +549,7 @@ uint8_t l2cap_create_ertm_channel(btstack_packet_handler_t packet_handler, bd_ad
     uint8_t result = l2cap_ertm_validate_local_config(ertm_config, buffer, size);
     if (result) return result;
 
-    l2cap_channel_t * channel = l2cap_create_channel_entry(packet_handler, address, BD_ADDR_TYPE_CLASSIC, psm, ertm_config->local_mtu, LEVEL_0);
+    l2cap_channel_t * channel = l2cap_create_channel_entry(packet_handler, address, BD_ADDR_TYPE_CLASSIC, psm, ertm_config->local_mtu, LEVEL_0, HCI_CON_HANDLE_INVALID);
     if (!channel) {
         return BTSTACK_MEMORY_ALLOC_FAILED;
     }
@@ -480,7 +558,7 @@ uint8_t l2cap_create_ertm_channel(btstack_packet_handler_t packet_handler, bd_ad
     l2cap_ertm_configure_channel(channel, ertm_config, buffer, size);
 
     // add to connections list
-    btstack_linked_list_add(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_list_add(&l2cap_channels, &l2cap_channel_index, channel);
 
     // store local_cid
     if (out_local_cid){
@@ -505,7 +583,7 @@ uint8_t l2cap_create_ertm_channel(btstack_packet_handler_t packet_handler, bd_ad
 
 static void l2cap_ertm_notify_channel_can_send(l2cap_channel_t * channel){
     if (l2cap_ertm_can_store_packet_now(channel)){
-        channel->waiting_for_can_send_now = 0;
+        l2cap_channel_set_waiting_for_can_send_now(channel, 0);
         l2cap_emit_can_send_now(channel->packet_handler, channel->local_cid);
     }
 }
@@ -564,7 +642,7 @@ uint8_t l2cap_ertm_set_ready(uint16_t local_cid){
 }
 
 // Process-ReqSeq
-static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t req_seq){
+static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint16_t req_seq){
     int num_buffers_acked = 0;
     l2cap_ertm_tx_packet_state_t * tx_state;
     log_info("l2cap_ertm_process_req_seq: tx_read_index %u, tx_write_index %u, req_seq %u", l2cap_channel->tx_read_index, l2cap_channel->tx_write_index, req_seq);
@@ -579,7 +657,7 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
 
         tx_state = &l2cap_channel->tx_packets_state[l2cap_channel->tx_read_index];
         // calc delta
-        int delta = (req_seq - tx_state->tx_seq) & 0x03f;
+        int delta = l2cap_ertm_seq_delta(l2cap_channel, req_seq, tx_state->tx_seq);
         if (delta == 0) break;  // all packets acknowledged
         if (delta > l2cap_channel->remote_tx_window_size) break;   
 
@@ -588,7 +666,7 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
         log_info("RR seq %u => packet with tx_seq %u done", req_seq, tx_state->tx_seq);
 
         l2cap_channel->tx_read_index++;
-        if (l2cap_channel->tx_read_index >= l2cap_channel->num_rx_buffers){
+        if (l2cap_channel->tx_read_index >= l2cap_channel->num_tx_buffers){
             l2cap_channel->tx_read_index = 0;
         }
     }
@@ -598,35 +676,68 @@ static void l2cap_ertm_process_req_seq(l2cap_channel_t * l2cap_channel, uint8_t
     }
 }     
 
-static l2cap_ertm_tx_packet_state_t * l2cap_ertm_get_tx_state(l2cap_channel_t * l2cap_channel, uint8_t tx_seq){
+// only unacknowledged frames can be requested for retransmission
+static int l2cap_ertm_get_tx_index(l2cap_channel_t * l2cap_channel, uint16_t tx_seq){
+    int index = l2cap_channel->tx_read_index;
     int i;
-    for (i=0;i<l2cap_channel->num_tx_buffers;i++){
-        l2cap_ertm_tx_packet_state_t * tx_state = &l2cap_channel->tx_packets_state[i];
-        if (tx_state->tx_seq == tx_seq) return tx_state;
+    for (i=0;i<l2cap_channel->unacked_frames;i++){
+        if (l2cap_channel->tx_packets_state[index].tx_seq == tx_seq) return index;
+        index++;
+        if (index >= l2cap_channel->num_tx_buffers){
+            index = 0;
+        }
     }
-    return NULL;
+    return -1;
+}
+
+static int l2cap_ertm_rx_index_for_delta(l2cap_channel_t * l2cap_channel, int delta){
+    int index = l2cap_channel->rx_store_index + delta;
+    if (index >= l2cap_channel->num_rx_buffers){
+        index -= l2cap_channel->num_rx_buffers;
+    }
+    return index;
 }
 
-// @param delta number of frames in the future, >= 1
+// @param delta number of frames in the future, 1 <= delta < num_rx_buffers
 static void l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel_t * l2cap_channel, l2cap_segmentation_and_reassembly_t sar, int delta, uint8_t * payload, uint16_t size){
     log_info("Store SDU with delta %u", delta);
-    // get rx state for packet to store
-    int index = l2cap_channel->rx_store_index + delta - 1;
-    if (index > l2cap_channel->num_rx_buffers){
-        index -= l2cap_channel->num_rx_buffers;
+    if (size > l2cap_channel->local_mps){
+        log_error("SDU segment larger than local MPS");
+        return;
     }
+    // get rx state for packet to store
+    int index = l2cap_ertm_rx_index_for_delta(l2cap_channel, delta);
     log_info("Index of packet to store %u", index);
     l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[index];
     // check if buffer is free
     if (rx_state->valid){
-        log_error("Packet buffer already used");
+        log_info("Duplicate frame, already stored");
         return;
     }
     rx_state->valid = 1;
     rx_state->sar = sar;
     rx_state->len = size;
-    uint8_t * rx_buffer = &l2cap_channel->rx_packets_data[index];
+    uint8_t * rx_buffer = &l2cap_channel->rx_packets_data[index * l2cap_channel->local_mps];
     memcpy(rx_buffer, payload, size);
+
+    // track highest received frame, all missing frames before it get selectively rejected
+    if (delta >= l2cap_ertm_seq_delta(l2cap_channel, l2cap_channel->srej_next_tx_seq, l2cap_channel->expected_tx_seq)){
+        l2cap_channel->srej_next_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, l2cap_channel->expected_tx_seq + delta);
+    }
+}
+
+// @returns tx_seq of next missing frame that has not been requested yet or -1
+static int l2cap_ertm_next_selective_reject_tx_seq(l2cap_channel_t * l2cap_channel){
+    int num_frames = l2cap_ertm_seq_delta(l2cap_channel, l2cap_channel->srej_next_tx_seq, l2cap_channel->expected_tx_seq);
+    int delta;
+    for (delta = 0; delta < num_frames; delta++){
+        l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[l2cap_ertm_rx_index_for_delta(l2cap_channel, delta)];
+        if (rx_state->valid) continue;
+        if (rx_state->srej_requested) continue;
+        rx_state->srej_requested = 1;
+        return (l2cap_channel->expected_tx_seq + delta) & l2cap_ertm_seq_mask(l2cap_channel);
+    }
+    return -1;
 }
 
 static void l2cap_ertm_handle_in_sequence_sdu(l2cap_channel_t * l2cap_channel, l2cap_segmentation_and_reassembly_t sar, uint8_t * payload, uint16_t size){
@@ -698,11 +809,13 @@ void l2cap_init(void){
     l2cap_channels = NULL;
     l2cap_services = NULL;
     require_security_level2_for_outgoing_sdp = 0;
+    btstack_keyed_index_init(&l2cap_channel_index, l2cap_channel_index_entries, L2CAP_CHANNEL_INDEX_SIZE);
 #endif
 
 #ifdef ENABLE_LE_DATA_CHANNELS
     l2cap_le_services = NULL;
     l2cap_le_channels = NULL;
+    btstack_keyed_index_init(&l2cap_le_channel_index, l2cap_le_channel_index_entries, L2CAP_CHANNEL_INDEX_SIZE);
 #endif
 
 #ifdef ENABLE_BLE
@@ -718,6 +831,10 @@ void l2cap_init(void){
 
     hci_register_acl_packet_handler(&l2cap_acl_handler);
 
+#ifdef L2CAP_USES_CHANNELS
+    hci_register_acl_recombination_sink_provider(&l2cap_pdu_sink_provider);
+#endif
+
 #ifdef ENABLE_CLASSIC
     gap_connectable_control(0); // no services yet
 #endif
@@ -821,6 +938,41 @@ static void l2cap_dispatch_to_channel(l2cap_channel_t *channel, uint8_t type, ui
     (* (channel->packet_handler))(type, channel->local_cid, data, size);
 }
 
+// channel lists are indexed by local cid, linear scan is only used if index overflowed
+static void l2cap_channel_list_add(btstack_linked_list_t * list, btstack_keyed_index_t * index, l2cap_channel_t * channel){
+    btstack_linked_list_add(list, (btstack_linked_item_t *) channel);
+    btstack_keyed_index_add(index, channel->local_cid, channel);
+}
+
+// call after channel was removed from list, e.g. by btstack_linked_list_iterator_remove
+static void l2cap_channel_index_remove(btstack_linked_list_t * list, btstack_keyed_index_t * index, l2cap_channel_t * channel){
+    btstack_keyed_index_remove(index, channel->local_cid, channel);
+    // overflowed index becomes usable again with empty list
+    if (btstack_linked_list_empty(list)){
+        btstack_keyed_index_clear(index);
+    }
+}
+
+static void l2cap_channel_list_remove(btstack_linked_list_t * list, btstack_keyed_index_t * index, l2cap_channel_t * channel){
+    btstack_linked_list_remove(list, (btstack_linked_item_t *) channel);
+    l2cap_channel_index_remove(list, index, channel);
+}
+
+static l2cap_channel_t * l2cap_channel_list_get(btstack_linked_list_t * list, btstack_keyed_index_t * index, uint16_t local_cid){
+    if (btstack_keyed_index_is_complete(index)){
+        return (l2cap_channel_t *) btstack_keyed_index_get(index, local_cid);
+    }
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, list);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
+        if ( channel->local_cid == local_cid) {
+            return channel;
+        }
+    }
+    return NULL;
+}
+
 static void l2cap_emit_simple_event_with_cid(l2cap_channel_t * channel, uint8_t event_code){
     uint8_t event[4];
     event[0] = event_code;
@@ -829,6 +981,60 @@ static void l2cap_emit_simple_event_with_cid(l2cap_channel_t * channel, uint8_t
     hci_dump_packet( HCI_EVENT_PACKET, 0, event, sizeof(event));
     l2cap_dispatch_to_channel(channel, HCI_EVENT_PACKET, event, sizeof(event));
 }
+
+static l2cap_channel_t * l2cap_get_channel_for_pdu_sink(uint16_t local_cid){
+    l2cap_channel_t * channel = NULL;
+#ifdef ENABLE_CLASSIC
+    channel = l2cap_get_channel_for_local_cid(local_cid);
+#endif
+#ifdef ENABLE_LE_DATA_CHANNELS
+    if (!channel){
+        channel = l2cap_le_get_channel_for_local_cid(local_cid);
+    }
+#endif
+    return channel;
+}
+
+// HCI recombination sink provider: fragments of PDUs for channels with registered sink are stored in place
+static uint8_t * l2cap_pdu_sink_provider(hci_con_handle_t con_handle, uint16_t cid, uint16_t l2cap_length, uint16_t * buffer_size){
+    UNUSED(l2cap_length);
+    l2cap_channel_t * channel = l2cap_get_channel_for_pdu_sink(cid);
+    if (!channel) return NULL;
+    if (channel->con_handle != con_handle) return NULL;
+    if (!channel->pdu_sink) return NULL;
+    *buffer_size = channel->pdu_sink_size;
+    return channel->pdu_sink;
+}
+
+static void l2cap_pdu_sink_release(l2cap_channel_t * channel){
+    if (!channel->pdu_sink) return;
+    hci_acl_recombination_sink_release(channel->con_handle, channel->pdu_sink);
+    channel->pdu_sink = NULL;
+    channel->pdu_sink_size = 0;
+}
+
+uint8_t l2cap_register_pdu_sink(uint16_t local_cid, uint8_t * buffer, uint16_t size){
+    l2cap_channel_t * channel = l2cap_get_channel_for_pdu_sink(local_cid);
+    if (!channel) {
+        log_error("l2cap_register_pdu_sink called but local_cid 0x%x not found", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+    if (size < L2CAP_PDU_SINK_SIZE(0)) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    l2cap_pdu_sink_release(channel);
+    channel->pdu_sink = buffer;
+    channel->pdu_sink_size = size;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_unregister_pdu_sink(uint16_t local_cid){
+    l2cap_channel_t * channel = l2cap_get_channel_for_pdu_sink(local_cid);
+    if (!channel) {
+        log_error("l2cap_unregister_pdu_sink called but local_cid 0x%x not found", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+    l2cap_pdu_sink_release(channel);
+    return ERROR_CODE_SUCCESS;
+}
 #endif
 
 #ifdef ENABLE_CLASSIC
@@ -874,15 +1080,7 @@ static void l2cap_emit_incoming_connection(l2cap_channel_t *channel) {
 }
 
 static l2cap_channel_t * l2cap_get_channel_for_local_cid(uint16_t local_cid){
-    btstack_linked_list_iterator_t it;    
-    btstack_linked_list_iterator_init(&it, &l2cap_channels);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-        if ( channel->local_cid == local_cid) {
-            return channel;
-        }
-    } 
-    return NULL;
+    return l2cap_channel_list_get(&l2cap_channels, &l2cap_channel_index, local_cid);
 }
 
 ///
@@ -890,7 +1088,7 @@ static l2cap_channel_t * l2cap_get_channel_for_local_cid(uint16_t local_cid){
 void l2cap_request_can_send_now_event(uint16_t local_cid){
     l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
     if (!channel) return;
-    channel->waiting_for_can_send_now = 1;
+    l2cap_channel_set_waiting_for_can_send_now(channel, 1);
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
         l2cap_ertm_notify_channel_can_send(channel);
@@ -908,9 +1106,39 @@ int  l2cap_can_send_packet_now(uint16_t local_cid){
         return l2cap_ertm_can_store_packet_now(channel);
     }
 #endif    
+    if (l2cap_channel_preempted(channel)) return 0;
     return hci_can_send_acl_packet_now(channel->con_handle);
 }
 
+uint8_t l2cap_set_channel_priority(uint16_t local_cid, l2cap_channel_priority_t priority){
+    l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
+    if (!channel) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    if (priority > L2CAP_CHANNEL_PRIORITY_HIGH) return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    // move waiting channel to new priority
+    uint8_t waiting = channel->waiting_for_can_send_now;
+    l2cap_channel_set_waiting_for_can_send_now(channel, 0);
+    channel->priority = priority;
+    l2cap_channel_set_waiting_for_can_send_now(channel, waiting);
+    // lower priority channels might have been waiting for this one
+    l2cap_notify_channel_can_send();
+    return 0;
+}
+
+uint8_t l2cap_set_channel_flush_timeout(uint16_t local_cid, uint16_t flush_timeout_ms){
+    l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
+    if (!channel) return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    if ((flush_timeout_ms == 0) || ((flush_timeout_ms > 1279) && (flush_timeout_ms != 0xffff))){
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    // flush timeout is part of the configuration request
+    if ((channel->state == L2CAP_STATE_OPEN) || (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SENT_CONF_REQ)){
+        log_error("l2cap_set_channel_flush_timeout: configuration request already sent for cid 0x%02x", local_cid);
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+    channel->local_flush_timeout = flush_timeout_ms;
+    return 0;
+}
+
 int  l2cap_can_send_prepared_packet_now(uint16_t local_cid){
     l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
     if (!channel) return 0;
@@ -955,7 +1183,8 @@ static void l2cap_rtx_timeout(btstack_timer_source_t * ts){
 
     // discard channel
     // no need to stop timer here, it is removed from list during timer callback
-    btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_set_waiting_for_can_send_now(channel, 0);
+    l2cap_channel_list_remove(&l2cap_channels, &l2cap_channel_index, channel);
     btstack_memory_l2cap_channel_free(channel);
 }
 
@@ -1034,15 +1263,18 @@ int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
     }
 #endif
 
-    // set non-flushable packet boundary flag if supported on Controller
+    // set non-flushable packet boundary flag if supported on Controller, unless channel uses flush timeout
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
-    uint8_t packet_boundary_flag = hci_non_flushable_packet_boundary_flag_supported() ? 0x00 : 0x02;
+    uint8_t packet_boundary_flag = 0x02;
+    if (!l2cap_channel_uses_flush_timeout(channel) && hci_non_flushable_packet_boundary_flag_supported()){
+        packet_boundary_flag = 0x00;
+    }
     l2cap_setup_header(acl_buffer, channel->con_handle, packet_boundary_flag, channel->remote_cid, len + fcs_size);
 
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
         // calculate FCS over l2cap data
-        uint16_t fcs = crc16_calc(acl_buffer + 4, 4 + len);
+        uint16_t fcs = btstack_crc16_calc(acl_buffer + 4, 4 + len);
         log_info("I-Frame: fcs 0x%04x", fcs);
         little_endian_store_16(acl_buffer, 8 + len, fcs);
     }
@@ -1072,7 +1304,7 @@ int l2cap_send(uint16_t local_cid, uint8_t *data, uint16_t len){
         return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
     }
 
-    if (!hci_can_send_acl_packet_now(channel->con_handle)){
+    if (!hci_can_send_acl_packet_now(channel->con_handle) || l2cap_channel_preempted(channel)){
         log_info("l2cap_send cid 0x%02x, cannot send", local_cid);
         return BTSTACK_ACL_BUFFERS_FULL;
     }
@@ -1138,7 +1370,7 @@ static uint16_t l2cap_setup_options(l2cap_channel_t * channel, uint8_t * config_
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
     // use ERTM options if supported
     hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
-    if ((connection->l2cap_state.information_state == L2CAP_INFORMATION_STATE_DONE) && (connection->l2cap_state.extended_feature_mask & 0x08)){
+    if (connection && (connection->l2cap_state.information_state == L2CAP_INFORMATION_STATE_DONE) && (connection->l2cap_state.extended_feature_mask & 0x08)){
         return l2cap_setup_options_ertm(channel, config_options);
 
     }
@@ -1146,11 +1378,58 @@ static uint16_t l2cap_setup_options(l2cap_channel_t * channel, uint8_t * config_
     return l2cap_setup_options_mtu(channel, config_options);
 }
 
+static int l2cap_channel_uses_flush_timeout(l2cap_channel_t * channel){
+    if (channel->local_flush_timeout == 0xffff) return 0;
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    // lost packets are retransmitted in ERTM
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION) return 0;
+#endif
+    return 1;
+}
+
+static uint16_t l2cap_setup_options_flush_timeout(l2cap_channel_t * channel, uint8_t * config_options){
+    if (!l2cap_channel_uses_flush_timeout(channel)) return 0;
+    config_options[0] = L2CAP_CONFIG_OPTION_TYPE_FLUSH_TIMEOUT;
+    config_options[1] = 2; // len param
+    little_endian_store_16(config_options, 2, channel->local_flush_timeout);
+    return 4;
+}
+
+// HCI Automatic Flush Timeout uses 0.625 ms units, max 0x7ff, 0 = no automatic flush
+static uint16_t l2cap_flush_timeout_to_slots(uint16_t flush_timeout_ms){
+    if (flush_timeout_ms == 0xffff) return 0;
+    uint32_t slots = ((uint32_t) flush_timeout_ms * 8) / 5;
+    return (uint16_t) btstack_max(1, btstack_min(slots, 0x7ff));
+}
+
+// Automatic Flush Timeout is set per ACL connection, use minimum of all open channels
+static void l2cap_update_automatic_flush_timeout(hci_con_handle_t con_handle){
+    // flushable packets would be dropped on other channels, too, if non-flushable ones are not supported
+    if (!hci_non_flushable_packet_boundary_flag_supported()) return;
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) return;
+    uint16_t flush_timeout_ms = 0xffff;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &l2cap_channels);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
+        if (channel->con_handle != con_handle) continue;
+        if (channel->state != L2CAP_STATE_OPEN) continue;
+        if (!l2cap_channel_uses_flush_timeout(channel)) continue;
+        flush_timeout_ms = btstack_min(flush_timeout_ms, channel->local_flush_timeout);
+    }
+    uint16_t automatic_flush_timeout = l2cap_flush_timeout_to_slots(flush_timeout_ms);
+    if (connection->l2cap_state.automatic_flush_timeout == automatic_flush_timeout) return;
+    connection->l2cap_state.automatic_flush_timeout = automatic_flush_timeout;
+    connection->l2cap_state.send_automatic_flush_timeout = 1;
+}
+
 static uint32_t l2cap_extended_features_mask(void){
     // extended features request supported, features: fixed channels, unicast connectionless data reception
     uint32_t features = 0x280;
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
-    features |= 0x0008;
+    // enhanced retransmission mode, extended window size
+    features |= 0x0108;
 #endif
     return features;
 }
@@ -1260,7 +1539,19 @@ static void l2cap_run(void){
 #endif
 
 #ifdef ENABLE_CLASSIC
-    uint8_t  config_options[10];
+    // update Automatic Flush Timeout
+    hci_connections_get_iterator(&it);
+    while(btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (!connection->l2cap_state.send_automatic_flush_timeout) continue;
+        if (!hci_can_send_command_packet_now()) break;
+        connection->l2cap_state.send_automatic_flush_timeout = 0;
+        hci_send_cmd(&hci_write_automatic_flush_timeout, connection->con_handle, connection->l2cap_state.automatic_flush_timeout);
+    }
+#endif
+
+#ifdef ENABLE_CLASSIC
+    uint8_t  config_options[20];
     btstack_linked_list_iterator_init(&it, &l2cap_channels);
     while (btstack_linked_list_iterator_has_next(&it)){
 
@@ -1292,6 +1583,7 @@ static void l2cap_run(void){
                 // discard channel - l2cap_finialize_channel_close without sending l2cap close event
                 l2cap_stop_rtx(channel);
                 btstack_linked_list_iterator_remove(&it);
+                l2cap_channel_index_remove(&l2cap_channels, &l2cap_channel_index, channel);
                 btstack_memory_l2cap_channel_free(channel); 
                 break;
                 
@@ -1345,11 +1637,13 @@ static void l2cap_run(void){
                     channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_SENT_CONF_REQ);
                     channel->local_sig_id = l2cap_next_sig_id();
                     uint16_t options_size = l2cap_setup_options(channel, config_options);
+                    options_size += l2cap_setup_options_flush_timeout(channel, &config_options[options_size]);
                     l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_REQUEST, channel->local_sig_id, channel->remote_cid, 0, options_size, &config_options);
                     l2cap_start_rtx(channel);
                 }
                 if (l2cap_channel_ready_for_open(channel)){
                     channel->state = L2CAP_STATE_OPEN;
+                    l2cap_update_automatic_flush_timeout(channel->con_handle);
                     l2cap_emit_channel_opened(channel, 0);  // success
                 }
                 break;
@@ -1368,6 +1662,7 @@ static void l2cap_run(void){
                 channel->state = L2CAP_STATE_WAIT_DISCONNECT;
                 l2cap_send_signaling_packet( channel->con_handle, DISCONNECTION_REQUEST, channel->local_sig_id, channel->remote_cid, channel->local_cid);   
                 break;
+
             default:
                 break;
         }
@@ -1394,7 +1689,7 @@ static void l2cap_run(void){
         if (channel->send_supervisor_frame_receiver_ready){
             channel->send_supervisor_frame_receiver_ready = 0;
             log_info("Send S-Frame: RR %u, final %u", channel->req_seq, channel->set_final_bit_after_packet_with_poll_bit_set);
-            uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0,  channel->set_final_bit_after_packet_with_poll_bit_set, channel->req_seq);
+            uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0,  channel->set_final_bit_after_packet_with_poll_bit_set, channel->req_seq);
             channel->set_final_bit_after_packet_with_poll_bit_set = 0;
             l2cap_ertm_send_supervisor_frame(channel, control);
             continue;
@@ -1402,46 +1697,56 @@ static void l2cap_run(void){
         if (channel->send_supervisor_frame_receiver_ready_poll){
             channel->send_supervisor_frame_receiver_ready_poll = 0;
             log_info("Send S-Frame: RR %u with poll=1 ", channel->req_seq);
-            uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1, 0, channel->req_seq);
+            uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1, 0, channel->req_seq);
             l2cap_ertm_send_supervisor_frame(channel, control);
             continue;
         }
         if (channel->send_supervisor_frame_receiver_not_ready){
             channel->send_supervisor_frame_receiver_not_ready = 0;
             log_info("Send S-Frame: RNR %u", channel->req_seq);
-            uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY, 0, 0, channel->req_seq);
+            uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY, 0, 0, channel->req_seq);
             l2cap_ertm_send_supervisor_frame(channel, control);
             continue;
         }
         if (channel->send_supervisor_frame_reject){
             channel->send_supervisor_frame_reject = 0;
             log_info("Send S-Frame: REJ %u", channel->req_seq);
-            uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0, 0, channel->req_seq);
+            uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0, 0, channel->req_seq);
             l2cap_ertm_send_supervisor_frame(channel, control);
             continue;
         }
         if (channel->send_supervisor_frame_selective_reject){
+            // one SREJ per missing frame
+            int tx_seq = l2cap_ertm_next_selective_reject_tx_seq(channel);
+            if (tx_seq >= 0){
+                log_info("Send S-Frame: SREJ %u", tx_seq);
+                uint32_t control = l2cap_ertm_control_field_for_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, channel->set_final_bit_after_packet_with_poll_bit_set, tx_seq);
+                channel->set_final_bit_after_packet_with_poll_bit_set = 0;
+                l2cap_ertm_send_supervisor_frame(channel, control);
+                continue;
+            }
             channel->send_supervisor_frame_selective_reject = 0;
-            log_info("Send S-Frame: SREJ %u", channel->expected_tx_seq);
-            uint16_t control = l2cap_encanced_control_field_for_supevisor_frame( L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, channel->set_final_bit_after_packet_with_poll_bit_set, channel->expected_tx_seq);
-            channel->set_final_bit_after_packet_with_poll_bit_set = 0;
-            l2cap_ertm_send_supervisor_frame(channel, control);
-            continue;
         }
 
         if (channel->srej_active){
+            int index = channel->tx_read_index;
             int i;
-            for (i=0;i<channel->num_tx_buffers;i++){
-                l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[i];
+            for (i=0;i<channel->unacked_frames;i++){
+                l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[index];
                 if (tx_state->retransmission_requested) {
                     tx_state->retransmission_requested = 0;
+                    tx_state->retry_count++;
                     uint8_t final = channel->set_final_bit_after_packet_with_poll_bit_set;
                     channel->set_final_bit_after_packet_with_poll_bit_set = 0;
-                    l2cap_ertm_send_information_frame(channel, i, final);
+                    l2cap_ertm_send_information_frame(channel, index, final);
                     break;
                 }
+                index++;
+                if (index >= channel->num_tx_buffers){
+                    index = 0;
+                }
             }
-            if (i == channel->num_tx_buffers){
+            if (i == channel->unacked_frames){
                 // no retransmission request found
                 channel->srej_active = 0;
             } else {
@@ -1457,29 +1762,29 @@ static void l2cap_run(void){
 #ifdef ENABLE_LE_DATA_CHANNELS
     btstack_linked_list_iterator_init(&it, &l2cap_le_channels);
     while (btstack_linked_list_iterator_has_next(&it)){
-        uint8_t  * acl_buffer;
-        uint8_t  * l2cap_payload;
-        uint16_t pos;
-        uint16_t payload_size;
         l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
         // log_info("l2cap_run: channel %p, state %u, var 0x%02x", channel, channel->state, channel->state_var);
         switch (channel->state){
             case L2CAP_STATE_WILL_SEND_LE_CONNECTION_REQUEST:
+                // wait for receive buffers
+                if (!channel->receive_sdu_buffer && !l2cap_le_has_receive_buffer_pool(channel)) break;
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
                 channel->state = L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE;
                 // le psm, source cid, mtu, mps, initial credits
                 channel->local_sig_id = l2cap_next_sig_id();
-                channel->credits_incoming =  channel->new_credits_incoming;
+                channel->credits_incoming = l2cap_le_get_initial_credits(channel);
                 channel->new_credits_incoming = 0;
-                l2cap_send_le_signaling_packet( channel->con_handle, LE_CREDIT_BASED_CONNECTION_REQUEST, channel->local_sig_id, channel->psm, channel->local_cid, channel->local_mtu, 23, channel->credits_incoming);
+                l2cap_send_le_signaling_packet( channel->con_handle, LE_CREDIT_BASED_CONNECTION_REQUEST, channel->local_sig_id, channel->psm, channel->local_cid, channel->local_mtu, L2CAP_LE_DATA_CHANNELS_LOCAL_MPS, channel->credits_incoming);
                 break;
             case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
+                // wait for receive buffers
+                if (!channel->receive_sdu_buffer && !l2cap_le_has_receive_buffer_pool(channel)) break;
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
                 // TODO: support larger MPS
                 channel->state = L2CAP_STATE_OPEN;
-                channel->credits_incoming =  channel->new_credits_incoming;
+                channel->credits_incoming = l2cap_le_get_initial_credits(channel);
                 channel->new_credits_incoming = 0;
-                l2cap_send_le_signaling_packet(channel->con_handle, LE_CREDIT_BASED_CONNECTION_RESPONSE, channel->remote_sig_id, channel->local_cid, channel->local_mtu, 23, channel->credits_incoming, 0);
+                l2cap_send_le_signaling_packet(channel->con_handle, LE_CREDIT_BASED_CONNECTION_RESPONSE, channel->remote_sig_id, channel->local_cid, channel->local_mtu, L2CAP_LE_DATA_CHANNELS_LOCAL_MPS, channel->credits_incoming, 0);
                 // notify client
                 l2cap_emit_le_channel_opened(channel, 0);
                 break;                       
@@ -1490,11 +1795,15 @@ static void l2cap_run(void){
                 // discard channel - l2cap_finialize_channel_close without sending l2cap close event
                 l2cap_stop_rtx(channel);
                 btstack_linked_list_iterator_remove(&it);
+                l2cap_channel_index_remove(&l2cap_le_channels, &l2cap_le_channel_index, channel);
                 btstack_memory_l2cap_channel_free(channel);
                 break;
             case L2CAP_STATE_OPEN:
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
 
+                // replenish credits for free receive buffers
+                l2cap_le_update_automatic_credits(channel);
+
                 // send credits
                 if (channel->new_credits_incoming){
                     log_info("l2cap: sending %u credits", channel->new_credits_incoming);
@@ -1506,39 +1815,15 @@ static void l2cap_run(void){
                     break;
                 }
 
-                // send data
-                if (!channel->send_sdu_buffer) break;
-                if (!channel->credits_outgoing) break;
-
-                // send part of SDU
-                hci_reserve_packet_buffer();
-                acl_buffer = hci_get_outgoing_packet_buffer();
-                l2cap_payload = acl_buffer + 8;
-                pos = 0;
-                if (!channel->send_sdu_pos){
-                    // store SDU len
-                    channel->send_sdu_pos += 2;
-                    little_endian_store_16(l2cap_payload, pos, channel->send_sdu_len);
-                    pos += 2;
-                }
-                payload_size = btstack_min(channel->send_sdu_len + 2 - channel->send_sdu_pos, channel->remote_mps - pos);
-                log_info("len %u, pos %u => payload %u, credits %u", channel->send_sdu_len, channel->send_sdu_pos, payload_size, channel->credits_outgoing);
-                memcpy(&l2cap_payload[pos], &channel->send_sdu_buffer[channel->send_sdu_pos-2], payload_size); // -2 for virtual SDU len
-                pos += payload_size;
-                channel->send_sdu_pos += payload_size;
-                l2cap_setup_header(acl_buffer, channel->con_handle, 0, channel->remote_cid, pos);
-                // done
-
-                channel->credits_outgoing--;
-
-                if (channel->send_sdu_pos >= channel->send_sdu_len + 2){
-                    channel->send_sdu_buffer = NULL;
-                    // send done event
-                    l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_LE_PACKET_SENT);
-                    // inform about can send now
-                    l2cap_le_notify_channel_can_send(channel);
+                // send data as long as credits are available and the controller can take it
+                while (1){
+                    l2cap_le_sdu_t * sdu = (l2cap_le_sdu_t *) btstack_linked_list_get_first_item(&channel->send_sdu_queue);
+                    if (!sdu) break;
+                    if (!channel->credits_outgoing) break;
+                    if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
+                    l2cap_le_send_pdu(channel, sdu);
+                    if (channel->state != L2CAP_STATE_OPEN) break;
                 }
-                hci_send_acl_packet_buffer(8 + pos);
                 break;
             case L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST:
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
@@ -1633,9 +1918,10 @@ static void l2cap_handle_remote_supported_features_received(l2cap_channel_t * ch
 
 #ifdef L2CAP_USES_CHANNELS
 static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t packet_handler, bd_addr_t address, bd_addr_type_t address_type, 
-    uint16_t psm, uint16_t local_mtu, gap_security_level_t security_level){
+    uint16_t psm, uint16_t local_mtu, gap_security_level_t security_level, hci_con_handle_t con_handle){
 
-    l2cap_channel_t * channel = btstack_memory_l2cap_channel_get();
+    // channels for existing connections are allocated from the memory of the connection
+    l2cap_channel_t * channel = btstack_memory_l2cap_channel_get_for_connection(con_handle);
     if (!channel) {
         return NULL;
     }
@@ -1651,6 +1937,8 @@ static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t pac
     channel->local_mtu  = local_mtu;
     channel->remote_mtu = L2CAP_MINIMAL_MTU;
     channel->required_security_level = security_level;
+    channel->local_flush_timeout = 0xffff;
+    channel->priority = L2CAP_CHANNEL_PRIORITY_NORMAL;
 
     // 
     channel->local_cid = l2cap_next_local_cid();
@@ -1683,7 +1971,7 @@ uint8_t l2cap_create_channel(btstack_packet_handler_t channel_packet_handler, bd
 
     log_info("L2CAP_CREATE_CHANNEL addr %s psm 0x%x mtu %u -> local mtu %u", bd_addr_to_str(address), psm, mtu, local_mtu);
 
-    l2cap_channel_t * channel = l2cap_create_channel_entry(channel_packet_handler, address, BD_ADDR_TYPE_CLASSIC, psm, local_mtu, LEVEL_0);
+    l2cap_channel_t * channel = l2cap_create_channel_entry(channel_packet_handler, address, BD_ADDR_TYPE_CLASSIC, psm, local_mtu, LEVEL_0, HCI_CON_HANDLE_INVALID);
     if (!channel) {
         return BTSTACK_MEMORY_ALLOC_FAILED;
     }
@@ -1693,7 +1981,7 @@ uint8_t l2cap_create_channel(btstack_packet_handler_t channel_packet_handler, bd
 #endif    
 
     // add to connections list
-    btstack_linked_list_add(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_list_add(&l2cap_channels, &l2cap_channel_index, channel);
 
     // store local_cid
     if (out_local_cid){
@@ -1743,6 +2031,7 @@ static void l2cap_handle_connection_failed_for_addr(bd_addr_t address, uint8_t s
                 // discard channel
                 l2cap_stop_rtx(channel);
                 btstack_linked_list_iterator_remove(&it);
+                l2cap_channel_index_remove(&l2cap_channels, &l2cap_channel_index, channel);
                 btstack_memory_l2cap_channel_free(channel);
                 break;
             default:
@@ -1765,18 +2054,122 @@ static void l2cap_handle_connection_success_for_addr(bd_addr_t address, hci_con_
 }
 #endif
 
-static void l2cap_notify_channel_can_send(void){
-
 #ifdef ENABLE_CLASSIC
+// @returns waiting channel with highest priority, first in list for same priority
+// get waiting channel with highest priority, starting after the channel that was notified last on this connection
+static l2cap_channel_t * l2cap_channel_waiting_for_can_send_now(hci_connection_t * connection){
+    int priority = -1;
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) l2cap_channels; it ; it = it->next){
+        l2cap_channel_t * channel = (l2cap_channel_t *) it;
+        if (!channel->waiting_for_can_send_now) continue;
+        if (channel->con_handle != connection->con_handle) continue;
+        if ((int) channel->priority > priority){
+            priority = channel->priority;
+        }
+    }
+    if (priority < 0) return NULL;
+
+    l2cap_channel_t * first_waiting = NULL;
+    int after_last = 0;
+    for (it = (btstack_linked_item_t *) l2cap_channels; it ; it = it->next){
+        l2cap_channel_t * channel = (l2cap_channel_t *) it;
+        if (channel->con_handle != connection->con_handle) continue;
+        if (channel->waiting_for_can_send_now && ((int) channel->priority == priority)){
+            if (after_last) return channel;
+            if (!first_waiting){
+                first_waiting = channel;
+            }
+        }
+        if (channel->local_cid == connection->l2cap_state.can_send_now_last_cid){
+            after_last = 1;
+        }
+    }
+    // wrap around
+    return first_waiting;
+}
+
+// update waiting flag and per-connection count of waiting channels for its priority
+static void l2cap_channel_set_waiting_for_can_send_now(l2cap_channel_t * channel, uint8_t waiting){
+    if (channel->waiting_for_can_send_now == waiting) return;
+    channel->waiting_for_can_send_now = waiting;
+    hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
+    if (!connection) return;
+    uint16_t * num_waiting = &connection->l2cap_state.num_waiting_for_can_send_now[channel->priority];
+    if (waiting){
+        (*num_waiting)++;
+    } else if (*num_waiting){
+        (*num_waiting)--;
+    }
+}
+
+// channel with higher priority on the same connection is waiting to send
+static int l2cap_channel_preempted(l2cap_channel_t * channel){
+    if (channel->priority == L2CAP_CHANNEL_PRIORITY_HIGH) return 0;
+    hci_connection_t * connection = hci_connection_for_handle(channel->con_handle);
+    if (!connection) return 0;
+    int priority;
+    for (priority = channel->priority + 1; priority <= L2CAP_CHANNEL_PRIORITY_HIGH; priority++){
+        if (connection->l2cap_state.num_waiting_for_can_send_now[priority]) return 1;
+    }
+    return 0;
+}
+
+static int l2cap_connection_ready_to_send(hci_connection_t * connection, void * context){
+    UNUSED(context);
+    int priority;
+    int num_waiting = 0;
+    for (priority = L2CAP_CHANNEL_PRIORITY_LOW; priority <= L2CAP_CHANNEL_PRIORITY_HIGH; priority++){
+        num_waiting += connection->l2cap_state.num_waiting_for_can_send_now[priority];
+    }
+    if (!num_waiting) return 0;
+    if (!l2cap_channel_waiting_for_can_send_now(connection)) return 0;
+    return hci_can_send_acl_packet_now(connection->con_handle);
+}
+
+// let ACL scheduler select the connection, and serve its channels round robin
+static void l2cap_notify_channel_can_send_scheduled(void){
+    // each waiting channel is notified at most once, even if it requests another can send now event
+    int num_waiting = 0;
     btstack_linked_list_iterator_t it;
     btstack_linked_list_iterator_init(&it, &l2cap_channels);
     while (btstack_linked_list_iterator_has_next(&it)){
         l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-        if (!channel->waiting_for_can_send_now) continue;
-        if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
-        channel->waiting_for_can_send_now = 0;
+        if (channel->waiting_for_can_send_now) num_waiting++;
+    }
+    while (num_waiting--){
+        hci_connection_t * connection = hci_acl_scheduler_select(&l2cap_connection_ready_to_send, NULL);
+        if (!connection) break;
+        l2cap_channel_t * channel = l2cap_channel_waiting_for_can_send_now(connection);
+        connection->l2cap_state.can_send_now_last_cid = channel->local_cid;
+        l2cap_channel_set_waiting_for_can_send_now(channel, 0);
         l2cap_emit_can_send_now(channel->packet_handler, channel->local_cid);
     }
+}
+#endif
+
+static void l2cap_notify_channel_can_send(void){
+
+#ifdef ENABLE_CLASSIC
+    if (hci_get_acl_scheduler() == HCI_ACL_SCHEDULER_FIFO){
+        // serve channels with higher priority first
+        int priority;
+        for (priority = L2CAP_CHANNEL_PRIORITY_HIGH; priority >= L2CAP_CHANNEL_PRIORITY_LOW; priority--){
+            btstack_linked_list_iterator_t it;
+            btstack_linked_list_iterator_init(&it, &l2cap_channels);
+            while (btstack_linked_list_iterator_has_next(&it)){
+                l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
+                if (channel->priority != priority) continue;
+                if (!channel->waiting_for_can_send_now) continue;
+                if (l2cap_channel_preempted(channel)) continue;
+                if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
+                l2cap_channel_set_waiting_for_can_send_now(channel, 0);
+                l2cap_emit_can_send_now(channel->packet_handler, channel->local_cid);
+            }
+        }
+    } else {
+        l2cap_notify_channel_can_send_scheduled();
+    }
 #endif
 
     int i;
@@ -1846,6 +2239,7 @@ static void l2cap_handle_hci_disconnect_event(l2cap_channel_t * channel){
     } else {
         l2cap_emit_channel_closed(channel);
     }
+    l2cap_channel_set_waiting_for_can_send_now(channel, 0);
     btstack_memory_l2cap_channel_free(channel);
 }
 
@@ -1918,6 +2312,7 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
                 l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
                 if (channel->con_handle != handle) continue;
                 btstack_linked_list_iterator_remove(&it);
+                l2cap_channel_index_remove(&l2cap_channels, &l2cap_channel_index, channel);
                 l2cap_stop_rtx(channel);
                 l2cap_handle_hci_disconnect_event(channel);
             }
@@ -1928,6 +2323,8 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
                 l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
                 if (channel->con_handle != handle) continue;
                 btstack_linked_list_iterator_remove(&it);
+                l2cap_channel_index_remove(&l2cap_le_channels, &l2cap_le_channel_index, channel);
+                l2cap_le_drop_queued_sdus(channel);
                 l2cap_handle_hci_disconnect_event(channel);
             }
 #endif
@@ -2058,7 +2455,7 @@ static void l2cap_handle_connection_request(hci_con_handle_t handle, uint8_t sig
     // alloc structure
     // log_info("l2cap_handle_connection_request register channel");
     l2cap_channel_t * channel = l2cap_create_channel_entry(service->packet_handler, hci_connection->address, BD_ADDR_TYPE_CLASSIC, 
-    psm, service->mtu, service->required_security_level);
+    psm, service->mtu, service->required_security_level, handle);
     if (!channel){
         // 0x0004 No resources available
         l2cap_register_signaling_response(handle, CONNECTION_REQUEST, sig_id, source_cid, 0x0004);
@@ -2079,7 +2476,7 @@ static void l2cap_handle_connection_request(hci_con_handle_t handle, uint8_t sig
     channel->state_var  = (L2CAP_CHANNEL_STATE_VAR) (L2CAP_CHANNEL_STATE_VAR_SEND_CONN_RESP_PEND | L2CAP_CHANNEL_STATE_VAR_INCOMING);
     
     // add to connections list
-    btstack_linked_list_add(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_list_add(&l2cap_channels, &l2cap_channel_index, channel);
 
     // assert security requirements
     gap_request_security_level(handle, channel->required_security_level);
@@ -2125,6 +2522,10 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
         channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_CONT);
     }
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    uint16_t extended_window_size = 0;
+#endif
+
     // accept the other's configuration options
     uint16_t end_pos = 4 + little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_LENGTH_OFFSET);
     uint16_t pos     = 8;
@@ -2195,6 +2596,10 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
                     break;
             }
         }        
+        // Extended Window Size { type(8): 7, len(8): 2, Max Window Size(16) } - overrides TxWindow of Retransmission and Flow Control Option
+        if (option_type == L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE && length == 2){
+            extended_window_size = little_endian_read_16(command, pos) & 0x3fff;
+        }
 #endif        
         // check for unknown options
         if (option_hint == 0 && (option_type < L2CAP_CONFIG_OPTION_TYPE_MAX_TRANSMISSION_UNIT || option_type > L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE)){
@@ -2203,6 +2608,15 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
         }
         pos += length;
     }
+
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (extended_window_size && channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        // Extended Window Size option implies extended control field
+        channel->extended_control = 1;
+        channel->remote_tx_window_size = extended_window_size;
+        log_info("Extended Window Size: tx window %u", channel->remote_tx_window_size);
+    }
+#endif
 }
 
 static void l2cap_signaling_handle_configure_response(l2cap_channel_t *channel, uint8_t result, uint8_t *command){
@@ -2322,7 +2736,8 @@ static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *c
                             }
                             
                             // discard channel
-                            btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+                            l2cap_channel_set_waiting_for_can_send_now(channel, 0);
+                            l2cap_channel_list_remove(&l2cap_channels, &l2cap_channel_index, channel);
                             btstack_memory_l2cap_channel_free(channel);
                             break;
                     }
@@ -2374,6 +2789,7 @@ static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *c
             if (l2cap_channel_ready_for_open(channel)){
                 // for open:
                 channel->state = L2CAP_STATE_OPEN;
+                l2cap_update_automatic_flush_timeout(channel->con_handle);
                 l2cap_emit_channel_opened(channel, 0);
             }
             break;
@@ -2461,7 +2877,8 @@ static void l2cap_signaling_handler_dispatch( hci_con_handle_t handle, uint8_t *
                         // map l2cap connection response result to BTstack status enumeration
                         l2cap_emit_channel_opened(channel, L2CAP_CONNECTION_RESPONSE_RESULT_ERTM_NOT_SUPPORTED);
                         // discard channel
-                        btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+                        l2cap_channel_set_waiting_for_can_send_now(channel, 0);
+                        l2cap_channel_list_remove(&l2cap_channels, &l2cap_channel_index, channel);
                         btstack_memory_l2cap_channel_free(channel);
                         continue;
                     } else {
@@ -2618,9 +3035,10 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
                 channel->state = L2CAP_STATE_CLOSED;
                 // no official value for this, use: Connection refused – LE_PSM not supported - 0x0002
                 l2cap_emit_le_channel_opened(channel, 0x0002);
-                                
+                l2cap_le_drop_queued_sdus(channel);
+
                 // discard channel
-                btstack_linked_list_remove(&l2cap_le_channels, (btstack_linked_item_t *) channel);
+                l2cap_channel_list_remove(&l2cap_le_channels, &l2cap_le_channel_index, channel);
                 btstack_memory_l2cap_channel_free(channel);
                 break;
             }
@@ -2690,7 +3108,7 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
 
                 // allocate channel
                 channel = l2cap_create_channel_entry(service->packet_handler, connection->address,
-                    BD_ADDR_TYPE_LE_RANDOM, le_psm, service->mtu, service->required_security_level);
+                    BD_ADDR_TYPE_LE_RANDOM, le_psm, service->mtu, service->required_security_level, handle);
                 if (!channel){
                     // 0x0004 Connection refused – no resources available
                     l2cap_register_signaling_response(handle, LE_CREDIT_BASED_CONNECTION_REQUEST, sig_id, source_cid, 0x0004);
@@ -2706,10 +3124,10 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
 
                 // set initial state
                 channel->state      = L2CAP_STATE_WAIT_CLIENT_ACCEPT_OR_REJECT;
-                channel->state_var |= L2CAP_CHANNEL_STATE_VAR_INCOMING;
+                channel->state_var = (L2CAP_CHANNEL_STATE_VAR) (channel->state_var | L2CAP_CHANNEL_STATE_VAR_INCOMING);
 
                 // add to connections list
-                btstack_linked_list_add(&l2cap_le_channels, (btstack_linked_item_t *) channel);
+                l2cap_channel_list_add(&l2cap_le_channels, &l2cap_le_channel_index, channel);
 
                 // post connection request event
                 l2cap_emit_le_incoming_connection(channel);
@@ -2739,9 +3157,10 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
                 channel->state = L2CAP_STATE_CLOSED;
                 // map l2cap connection response result to BTstack status enumeration
                 l2cap_emit_le_channel_opened(channel, result);
-                                
+                l2cap_le_drop_queued_sdus(channel);
+
                 // discard channel
-                btstack_linked_list_remove(&l2cap_le_channels, (btstack_linked_item_t *) channel);
+                l2cap_channel_list_remove(&l2cap_le_channels, &l2cap_le_channel_index, channel);
                 btstack_memory_l2cap_channel_free(channel);
                 break;
             }
@@ -2865,7 +3284,7 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                 if (l2cap_channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
 
                     // verify FCS
-                    uint16_t fcs_calculated = crc16_calc(&packet[4], size - (4+2));
+                    uint16_t fcs_calculated = btstack_crc16_calc(&packet[4], size - (4+2));
                     uint16_t fcs_packet     = little_endian_read_16(packet, size-2);
                     log_info("Packet FCS 0x%04x, calculated FCS 0x%04x", fcs_packet, fcs_calculated);
                     if (fcs_calculated != fcs_packet){
@@ -2875,15 +3294,16 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                     }
 
                     // switch on packet type
-                    uint16_t control = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
-                    uint8_t  req_seq = (control >> 8) & 0x3f;
-                    int final = (control >> 7) & 0x01;
-                    if (control & 1){
+                    l2cap_ertm_control_t control;
+                    l2cap_ertm_parse_control_field(l2cap_channel, packet, COMPLETE_L2CAP_HEADER, &control);
+                    uint16_t req_seq = control.req_seq;
+                    int final = control.final;
+                    if (control.supervisor_frame){
                         // S-Frame
-                        int poll  = (control >> 4) & 0x01;
-                        l2cap_supervisory_function_t s = (l2cap_supervisory_function_t) ((control >> 2) & 0x03);
-                        log_info("Control: 0x%04x => Supervisory function %u, ReqSeq %02u", control, (int) s, req_seq);
-                        l2cap_ertm_tx_packet_state_t * tx_state;
+                        int poll  = control.poll;
+                        l2cap_supervisory_function_t s = control.supervisory_function;
+                        log_info("Control => Supervisory function %u, ReqSeq %02u", (int) s, req_seq);
+                        int tx_index;
                         switch (s){
                             case L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY:
                                 log_info("L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY");
@@ -2895,18 +3315,9 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                                 }
                                 if (poll){
                                     // check if we did request selective retransmission before <==> we have stored SDU segments
-                                    int i;
-                                    int num_stored_out_of_order_packets = 0;
-                                    for (i=0;i<l2cap_channel->num_rx_buffers;i++){
-                                        int index = l2cap_channel->rx_store_index + i;
-                                        if (index >= l2cap_channel->num_rx_buffers){
-                                            index -= l2cap_channel->num_rx_buffers;
-                                        }
-                                        l2cap_ertm_rx_packet_state_t * rx_state = &l2cap_channel->rx_packets_state[index];
-                                        if (!rx_state->valid) continue;
-                                        num_stored_out_of_order_packets++;
-                                    }
-                                    if (num_stored_out_of_order_packets){
+                                    if (l2cap_channel->srej_next_tx_seq != l2cap_channel->expected_tx_seq){
+                                        // request oldest missing frame again with final bit set
+                                        l2cap_channel->rx_packets_state[l2cap_channel->rx_store_index].srej_requested = 0;
                                         l2cap_channel->send_supervisor_frame_selective_reject = 1;
                                     } else {
                                         l2cap_channel->send_supervisor_frame_receiver_ready   = 1;
@@ -2940,8 +3351,14 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                                     l2cap_ertm_process_req_seq(l2cap_channel, req_seq);
                                 }
                                 // find requested i-frame
-                                tx_state = l2cap_ertm_get_tx_state(l2cap_channel, req_seq);
-                                if (tx_state){
+                                tx_index = l2cap_ertm_get_tx_index(l2cap_channel, req_seq);
+                                if (tx_index >= 0){
+                                    l2cap_ertm_tx_packet_state_t * tx_state = &l2cap_channel->tx_packets_state[tx_index];
+                                    if (tx_state->retry_count >= l2cap_channel->remote_max_transmit){
+                                        log_info("SREJ for tx_seq %u & retry count >= max transmit -> disconnect", req_seq);
+                                        l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                                        break;
+                                    }
                                     log_info("Retransmission for tx_seq %u requested", req_seq);
                                     l2cap_channel->set_final_bit_after_packet_with_poll_bit_set = poll;
                                     tx_state->retransmission_requested = 1;
@@ -2955,9 +3372,10 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                     } else {
                         // I-Frame
                         // get control
-                        l2cap_segmentation_and_reassembly_t sar = (l2cap_segmentation_and_reassembly_t) (control >> 14);
-                        uint8_t tx_seq = (control >> 1) & 0x3f;
-                        log_info("Control: 0x%04x => SAR %u, ReqSeq %02u, R?, TxSeq %02u", control, (int) sar, req_seq, tx_seq);
+                        l2cap_segmentation_and_reassembly_t sar = control.sar;
+                        uint16_t tx_seq = control.tx_seq;
+                        uint16_t header_size = COMPLETE_L2CAP_HEADER + l2cap_ertm_control_field_size(l2cap_channel);
+                        log_info("Control => SAR %u, ReqSeq %02u, R?, TxSeq %02u", (int) sar, req_seq, tx_seq);
                         log_info("SAR: pos %u", l2cap_channel->reassembly_pos);
                         log_info("State: expected_tx_seq %02u, req_seq %02u", l2cap_channel->expected_tx_seq, l2cap_channel->req_seq);
                         l2cap_ertm_process_req_seq(l2cap_channel, req_seq);
@@ -2966,13 +3384,22 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                             l2cap_channel->tx_send_index = l2cap_channel->tx_read_index;
                         }
                         // check ordering
-                        if (l2cap_channel->expected_tx_seq == tx_seq){
+                        int delta = l2cap_ertm_seq_delta(l2cap_channel, tx_seq, l2cap_channel->expected_tx_seq);
+                        if (delta == 0){
                             log_info("Received expected frame with TxSeq == ExpectedTxSeq == %02u", tx_seq);
-                            l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel->expected_tx_seq);
+                            int in_order = l2cap_channel->srej_next_tx_seq == l2cap_channel->expected_tx_seq;
+                            l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, l2cap_channel->expected_tx_seq);
                             l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
+                            if (in_order){
+                                l2cap_channel->srej_next_tx_seq = l2cap_channel->expected_tx_seq;
+                            }
+
+                            // release buffer of expected frame
+                            l2cap_channel->rx_packets_state[l2cap_channel->rx_store_index].srej_requested = 0;
+                            l2cap_channel->rx_store_index = l2cap_ertm_rx_index_for_delta(l2cap_channel, 1);
  
                             // process SDU
-                            l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, sar, &packet[COMPLETE_L2CAP_HEADER+2], size-(COMPLETE_L2CAP_HEADER+2+2));
+                            l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, sar, &packet[header_size], size-(header_size+2));
 
                             // process stored segments
                             while (1){
@@ -2981,35 +3408,32 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                                 if (!rx_state->valid) break;
 
                                 log_info("Processing stored frame with TxSeq == ExpectedTxSeq == %02u", l2cap_channel->expected_tx_seq);
-                                l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel->expected_tx_seq);
+                                l2cap_channel->expected_tx_seq = l2cap_next_ertm_seq_nr(l2cap_channel, l2cap_channel->expected_tx_seq);
                                 l2cap_channel->req_seq         = l2cap_channel->expected_tx_seq;
 
                                 rx_state->valid = 0;
-                                l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, rx_state->sar, &l2cap_channel->rx_packets_data[index], rx_state->len);
+                                rx_state->srej_requested = 0;
+                                l2cap_ertm_handle_in_sequence_sdu(l2cap_channel, rx_state->sar, &l2cap_channel->rx_packets_data[index * l2cap_channel->local_mps], rx_state->len);
 
                                 // update rx store index
-                                index++;
-                                if (index >= l2cap_channel->num_rx_buffers){
-                                    index = 0;
-                                }
-                                l2cap_channel->rx_store_index = index;
+                                l2cap_channel->rx_store_index = l2cap_ertm_rx_index_for_delta(l2cap_channel, 1);
                             }
 
                             //
                             l2cap_channel->send_supervisor_frame_receiver_ready = 1;
 
+                        } else if (delta < l2cap_channel->num_rx_buffers){
+                            // store segment
+                            l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel, sar, delta, &packet[header_size], size-(header_size+2));
+
+                            log_info("Received unexpected frame TxSeq %u but expected %u -> send S-SREJ", tx_seq, l2cap_channel->expected_tx_seq);
+                            l2cap_channel->send_supervisor_frame_selective_reject = 1;
+                        } else if (l2cap_ertm_seq_delta(l2cap_channel, l2cap_channel->expected_tx_seq, tx_seq) <= l2cap_channel->num_rx_buffers){
+                            log_info("Received duplicate frame TxSeq %u, expected %u -> ignore", tx_seq, l2cap_channel->expected_tx_seq);
+                            l2cap_channel->send_supervisor_frame_receiver_ready = 1;
                         } else {
-                            int delta = (tx_seq - l2cap_channel->expected_tx_seq) & 0x3f;
-                            if (delta < 2){
-                                // store segment
-                                l2cap_ertm_handle_out_of_sequence_sdu(l2cap_channel, sar, delta, &packet[COMPLETE_L2CAP_HEADER+2], size-(COMPLETE_L2CAP_HEADER+2+2));
-
-                                log_info("Received unexpected frame TxSeq %u but expected %u -> send S-SREJ", tx_seq, l2cap_channel->expected_tx_seq);
-                                l2cap_channel->send_supervisor_frame_selective_reject = 1;
-                            } else {
-                                log_info("Received unexpected frame TxSeq %u but expected %u -> send S-REJ", tx_seq, l2cap_channel->expected_tx_seq);
-                                l2cap_channel->send_supervisor_frame_reject = 1;
-                            }
+                            log_info("Received unexpected frame TxSeq %u but expected %u -> send S-REJ", tx_seq, l2cap_channel->expected_tx_seq);
+                            l2cap_channel->send_supervisor_frame_reject = 1;
                         }
                     }
                     break;
@@ -3028,27 +3452,65 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                     break;
                 }
                 l2cap_channel->credits_incoming--;
+                if (!l2cap_channel->credits_incoming){
+                    // remote cannot send until new credits are provided
+                    l2cap_channel->incoming_credits_exhausted++;
+                }
 
-                // automatic credits
-                if (l2cap_channel->credits_incoming < L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK && l2cap_channel->automatic_credits){
+                // automatic credits, see l2cap_le_update_automatic_credits for receive buffer pool
+                if (l2cap_channel->credits_incoming < L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK && l2cap_channel->automatic_credits
+                && !l2cap_le_has_receive_buffer_pool(l2cap_channel)){
                     l2cap_channel->new_credits_incoming = L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT;
                 }
 
                 // first fragment
                 uint16_t pos = 0;
                 if (!l2cap_channel->receive_sdu_len){
-                    l2cap_channel->receive_sdu_len = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
-                    l2cap_channel->receive_sdu_pos = 0;                   
+                    if (size < COMPLETE_L2CAP_HEADER + 2) break;
+                    uint16_t sdu_len = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
+                    if (sdu_len > l2cap_channel->local_mtu){
+                        log_error("LE Data Channel SDU len %u > MTU %u", sdu_len, l2cap_channel->local_mtu);
+                        l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                        break;
+                    }
+                    l2cap_channel->receive_sdu_len = sdu_len;
+                    l2cap_channel->receive_sdu_pos = 0;
+                    if (l2cap_le_has_receive_buffer_pool(l2cap_channel)){
+                        l2cap_channel->receive_sdu_buffer = (uint8_t *) btstack_memory_pool_get(&l2cap_channel->receive_buffer_pool);
+                        if (!l2cap_channel->receive_sdu_buffer){
+                            log_error("LE Data Channel no free receive buffer, drop SDU");
+                            l2cap_channel->incoming_sdus_dropped++;
+                        }
+                    }
                     pos  += 2;
                     size -= 2;
                 }
-                memcpy(&l2cap_channel->receive_sdu_buffer[l2cap_channel->receive_sdu_pos], &packet[COMPLETE_L2CAP_HEADER+pos], size-COMPLETE_L2CAP_HEADER);
-                l2cap_channel->receive_sdu_pos += size - COMPLETE_L2CAP_HEADER;
+                uint16_t fragment_size = size - COMPLETE_L2CAP_HEADER;
+                if (l2cap_channel->receive_sdu_pos + fragment_size > l2cap_channel->receive_sdu_len){
+                    log_error("LE Data Channel payload exceeds SDU len %u", l2cap_channel->receive_sdu_len);
+                    l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                    break;
+                }
+                if (l2cap_channel->receive_sdu_buffer){
+                    memcpy(&l2cap_channel->receive_sdu_buffer[l2cap_channel->receive_sdu_pos], &packet[COMPLETE_L2CAP_HEADER+pos], fragment_size);
+                }
+                l2cap_channel->receive_sdu_pos += fragment_size;
                 // done?
                 log_info("le packet pos %u, len %u", l2cap_channel->receive_sdu_pos, l2cap_channel->receive_sdu_len);
                 if (l2cap_channel->receive_sdu_pos >= l2cap_channel->receive_sdu_len){
-                    l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, l2cap_channel->receive_sdu_buffer, l2cap_channel->receive_sdu_len);
+                    uint8_t * receive_sdu_buffer = l2cap_channel->receive_sdu_buffer;
                     l2cap_channel->receive_sdu_len = 0;
+                    if (l2cap_le_has_receive_buffer_pool(l2cap_channel)){
+                        // buffer is returned with l2cap_le_release_receive_buffer
+                        l2cap_channel->receive_sdu_buffer = NULL;
+                        if (receive_sdu_buffer){
+                            int index = l2cap_le_get_receive_buffer_index(l2cap_channel, receive_sdu_buffer);
+                            l2cap_channel->receive_buffers_delivered |= 1UL << index;
+                        }
+                    }
+                    if (receive_sdu_buffer){
+                        l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, receive_sdu_buffer, l2cap_channel->receive_sdu_pos);
+                    }
                 }
             } else {
                 log_error("LE Data Channel packet received but no channel found for cid 0x%02x", channel_id);
@@ -3071,10 +3533,13 @@ void l2cap_register_fixed_channel(btstack_packet_handler_t the_packet_handler, u
 // finalize closed channel - l2cap_handle_disconnect_request & DISCONNECTION_RESPONSE
 void l2cap_finialize_channel_close(l2cap_channel_t * channel){
     channel->state = L2CAP_STATE_CLOSED;
+    l2cap_pdu_sink_release(channel);
     l2cap_emit_channel_closed(channel);
     // discard channel
     l2cap_stop_rtx(channel);
-    btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_set_waiting_for_can_send_now(channel, 0);
+    l2cap_channel_list_remove(&l2cap_channels, &l2cap_channel_index, channel);
+    l2cap_update_automatic_flush_timeout(channel->con_handle);
     btstack_memory_l2cap_channel_free(channel);
 }
 
@@ -3148,14 +3613,118 @@ uint8_t l2cap_unregister_service(uint16_t psm){
 
 #ifdef ENABLE_LE_DATA_CHANNELS
 
+static int l2cap_le_has_receive_buffer_pool(l2cap_channel_t * channel){
+    return btstack_memory_pool_get_count(&channel->receive_buffer_pool) > 0;
+}
+
+// @returns index of buffer in receive buffer storage or -1 if not a receive buffer
+static int l2cap_le_get_receive_buffer_index(l2cap_channel_t * channel, uint8_t * buffer){
+    uint32_t storage_size = btstack_memory_pool_get_count(&channel->receive_buffer_pool) * channel->receive_buffer_size;
+    if ((buffer < channel->receive_buffer_storage) || (buffer >= channel->receive_buffer_storage + storage_size)) return -1;
+    uint32_t offset = (uint32_t)(buffer - channel->receive_buffer_storage);
+    if ((offset % channel->receive_buffer_size) != 0) return -1;
+    return (int) (offset / channel->receive_buffer_size);
+}
+
+// number of PDUs remote may send for the free receive buffers
+static uint16_t l2cap_le_get_automatic_credits_target(l2cap_channel_t * channel){
+    uint32_t free_buffers = btstack_memory_pool_get_count(&channel->receive_buffer_pool) - btstack_memory_pool_get_in_use(&channel->receive_buffer_pool);
+    // SDU len field + SDU segmented into PDUs of local MPS
+    uint32_t pdus_per_sdu = (channel->local_mtu + 2 + L2CAP_LE_DATA_CHANNELS_LOCAL_MPS - 1) / L2CAP_LE_DATA_CHANNELS_LOCAL_MPS;
+    uint32_t target_credits = free_buffers * pdus_per_sdu;
+    // SDU in reassembly still needs its remaining PDUs
+    if (channel->receive_sdu_len){
+        uint16_t bytes_remaining = channel->receive_sdu_len - channel->receive_sdu_pos;
+        target_credits += (bytes_remaining + L2CAP_LE_DATA_CHANNELS_LOCAL_MPS - 1) / L2CAP_LE_DATA_CHANNELS_LOCAL_MPS;
+    }
+    return (uint16_t) btstack_min(target_credits, 0xffff);
+}
+
+static uint16_t l2cap_le_get_initial_credits(l2cap_channel_t * channel){
+    if (channel->automatic_credits && l2cap_le_has_receive_buffer_pool(channel)){
+        return l2cap_le_get_automatic_credits_target(channel);
+    }
+    return channel->new_credits_incoming;
+}
+
+// provide credits for free receive buffers when outstanding credits drop below half of them
+static void l2cap_le_update_automatic_credits(l2cap_channel_t * channel){
+    if (!channel->automatic_credits) return;
+    if (!l2cap_le_has_receive_buffer_pool(channel)) return;
+    uint32_t outstanding_credits = channel->credits_incoming + channel->new_credits_incoming;
+    uint16_t target_credits = l2cap_le_get_automatic_credits_target(channel);
+    if (outstanding_credits >= target_credits) return;
+    if (outstanding_credits > (target_credits / 2)) return;
+    channel->new_credits_incoming += target_credits - outstanding_credits;
+}
+
+// send next PDU of first queued SDU, requires outgoing credit and hci_can_send_acl_packet_now
+static void l2cap_le_send_pdu(l2cap_channel_t * channel, l2cap_le_sdu_t * sdu){
+    hci_reserve_packet_buffer();
+    uint8_t * acl_buffer    = hci_get_outgoing_packet_buffer();
+    uint8_t * l2cap_payload = acl_buffer + 8;
+    uint16_t pos = 0;
+    if (!sdu->pos){
+        // store SDU len
+        sdu->pos += 2;
+        little_endian_store_16(l2cap_payload, pos, sdu->len);
+        pos += 2;
+    }
+    uint16_t payload_size = btstack_min(sdu->len + 2 - sdu->pos, channel->remote_mps - pos);
+    log_info("len %u, pos %u => payload %u, credits %u", (unsigned int) sdu->len, sdu->pos, payload_size, channel->credits_outgoing);
+    sdu->pos += payload_size;
+
+    // gather payload from segments
+    while (payload_size && (sdu->segment_index < sdu->num_segments)){
+        const l2cap_le_sdu_segment_t * segment = &sdu->segments[sdu->segment_index];
+        uint16_t bytes_to_copy = btstack_min(segment->len - sdu->segment_pos, payload_size);
+        memcpy(&l2cap_payload[pos], &segment->data[sdu->segment_pos], bytes_to_copy);
+        pos               += bytes_to_copy;
+        payload_size      -= bytes_to_copy;
+        sdu->segment_pos  += bytes_to_copy;
+        if (sdu->segment_pos >= segment->len){
+            sdu->segment_index++;
+            sdu->segment_pos = 0;
+        }
+    }
+    l2cap_setup_header(acl_buffer, channel->con_handle, 0, channel->remote_cid, pos);
+
+    channel->credits_outgoing--;
+
+    if (sdu->pos >= sdu->len + 2){
+        btstack_linked_list_remove(&channel->send_sdu_queue, (btstack_linked_item_t *) sdu);
+        sdu->queued = 0;
+        // send done event
+        l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_LE_PACKET_SENT);
+        // inform about can send now
+        l2cap_le_notify_channel_can_send(channel);
+    }
+    // sender blocked until remote provides more credits
+    if (!channel->credits_outgoing && !btstack_linked_list_empty(&channel->send_sdu_queue)){
+        channel->outgoing_credits_exhausted++;
+    }
+    hci_send_acl_packet_buffer(8 + pos);
+}
+
 static void l2cap_le_notify_channel_can_send(l2cap_channel_t *channel){
     if (!channel->waiting_for_can_send_now) return;
-    if (channel->send_sdu_buffer) return;
+    if (channel->send_sdu.queued) return;
     channel->waiting_for_can_send_now = 0;
     log_info("L2CAP_EVENT_CHANNEL_LE_CAN_SEND_NOW local_cid 0x%x", channel->local_cid);
     l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_LE_CAN_SEND_NOW);
 }
 
+// release all queued SDUs of a channel that gets discarded
+static void l2cap_le_drop_queued_sdus(l2cap_channel_t * channel){
+    while (1){
+        l2cap_le_sdu_t * sdu = (l2cap_le_sdu_t *) btstack_linked_list_pop(&channel->send_sdu_queue);
+        if (!sdu) break;
+        sdu->queued = 0;
+        log_info("L2CAP_EVENT_LE_PACKET_DROPPED local_cid 0x%x", channel->local_cid);
+        l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_LE_PACKET_DROPPED);
+    }
+}
+
 // 1BH2222
 static void l2cap_emit_le_incoming_connection(l2cap_channel_t *channel) {
     log_info("L2CAP_EVENT_LE_INCOMING_CONNECTION addr_type %u, addr %s handle 0x%x psm 0x%x local_cid 0x%x remote_cid 0x%x, remote_mtu %u",
@@ -3196,23 +3765,17 @@ static void l2cap_emit_le_channel_opened(l2cap_channel_t *channel, uint8_t statu
 }
 
 static l2cap_channel_t * l2cap_le_get_channel_for_local_cid(uint16_t local_cid){
-    btstack_linked_list_iterator_t it;    
-    btstack_linked_list_iterator_init(&it, &l2cap_le_channels);
-    while (btstack_linked_list_iterator_has_next(&it)){
-        l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
-        if ( channel->local_cid == local_cid) {
-            return channel;
-        }
-    } 
-    return NULL;
+    return l2cap_channel_list_get(&l2cap_le_channels, &l2cap_le_channel_index, local_cid);
 }
 
 // finalize closed channel - l2cap_handle_disconnect_request & DISCONNECTION_RESPONSE
 void l2cap_le_finialize_channel_close(l2cap_channel_t * channel){
     channel->state = L2CAP_STATE_CLOSED;
+    l2cap_pdu_sink_release(channel);
+    l2cap_le_drop_queued_sdus(channel);
     l2cap_emit_simple_event_with_cid(channel, L2CAP_EVENT_CHANNEL_CLOSED);
     // discard channel
-    btstack_linked_list_remove(&l2cap_le_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_list_remove(&l2cap_le_channels, &l2cap_le_channel_index, channel);
     btstack_memory_l2cap_channel_free(channel);
 }
 
@@ -3320,7 +3883,7 @@ uint8_t l2cap_le_create_channel(btstack_packet_handler_t packet_handler, hci_con
         return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
     }
 
-    l2cap_channel_t * channel = l2cap_create_channel_entry(packet_handler, connection->address, connection->address_type, psm, mtu, security_level);
+    l2cap_channel_t * channel = l2cap_create_channel_entry(packet_handler, connection->address, connection->address_type, psm, mtu, security_level, con_handle);
     if (!channel) {
         return BTSTACK_MEMORY_ALLOC_FAILED;
     }
@@ -3339,7 +3902,7 @@ uint8_t l2cap_le_create_channel(btstack_packet_handler_t packet_handler, hci_con
     channel->automatic_credits    = initial_credits == L2CAP_LE_AUTOMATIC_CREDITS;
 
     // add to connections list
-    btstack_linked_list_add(&l2cap_le_channels, (btstack_linked_item_t *) channel);
+    l2cap_channel_list_add(&l2cap_le_channels, &l2cap_le_channel_index, channel);
 
     // go
     l2cap_run();
@@ -3381,6 +3944,102 @@ uint8_t l2cap_le_provide_credits(uint16_t local_cid, uint16_t credits){
     return 0;
 }
 
+/**
+ * @brief Provide pool of receive buffers for LE Data Channel
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ * @param storage               storage for num_buffers receive buffers
+ * @param buffer_size           size of single receive buffer
+ * @param num_buffers
+ */
+uint8_t l2cap_le_set_receive_buffers(uint16_t local_cid, void * storage, uint16_t buffer_size, uint16_t num_buffers){
+    l2cap_channel_t * channel = l2cap_le_get_channel_for_local_cid(local_cid);
+    if (!channel) {
+        log_error("l2cap_le_set_receive_buffers no channel for cid 0x%02x", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+
+    if ((buffer_size < channel->local_mtu) || (buffer_size < sizeof(void *)) || (num_buffers == 0) || (num_buffers > L2CAP_LE_MAX_RECEIVE_BUFFERS)){
+        log_error("l2cap_le_set_receive_buffers cid 0x%02x, %u buffers of size %u for MTU %u", local_cid, num_buffers, buffer_size, channel->local_mtu);
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+
+    // buffers cannot be replaced while in use
+    if (channel->receive_sdu_len || btstack_memory_pool_get_in_use(&channel->receive_buffer_pool)){
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+
+    btstack_memory_pool_create(&channel->receive_buffer_pool, storage, num_buffers, buffer_size);
+    channel->receive_buffer_storage = (uint8_t *) storage;
+    channel->receive_buffer_size    = buffer_size;
+    channel->receive_buffers_delivered = 0;
+    channel->receive_sdu_buffer     = NULL;
+
+    // go
+    l2cap_run();
+    return 0;
+}
+
+/**
+ * @brief Return receive buffer of an L2CAP_DATA_PACKET to the pool of receive buffers
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ * @param buffer                data pointer of L2CAP_DATA_PACKET
+ */
+uint8_t l2cap_le_release_receive_buffer(uint16_t local_cid, uint8_t * buffer){
+    l2cap_channel_t * channel = l2cap_le_get_channel_for_local_cid(local_cid);
+    if (!channel) {
+        log_error("l2cap_le_release_receive_buffer no channel for cid 0x%02x", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+
+    // validate buffer
+    int index = l2cap_le_get_receive_buffer_index(channel, buffer);
+    if (index < 0){
+        log_error("l2cap_le_release_receive_buffer cid 0x%02x, invalid buffer %p", local_cid, buffer);
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+
+    // only buffers delivered to the application can be released, and only once
+    uint32_t buffer_mask = 1UL << index;
+    if ((channel->receive_buffers_delivered & buffer_mask) == 0){
+        log_error("l2cap_le_release_receive_buffer cid 0x%02x, buffer %p not in use", local_cid, buffer);
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    channel->receive_buffers_delivered &= ~buffer_mask;
+
+    btstack_memory_pool_free(&channel->receive_buffer_pool, buffer);
+
+    // go
+    l2cap_run();
+    return 0;
+}
+
+/**
+ * @brief Request emission of L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ */
+uint8_t l2cap_le_request_channel_statistics_event(uint16_t local_cid){
+    l2cap_channel_t * channel = l2cap_le_get_channel_for_local_cid(local_cid);
+    if (!channel) {
+        log_error("l2cap_le_request_channel_statistics_event no channel for cid 0x%02x", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+    uint16_t free_buffers = btstack_memory_pool_get_count(&channel->receive_buffer_pool) - btstack_memory_pool_get_in_use(&channel->receive_buffer_pool);
+    uint8_t event[24];
+    event[0] = L2CAP_EVENT_LE_CHANNEL_STATISTICS;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event,  2, channel->local_cid);
+    little_endian_store_16(event,  4, channel->credits_incoming);
+    little_endian_store_16(event,  6, channel->credits_outgoing);
+    little_endian_store_16(event,  8, btstack_memory_pool_get_count(&channel->receive_buffer_pool));
+    little_endian_store_16(event, 10, free_buffers);
+    little_endian_store_32(event, 12, channel->incoming_credits_exhausted);
+    little_endian_store_32(event, 16, channel->outgoing_credits_exhausted);
+    little_endian_store_32(event, 20, channel->incoming_sdus_dropped);
+    hci_dump_packet(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    l2cap_dispatch_to_channel(channel, HCI_EVENT_PACKET, event, sizeof(event));
+    return 0;
+}
+
 /**
  * @brief Check if outgoing buffer is available and that there's space on the Bluetooth module
  * @param local_cid             L2CAP LE Data Channel Identifier
@@ -3396,7 +4055,7 @@ int l2cap_le_can_send_now(uint16_t local_cid){
     if (channel->state != L2CAP_STATE_OPEN) return 0;
 
     // check queue
-    if (channel->send_sdu_buffer) return 0;    
+    if (channel->send_sdu.queued) return 0;    
 
     // fine, go ahead
     return 1;
@@ -3439,14 +4098,59 @@ uint8_t l2cap_le_send_data(uint16_t local_cid, uint8_t * data, uint16_t len){
         return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
     }
 
-    if (channel->send_sdu_buffer){
+    if (channel->send_sdu.queued){
         log_info("l2cap_send cid 0x%02x, cannot send", local_cid);
         return BTSTACK_ACL_BUFFERS_FULL;
     }
 
-    channel->send_sdu_buffer = data;
-    channel->send_sdu_len    = len;
-    channel->send_sdu_pos    = 0;
+    l2cap_le_sdu_init(&channel->send_sdu, data, len);
+    return l2cap_le_queue_sdu(local_cid, &channel->send_sdu);
+}
+
+void l2cap_le_sdu_init(l2cap_le_sdu_t * sdu, const uint8_t * data, uint16_t len){
+    sdu->single_segment.data = data;
+    sdu->single_segment.len  = len;
+    l2cap_le_sdu_init_scatter_gather(sdu, &sdu->single_segment, 1);
+}
+
+void l2cap_le_sdu_init_scatter_gather(l2cap_le_sdu_t * sdu, const l2cap_le_sdu_segment_t * segments, uint16_t num_segments){
+    uint32_t len = 0;
+    int i;
+    for (i=0;i<num_segments;i++){
+        len += segments[i].len;
+    }
+    sdu->segments      = segments;
+    sdu->num_segments  = num_segments;
+    sdu->len           = len;
+    sdu->pos           = 0;
+    sdu->segment_index = 0;
+    sdu->segment_pos   = 0;
+    sdu->queued        = 0;
+}
+
+uint8_t l2cap_le_queue_sdu(uint16_t local_cid, l2cap_le_sdu_t * sdu){
+
+    l2cap_channel_t * channel = l2cap_le_get_channel_for_local_cid(local_cid);
+    if (!channel) {
+        log_error("l2cap_le_queue_sdu no channel for cid 0x%02x", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+
+    if (sdu->len > channel->remote_mtu){
+        log_error("l2cap_le_queue_sdu cid 0x%02x, data length exceeds remote MTU.", local_cid);
+        return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
+    }
+
+    if (sdu->queued){
+        log_error("l2cap_le_queue_sdu cid 0x%02x, SDU already queued", local_cid);
+        return ERROR_CODE_COMMAND_DISALLOWED;
+    }
+
+    sdu->pos           = 0;
+    sdu->segment_index = 0;
+    sdu->segment_pos   = 0;
+    sdu->queued        = 1;
+    btstack_linked_list_add_tail(&channel->send_sdu_queue, (btstack_linked_item_t *) sdu);
 
     l2cap_run();
     return 0;
@@ -49,6 +49,8 @@
 #include "hci.h"
 #include "l2cap_signaling.h"
 #include "btstack_util.h"
+#include "btstack_keyed_index.h"
+#include "btstack_memory_pool.h"
 #include "bluetooth.h"
 
 #if defined __cplusplus
@@ -69,6 +71,21 @@ extern "C" {
 
 #define L2CAP_LE_AUTOMATIC_CREDITS 0xffff
 
+// max number of receive buffers per LE Data Channel, see l2cap_le_set_receive_buffers
+#define L2CAP_LE_MAX_RECEIVE_BUFFERS 32
+
+// size of index to find channel by local cid, linear search is used if more channels are open
+#ifndef L2CAP_CHANNEL_INDEX_SIZE
+#if !defined(HAVE_MALLOC) && defined(MAX_NR_L2CAP_CHANNELS)
+#define L2CAP_CHANNEL_INDEX_SIZE BTSTACK_KEYED_INDEX_SIZE_FOR(MAX_NR_L2CAP_CHANNELS)
+#else
+#define L2CAP_CHANNEL_INDEX_SIZE 32
+#endif
+#endif
+
+// size of PDU sink for PDUs with given max payload - PRE_BUFFER + ACL Header + L2CAP Header + payload
+#define L2CAP_PDU_SINK_SIZE(max_payload) (HCI_INCOMING_PRE_BUFFER_SIZE + HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE + (max_payload))
+
 // private structs
 typedef enum {
     L2CAP_STATE_CLOSED = 1,           // no baseband
@@ -119,12 +136,13 @@ typedef struct {
     l2cap_segmentation_and_reassembly_t sar;
     uint16_t len;
     uint8_t  valid;
+    uint8_t  srej_requested;
 } l2cap_ertm_rx_packet_state_t;
 
 typedef struct {
     l2cap_segmentation_and_reassembly_t sar;
     uint16_t len;
-    uint8_t tx_seq;
+    uint16_t tx_seq;
     uint8_t retry_count;
     uint8_t retransmission_requested;
 } l2cap_ertm_tx_packet_state_t;
@@ -146,13 +164,52 @@ typedef struct {
     uint16_t local_mtu;
 
     // Number of buffers for outgoing data
-    uint8_t num_tx_buffers;
+    uint16_t num_tx_buffers;
 
     // Number of packets that can be received out of order (-> our tx_window size)
-    uint8_t num_rx_buffers;
+    // Windows larger than 63 frames require the Extended Window Size option, max 16383
+    uint16_t num_rx_buffers;
 
 } l2cap_ertm_config_t;
 
+// priority of outgoing data, see l2cap_set_channel_priority
+typedef enum {
+    L2CAP_CHANNEL_PRIORITY_LOW = 0,                 // e.g. OBEX bulk transfer
+    L2CAP_CHANNEL_PRIORITY_NORMAL,
+    L2CAP_CHANNEL_PRIORITY_HIGH,                    // e.g. AVDTP media
+} l2cap_channel_priority_t;
+
+// part of an outgoing LE Data Channel SDU
+typedef struct {
+    const uint8_t * data;
+    uint16_t        len;
+} l2cap_le_sdu_segment_t;
+
+// outgoing LE Data Channel SDU, queued with l2cap_le_queue_sdu
+typedef struct {
+    // linked list - assert: first field
+    btstack_linked_item_t item;
+
+    // scatter-gather list
+    const l2cap_le_sdu_segment_t * segments;
+    uint16_t num_segments;
+
+    // used by l2cap_le_sdu_init
+    l2cap_le_sdu_segment_t single_segment;
+
+    // SDU len, sum of all segments, checked against remote MTU by l2cap_le_queue_sdu
+    uint32_t len;
+
+    // bytes sent, including 2 byte SDU length
+    uint16_t pos;
+
+    // read position in scatter-gather list
+    uint16_t segment_index;
+    uint16_t segment_pos;
+
+    uint8_t  queued;
+} l2cap_le_sdu_t;
+
 // info regarding an actual connection
 typedef struct {
     // linked list - assert: first field
@@ -184,6 +241,12 @@ typedef struct {
 
     uint16_t  flush_timeout;    // default 0xffff
 
+    // flush timeout for outgoing packets in ms, default 0xffff, see l2cap_set_channel_flush_timeout
+    uint16_t  local_flush_timeout;
+
+    // l2cap_channel_priority_t
+    uint8_t   priority;
+
     uint16_t  psm;
     
     gap_security_level_t required_security_level;
@@ -198,10 +261,18 @@ typedef struct {
     uint16_t  receive_sdu_len;
     uint16_t  receive_sdu_pos;
 
-    // outgoing SDU
-    uint8_t  * send_sdu_buffer;
-    uint16_t   send_sdu_len;
-    uint16_t   send_sdu_pos;
+    // pool of buffers for incoming SDUs, see l2cap_le_set_receive_buffers
+    btstack_memory_pool_t receive_buffer_pool;
+    uint8_t * receive_buffer_storage;
+    uint16_t  receive_buffer_size;
+    // bit per receive buffer, set while buffer is owned by application
+    uint32_t  receive_buffers_delivered;
+
+    // outgoing SDUs, sent in order
+    btstack_linked_list_t send_sdu_queue;
+
+    // outgoing SDU for l2cap_le_send_data
+    l2cap_le_sdu_t send_sdu;
 
     // max PDU size
     uint16_t  remote_mps;
@@ -218,6 +289,15 @@ typedef struct {
     // automatic credits incoming
     uint16_t automatic_credits;
 
+    // credit statistics, see l2cap_le_request_channel_statistics_event
+    uint32_t incoming_credits_exhausted;
+    uint32_t outgoing_credits_exhausted;
+    uint32_t incoming_sdus_dropped;
+
+    // sink for reassembly of fragmented PDUs, see l2cap_register_pdu_sink
+    uint8_t * pdu_sink;
+    uint16_t  pdu_sink_size;
+
 #ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
 
     // l2cap channel mode: basic or enhanced retransmission mode
@@ -239,7 +319,7 @@ typedef struct {
     uint16_t remote_retransmission_timeout_ms;
     uint16_t remote_monitor_timeout_ms;
 
-    uint8_t remote_tx_window_size;
+    uint16_t remote_tx_window_size;
 
     uint8_t local_max_transmit;
     uint8_t remote_max_transmit;
@@ -247,39 +327,45 @@ typedef struct {
     // if ertm is not mandatory, allow fallback to L2CAP Basic Mode - flag
     uint8_t ertm_mandatory;
 
+    // use 32-bit extended control field with 14-bit sequence numbers - flag
+    uint8_t extended_control;
+
     // sender: max num of stored outgoing frames
-    uint8_t num_tx_buffers;
+    uint16_t num_tx_buffers;
 
     // sender: number of unacknowledeged I-Frames - frames have been sent, but not acknowledged yet
-    uint8_t unacked_frames;
+    uint16_t unacked_frames;
 
     // sender: buffer index of oldest packet
-    uint8_t tx_read_index;
+    uint16_t tx_read_index;
 
     // sender: buffer index to store next tx packet
-    uint8_t tx_write_index;
+    uint16_t tx_write_index;
 
     // sender: buffer index of packet to send next
-    uint8_t tx_send_index;
+    uint16_t tx_send_index;
 
     // sender: next seq nr used for sending
-    uint8_t next_tx_seq;
+    uint16_t next_tx_seq;
 
     // sender: selective retransmission requested
     uint8_t srej_active;
 
 
     // receiver: max num out-of-order packets // tx_window
-    uint8_t num_rx_buffers;
+    uint16_t num_rx_buffers;
 
-    // receiver: buffer index of to store packet with delta = 1
-    uint8_t rx_store_index;
+    // receiver: buffer index of packet with tx_seq == expected_tx_seq
+    uint16_t rx_store_index;
 
     // receiver: value of tx_seq in next expected i-frame
-    uint8_t expected_tx_seq;
+    uint16_t expected_tx_seq;
+
+    // receiver: tx_seq following the highest out-of-order frame, == expected_tx_seq if none stored
+    uint16_t srej_next_tx_seq;
 
     // receiver: request transmission with tx_seq = req_seq and ack up to and including req_seq
-    uint8_t req_seq;
+    uint16_t req_seq;
 
     // receiver: local busy condition
     uint8_t local_busy;
@@ -296,7 +382,7 @@ typedef struct {
     // receiver: send REJ frame - flag
     uint8_t send_supervisor_frame_reject;
 
-    // receiver: send SREJ frame - flag
+    // receiver: send SREJ frames for all missing frames not requested yet - flag
     uint8_t send_supervisor_frame_selective_reject;
 
     // set final bit after poll packet with poll bit was received
@@ -474,6 +560,29 @@ int  l2cap_can_send_packet_now(uint16_t local_cid);
  */
 void l2cap_request_can_send_now_event(uint16_t local_cid);
 
+/**
+ * @brief Set priority for outgoing data. Channels with higher priority get L2CAP_EVENT_CAN_SEND_NOW first,
+ *        and channels with lower priority on the same connection cannot send while they are waiting for it.
+ *        Default: L2CAP_CHANNEL_PRIORITY_NORMAL
+ * @param local_cid
+ * @param priority
+ * @return status
+ */
+uint8_t l2cap_set_channel_priority(uint16_t local_cid, l2cap_channel_priority_t priority);
+
+/**
+ * @brief Set flush timeout for outgoing data, e.g. for AVDTP media. Packets are sent as automatically flushable
+ *        and dropped by the Controller if they cannot be sent within the flush timeout, while other channels
+ *        use non-flushable packets. The flush timeout is announced in the configuration request, so it cannot be
+ *        changed after the configuration request was sent.
+ * @note The Controller supports a single Automatic Flush Timeout per ACL connection. It is set to the minimum
+ *       flush timeout of all open channels on the connection, and only if the Controller supports non-flushable packets
+ * @param local_cid
+ * @param flush_timeout_ms 1..1279 ms, or 0xffff for no flush timeout (default)
+ * @return status, ERROR_CODE_COMMAND_DISALLOWED if configuration request was already sent
+ */
+uint8_t l2cap_set_channel_flush_timeout(uint16_t local_cid, uint16_t flush_timeout_ms);
+
 /** 
  * @brief Reserve outgoing buffer
  */
@@ -494,6 +603,24 @@ int l2cap_send_prepared(uint16_t local_cid, uint16_t len);
  */
 void l2cap_release_packet_buffer(void);
 
+/** 
+ * @brief Register buffer to reassemble fragmented PDUs of the channel in place
+ * @note ACL fragments are written only once into this buffer and the complete PDU is delivered from it,
+ *       the buffer must not be used by the application while a PDU is being received
+ * @param local_cid
+ * @param buffer of size L2CAP_PDU_SINK_SIZE(max PDU payload)
+ * @param size
+ * @return status
+ */
+uint8_t l2cap_register_pdu_sink(uint16_t local_cid, uint8_t * buffer, uint16_t size);
+
+/** 
+ * @brief Unregister PDU sink. A PDU that is currently reassembled in it gets dropped
+ * @param local_cid
+ * @return status
+ */
+uint8_t l2cap_unregister_pdu_sink(uint16_t local_cid);
+
 
 //
 // LE Connection Oriented Channels feature with the LE Credit Based Flow Control Mode == LE Data Channel
@@ -555,6 +682,33 @@ uint8_t l2cap_le_create_channel(btstack_packet_handler_t packet_handler, hci_con
  */
 uint8_t l2cap_le_provide_credits(uint16_t cid, uint16_t credits);
 
+/**
+ * @brief Provide pool of receive buffers for LE Data Channel. Each incoming SDU is reassembled into a free buffer
+ *        and stays in use after the L2CAP_DATA_PACKET until it is returned with l2cap_le_release_receive_buffer.
+ *        With L2CAP_LE_AUTOMATIC_CREDITS, credits are granted for the number of free receive buffers.
+ * @note If receive_sdu_buffer was NULL in l2cap_le_create_channel or l2cap_le_accept_connection, the connection
+ *       request/response is sent after the receive buffers have been provided
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ * @param storage               storage for num_buffers receive buffers, aligned to pointer size
+ * @param buffer_size           size of single receive buffer, >= MTU and >= sizeof(void *)
+ * @param num_buffers           <= L2CAP_LE_MAX_RECEIVE_BUFFERS
+ */
+uint8_t l2cap_le_set_receive_buffers(uint16_t local_cid, void * storage, uint16_t buffer_size, uint16_t num_buffers);
+
+/**
+ * @brief Return receive buffer of an L2CAP_DATA_PACKET to the pool of receive buffers
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ * @param buffer                data pointer of L2CAP_DATA_PACKET
+ * @returns ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if buffer is not part of the pool or has already been released
+ */
+uint8_t l2cap_le_release_receive_buffer(uint16_t local_cid, uint8_t * buffer);
+
+/**
+ * @brief Request emission of L2CAP_EVENT_LE_CHANNEL_STATISTICS
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ */
+uint8_t l2cap_le_request_channel_statistics_event(uint16_t local_cid);
+
 /**
  * @brief Check if packet can be scheduled for transmission
  * @param local_cid             L2CAP LE Data Channel Identifier
@@ -578,6 +732,35 @@ uint8_t l2cap_le_request_can_send_now_event(uint16_t cid);
  */
 uint8_t l2cap_le_send_data(uint16_t cid, uint8_t * data, uint16_t size);
 
+/**
+ * @brief Init SDU with single data buffer
+ * @param sdu
+ * @param data                  data to send, needs to stay valid until SDU was sent
+ * @param len                   data size
+ */
+void l2cap_le_sdu_init(l2cap_le_sdu_t * sdu, const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Init SDU with scatter-gather list, SDU is concatenation of all segments
+ * @note l2cap_le_queue_sdu rejects the SDU if the total size exceeds the remote MTU
+ * @param sdu
+ * @param segments              list of segments, segments and their data need to stay valid until SDU was sent
+ * @param num_segments
+ */
+void l2cap_le_sdu_init_scatter_gather(l2cap_le_sdu_t * sdu, const l2cap_le_sdu_segment_t * segments, uint16_t num_segments);
+
+/**
+ * @brief Queue SDU for LE Data Channel
+ * @note SDUs are segmented and sent in order as long as credits are available. For each SDU,
+ *       L2CAP_EVENT_LE_PACKET_SENT is emitted after it was sent, then the SDU can be reused.
+ *       If the channel gets closed, L2CAP_EVENT_LE_PACKET_DROPPED is emitted for each SDU that was
+ *       still queued before the channel closed event, then these SDUs can be reused as well.
+ * @param local_cid             L2CAP LE Data Channel Identifier
+ * @param sdu                   initialized with l2cap_le_sdu_init or l2cap_le_sdu_init_scatter_gather
+ * @return status
+ */
+uint8_t l2cap_le_queue_sdu(uint16_t local_cid, l2cap_le_sdu_t * sdu);
+
 /**
  * @brief Disconnect from LE Data Channel
  * @param local_cid             L2CAP LE Data Channel Identifier
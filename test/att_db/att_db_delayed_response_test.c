@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// ATT DB delayed response tests: callbacks can return pending and are called again
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+
+static att_connection_t att_connection;
+static uint16_t handle_value_a;
+static uint16_t handle_value_b;
+static uint16_t handle_value_write;
+
+static int      values_ready;
+static int      write_complete;
+static int      num_read_queries;
+static int      num_writes;
+static uint8_t  value_a[] = { 0x01, 0x02 };
+static uint8_t  value_b[] = { 0x03, 0x04 };
+
+static uint16_t att_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    uint8_t * value;
+    if (attribute_handle == handle_value_a){
+        value = value_a;
+    } else if (attribute_handle == handle_value_b){
+        value = value_b;
+    } else {
+        return 0;
+    }
+    if (buffer == NULL){
+        num_read_queries++;
+        if (!values_ready) return ATT_READ_RESPONSE_PENDING;
+        return 2;
+    }
+    uint16_t bytes_to_copy = 2 - offset;
+    if (bytes_to_copy > buffer_size){
+        bytes_to_copy = buffer_size;
+    }
+    memcpy(buffer, &value[offset], bytes_to_copy);
+    return bytes_to_copy;
+}
+
+static int att_write_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    UNUSED(transaction_mode);
+    UNUSED(offset);
+    UNUSED(buffer);
+    UNUSED(buffer_size);
+    if (attribute_handle != handle_value_write) return 0;
+    num_writes++;
+    if (!write_complete) return ATT_ERROR_WRITE_RESPONSE_PENDING;
+    return 0;
+}
+
+TEST_GROUP(AttDbDelayedResponse){
+    void setup(void){
+        att_db_util_init();
+        att_db_util_add_service_uuid16(0x180f);
+        handle_value_a     = att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ | ATT_PROPERTY_DYNAMIC, NULL, 0);
+        handle_value_b     = att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ | ATT_PROPERTY_DYNAMIC, NULL, 0);
+        handle_value_write = att_db_util_add_characteristic_uuid16(0x2a50, ATT_PROPERTY_WRITE | ATT_PROPERTY_DYNAMIC, NULL, 0);
+        att_set_db(att_db_util_get_address());
+        att_set_read_callback(&att_read_callback);
+        att_set_write_callback(&att_write_callback);
+        memset(&att_connection, 0, sizeof(att_connection));
+        att_connection.mtu = ATT_DEFAULT_MTU;
+        att_connection.max_mtu = 100;
+        values_ready = 0;
+        write_complete = 0;
+        num_read_queries = 0;
+        num_writes = 0;
+    }
+};
+
+TEST(AttDbDelayedResponse, Read){
+    uint8_t request[3];
+    uint8_t response[32];
+    request[0] = ATT_READ_REQUEST;
+    little_endian_store_16(request, 1, handle_value_a);
+    CHECK_EQUAL(ATT_READ_RESPONSE_PENDING, att_handle_request(&att_connection, request, sizeof(request), response));
+
+    values_ready = 1;
+    CHECK_EQUAL(3, att_handle_request(&att_connection, request, sizeof(request), response));
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    MEMCMP_EQUAL(value_a, &response[1], 2);
+}
+
+TEST(AttDbDelayedResponse, ReadBlob){
+    uint8_t request[5];
+    uint8_t response[32];
+    request[0] = ATT_READ_BLOB_REQUEST;
+    little_endian_store_16(request, 1, handle_value_b);
+    little_endian_store_16(request, 3, 1);
+    CHECK_EQUAL(ATT_READ_RESPONSE_PENDING, att_handle_request(&att_connection, request, sizeof(request), response));
+
+    values_ready = 1;
+    CHECK_EQUAL(2, att_handle_request(&att_connection, request, sizeof(request), response));
+    CHECK_EQUAL(ATT_READ_BLOB_RESPONSE, response[0]);
+    CHECK_EQUAL(value_b[1], response[1]);
+}
+
+TEST(AttDbDelayedResponse, ReadMultiple){
+    uint8_t request[5];
+    uint8_t response[32];
+    request[0] = ATT_READ_MULTIPLE_REQUEST;
+    little_endian_store_16(request, 1, handle_value_a);
+    little_endian_store_16(request, 3, handle_value_b);
+    CHECK_EQUAL(ATT_READ_RESPONSE_PENDING, att_handle_request(&att_connection, request, sizeof(request), response));
+    // all values requested in a single pass
+    CHECK_EQUAL(2, num_read_queries);
+
+    values_ready = 1;
+    CHECK_EQUAL(5, att_handle_request(&att_connection, request, sizeof(request), response));
+    CHECK_EQUAL(ATT_READ_MULTIPLE_RESPONSE, response[0]);
+    MEMCMP_EQUAL(value_a, &response[1], 2);
+    MEMCMP_EQUAL(value_b, &response[3], 2);
+}
+
+TEST(AttDbDelayedResponse, ReadByType){
+    uint8_t request[7];
+    uint8_t response[32];
+    request[0] = ATT_READ_BY_TYPE_REQUEST;
+    little_endian_store_16(request, 1, 0x0001);
+    little_endian_store_16(request, 3, 0xffff);
+    little_endian_store_16(request, 5, 0x2a19);
+    CHECK_EQUAL(ATT_READ_RESPONSE_PENDING, att_handle_request(&att_connection, request, sizeof(request), response));
+    CHECK_EQUAL(2, num_read_queries);
+
+    values_ready = 1;
+    CHECK_EQUAL(10, att_handle_request(&att_connection, request, sizeof(request), response));
+    CHECK_EQUAL(ATT_READ_BY_TYPE_RESPONSE, response[0]);
+    CHECK_EQUAL(4, response[1]);
+    CHECK_EQUAL(handle_value_a, little_endian_read_16(response, 2));
+    MEMCMP_EQUAL(value_a, &response[4], 2);
+    CHECK_EQUAL(handle_value_b, little_endian_read_16(response, 6));
+    MEMCMP_EQUAL(value_b, &response[8], 2);
+}
+
+TEST(AttDbDelayedResponse, Write){
+    uint8_t request[5];
+    uint8_t response[32];
+    request[0] = ATT_WRITE_REQUEST;
+    little_endian_store_16(request, 1, handle_value_write);
+    little_endian_store_16(request, 3, 0x1234);
+    CHECK_EQUAL(ATT_INTERNAL_WRITE_RESPONSE_PENDING, att_handle_request(&att_connection, request, sizeof(request), response));
+
+    write_complete = 1;
+    CHECK_EQUAL(1, att_handle_request(&att_connection, request, sizeof(request), response));
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, response[0]);
+    CHECK_EQUAL(2, num_writes);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
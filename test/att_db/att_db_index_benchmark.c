@@ -0,0 +1,138 @@
+// micro-benchmark for ATT DB lookups with and without index, run with 'make benchmark'
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+#include "hci_dump.h"
+
+#define NUM_ITERATIONS    100
+#define NUM_SERVICES       40
+#define NUM_CHARACTERISTICS 4
+#define MAX_NUM_ATTRIBUTES (1 + NUM_SERVICES * (1 + NUM_CHARACTERISTICS * 3))
+
+static att_db_index_entry_t index_entries[MAX_NUM_ATTRIBUTES];
+static att_connection_t att_connection;
+static uint8_t request[32];
+static uint8_t response[ATT_DEFAULT_MTU];
+static uint16_t num_attributes;
+static uint32_t num_requests;
+
+static double seconds_since(struct timespec * start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static uint16_t range_request(uint8_t opcode, uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
+    request[0] = opcode;
+    little_endian_store_16(request, 1, start_handle);
+    little_endian_store_16(request, 3, end_handle);
+    little_endian_store_16(request, 5, uuid16);
+    num_requests++;
+    return att_handle_request(&att_connection, request, 7, response);
+}
+
+// discover all primary services, returns number of services
+static int discover_services(void){
+    int services = 0;
+    uint16_t start_handle = 1;
+    while (1){
+        uint16_t len = range_request(ATT_READ_BY_GROUP_TYPE_REQUEST, start_handle, 0xffff, GATT_PRIMARY_SERVICE_UUID);
+        if (response[0] != ATT_READ_BY_GROUP_TYPE_RESPONSE) break;
+        uint16_t pair_len = response[1];
+        uint16_t pos;
+        for (pos = 2; pos + pair_len <= len; pos += pair_len){
+            services++;
+            start_handle = little_endian_read_16(response, pos + 2) + 1;
+        }
+    }
+    return services;
+}
+
+// discover all characteristics, returns number of characteristics
+static int discover_characteristics(void){
+    int characteristics = 0;
+    uint16_t start_handle = 1;
+    while (1){
+        uint16_t len = range_request(ATT_READ_BY_TYPE_REQUEST, start_handle, 0xffff, GATT_CHARACTERISTICS_UUID);
+        if (response[0] != ATT_READ_BY_TYPE_RESPONSE) break;
+        uint16_t pair_len = response[1];
+        uint16_t pos;
+        for (pos = 2; pos + pair_len <= len; pos += pair_len){
+            characteristics++;
+            start_handle = little_endian_read_16(response, pos) + 1;
+        }
+    }
+    return characteristics;
+}
+
+// read all attributes, returns number of successful reads
+static int read_all(void){
+    int reads = 0;
+    uint16_t handle;
+    for (handle = 1; handle <= num_attributes; handle++){
+        request[0] = ATT_READ_REQUEST;
+        little_endian_store_16(request, 1, handle);
+        num_requests++;
+        att_handle_request(&att_connection, request, 3, response);
+        if (response[0] == ATT_READ_RESPONSE) reads++;
+    }
+    return reads;
+}
+
+static void run(const char * name, int (*scenario)(void)){
+    const char * modes[] = { "linear", "index" };
+    int mode;
+    for (mode = 0; mode < 2; mode++){
+        if (mode){
+            att_set_db_index(index_entries, MAX_NUM_ATTRIBUTES);
+        } else {
+            att_set_db_index(NULL, 0);
+        }
+        struct timespec start;
+        int result = 0;
+        int i;
+        num_requests = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < NUM_ITERATIONS; i++){
+            result = (*scenario)();
+        }
+        double seconds = seconds_since(&start);
+        printf("%-26s %-6s %8.2f us/request (%u requests, result %u)\n", name, modes[mode],
+            seconds * 1e6 / num_requests, num_requests, result);
+    }
+}
+
+int main(void){
+    // only measure lookups
+    hci_dump_enable_log_level(LOG_LEVEL_INFO, 0);
+
+    uint8_t value[8];
+    memset(value, 0x55, sizeof(value));
+    att_db_util_init();
+    att_db_util_add_service_uuid16(GAP_SERVICE_UUID);
+    int i;
+    for (i = 0; i < NUM_SERVICES; i++){
+        att_db_util_add_service_uuid16(0x1800 + i);
+        int j;
+        for (j = 0; j < NUM_CHARACTERISTICS; j++){
+            att_db_util_add_characteristic_uuid16(0x2a00 + j, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, value, sizeof(value));
+        }
+    }
+    att_set_db(att_db_util_get_address());
+    num_attributes = att_db_get_num_attributes();
+    att_connection.mtu = ATT_DEFAULT_MTU;
+    att_connection.max_mtu = ATT_DEFAULT_MTU;
+
+    printf("ATT DB with %u attributes, %u bytes\n", num_attributes, att_db_util_get_size());
+    run("discover services", &discover_services);
+    run("discover characteristics", &discover_characteristics);
+    run("read all attributes", &read_all);
+    return 0;
+}
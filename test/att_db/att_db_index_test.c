@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// ATT DB index tests: all requests have to return the same result with and without index
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+
+// profile_data and profile_data_index generated by compile_gatt.py
+#include "le_counter_generated.h"
+
+#define MAX_NUM_ATTRIBUTES 200
+
+// 0000FF10-0000-1000-8000-00805F9B34FB
+static uint8_t counter_service_uuid[] = { 0x00, 0x00, 0xFF, 0x10, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB};
+// 0000FF11-0000-1000-8000-00805F9B34FB
+static uint8_t counter_characteristic_uuid[] = { 0x00, 0x00, 0xFF, 0x11, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB};
+// 6E400001-B5A3-F393-E0A9-E50E24DCCA9E
+static uint8_t nordic_uart_service_uuid[] = { 0x6E, 0x40, 0x00, 0x01, 0xB5, 0xA3, 0xF3, 0x93, 0xE0, 0xA9, 0xE5, 0x0E, 0x24, 0xDC, 0xCA, 0x9E};
+// 6E400002-B5A3-F393-E0A9-E50E24DCCA9E
+static uint8_t nordic_uart_rx_uuid[] = { 0x6E, 0x40, 0x00, 0x02, 0xB5, 0xA3, 0xF3, 0x93, 0xE0, 0xA9, 0xE5, 0x0E, 0x24, 0xDC, 0xCA, 0x9E};
+
+static att_db_index_entry_t index_entries[MAX_NUM_ATTRIBUTES];
+static att_connection_t att_connection;
+static uint16_t num_attributes;
+
+static void setup_db(void){
+    uint8_t value[20];
+    unsigned int i;
+    for (i=0;i<sizeof(value);i++){
+        value[i] = i;
+    }
+    att_db_util_init();
+    att_db_util_add_service_uuid16(GAP_SERVICE_UUID);
+    att_db_util_add_characteristic_uuid16(GAP_DEVICE_NAME_UUID, ATT_PROPERTY_READ, (uint8_t*)"ATT DB Index", 12);
+    att_db_util_add_service_uuid16(0x1801);
+    att_db_util_add_characteristic_uuid16(0x2a05, ATT_PROPERTY_READ, NULL, 0);
+    att_db_util_add_service_uuid128(counter_service_uuid);
+    att_db_util_add_characteristic_uuid128(counter_characteristic_uuid, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, value, 4);
+    for (i=0;i<10;i++){
+        att_db_util_add_service_uuid16(0x180f + i);
+        att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, value, 1);
+        att_db_util_add_characteristic_uuid16(0x2a00 + i, ATT_PROPERTY_READ, value, i);
+        att_db_util_add_characteristic_uuid16(0x2a50, ATT_PROPERTY_WRITE, value, 2);
+    }
+    att_db_util_add_service_uuid128(nordic_uart_service_uuid);
+    att_db_util_add_characteristic_uuid128(nordic_uart_rx_uuid, ATT_PROPERTY_READ | ATT_PROPERTY_WRITE, value, 20);
+    att_db_util_add_service_uuid16(0x1820);
+    att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ, value, 1);
+}
+
+static uint16_t handle_request(int use_index, uint8_t * request, uint16_t request_len, uint8_t * response){
+    if (use_index){
+        att_set_db_index(index_entries, MAX_NUM_ATTRIBUTES);
+    } else {
+        att_set_db_index(NULL, 0);
+    }
+    return att_handle_request(&att_connection, request, request_len, response);
+}
+
+static void check_request(uint8_t * request, uint16_t request_len){
+    uint8_t response_linear[256];
+    uint8_t response_index[256];
+    uint16_t len_linear = handle_request(0, request, request_len, response_linear);
+    uint16_t len_index  = handle_request(1, request, request_len, response_index);
+    CHECK_EQUAL(len_linear, len_index);
+    MEMCMP_EQUAL(response_linear, response_index, len_linear);
+}
+
+static void check_range_request(uint8_t opcode, uint16_t start_handle, uint16_t end_handle, const uint8_t * data, uint16_t data_len){
+    uint8_t request[32];
+    request[0] = opcode;
+    little_endian_store_16(request, 1, start_handle);
+    little_endian_store_16(request, 3, end_handle);
+    memcpy(&request[5], data, data_len);
+    check_request(request, 5 + data_len);
+}
+
+static void check_range_request_uuid16(uint8_t opcode, uint16_t start_handle, uint16_t end_handle, uint16_t uuid16){
+    uint8_t uuid[2];
+    little_endian_store_16(uuid, 0, uuid16);
+    check_range_request(opcode, start_handle, end_handle, uuid, 2);
+}
+
+static void check_range_request_uuid128(uint8_t opcode, uint16_t start_handle, uint16_t end_handle, const uint8_t * uuid128){
+    uint8_t uuid[16];
+    reverse_128(uuid128, uuid);
+    check_range_request(opcode, start_handle, end_handle, uuid, 16);
+}
+
+static void check_all_ranges(void (*check)(uint16_t start_handle, uint16_t end_handle)){
+    uint16_t end_handles[] = { 0, 1, 2, 5, 0x0f, 0xffff };
+    uint16_t start_handle;
+    for (start_handle = 0; start_handle <= num_attributes + 2; start_handle++){
+        unsigned int i;
+        for (i=0;i<sizeof(end_handles)/sizeof(uint16_t);i++){
+            uint16_t end_handle = end_handles[i];
+            if (end_handle < 0x0f){
+                end_handle = start_handle + end_handle;
+            }
+            (*check)(start_handle, end_handle);
+        }
+    }
+}
+
+static void check_find_information(uint16_t start_handle, uint16_t end_handle){
+    check_range_request(ATT_FIND_INFORMATION_REQUEST, start_handle, end_handle, NULL, 0);
+}
+
+static void check_read_by_type(uint16_t start_handle, uint16_t end_handle){
+    uint8_t base_uuid_characteristic[16];
+    uuid_add_bluetooth_prefix(base_uuid_characteristic, GATT_CHARACTERISTICS_UUID);
+    check_range_request_uuid16(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, GATT_CHARACTERISTICS_UUID);
+    check_range_request_uuid16(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, 0x2a19);
+    check_range_request_uuid16(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, 0x2a50);
+    check_range_request_uuid16(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, 0x2a01);
+    check_range_request_uuid16(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, 0x2a09);
+    check_range_request_uuid16(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, 0x1234);
+    check_range_request_uuid128(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, base_uuid_characteristic);
+    check_range_request_uuid128(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, counter_characteristic_uuid);
+    check_range_request_uuid128(ATT_READ_BY_TYPE_REQUEST, start_handle, end_handle, nordic_uart_rx_uuid);
+}
+
+static void check_read_by_group_type(uint16_t start_handle, uint16_t end_handle){
+    uint8_t base_uuid_primary_service[16];
+    uuid_add_bluetooth_prefix(base_uuid_primary_service, GATT_PRIMARY_SERVICE_UUID);
+    check_range_request_uuid16(ATT_READ_BY_GROUP_TYPE_REQUEST, start_handle, end_handle, GATT_PRIMARY_SERVICE_UUID);
+    check_range_request_uuid16(ATT_READ_BY_GROUP_TYPE_REQUEST, start_handle, end_handle, GATT_SECONDARY_SERVICE_UUID);
+    check_range_request_uuid16(ATT_READ_BY_GROUP_TYPE_REQUEST, start_handle, end_handle, GATT_CHARACTERISTICS_UUID);
+    check_range_request_uuid128(ATT_READ_BY_GROUP_TYPE_REQUEST, start_handle, end_handle, base_uuid_primary_service);
+}
+
+static void check_find_by_type_value(uint16_t start_handle, uint16_t end_handle){
+    uint8_t data[18];
+    little_endian_store_16(data, 0, GATT_PRIMARY_SERVICE_UUID);
+    little_endian_store_16(data, 2, 0x1812);
+    check_range_request(ATT_FIND_BY_TYPE_VALUE_REQUEST, start_handle, end_handle, data, 4);
+    little_endian_store_16(data, 2, 0x1820);
+    check_range_request(ATT_FIND_BY_TYPE_VALUE_REQUEST, start_handle, end_handle, data, 4);
+    reverse_128(counter_service_uuid, &data[2]);
+    check_range_request(ATT_FIND_BY_TYPE_VALUE_REQUEST, start_handle, end_handle, data, 18);
+}
+
+TEST_GROUP(AttDbIndex){
+    void setup(void){
+        setup_db();
+        att_set_db_index(NULL, 0);
+        att_set_db(att_db_util_get_address());
+        num_attributes = att_db_get_num_attributes();
+        memset(&att_connection, 0, sizeof(att_connection));
+        att_connection.mtu = ATT_DEFAULT_MTU;
+        att_connection.max_mtu = 100;
+    }
+    void teardown(void){
+        att_set_db_index(NULL, 0);
+    }
+};
+
+TEST(AttDbIndex, NumAttributes){
+    CHECK_EQUAL(96, num_attributes);
+    att_set_db_index(index_entries, MAX_NUM_ATTRIBUTES);
+    CHECK_EQUAL(96, att_db_get_num_attributes());
+}
+
+TEST(AttDbIndex, FindInformation){
+    check_all_ranges(&check_find_information);
+}
+
+TEST(AttDbIndex, ReadByType){
+    check_all_ranges(&check_read_by_type);
+    att_connection.mtu = 100;
+    check_all_ranges(&check_read_by_type);
+}
+
+TEST(AttDbIndex, ReadByGroupType){
+    check_all_ranges(&check_read_by_group_type);
+    att_connection.mtu = 100;
+    check_all_ranges(&check_read_by_group_type);
+}
+
+TEST(AttDbIndex, FindByTypeValue){
+    check_all_ranges(&check_find_by_type_value);
+}
+
+TEST(AttDbIndex, Read){
+    uint8_t request[5];
+    uint16_t handle;
+    for (handle = 0; handle <= num_attributes + 2; handle++){
+        request[0] = ATT_READ_REQUEST;
+        little_endian_store_16(request, 1, handle);
+        check_request(request, 3);
+        request[0] = ATT_READ_BLOB_REQUEST;
+        little_endian_store_16(request, 3, 1);
+        check_request(request, 5);
+    }
+}
+
+TEST(AttDbIndex, ReadMultiple){
+    uint8_t request[7];
+    uint16_t handle;
+    request[0] = ATT_READ_MULTIPLE_REQUEST;
+    for (handle = 1; handle <= num_attributes; handle++){
+        little_endian_store_16(request, 1, handle);
+        little_endian_store_16(request, 3, num_attributes + 1 - handle);
+        little_endian_store_16(request, 5, handle);
+        check_request(request, 7);
+    }
+}
+
+TEST(AttDbIndex, GattServerLookup){
+    uint16_t uuid16s[] = { 0x1800, 0x1801, 0x180f, 0x1812, 0x1818, 0x1820, 0x1234 };
+    unsigned int i;
+    for (i=0;i<sizeof(uuid16s)/sizeof(uint16_t);i++){
+        uint16_t start_linear = 0, end_linear = 0, start_index = 0, end_index = 0;
+        att_set_db_index(NULL, 0);
+        int found_linear = gatt_server_get_get_handle_range_for_service_with_uuid16(uuid16s[i], &start_linear, &end_linear);
+        uint16_t value_linear = gatt_server_get_value_handle_for_characteristic_with_uuid16(start_linear, end_linear, 0x2a19);
+        uint16_t ccc_linear   = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(start_linear, end_linear, 0x2a19);
+        att_set_db_index(index_entries, MAX_NUM_ATTRIBUTES);
+        int found_index = gatt_server_get_get_handle_range_for_service_with_uuid16(uuid16s[i], &start_index, &end_index);
+        uint16_t value_index = gatt_server_get_value_handle_for_characteristic_with_uuid16(start_index, end_index, 0x2a19);
+        uint16_t ccc_index   = gatt_server_get_client_configuration_handle_for_characteristic_with_uuid16(start_index, end_index, 0x2a19);
+        CHECK_EQUAL(found_linear, found_index);
+        CHECK_EQUAL(start_linear, start_index);
+        CHECK_EQUAL(end_linear, end_index);
+        CHECK_EQUAL(value_linear, value_index);
+        CHECK_EQUAL(ccc_linear, ccc_index);
+    }
+}
+
+TEST(AttDbIndex, IndexTooSmall){
+    att_set_db_index(index_entries, 10);
+    uint8_t request[3];
+    request[0] = ATT_READ_REQUEST;
+    little_endian_store_16(request, 1, num_attributes);
+    uint8_t response[32];
+    uint16_t len = att_handle_request(&att_connection, request, sizeof(request), response);
+    CHECK_EQUAL(ATT_READ_RESPONSE, response[0]);
+    CHECK_EQUAL(2, len);
+    CHECK_EQUAL(num_attributes, att_db_get_num_attributes());
+}
+
+TEST(AttDbIndex, PrecomputedTable){
+    uint16_t num_entries = sizeof(profile_data_index) / sizeof(att_db_index_entry_t);
+    att_set_db(profile_data);
+    CHECK_EQUAL(num_entries, att_db_get_num_attributes());
+
+    // same as index built at runtime
+    att_set_db_index(index_entries, MAX_NUM_ATTRIBUTES);
+    MEMCMP_EQUAL(profile_data_index, index_entries, sizeof(profile_data_index));
+
+    att_set_db_index(NULL, 0);
+    att_set_db_index_table(profile_data_index, num_entries);
+    uint8_t request[3];
+    request[0] = ATT_READ_REQUEST;
+    little_endian_store_16(request, 1, ATT_CHARACTERISTIC_GAP_DEVICE_NAME_01_VALUE_HANDLE);
+    uint8_t response[32];
+    uint16_t len = att_handle_request(&att_connection, request, sizeof(request), response);
+    CHECK_EQUAL(11, len);
+    MEMCMP_EQUAL("LE Counter", &response[1], 10);
+    CHECK_EQUAL(ATT_CHARACTERISTIC_GAP_DEVICE_NAME_01_VALUE_HANDLE, gatt_server_get_value_handle_for_characteristic_with_uuid16(1, 0xffff, GAP_DEVICE_NAME_UUID));
+
+    // table doesn't match other ATT DB
+    att_set_db(att_db_util_get_address());
+    CHECK_EQUAL(num_attributes, att_db_get_num_attributes());
+    len = att_handle_request(&att_connection, request, sizeof(request), response);
+    CHECK_EQUAL(13, len);
+    MEMCMP_EQUAL("ATT DB Index", &response[1], 12);
+}
+
+TEST(AttDbIndex, PrecomputedTableInvalidPosition){
+    uint16_t num_entries = sizeof(profile_data_index) / sizeof(att_db_index_entry_t);
+    att_set_db(profile_data);
+    uint16_t start_handle;
+    uint16_t end_handle;
+    CHECK_EQUAL(1, gatt_server_get_get_handle_range_for_service_with_uuid16(GAP_SERVICE_UUID, &start_handle, &end_handle));
+
+    // group end of first service points behind table
+    att_db_index_entry_t table[MAX_NUM_ATTRIBUTES];
+    memcpy(table, profile_data_index, sizeof(profile_data_index));
+    table[0].group_end = num_entries;
+    table[num_entries] = table[0];
+    table[num_entries].handle = 0x1234;
+    att_set_db_index_table(table, num_entries);
+    uint16_t end_handle_with_table = 0;
+    CHECK_EQUAL(1, gatt_server_get_get_handle_range_for_service_with_uuid16(GAP_SERVICE_UUID, &start_handle, &end_handle_with_table));
+    CHECK_EQUAL(end_handle, end_handle_with_table);
+
+    // uuid16 order points behind table
+    memcpy(table, profile_data_index, sizeof(profile_data_index));
+    table[0].uuid16_order = num_entries;
+    att_set_db_index_table(table, num_entries);
+    CHECK_EQUAL(ATT_CHARACTERISTIC_GAP_DEVICE_NAME_01_VALUE_HANDLE, gatt_server_get_value_handle_for_characteristic_with_uuid16(1, 0xffff, GAP_DEVICE_NAME_UUID));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2018 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// test ATT Server: delayed responses with att_server_response_ready
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "ble/att_server.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "mock.h"
+
+#define TEST_CON_HANDLE_A  0x0040
+#define TEST_CON_HANDLE_B  0x0041
+
+static uint16_t handle_dynamic;
+static uint16_t handle_static;
+static uint16_t handle_authorization;
+
+static uint8_t  dynamic_value[] = { 0x01, 0x02, 0x03 };
+static uint8_t  static_value[]  = { 0x04, 0x05 };
+
+static int      value_ready;
+static int      write_complete;
+static int      num_read_callbacks;
+static int      num_write_callbacks;
+static uint16_t last_write_handle;
+static uint16_t last_write_len;
+static uint8_t  last_write_value[10];
+
+static uint16_t att_read_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t offset, uint8_t * buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    if ((attribute_handle != handle_dynamic) && (attribute_handle != handle_authorization)) return 0;
+    if (buffer == NULL){
+        num_read_callbacks++;
+        if (!value_ready) return ATT_READ_RESPONSE_PENDING;
+    }
+    if (buffer == NULL) return sizeof(dynamic_value);
+    uint16_t bytes_to_copy = btstack_min(sizeof(dynamic_value) - offset, buffer_size);
+    memcpy(buffer, &dynamic_value[offset], bytes_to_copy);
+    return bytes_to_copy;
+}
+
+static int att_write_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
+    UNUSED(con_handle);
+    UNUSED(offset);
+    if (transaction_mode != ATT_TRANSACTION_MODE_NONE) return 0;
+    num_write_callbacks++;
+    // called with the same parameters again after att_server_response_ready
+    if (num_write_callbacks > 1){
+        CHECK_EQUAL(last_write_handle, attribute_handle);
+        CHECK_EQUAL(last_write_len, buffer_size);
+        MEMCMP_EQUAL(last_write_value, buffer, buffer_size);
+    }
+    last_write_handle = attribute_handle;
+    last_write_len = btstack_min(buffer_size, sizeof(last_write_value));
+    memcpy(last_write_value, buffer, last_write_len);
+    if (!write_complete) return ATT_ERROR_WRITE_RESPONSE_PENDING;
+    return 0;
+}
+
+static void send_read_request(hci_con_handle_t con_handle, uint16_t attribute_handle){
+    uint8_t request[3];
+    request[0] = ATT_READ_REQUEST;
+    little_endian_store_16(request, 1, attribute_handle);
+    mock_simulate_att_packet(con_handle, request, sizeof(request));
+}
+
+static void send_write_request(hci_con_handle_t con_handle, uint16_t attribute_handle, uint8_t value){
+    uint8_t request[4];
+    request[0] = ATT_WRITE_REQUEST;
+    little_endian_store_16(request, 1, attribute_handle);
+    request[3] = value;
+    mock_simulate_att_packet(con_handle, request, sizeof(request));
+}
+
+static uint8_t * get_sent_packet(int index, hci_con_handle_t expected_con_handle, uint16_t * size){
+    hci_con_handle_t con_handle;
+    CHECK(index < mock_num_sent_packets());
+    uint8_t * packet = mock_get_sent_packet(index, &con_handle, size);
+    CHECK_EQUAL(expected_con_handle, con_handle);
+    return packet;
+}
+
+static void check_read_response(int index, hci_con_handle_t con_handle, const uint8_t * value, uint16_t value_len){
+    uint16_t size;
+    uint8_t * packet = get_sent_packet(index, con_handle, &size);
+    CHECK_EQUAL(ATT_READ_RESPONSE, packet[0]);
+    CHECK_EQUAL(1 + value_len, size);
+    MEMCMP_EQUAL(value, &packet[1], value_len);
+}
+
+TEST_GROUP(ATT_SERVER_DELAYED_RESPONSE){
+    void setup(void){
+        mock_init();
+        value_ready = 0;
+        write_complete = 0;
+        num_read_callbacks = 0;
+        num_write_callbacks = 0;
+        att_db_util_init();
+        att_db_util_add_service_uuid16(0x180f);
+        handle_dynamic = att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ | ATT_PROPERTY_WRITE | ATT_PROPERTY_DYNAMIC, NULL, 0);
+        handle_static  = att_db_util_add_characteristic_uuid16(0x2a00, ATT_PROPERTY_READ, static_value, sizeof(static_value));
+        handle_authorization = att_db_util_add_characteristic_uuid16(0x2a01, ATT_PROPERTY_READ | ATT_PROPERTY_DYNAMIC | ATT_PROPERTY_AUTHORIZATION_REQUIRED, NULL, 0);
+        att_server_init(att_db_util_get_address(), &att_read_callback, &att_write_callback);
+        mock_simulate_le_connection(TEST_CON_HANDLE_A);
+    }
+};
+
+TEST(ATT_SERVER_DELAYED_RESPONSE, ReadResponsePending){
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, att_server_response_ready(TEST_CON_HANDLE_A));
+
+    send_read_request(TEST_CON_HANDLE_A, handle_dynamic);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, num_read_callbacks);
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    // still pending
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    // read callback called again with same request
+    value_ready = 1;
+    CHECK_EQUAL(0, att_server_response_ready(TEST_CON_HANDLE_A));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, att_server_response_ready(TEST_CON_HANDLE_A));
+    CHECK(mock_can_send_now_requested());
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(2, num_read_callbacks);
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_read_response(0, TEST_CON_HANDLE_A, dynamic_value, sizeof(dynamic_value));
+
+    // server accepts next request
+    mock_clear_sent_packets();
+    send_read_request(TEST_CON_HANDLE_A, handle_static);
+    mock_simulate_can_send_now();
+    check_read_response(0, TEST_CON_HANDLE_A, static_value, sizeof(static_value));
+}
+
+TEST(ATT_SERVER_DELAYED_RESPONSE, WriteResponsePending){
+    send_write_request(TEST_CON_HANDLE_A, handle_dynamic, 0x42);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, num_write_callbacks);
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    write_complete = 1;
+    CHECK_EQUAL(0, att_server_response_ready(TEST_CON_HANDLE_A));
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(2, num_write_callbacks);
+    CHECK_EQUAL(0x42, last_write_value[0]);
+
+    uint16_t size;
+    uint8_t * packet = get_sent_packet(0, TEST_CON_HANDLE_A, &size);
+    CHECK_EQUAL(1, size);
+    CHECK_EQUAL(ATT_WRITE_RESPONSE, packet[0]);
+}
+
+TEST(ATT_SERVER_DELAYED_RESPONSE, UnknownConnection){
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, att_server_response_ready(TEST_CON_HANDLE_B));
+}
+
+TEST(ATT_SERVER_DELAYED_RESPONSE, OtherConnectionServedWhilePending){
+    mock_simulate_le_connection(TEST_CON_HANDLE_B);
+
+    send_read_request(TEST_CON_HANDLE_A, handle_dynamic);
+    send_read_request(TEST_CON_HANDLE_B, handle_static);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_read_response(0, TEST_CON_HANDLE_B, static_value, sizeof(static_value));
+
+    mock_clear_sent_packets();
+    value_ready = 1;
+    CHECK_EQUAL(0, att_server_response_ready(TEST_CON_HANDLE_A));
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_read_response(0, TEST_CON_HANDLE_A, dynamic_value, sizeof(dynamic_value));
+}
+
+TEST(ATT_SERVER_DELAYED_RESPONSE, ResponseBufferedUntilCanSend){
+    value_ready = 1;
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+
+    // response is prepared in per-connection buffer right away
+    send_read_request(TEST_CON_HANDLE_A, handle_dynamic);
+    CHECK_EQUAL(1, num_read_callbacks);
+    CHECK(mock_can_send_now_requested());
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    // requests are ignored while response has not been sent
+    send_read_request(TEST_CON_HANDLE_A, handle_static);
+
+    // prepared response is sent without calling read callback again
+    mock_set_can_send(TEST_CON_HANDLE_A, 1);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, num_read_callbacks);
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_read_response(0, TEST_CON_HANDLE_A, dynamic_value, sizeof(dynamic_value));
+}
+
+TEST(ATT_SERVER_DELAYED_RESPONSE, AuthorizationRetry){
+    value_ready = 1;
+
+    // authenticated connection
+    uint8_t encryption_change[] = { HCI_EVENT_ENCRYPTION_CHANGE, 4, 0, 0, 0, 1};
+    little_endian_store_16(encryption_change, 3, TEST_CON_HANDLE_A);
+    mock_simulate_hci_event(encryption_change, sizeof(encryption_change));
+
+    // insufficient authorization triggers authorization request, request is kept
+    send_read_request(TEST_CON_HANDLE_A, handle_authorization);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_pairing_requests());
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    // authorization granted -> request processed again
+    uint8_t authorization_result[12];
+    memset(authorization_result, 0, sizeof(authorization_result));
+    authorization_result[0] = SM_EVENT_AUTHORIZATION_RESULT;
+    authorization_result[1] = sizeof(authorization_result) - 2;
+    little_endian_store_16(authorization_result, 2, TEST_CON_HANDLE_A);
+    authorization_result[11] = 1;
+    mock_simulate_sm_event(authorization_result, sizeof(authorization_result));
+    CHECK(mock_can_send_now_requested());
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_read_response(0, TEST_CON_HANDLE_A, dynamic_value, sizeof(dynamic_value));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// test ATT Server: notification queue
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "ble/att_db.h"
+#include "ble/att_db_util.h"
+#include "ble/att_server.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "mock.h"
+
+#define TEST_CON_HANDLE_A  0x0040
+#define TEST_CON_HANDLE_B  0x0041
+#define TEST_VALUE_HANDLE  0x0010
+
+static uint8_t statistics_event[20];
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS:
+            CHECK_EQUAL(sizeof(statistics_event), size);
+            memcpy(statistics_event, packet, size);
+            break;
+        default:
+            break;
+    }
+}
+
+static void request_statistics(hci_con_handle_t con_handle){
+    memset(statistics_event, 0, sizeof(statistics_event));
+    att_server_request_notification_queue_statistics_event(con_handle);
+    CHECK_EQUAL(ATT_EVENT_NOTIFICATION_QUEUE_STATISTICS, statistics_event[0]);
+    CHECK_EQUAL(con_handle, att_event_notification_queue_statistics_get_handle(statistics_event));
+}
+
+static void queue_notification(hci_con_handle_t con_handle, uint16_t attribute_handle, uint8_t value, uint16_t value_len){
+    uint8_t data[30];
+    memset(data, value, sizeof(data));
+    CHECK_EQUAL(0, att_server_queue_notification(con_handle, attribute_handle, data, value_len));
+}
+
+// verify Handle Value Notification
+static void check_notification(int index, hci_con_handle_t expected_con_handle, uint16_t attribute_handle, uint8_t value, uint16_t value_len){
+    hci_con_handle_t con_handle;
+    uint16_t size;
+    CHECK(index < mock_num_sent_packets());
+    uint8_t * packet = mock_get_sent_packet(index, &con_handle, &size);
+    CHECK_EQUAL(expected_con_handle, con_handle);
+    CHECK_EQUAL(3 + value_len, size);
+    CHECK_EQUAL(ATT_HANDLE_VALUE_NOTIFICATION, packet[0]);
+    CHECK_EQUAL(attribute_handle, little_endian_read_16(packet, 1));
+    int i;
+    for (i=0;i<value_len;i++){
+        CHECK_EQUAL(value, packet[3+i]);
+    }
+}
+
+TEST_GROUP(ATT_SERVER_NOTIFICATION_QUEUE){
+    void setup(void){
+        mock_init();
+        att_db_util_init();
+        att_db_util_add_service_uuid16(0x180f);
+        uint8_t battery_level = 100;
+        att_db_util_add_characteristic_uuid16(0x2a19, ATT_PROPERTY_READ | ATT_PROPERTY_NOTIFY, &battery_level, 1);
+        att_server_init(att_db_util_get_address(), NULL, NULL);
+        att_server_register_packet_handler(&packet_handler);
+        mock_simulate_le_connection(TEST_CON_HANDLE_A);
+    }
+};
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, SentInOrder){
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 2);
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE + 1, 0x02, 3);
+    CHECK(mock_can_send_now_requested());
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    request_statistics(TEST_CON_HANDLE_A);
+    CHECK_EQUAL(2, att_event_notification_queue_statistics_get_queued_notifications(statistics_event));
+
+    // without Multiple Handle Value Notifications, each one is sent separately
+    mock_set_can_send(TEST_CON_HANDLE_A, 1);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(2, mock_num_sent_packets());
+    check_notification(0, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 2);
+    check_notification(1, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE + 1, 0x02, 3);
+    CHECK(!mock_can_send_now_requested());
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, ValueTruncatedToMtu){
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 30);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_notification(0, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, ATT_DEFAULT_MTU - 3);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, DroppedWhenFull){
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+    // each entry uses 4 bytes plus value, values are truncated to MTU - 3
+    uint16_t value_len = ATT_DEFAULT_MTU - 3;
+    int num_fit = ATT_SERVER_NOTIFICATION_QUEUE_SIZE / (4 + value_len);
+    int i;
+    for (i=0;i<num_fit;i++){
+        queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, (uint8_t) i, value_len);
+    }
+    uint8_t data[ATT_DEFAULT_MTU - 3];
+    memset(data, 0xff, sizeof(data));
+    CHECK_EQUAL(BTSTACK_MEMORY_ALLOC_FAILED, att_server_queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, data, value_len));
+
+    request_statistics(TEST_CON_HANDLE_A);
+    CHECK_EQUAL(num_fit, att_event_notification_queue_statistics_get_queued_notifications(statistics_event));
+    CHECK_EQUAL(num_fit, att_event_notification_queue_statistics_get_queued_notifications_max(statistics_event));
+    CHECK_EQUAL(1, att_event_notification_queue_statistics_get_notifications_dropped(statistics_event));
+    CHECK_EQUAL(0, att_event_notification_queue_statistics_get_notifications_sent(statistics_event));
+
+    // queued notifications are sent, dropped one is not
+    mock_set_can_send(TEST_CON_HANDLE_A, 1);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(num_fit, mock_num_sent_packets());
+    for (i=0;i<num_fit;i++){
+        check_notification(i, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, (uint8_t) i, value_len);
+    }
+
+    // space available again
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, value_len);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, CombinedWithinMtu){
+    att_server_enable_multiple_handle_value_notifications(TEST_CON_HANDLE_A, 1);
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+    // 1 + 3 * (4 + 3) = 22 bytes fit into default MTU of 23, the fourth does not
+    int i;
+    for (i=0;i<4;i++){
+        queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE + i, (uint8_t) i, 3);
+    }
+    mock_set_can_send(TEST_CON_HANDLE_A, 1);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(2, mock_num_sent_packets());
+
+    hci_con_handle_t con_handle;
+    uint16_t size;
+    uint8_t * packet = mock_get_sent_packet(0, &con_handle, &size);
+    CHECK_EQUAL(TEST_CON_HANDLE_A, con_handle);
+    CHECK_EQUAL(22, size);
+    CHECK(size <= ATT_DEFAULT_MTU);
+    CHECK_EQUAL(ATT_MULTIPLE_HANDLE_VALUE_NOTIFICATION, packet[0]);
+    uint16_t pos = 1;
+    for (i=0;i<3;i++){
+        CHECK_EQUAL(TEST_VALUE_HANDLE + i, little_endian_read_16(packet, pos));
+        CHECK_EQUAL(3, little_endian_read_16(packet, pos + 2));
+        CHECK_EQUAL(i, packet[pos + 4]);
+        pos += 7;
+    }
+
+    // single remaining notification sent as regular Handle Value Notification
+    check_notification(1, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE + 3, 0x03, 3);
+
+    request_statistics(TEST_CON_HANDLE_A);
+    CHECK_EQUAL(0, att_event_notification_queue_statistics_get_queued_notifications(statistics_event));
+    CHECK_EQUAL(4, att_event_notification_queue_statistics_get_queued_notifications_max(statistics_event));
+    CHECK_EQUAL(4, att_event_notification_queue_statistics_get_notifications_sent(statistics_event));
+    CHECK_EQUAL(2, att_event_notification_queue_statistics_get_notification_packets_sent(statistics_event));
+    CHECK_EQUAL(0, att_event_notification_queue_statistics_get_notifications_dropped(statistics_event));
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, SingleNotificationNotCombined){
+    att_server_enable_multiple_handle_value_notifications(TEST_CON_HANDLE_A, 1);
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+    // two notifications that do not fit into a single Multiple Handle Value Notification
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 15);
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x02, 15);
+    mock_set_can_send(TEST_CON_HANDLE_A, 1);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(2, mock_num_sent_packets());
+    check_notification(0, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 15);
+    check_notification(1, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x02, 15);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, OtherConnectionsServed){
+    mock_simulate_le_connection(TEST_CON_HANDLE_B);
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 2);
+    queue_notification(TEST_CON_HANDLE_B, TEST_VALUE_HANDLE, 0x02, 2);
+
+    // first connection cannot send, second one can
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_notification(0, TEST_CON_HANDLE_B, TEST_VALUE_HANDLE, 0x02, 2);
+    CHECK(mock_can_send_now_requested());
+
+    mock_clear_sent_packets();
+    mock_set_can_send(TEST_CON_HANDLE_A, 1);
+    mock_simulate_can_send_now();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    check_notification(0, TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 2);
+}
+
+TEST(ATT_SERVER_NOTIFICATION_QUEUE, UnknownConnection){
+    mock_set_can_send(TEST_CON_HANDLE_A, 0);
+    queue_notification(TEST_CON_HANDLE_A, TEST_VALUE_HANDLE, 0x01, 2);
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, att_server_queue_notification(TEST_CON_HANDLE_B, TEST_VALUE_HANDLE, NULL, 0));
+    request_statistics(TEST_CON_HANDLE_A);
+    CHECK_EQUAL(1, att_event_notification_queue_statistics_get_queued_notifications(statistics_event));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
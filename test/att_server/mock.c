@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2018 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// ATT Server BTstack Mocks - LE connections, ATT fixed channel and SM
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hci.h"
+#include "l2cap.h"
+#include "ble/le_device_db.h"
+#include "ble/sm.h"
+
+#include "mock.h"
+
+#define MOCK_MAX_CONNECTIONS 2
+#define MOCK_MAX_PACKETS     20
+#define MOCK_MAX_PACKET_SIZE 256
+
+static btstack_packet_handler_t registered_hci_event_handler;
+static btstack_packet_handler_t registered_sm_event_handler;
+static btstack_packet_handler_t registered_att_handler;
+
+static btstack_linked_list_t connections;
+static hci_connection_t      mock_connections[MOCK_MAX_CONNECTIONS];
+static int                   num_connections;
+static uint8_t               can_send[MOCK_MAX_CONNECTIONS];
+
+static int      can_send_now_requested;
+
+static uint8_t  outgoing_buffer[MOCK_MAX_PACKET_SIZE];
+static int      outgoing_buffer_reserved;
+
+static uint8_t          sent_packets[MOCK_MAX_PACKETS][MOCK_MAX_PACKET_SIZE];
+static uint16_t         sent_packet_sizes[MOCK_MAX_PACKETS];
+static hci_con_handle_t sent_packet_handles[MOCK_MAX_PACKETS];
+static int              num_sent_packets;
+
+static authorization_state_t authorization_state;
+static int                   num_pairing_requests;
+
+static int mock_connection_index(hci_con_handle_t con_handle){
+	int i;
+	for (i=0;i<num_connections;i++){
+		if (mock_connections[i].con_handle == con_handle) return i;
+	}
+	return -1;
+}
+
+void mock_init(void){
+	memset(mock_connections, 0, sizeof(mock_connections));
+	connections = NULL;
+	num_connections = 0;
+	can_send_now_requested = 0;
+	num_sent_packets = 0;
+	outgoing_buffer_reserved = 0;
+	authorization_state = AUTHORIZATION_UNKNOWN;
+	num_pairing_requests = 0;
+}
+
+void mock_simulate_le_connection(hci_con_handle_t con_handle){
+	if (num_connections >= MOCK_MAX_CONNECTIONS) return;
+	hci_connection_t * connection = &mock_connections[num_connections];
+	can_send[num_connections] = 1;
+	num_connections++;
+	connection->con_handle = con_handle;
+	connection->address_type = BD_ADDR_TYPE_LE_PUBLIC;
+	// iterate connections in order of creation
+	btstack_linked_list_add_tail(&connections, (btstack_linked_item_t *) connection);
+
+	uint8_t event[21];
+	memset(event, 0, sizeof(event));
+	event[0] = HCI_EVENT_LE_META;
+	event[1] = sizeof(event) - 2;
+	event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+	little_endian_store_16(event, 4, con_handle);
+	(*registered_hci_event_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+void mock_simulate_hci_event(uint8_t * packet, uint16_t size){
+	(*registered_hci_event_handler)(HCI_EVENT_PACKET, 0, packet, size);
+}
+
+void mock_simulate_att_packet(hci_con_handle_t con_handle, uint8_t * packet, uint16_t size){
+	(*registered_att_handler)(ATT_DATA_PACKET, con_handle, packet, size);
+}
+
+void mock_simulate_sm_event(uint8_t * packet, uint16_t size){
+	(*registered_sm_event_handler)(HCI_EVENT_PACKET, 0, packet, size);
+}
+
+void mock_set_can_send(hci_con_handle_t con_handle, int enabled){
+	int index = mock_connection_index(con_handle);
+	if (index < 0) return;
+	can_send[index] = enabled;
+}
+
+int mock_can_send_now_requested(void){
+	return can_send_now_requested;
+}
+
+void mock_simulate_can_send_now(void){
+	if (!can_send_now_requested) return;
+	can_send_now_requested = 0;
+	uint8_t event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 0, 0};
+	little_endian_store_16(event, 2, L2CAP_CID_ATTRIBUTE_PROTOCOL);
+	(*registered_att_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+void mock_set_authorization_state(authorization_state_t state){
+	authorization_state = state;
+}
+
+int mock_num_pairing_requests(void){
+	return num_pairing_requests;
+}
+
+int mock_num_sent_packets(void){
+	return num_sent_packets;
+}
+
+uint8_t * mock_get_sent_packet(int index, hci_con_handle_t * con_handle, uint16_t * size){
+	*con_handle = sent_packet_handles[index];
+	*size = sent_packet_sizes[index];
+	return sent_packets[index];
+}
+
+void mock_clear_sent_packets(void){
+	num_sent_packets = 0;
+}
+
+static int mock_store_sent_packet(hci_con_handle_t con_handle, const uint8_t * data, uint16_t len){
+	if (num_sent_packets >= MOCK_MAX_PACKETS){
+		printf("mock: too many sent packets\n");
+		return BTSTACK_ACL_BUFFERS_FULL;
+	}
+	memcpy(sent_packets[num_sent_packets], data, len);
+	sent_packet_sizes[num_sent_packets] = len;
+	sent_packet_handles[num_sent_packets] = con_handle;
+	num_sent_packets++;
+	return 0;
+}
+
+// HCI
+
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+	registered_hci_event_handler = callback_handler->callback;
+}
+
+hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+	int index = mock_connection_index(con_handle);
+	if (index < 0) return NULL;
+	return &mock_connections[index];
+}
+
+void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
+	btstack_linked_list_iterator_init(it, &connections);
+}
+
+int hci_can_send_acl_le_packet_now(void){
+	if (outgoing_buffer_reserved) return 0;
+	int i;
+	for (i=0;i<num_connections;i++){
+		if (can_send[i]) return 1;
+	}
+	return 0;
+}
+
+// L2CAP
+
+void l2cap_register_fixed_channel(btstack_packet_handler_t packet_handler, uint16_t channel_id){
+	if (channel_id != L2CAP_CID_ATTRIBUTE_PROTOCOL) return;
+	registered_att_handler = packet_handler;
+}
+
+int l2cap_can_send_fixed_channel_packet_now(hci_con_handle_t con_handle, uint16_t channel_id){
+	UNUSED(channel_id);
+	int index = mock_connection_index(con_handle);
+	if (index < 0) return 0;
+	if (outgoing_buffer_reserved) return 0;
+	return can_send[index];
+}
+
+void l2cap_request_can_send_fix_channel_now_event(hci_con_handle_t con_handle, uint16_t channel_id){
+	UNUSED(con_handle);
+	UNUSED(channel_id);
+	can_send_now_requested = 1;
+}
+
+int l2cap_reserve_packet_buffer(void){
+	outgoing_buffer_reserved = 1;
+	return 1;
+}
+
+void l2cap_release_packet_buffer(void){
+	outgoing_buffer_reserved = 0;
+}
+
+uint8_t * l2cap_get_outgoing_buffer(void){
+	return outgoing_buffer;
+}
+
+int l2cap_send_prepared_connectionless(hci_con_handle_t con_handle, uint16_t cid, uint16_t len){
+	UNUSED(cid);
+	outgoing_buffer_reserved = 0;
+	return mock_store_sent_packet(con_handle, outgoing_buffer, len);
+}
+
+int l2cap_send_connectionless(hci_con_handle_t con_handle, uint16_t cid, uint8_t *data, uint16_t len){
+	UNUSED(cid);
+	if (!l2cap_can_send_fixed_channel_packet_now(con_handle, cid)) return BTSTACK_ACL_BUFFERS_FULL;
+	return mock_store_sent_packet(con_handle, data, len);
+}
+
+uint16_t l2cap_max_le_mtu(void){
+	return HCI_ACL_PAYLOAD_SIZE - L2CAP_HEADER_SIZE;
+}
+
+// SM
+
+void sm_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+	registered_sm_event_handler = callback_handler->callback;
+}
+
+int sm_encryption_key_size(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+	return 16;
+}
+
+int sm_authenticated(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+	return 1;
+}
+
+authorization_state_t sm_authorization_state(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+	return authorization_state;
+}
+
+void sm_request_pairing(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+	num_pairing_requests++;
+}
+
+int sm_cmac_ready(void){
+	return 0;
+}
+
+void sm_cmac_signed_write_start(const sm_key_t key, uint8_t opcode, uint16_t attribute_handle, uint16_t message_len, const uint8_t * message, uint32_t sign_counter, void (*done_callback)(uint8_t * hash)){
+	UNUSED(opcode);
+	UNUSED(attribute_handle);
+	UNUSED(message_len);
+	UNUSED(message);
+	UNUSED(sign_counter);
+	UNUSED(done_callback);
+}
+
+// LE Device DB
+
+uint32_t le_device_db_remote_counter_get(int index){
+	UNUSED(index);
+	return 0;
+}
+
+void le_device_db_remote_counter_set(int index, uint32_t counter){
+	UNUSED(index);
+	UNUSED(counter);
+}
+
+void le_device_db_remote_csrk_get(int index, sm_key_t csrk){
+	UNUSED(index);
+	memset(csrk, 0, 16);
+}
+
+// Run Loop
+
+void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+	UNUSED(ts);
+	UNUSED(timeout_in_ms);
+}
+
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*process)(btstack_timer_source_t *_ts)){
+	ts->process = process;
+}
+
+void btstack_run_loop_set_timer_context(btstack_timer_source_t * ts, void * context){
+	ts->context = context;
+}
+
+void * btstack_run_loop_get_timer_context(btstack_timer_source_t * ts){
+	return ts->context;
+}
+
+void btstack_run_loop_add_timer(btstack_timer_source_t * ts){
+	UNUSED(ts);
+}
+
+int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
+	UNUSED(ts);
+	return 0;
+}
@@ -0,0 +1,19 @@
+#include <stdint.h>
+#include "btstack_defines.h"
+#include "bluetooth.h"
+#include "ble/sm.h"
+
+void mock_init(void);
+void mock_simulate_le_connection(hci_con_handle_t con_handle);
+void mock_simulate_hci_event(uint8_t * packet, uint16_t size);
+void mock_simulate_att_packet(hci_con_handle_t con_handle, uint8_t * packet, uint16_t size);
+void mock_simulate_sm_event(uint8_t * packet, uint16_t size);
+void mock_simulate_can_send_now(void);
+void mock_set_can_send(hci_con_handle_t con_handle, int enabled);
+int  mock_can_send_now_requested(void);
+void mock_set_authorization_state(authorization_state_t state);
+int  mock_num_pairing_requests(void);
+
+int       mock_num_sent_packets(void);
+uint8_t * mock_get_sent_packet(int index, hci_con_handle_t * con_handle, uint16_t * size);
+void      mock_clear_sent_packets(void);
@@ -0,0 +1,63 @@
+// micro-benchmark for CRC calculations, run with 'make benchmark'
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "btstack_crc.h"
+
+#define NUM_ITERATIONS 100000
+
+// max ERTM PDU used by BTstack: 1021 bytes
+static uint8_t frame[1021];
+
+static double seconds_since(struct timespec * start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(const char * name, double seconds, uint32_t checksum){
+    double bytes = (double) NUM_ITERATIONS * sizeof(frame);
+    printf("%-12s %8.1f MB/s (checksum %08x)\n", name, bytes / seconds / 1e6, checksum);
+}
+
+int main(void){
+    unsigned int i;
+    for (i = 0; i < sizeof(frame); i++){
+        frame[i] = i * 7;
+    }
+#ifdef ENABLE_BTSTACK_CRC_SLICING_BY_8
+    printf("CRC slicing-by-8, %u byte frames\n", (unsigned int) sizeof(frame));
+#else
+    printf("CRC single table, %u byte frames\n", (unsigned int) sizeof(frame));
+#endif
+
+    struct timespec start;
+    uint32_t checksum;
+
+    checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NUM_ITERATIONS; i++){
+        frame[0] = i;
+        checksum += btstack_crc16_calc(frame, sizeof(frame));
+    }
+    report("crc16", seconds_since(&start), checksum);
+
+    checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NUM_ITERATIONS; i++){
+        frame[0] = i;
+        checksum += btstack_crc16_ccitt_update(0xffff, frame, sizeof(frame));
+    }
+    report("crc16 ccitt", seconds_since(&start), checksum);
+
+    checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < NUM_ITERATIONS; i++){
+        frame[0] = i;
+        checksum += btstack_crc8_update(0xff, frame, sizeof(frame));
+    }
+    report("crc8", seconds_since(&start), checksum);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_crc.h"
+
+static const uint8_t check_input[] = "123456789";
+
+// bitwise reference implementation, LSB first
+static uint16_t crc_reference(uint16_t poly, uint16_t crc, const uint8_t * data, uint16_t len){
+    while (len--){
+        crc ^= *data++;
+        int i;
+        for (i = 0; i < 8; i++){
+            crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static uint8_t data[1100];
+
+TEST_GROUP(CRC){
+    void setup(void){
+        uint32_t seed = 0x12345678;
+        unsigned int i;
+        for (i = 0; i < sizeof(data); i++){
+            seed = seed * 1103515245 + 12345;
+            data[i] = seed >> 16;
+        }
+    }
+};
+
+TEST(CRC, CheckValues){
+    CHECK_EQUAL(0xbb3d, btstack_crc16_calc(check_input, 9));
+    CHECK_EQUAL(0x6f91, btstack_crc16_ccitt_update(0xffff, check_input, 9));
+    CHECK_EQUAL(0xd0,   btstack_crc8_update(0xff, check_input, 9));
+}
+
+TEST(CRC, RfcommSabmFcs){
+    const uint8_t sabm[] = { 0x03, 0x3f, 0x01 };
+    CHECK_EQUAL(0x1c, 0xff - btstack_crc8_update(0xff, sabm, sizeof(sabm)));
+}
+
+TEST(CRC, MatchesReference){
+    // all lengths up to more than one slice, with all alignments
+    int offset;
+    int len;
+    for (offset = 0; offset < 8; offset++){
+        for (len = 0; len < 40; len++){
+            CHECK_EQUAL(crc_reference(0xa001, 0, &data[offset], len), btstack_crc16_calc(&data[offset], len));
+            CHECK_EQUAL(crc_reference(0x8408, 0xffff, &data[offset], len), btstack_crc16_ccitt_update(0xffff, &data[offset], len));
+            CHECK_EQUAL(crc_reference(0xe0, 0xff, &data[offset], len), btstack_crc8_update(0xff, &data[offset], len));
+        }
+    }
+    CHECK_EQUAL(crc_reference(0xa001, 0, data, 1021), btstack_crc16_calc(data, 1021));
+}
+
+TEST(CRC, Incremental){
+    uint16_t crc16 = btstack_crc16_update(0, data, 13);
+    crc16 = btstack_crc16_update(crc16, &data[13], 1008);
+    CHECK_EQUAL(btstack_crc16_calc(data, 1021), crc16);
+    uint8_t crc8 = btstack_crc8_update(0xff, data, 3);
+    crc8 = btstack_crc8_update(crc8, &data[3], 20);
+    CHECK_EQUAL(btstack_crc8_update(0xff, data, 23), crc8);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -26,6 +26,12 @@
 
 static uint16_t gatt_client_handle = 0x40;
 static int gatt_query_complete = 0;
+static int gatt_query_complete_count = 0;
+static int read_on_characteristic_result = 0;
+static uint8_t queued_read_status;
+static int write_without_response_on_characteristic_result = 0;
+static uint8_t write_without_response_status;
+static void (*characteristic_result_handler)(void);
 
 typedef enum {
 	IDLE,
@@ -73,6 +79,10 @@ static gatt_client_characteristic_descriptor_t descriptors[50];
 
 void mock_simulate_discover_primary_services_response(void);
 void mock_simulate_att_exchange_mtu_response(void);
+void mock_simulate_disconnected(void);
+void mock_simulate_timeout(void);
+void mock_hold_responses(void);
+void mock_release_responses(int drop_held_request);
 
 void CHECK_EQUAL_ARRAY(const uint8_t * expected, uint8_t * actual, int size){
 	for (int i=0; i<size; i++){
@@ -151,6 +161,7 @@ static void handle_ble_client_event(uint8_t packet_type, uint16_t channel, uint8
 		case GATT_EVENT_QUERY_COMPLETE:
 			status = packet[4];
             gatt_query_complete = 1;
+            gatt_query_complete_count++;
             if (status){
                 gatt_query_complete = 0;
                 printf("GATT_EVENT_QUERY_COMPLETE failed with status 0x%02X\n", status);
@@ -190,6 +201,20 @@ static void handle_ble_client_event(uint8_t packet_type, uint16_t channel, uint8
 			}
         	characteristics[result_index++] = characteristic;
         	result_counter++;
+        	// start a read or write while the discovery is still active
+        	if (read_on_characteristic_result){
+        		read_on_characteristic_result = 0;
+        		queued_read_status = gatt_client_read_value_of_characteristic(handle_ble_client_event, gatt_client_handle, &characteristics[0]);
+        	}
+        	if (write_without_response_on_characteristic_result){
+        		write_without_response_on_characteristic_result = 0;
+        		write_without_response_status = gatt_client_write_value_of_characteristic_without_response(gatt_client_handle, characteristics[0].value_handle, short_value_length, (uint8_t*)short_value);
+        	}
+        	if (characteristic_result_handler){
+        		void (*handler)(void) = characteristic_result_handler;
+        		characteristic_result_handler = NULL;
+        		(*handler)();
+        	}
             break;
         case GATT_EVENT_ALL_CHARACTERISTIC_DESCRIPTORS_QUERY_RESULT:
         	descriptor.handle = little_endian_read_16(packet, 4);
@@ -301,6 +326,7 @@ TEST_GROUP(GATTClient){
 
 	void reset_query_state(void){
 		gatt_query_complete = 0;
+		gatt_query_complete_count = 0;
 		result_counter = 0;
 		result_index = 0;
 	}
@@ -698,8 +724,243 @@ TEST(GATTClient, TestWriteReliableLongCharacteristicValue){
 	CHECK_EQUAL(gatt_query_complete, 1);
 }
 
+TEST(GATTClient, TestQueuedReadCharacteristicValue){
+	reset_query_state();
+	status = gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16);
+	CHECK_EQUAL(status, 0);
+	CHECK_EQUAL(gatt_query_complete, 1);
+
+	// read requested while characteristic discovery is active
+	test = READ_CHARACTERISTIC_VALUE;
+	reset_query_state();
+	read_on_characteristic_result = 1;
+	queued_read_status = 0xff;
+	status = gatt_client_discover_characteristics_for_service_by_uuid16(handle_ble_client_event, gatt_client_handle, &services[0], 0xF100);
+	CHECK_EQUAL(status, 0);
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+	// read is queued and started after the discovery completed
+	CHECK_EQUAL(queued_read_status, 0);
+	CHECK_EQUAL(gatt_query_complete_count, 2);
+#else
+	CHECK_EQUAL(queued_read_status, GATT_CLIENT_IN_WRONG_STATE);
+	CHECK_EQUAL(gatt_query_complete_count, 1);
+#endif
+	CHECK_EQUAL(gatt_client_is_ready(gatt_client_handle), 1);
+}
+
+TEST(GATTClient, TestWriteWithoutResponseWhileBusy){
+	reset_query_state();
+	status = gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16);
+	CHECK_EQUAL(status, 0);
+
+	test = WRITE_CHARACTERISTIC_VALUE;
+	reset_query_state();
+	write_without_response_on_characteristic_result = 1;
+	write_without_response_status = 0xff;
+	status = gatt_client_discover_characteristics_for_service_by_uuid16(handle_ble_client_event, gatt_client_handle, &services[0], 0xF100);
+	CHECK_EQUAL(status, 0);
+	CHECK_EQUAL(gatt_query_complete_count, 1);
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+	// write commands don't have to wait for the active query
+	CHECK_EQUAL(write_without_response_status, 0);
+#else
+	CHECK_EQUAL(write_without_response_status, GATT_CLIENT_IN_WRONG_STATE);
+#endif
+}
+
+static int     descriptors_complete_count;
+static uint8_t descriptors_complete_status;
+static uint8_t descriptors_status;
+
+static void handle_descriptors_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	if (packet_type != HCI_EVENT_PACKET) return;
+	if (packet[0] != GATT_EVENT_QUERY_COMPLETE) return;
+	descriptors_complete_count++;
+	descriptors_complete_status = packet[4];
+}
+
+static void discover_descriptors_without_descriptors_and_read(void){
+	gatt_client_characteristic_t characteristic;
+	memset(&characteristic, 0, sizeof(characteristic));
+	characteristic.start_handle = characteristics[0].start_handle;
+	characteristic.value_handle = characteristics[0].value_handle;
+	characteristic.end_handle   = characteristics[0].value_handle;
+	descriptors_status = gatt_client_discover_characteristic_descriptors(handle_descriptors_event, gatt_client_handle, &characteristic);
+	queued_read_status = gatt_client_read_value_of_characteristic(handle_ble_client_event, gatt_client_handle, &characteristics[0]);
+}
+
+TEST(GATTClient, TestQueuedDiscoverCharacteristicWithoutDescriptors){
+	reset_query_state();
+	status = gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16);
+	CHECK_EQUAL(status, 0);
+
+	test = READ_CHARACTERISTIC_VALUE;
+	reset_query_state();
+	descriptors_complete_count = 0;
+	descriptors_complete_status = 0xff;
+	descriptors_status = 0xff;
+	queued_read_status = 0xff;
+	characteristic_result_handler = &discover_descriptors_without_descriptors_and_read;
+	status = gatt_client_discover_characteristics_for_service_by_uuid16(handle_ble_client_event, gatt_client_handle, &services[0], 0xF100);
+	CHECK_EQUAL(status, 0);
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+	// completed right away with its own callback, read behind it is not blocked
+	CHECK_EQUAL(descriptors_status, 0);
+	CHECK_EQUAL(descriptors_complete_count, 1);
+	CHECK_EQUAL(descriptors_complete_status, 0);
+	CHECK_EQUAL(queued_read_status, 0);
+	CHECK_EQUAL(gatt_query_complete_count, 2);
+#else
+	CHECK_EQUAL(descriptors_status, GATT_CLIENT_IN_WRONG_STATE);
+	CHECK_EQUAL(descriptors_complete_count, 0);
+	CHECK_EQUAL(queued_read_status, GATT_CLIENT_IN_WRONG_STATE);
+	CHECK_EQUAL(gatt_query_complete_count, 1);
+#endif
+	CHECK_EQUAL(gatt_client_is_ready(gatt_client_handle), 1);
+}
+
+#ifdef ENABLE_GATT_CLIENT_REQUEST_QUEUE
+
+#define NUM_QUEUE_TEST_REQUESTS (MAX_NR_GATT_CLIENT_REQUESTS + 1)
+
+static int     queue_complete_order[NUM_QUEUE_TEST_REQUESTS + 1];
+static uint8_t queue_complete_status[NUM_QUEUE_TEST_REQUESTS + 1];
+static int     queue_complete_count;
+static int     queue_value_count;
+
+static void queue_test_handle_event(int request, uint8_t *packet){
+	switch (packet[0]){
+		case GATT_EVENT_CHARACTERISTIC_VALUE_QUERY_RESULT:
+			queue_value_count++;
+			break;
+		case GATT_EVENT_QUERY_COMPLETE:
+			queue_complete_status[queue_complete_count] = packet[4];
+			queue_complete_order[queue_complete_count++] = request;
+			break;
+		default:
+			break;
+	}
+}
+
+static void handle_queue_test_event_0(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	queue_test_handle_event(0, packet);
+}
+static void handle_queue_test_event_1(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	queue_test_handle_event(1, packet);
+}
+static void handle_queue_test_event_2(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	queue_test_handle_event(2, packet);
+}
+static void handle_queue_test_event_3(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+	queue_test_handle_event(3, packet);
+}
+
+static const btstack_packet_handler_t queue_test_handlers[] = {
+	&handle_queue_test_event_0,
+	&handle_queue_test_event_1,
+	&handle_queue_test_event_2,
+	&handle_queue_test_event_3,
+};
+
+static uint16_t gatt_client_requests_in_use(void){
+	btstack_memory_stats_t stats;
+	btstack_memory_get_stats(BTSTACK_MEMORY_TYPE_GATT_CLIENT_REQUEST, &stats);
+	return stats.in_use;
+}
+
+TEST_GROUP(GATTClientRequestQueue){
+	void setup(void){
+		// find characteristic to read
+		test = IDLE;
+		result_index = 0;
+		CHECK_EQUAL(0, gatt_client_discover_primary_services_by_uuid16(handle_ble_client_event, gatt_client_handle, service_uuid16));
+		result_index = 0;
+		CHECK_EQUAL(0, gatt_client_discover_characteristics_for_service_by_uuid16(handle_ble_client_event, gatt_client_handle, &services[0], 0xF100));
+		CHECK_EQUAL(1, gatt_client_is_ready(gatt_client_handle));
+
+		test = READ_CHARACTERISTIC_VALUE;
+		queue_complete_count = 0;
+		queue_value_count = 0;
+		memset(queue_complete_order, 0xff, sizeof(queue_complete_order));
+		memset(queue_complete_status, 0xff, sizeof(queue_complete_status));
+	}
+
+	void teardown(void){
+		mock_release_responses(1);
+	}
+
+	// first request is sent and waits for its held response, all others are queued
+	void start_requests(int num_requests){
+		mock_hold_responses();
+		for (int i = 0; i < num_requests; i++){
+			uint8_t status = gatt_client_read_value_of_characteristic(queue_test_handlers[i], gatt_client_handle, &characteristics[0]);
+			CHECK_EQUAL(0, status);
+		}
+		CHECK_EQUAL(0, gatt_client_is_ready(gatt_client_handle));
+		CHECK_EQUAL(num_requests - 1, gatt_client_requests_in_use());
+	}
+};
+
+TEST(GATTClientRequestQueue, RequestsCompleteInOrder){
+	start_requests(NUM_QUEUE_TEST_REQUESTS);
+	CHECK_EQUAL(0, queue_complete_count);
+
+	mock_release_responses(0);
+	CHECK_EQUAL(NUM_QUEUE_TEST_REQUESTS, queue_complete_count);
+	CHECK_EQUAL(NUM_QUEUE_TEST_REQUESTS, queue_value_count);
+	for (int i = 0; i < NUM_QUEUE_TEST_REQUESTS; i++){
+		CHECK_EQUAL(i, queue_complete_order[i]);
+		CHECK_EQUAL(0, queue_complete_status[i]);
+	}
+	CHECK_EQUAL(0, gatt_client_requests_in_use());
+	CHECK_EQUAL(1, gatt_client_is_ready(gatt_client_handle));
+}
+
+TEST(GATTClientRequestQueue, RequestRejectedIfPoolIsFull){
+	start_requests(NUM_QUEUE_TEST_REQUESTS);
+
+	uint8_t status = gatt_client_read_value_of_characteristic(handle_ble_client_event, gatt_client_handle, &characteristics[0]);
+	CHECK_EQUAL(BTSTACK_MEMORY_ALLOC_FAILED, status);
+	CHECK_EQUAL(MAX_NR_GATT_CLIENT_REQUESTS, gatt_client_requests_in_use());
+
+	// queued requests are not affected
+	mock_release_responses(0);
+	CHECK_EQUAL(NUM_QUEUE_TEST_REQUESTS, queue_complete_count);
+	CHECK_EQUAL(NUM_QUEUE_TEST_REQUESTS - 1, queue_complete_order[NUM_QUEUE_TEST_REQUESTS - 1]);
+	CHECK_EQUAL(0, gatt_client_requests_in_use());
+}
+
+TEST(GATTClientRequestQueue, DisconnectCompletesQueuedRequests){
+	start_requests(NUM_QUEUE_TEST_REQUESTS);
+
+	mock_simulate_disconnected();
+	CHECK_EQUAL(NUM_QUEUE_TEST_REQUESTS, queue_complete_count);
+	CHECK_EQUAL(0, queue_value_count);
+	for (int i = 0; i < NUM_QUEUE_TEST_REQUESTS; i++){
+		CHECK_EQUAL(i, queue_complete_order[i]);
+		CHECK_EQUAL(ATT_ERROR_HCI_DISCONNECT_RECEIVED, queue_complete_status[i]);
+	}
+	CHECK_EQUAL(0, gatt_client_requests_in_use());
+}
+
+TEST(GATTClientRequestQueue, TimeoutCompletesQueuedRequests){
+	start_requests(NUM_QUEUE_TEST_REQUESTS);
+
+	mock_simulate_timeout();
+	CHECK_EQUAL(NUM_QUEUE_TEST_REQUESTS, queue_complete_count);
+	CHECK_EQUAL(0, queue_value_count);
+	for (int i = 0; i < NUM_QUEUE_TEST_REQUESTS; i++){
+		CHECK_EQUAL(i, queue_complete_order[i]);
+		CHECK_EQUAL(ATT_ERROR_TIMEOUT, queue_complete_status[i]);
+	}
+	CHECK_EQUAL(0, gatt_client_requests_in_use());
+	CHECK_EQUAL(1, gatt_client_is_ready(gatt_client_handle));
+}
+
+#endif
 
 int main (int argc, const char * argv[]){
+	btstack_memory_init();
 	att_set_db(profile_data);
 	att_set_write_callback(&att_write_callback);
 	att_set_read_callback(&att_read_callback);
@@ -19,6 +19,13 @@ static const uint16_t max_mtu = 23;
 static uint8_t  l2cap_stack_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + 8 + max_mtu];	// pre buffer + HCI Header + L2CAP header
 uint16_t gatt_client_handle = 0x40;
 
+// requests are answered right away unless held
+static int      hold_responses;
+static uint8_t  held_request[HCI_INCOMING_PRE_BUFFER_SIZE + 8 + max_mtu];
+static uint16_t held_request_len;
+
+static btstack_timer_source_t * active_timer;
+
 uint16_t get_gatt_client_handle(void){
 	return gatt_client_handle;
 }
@@ -38,6 +45,18 @@ void mock_simulate_connected(void){
 	registered_hci_event_handler(HCI_EVENT_PACKET, 0, (uint8_t *)&packet, sizeof(packet));
 }
 
+void mock_simulate_disconnected(void){
+	uint8_t packet[] = {HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0x00, (uint8_t) (gatt_client_handle & 0xff), (uint8_t) (gatt_client_handle >> 8), 0x13};
+	registered_hci_event_handler(HCI_EVENT_PACKET, 0, (uint8_t *)&packet, sizeof(packet));
+}
+
+void mock_simulate_timeout(void){
+	btstack_timer_source_t * timer = active_timer;
+	if (!timer) return;
+	active_timer = NULL;
+	(*timer->process)(timer);
+}
+
 void mock_simulate_scan_response(void){
 	uint8_t packet[] = {0xE2, 0x13, 0xE2, 0x01, 0x34, 0xB1, 0xF7, 0xD1, 0x77, 0x9B, 0xCC, 0x09, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
 	registered_hci_event_handler(HCI_EVENT_PACKET, 0, (uint8_t *)&packet, sizeof(packet));
@@ -61,6 +80,30 @@ static void att_init_connection(att_connection_t * att_connection){
 	att_connection->authorized = 0;
 }
 
+void mock_hold_responses(void){
+	hold_responses = 1;
+	held_request_len = 0;
+}
+
+static void respond_to_request(uint8_t * request, uint16_t len){
+	att_connection_t att_connection;
+	att_init_connection(&att_connection);
+	uint8_t response[max_mtu];
+	uint16_t response_len = att_handle_request(&att_connection, request, len, &response[0]);
+	if (response_len){
+		att_packet_handler(ATT_DATA_PACKET, gatt_client_handle, &response[0], response_len);
+	}
+}
+
+// stop holding responses and answer the last held request, if any
+void mock_release_responses(int drop_held_request){
+	hold_responses = 0;
+	uint16_t len = held_request_len;
+	held_request_len = 0;
+	if (!len || drop_held_request) return;
+	respond_to_request(held_request, len);
+}
+
 int hci_can_send_acl_le_packet_now(void){
 	return 1;
 }
@@ -108,13 +151,12 @@ void l2cap_request_can_send_fix_channel_now_event(uint16_t handle, uint16_t chan
 }
 
 int l2cap_send_prepared_connectionless(uint16_t handle, uint16_t cid, uint16_t len){
-	att_connection_t att_connection;
-	att_init_connection(&att_connection);
-	uint8_t response[max_mtu];
-	uint16_t response_len = att_handle_request(&att_connection, l2cap_get_outgoing_buffer(), len, &response[0]);
-	if (response_len){
-		att_packet_handler(ATT_DATA_PACKET, gatt_client_handle, &response[0], response_len);
+	if (hold_responses){
+		memcpy(held_request, l2cap_get_outgoing_buffer(), len);
+		held_request_len = len;
+		return 0;
 	}
+	respond_to_request(l2cap_get_outgoing_buffer(), len);
 	return 0;
 }
 
@@ -133,13 +175,18 @@ void btstack_run_loop_set_timer(btstack_timer_source_t *a, uint32_t timeout_in_m
 
 // Set callback that will be executed when timer expires.
 void btstack_run_loop_set_timer_handler(btstack_timer_source_t *ts, void (*process)(btstack_timer_source_t *_ts)){
+	ts->process = process;
 }
 
 // Add/Remove timer source.
 void btstack_run_loop_add_timer(btstack_timer_source_t *timer){
+	active_timer = timer;
 }
 
 int  btstack_run_loop_remove_timer(btstack_timer_source_t *timer){
+	if (active_timer == timer){
+		active_timer = NULL;
+	}
 	return 1;
 }
 
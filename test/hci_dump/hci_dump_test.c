@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "hci.h"
+#include "hci_dump.h"
+
+#define LOG_FILE     "hci_dump_test.log"
+#define PACKET_LEN   10
+#define RECORD_LEN   (13 + PACKET_LEN)
+
+static uint8_t packet[PACKET_LEN];
+
+static void remove_log_files(void){
+    char name[40];
+    int i;
+    unlink(LOG_FILE);
+    for (i = 1; i < 5; i++){
+        snprintf(name, sizeof(name), "%s.%u", LOG_FILE, i);
+        unlink(name);
+    }
+}
+
+// returns -1 if file does not exist
+static int file_size(const char * name){
+    struct stat file_stat;
+    if (stat(name, &file_stat) < 0) return -1;
+    return (int) file_stat.st_size;
+}
+
+static int read_file(const char * name, uint8_t * buffer, int buffer_size){
+    FILE * file = fopen(name, "rb");
+    if (!file) return -1;
+    int len = (int) fread(buffer, 1, buffer_size, file);
+    fclose(file);
+    return len;
+}
+
+static void dump_packet(uint8_t value){
+    memset(packet, value, sizeof(packet));
+    hci_dump_packet(HCI_EVENT_PACKET, 1, packet, sizeof(packet));
+}
+
+TEST_GROUP(HciDump){
+    void setup(void){
+        remove_log_files();
+        hci_dump_set_max_packets(-1);
+        hci_dump_set_max_file_size(0, 0);
+        hci_dump_open(LOG_FILE, HCI_DUMP_BLUEZ);
+    }
+    void teardown(void){
+        remove_log_files();
+    }
+};
+
+TEST(HciDump, WriteRecords){
+    int i;
+    for (i = 0; i < 5; i++){
+        dump_packet(i);
+    }
+    hci_dump_close();
+    CHECK_EQUAL(5 * RECORD_LEN, file_size(LOG_FILE));
+    CHECK_EQUAL(0, hci_dump_get_dropped_records());
+}
+
+TEST(HciDump, MaxPackets){
+    hci_dump_set_max_packets(3);
+    int i;
+    for (i = 0; i < 5; i++){
+        dump_packet(i);
+    }
+    hci_dump_close();
+
+    // file truncated before 4th packet
+    uint8_t buffer[3 * RECORD_LEN];
+    CHECK_EQUAL(2 * RECORD_LEN, read_file(LOG_FILE, buffer, sizeof(buffer)));
+    CHECK_EQUAL(3, buffer[13]);
+    CHECK_EQUAL(4, buffer[RECORD_LEN + 13]);
+}
+
+TEST(HciDump, RotateFiles){
+    hci_dump_set_max_file_size(2 * RECORD_LEN, 3);
+    int i;
+    for (i = 0; i < 10; i++){
+        dump_packet(i);
+    }
+    hci_dump_close();
+
+    // records are not split and oldest file is overwritten
+    CHECK_EQUAL(0, file_size(LOG_FILE) % RECORD_LEN);
+    CHECK_TRUE(file_size(LOG_FILE ".1") >= 2 * RECORD_LEN);
+    CHECK_EQUAL(0, file_size(LOG_FILE ".1") % RECORD_LEN);
+    CHECK_EQUAL(-1, file_size(LOG_FILE ".3"));
+#ifndef ENABLE_HCI_DUMP_ASYNC
+    // rotate after every second record
+    CHECK_EQUAL(0, file_size(LOG_FILE));
+    CHECK_EQUAL(2 * RECORD_LEN, file_size(LOG_FILE ".1"));
+    CHECK_EQUAL(2 * RECORD_LEN, file_size(LOG_FILE ".2"));
+#endif
+}
+
+#ifdef ENABLE_HCI_DUMP_ASYNC
+TEST(HciDump, DroppedRecords){
+    // record larger than buffer is dropped
+    uint8_t large_packet[300];
+    memset(large_packet, 0, sizeof(large_packet));
+    hci_dump_packet(HCI_EVENT_PACKET, 1, large_packet, sizeof(large_packet));
+    CHECK_EQUAL(1, hci_dump_get_dropped_records());
+
+    // note is added before next record
+    dump_packet(1);
+    hci_dump_close();
+    CHECK_EQUAL(1, hci_dump_get_dropped_records());
+
+    const char * note = "hci_dump: 1 records dropped";
+    uint8_t buffer[200];
+    int len = read_file(LOG_FILE, buffer, sizeof(buffer));
+    CHECK_EQUAL(13 + (int) strlen(note) + RECORD_LEN, len);
+    CHECK_EQUAL(LOG_MESSAGE_PACKET, buffer[12]);
+    CHECK_EQUAL(0, memcmp(note, &buffer[13], strlen(note)));
+    CHECK_EQUAL(1, buffer[len - 1]);
+}
+#endif
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
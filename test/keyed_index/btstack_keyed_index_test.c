@@ -0,0 +1,70 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_keyed_index.h"
+
+#define INDEX_SIZE 8
+// one entry is always kept free
+#define INDEX_CAPACITY (INDEX_SIZE - 1)
+
+static btstack_keyed_index_entry_t entries[INDEX_SIZE];
+static btstack_keyed_index_t keyed_index;
+static int values[INDEX_SIZE];
+
+TEST_GROUP(KeyedIndex){
+    void setup(void){
+        btstack_keyed_index_init(&keyed_index, entries, INDEX_SIZE);
+    }
+};
+
+TEST(KeyedIndex, Empty){
+    POINTERS_EQUAL(NULL, btstack_keyed_index_get(&keyed_index, 0x40));
+    CHECK_EQUAL(1, btstack_keyed_index_is_complete(&keyed_index));
+}
+
+TEST(KeyedIndex, AddGet){
+    int i;
+    for (i = 0; i < INDEX_CAPACITY; i++){
+        CHECK_EQUAL(0, btstack_keyed_index_add(&keyed_index, 0x40 + i, &values[i]));
+    }
+    for (i = 0; i < INDEX_CAPACITY; i++){
+        POINTERS_EQUAL(&values[i], btstack_keyed_index_get(&keyed_index, 0x40 + i));
+    }
+    POINTERS_EQUAL(NULL, btstack_keyed_index_get(&keyed_index, 0x40 + INDEX_CAPACITY));
+}
+
+TEST(KeyedIndex, Overflow){
+    int i;
+    for (i = 0; i < INDEX_CAPACITY; i++){
+        btstack_keyed_index_add(&keyed_index, 0x40 + i, &values[i]);
+    }
+    CHECK_EQUAL(-1, btstack_keyed_index_add(&keyed_index, 0x40 + INDEX_CAPACITY, &values[INDEX_CAPACITY]));
+    CHECK_EQUAL(0, btstack_keyed_index_is_complete(&keyed_index));
+    btstack_keyed_index_clear(&keyed_index);
+    CHECK_EQUAL(1, btstack_keyed_index_is_complete(&keyed_index));
+    POINTERS_EQUAL(NULL, btstack_keyed_index_get(&keyed_index, 0x40));
+}
+
+TEST(KeyedIndex, RemoveFromFullIndex){
+    // in a full index, most keys are not stored at their home position
+    int i;
+    for (i = 0; i < INDEX_CAPACITY; i++){
+        btstack_keyed_index_add(&keyed_index, 0x40 + i, &values[i]);
+    }
+    for (i = 0; i < INDEX_CAPACITY; i += 2){
+        CHECK_EQUAL(0, btstack_keyed_index_remove(&keyed_index, 0x40 + i, &values[i]));
+        CHECK_EQUAL(-1, btstack_keyed_index_remove(&keyed_index, 0x40 + i, &values[i]));
+    }
+    for (i = 0; i < INDEX_CAPACITY; i++){
+        POINTERS_EQUAL((i & 1) ? &values[i] : NULL, btstack_keyed_index_get(&keyed_index, 0x40 + i));
+    }
+}
+
+TEST(KeyedIndex, RemoveChecksValue){
+    btstack_keyed_index_add(&keyed_index, 0x40, &values[0]);
+    CHECK_EQUAL(-1, btstack_keyed_index_remove(&keyed_index, 0x40, &values[1]));
+    POINTERS_EQUAL(&values[0], btstack_keyed_index_get(&keyed_index, 0x40));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,393 @@
+
+// *****************************************************************************
+//
+// test L2CAP Enhanced Retransmission Mode: SREJ, Extended Window Size, extended control field
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_crc.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "l2cap.h"
+#include "l2cap_signaling.h"
+#include "mock.h"
+
+#define TEST_CON_HANDLE  0x0040
+#define TEST_PSM         0x1001
+#define TEST_REMOTE_CID  0x0070
+#define TEST_REMOTE_MPS  20
+
+#define FEATURE_ERTM                 0x0008
+#define FEATURE_EXTENDED_WINDOW_SIZE 0x0100
+
+static bd_addr_t remote_addr = { 0x00, 0x1b, 0xdc, 0x07, 0x32, 0xef };
+
+static uint8_t  ertm_buffer[10000];
+static uint16_t local_cid;
+static int      channel_opened;
+static uint8_t  channel_opened_status;
+
+static uint8_t  received_data[10];
+static int      num_received_data;
+
+static uint8_t  config_request[100];
+static uint16_t config_request_len;
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    switch (packet_type){
+        case L2CAP_DATA_PACKET:
+            // every test SDU consists of a single byte
+            CHECK_EQUAL(1, size);
+            received_data[num_received_data++] = packet[0];
+            break;
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) == L2CAP_EVENT_CHANNEL_OPENED){
+                channel_opened = 1;
+                channel_opened_status = l2cap_event_channel_opened_get_status(packet);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void send_l2cap_packet(uint16_t cid, const uint8_t * payload, uint16_t payload_len, int add_fcs){
+    uint8_t packet[100];
+    uint16_t l2cap_len = payload_len + (add_fcs ? 2 : 0);
+    little_endian_store_16(packet, 0, TEST_CON_HANDLE | 0x2000);
+    little_endian_store_16(packet, 2, 4 + l2cap_len);
+    little_endian_store_16(packet, 4, l2cap_len);
+    little_endian_store_16(packet, 6, cid);
+    memcpy(&packet[8], payload, payload_len);
+    if (add_fcs){
+        little_endian_store_16(packet, 8 + payload_len, btstack_crc16_calc(&packet[4], 4 + payload_len));
+    }
+    mock_simulate_acl_packet(packet, 8 + l2cap_len);
+}
+
+static void send_signaling_packet(uint8_t code, uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint8_t command[60];
+    command[0] = code;
+    command[1] = sig_id;
+    little_endian_store_16(command, 2, len);
+    memcpy(&command[4], data, len);
+    send_l2cap_packet(L2CAP_CID_SIGNALING, command, 4 + len, 0);
+}
+
+static void send_i_frame(int extended_control, uint16_t tx_seq, uint16_t req_seq, uint8_t data){
+    uint8_t payload[5];
+    uint16_t pos;
+    if (extended_control){
+        little_endian_store_32(payload, 0, (((uint32_t) tx_seq) << 18) | (((uint32_t) req_seq) << 2));
+        pos = 4;
+    } else {
+        little_endian_store_16(payload, 0, (req_seq << 8) | (tx_seq << 1));
+        pos = 2;
+    }
+    payload[pos++] = data;
+    send_l2cap_packet(local_cid, payload, pos, 1);
+}
+
+static void send_s_frame(l2cap_supervisory_function_t function, int poll, uint16_t req_seq){
+    uint8_t payload[2];
+    little_endian_store_16(payload, 0, (req_seq << 8) | (poll << 4) | (((int) function) << 2) | 1);
+    send_l2cap_packet(local_cid, payload, 2, 1);
+}
+
+// @returns position of config option in config request or 0 if not found
+static uint16_t find_config_option(uint8_t option_type){
+    uint16_t pos = 12;
+    while (pos < config_request_len){
+        if ((config_request[pos] & 0x7f) == option_type) return pos;
+        pos += 2 + config_request[pos+1];
+    }
+    return 0;
+}
+
+static uint8_t * last_sent_packet(uint16_t * size){
+    CHECK(mock_num_sent_packets() > 0);
+    return mock_get_sent_packet(mock_num_sent_packets() - 1, size);
+}
+
+static void open_channel(uint16_t extended_feature_mask, uint16_t num_rx_buffers, uint16_t remote_extended_window_size){
+    l2cap_ertm_config_t ertm_config = {
+        1,      // ertm mandatory
+        2,      // max transmit
+        2000,   // retransmission timeout ms
+        12000,  // monitor timeout ms
+        48,     // local mtu
+        4,      // num tx buffers
+        num_rx_buffers,
+    };
+
+    mock_simulate_connection(remote_addr, TEST_CON_HANDLE, extended_feature_mask);
+
+    uint8_t status = l2cap_create_ertm_channel(&packet_handler, remote_addr, TEST_PSM, &ertm_config, ertm_buffer, sizeof(ertm_buffer), &local_cid);
+    CHECK_EQUAL(0, status);
+
+    // connection request sent -> accept
+    uint16_t size;
+    uint8_t * packet = last_sent_packet(&size);
+    CHECK_EQUAL(CONNECTION_REQUEST, packet[8]);
+    uint8_t connection_response[8];
+    little_endian_store_16(connection_response, 0, TEST_REMOTE_CID);
+    little_endian_store_16(connection_response, 2, local_cid);
+    little_endian_store_16(connection_response, 4, 0);
+    little_endian_store_16(connection_response, 6, 0);
+    send_signaling_packet(CONNECTION_RESPONSE, packet[9], connection_response, sizeof(connection_response));
+
+    // store configure request
+    packet = last_sent_packet(&size);
+    CHECK_EQUAL(CONFIGURE_REQUEST, packet[8]);
+    memcpy(config_request, packet, size);
+    config_request_len = size;
+
+    // remote configure request with Retransmission and Flow Control option and optional Extended Window Size option
+    uint8_t remote_config_request[19];
+    uint16_t pos = 0;
+    little_endian_store_16(remote_config_request, pos, local_cid);
+    pos += 2;
+    little_endian_store_16(remote_config_request, pos, 0);
+    pos += 2;
+    remote_config_request[pos++] = L2CAP_CONFIG_OPTION_TYPE_RETRANSMISSION_AND_FLOW_CONTROL;
+    remote_config_request[pos++] = 9;
+    remote_config_request[pos++] = L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION;
+    remote_config_request[pos++] = 10;  // tx window
+    remote_config_request[pos++] = 3;   // max transmit
+    little_endian_store_16(remote_config_request, pos, 2000);
+    pos += 2;
+    little_endian_store_16(remote_config_request, pos, 12000);
+    pos += 2;
+    little_endian_store_16(remote_config_request, pos, TEST_REMOTE_MPS);
+    pos += 2;
+    if (remote_extended_window_size){
+        remote_config_request[pos++] = L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE;
+        remote_config_request[pos++] = 2;
+        little_endian_store_16(remote_config_request, pos, remote_extended_window_size);
+        pos += 2;
+    }
+    send_signaling_packet(CONFIGURE_REQUEST, 0x20, remote_config_request, pos);
+    packet = last_sent_packet(&size);
+    CHECK_EQUAL(CONFIGURE_RESPONSE, packet[8]);
+
+    // accept our configure request
+    uint8_t config_response[6];
+    little_endian_store_16(config_response, 0, local_cid);
+    little_endian_store_16(config_response, 2, 0);
+    little_endian_store_16(config_response, 4, 0);
+    send_signaling_packet(CONFIGURE_RESPONSE, config_request[9], config_response, sizeof(config_response));
+
+    CHECK_EQUAL(1, channel_opened);
+    CHECK_EQUAL(0, channel_opened_status);
+    mock_clear_sent_packets();
+}
+
+// verify S-Frame with 16-bit control field
+static void check_s_frame(uint8_t * packet, uint16_t size, l2cap_supervisory_function_t function, uint16_t req_seq){
+    CHECK_EQUAL(12, size);
+    CHECK_EQUAL(TEST_REMOTE_CID, little_endian_read_16(packet, 6));
+    uint16_t control = little_endian_read_16(packet, 8);
+    CHECK_EQUAL(1, control & 1);
+    CHECK_EQUAL((int) function, (control >> 2) & 0x03);
+    CHECK_EQUAL(req_seq, (control >> 8) & 0x3f);
+}
+
+// verify S-Frame with 32-bit extended control field
+static void check_extended_s_frame(uint8_t * packet, uint16_t size, l2cap_supervisory_function_t function, uint16_t req_seq){
+    CHECK_EQUAL(14, size);
+    CHECK_EQUAL(TEST_REMOTE_CID, little_endian_read_16(packet, 6));
+    uint32_t control = little_endian_read_32(packet, 8);
+    CHECK_EQUAL(1, control & 1);
+    CHECK_EQUAL((int) function, (control >> 16) & 0x03);
+    CHECK_EQUAL(req_seq, (control >> 2) & 0x3fff);
+}
+
+TEST_GROUP(L2CAP_ERTM){
+    void setup(void){
+        mock_init();
+        btstack_memory_init();
+        l2cap_init();
+        local_cid = 0;
+        channel_opened = 0;
+        num_received_data = 0;
+        config_request_len = 0;
+    }
+};
+
+TEST(L2CAP_ERTM, StandardWindowWithoutRemoteSupport){
+    open_channel(FEATURE_ERTM, 70, 0);
+
+    // TxWindow limited to 63, no Extended Window Size option
+    uint16_t pos = find_config_option(L2CAP_CONFIG_OPTION_TYPE_RETRANSMISSION_AND_FLOW_CONTROL);
+    CHECK(pos > 0);
+    CHECK_EQUAL(63, config_request[pos+3]);
+    CHECK_EQUAL(0, find_config_option(L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE));
+
+    // 16-bit control field
+    send_i_frame(0, 0, 0, 0x10);
+    CHECK_EQUAL(1, num_received_data);
+    uint16_t size;
+    uint8_t * packet = last_sent_packet(&size);
+    check_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1);
+}
+
+TEST(L2CAP_ERTM, ExtendedWindowSizeOption){
+    open_channel(FEATURE_ERTM | FEATURE_EXTENDED_WINDOW_SIZE, 70, 0);
+
+    uint16_t pos = find_config_option(L2CAP_CONFIG_OPTION_TYPE_RETRANSMISSION_AND_FLOW_CONTROL);
+    CHECK(pos > 0);
+    CHECK_EQUAL(63, config_request[pos+3]);
+    pos = find_config_option(L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE);
+    CHECK(pos > 0);
+    CHECK_EQUAL(2, config_request[pos+1]);
+    CHECK_EQUAL(70, little_endian_read_16(config_request, pos+2));
+}
+
+TEST(L2CAP_ERTM, ExtendedControlField){
+    open_channel(FEATURE_ERTM | FEATURE_EXTENDED_WINDOW_SIZE, 70, 0);
+
+    // 14-bit sequence numbers: frames beyond 63 are still inside the window
+    send_i_frame(1, 0, 0, 0x10);
+    CHECK_EQUAL(1, num_received_data);
+    CHECK_EQUAL(0x10, received_data[0]);
+    uint16_t size;
+    uint8_t * packet = last_sent_packet(&size);
+    check_extended_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1);
+
+    send_i_frame(1, 65, 0, 0x11);
+    CHECK_EQUAL(1, num_received_data);
+    packet = last_sent_packet(&size);
+    check_extended_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 1);
+}
+
+TEST(L2CAP_ERTM, ExtendedControlFieldRequestedByRemote){
+    // remote sends Extended Window Size option for small local window
+    open_channel(FEATURE_ERTM | FEATURE_EXTENDED_WINDOW_SIZE, 10, 100);
+    CHECK_EQUAL(0, find_config_option(L2CAP_CONFIG_OPTION_TYPE_EXTENDED_WINDOW_SIZE));
+
+    send_i_frame(1, 0, 0, 0x10);
+    CHECK_EQUAL(1, num_received_data);
+    uint16_t size;
+    uint8_t * packet = last_sent_packet(&size);
+    check_extended_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1);
+
+    // outgoing I-Frame uses extended control field as well
+    mock_clear_sent_packets();
+    uint8_t data = 0x20;
+    CHECK_EQUAL(0, l2cap_send(local_cid, &data, 1));
+    packet = last_sent_packet(&size);
+    CHECK_EQUAL(15, size);
+    uint32_t control = little_endian_read_32(packet, 8);
+    CHECK_EQUAL(0, control & 1);
+    CHECK_EQUAL(0, (control >> 18) & 0x3fff);   // tx_seq
+    CHECK_EQUAL(1, (control >> 2) & 0x3fff);    // req_seq
+    CHECK_EQUAL(data, packet[12]);
+}
+
+TEST(L2CAP_ERTM, SelectiveRejectForMissingFrame){
+    open_channel(FEATURE_ERTM, 10, 0);
+    uint16_t size;
+    uint8_t * packet;
+
+    send_i_frame(0, 0, 0, 0x10);
+    CHECK_EQUAL(1, num_received_data);
+
+    // frame 1 missing -> SREJ 1
+    mock_clear_sent_packets();
+    send_i_frame(0, 2, 0, 0x12);
+    CHECK_EQUAL(1, num_received_data);
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    packet = last_sent_packet(&size);
+    check_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 1);
+
+    // frame 1 already requested -> no further SREJ
+    mock_clear_sent_packets();
+    send_i_frame(0, 3, 0, 0x13);
+    mock_simulate_packet_sent();
+    CHECK_EQUAL(1, num_received_data);
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    // duplicate of stored frame is ignored
+    send_i_frame(0, 2, 0, 0x12);
+    CHECK_EQUAL(1, num_received_data);
+
+    // retransmitted frame 1 -> stored frames get delivered in order
+    send_i_frame(0, 1, 0, 0x11);
+    CHECK_EQUAL(4, num_received_data);
+    CHECK_EQUAL(0x10, received_data[0]);
+    CHECK_EQUAL(0x11, received_data[1]);
+    CHECK_EQUAL(0x12, received_data[2]);
+    CHECK_EQUAL(0x13, received_data[3]);
+    packet = last_sent_packet(&size);
+    check_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 4);
+}
+
+TEST(L2CAP_ERTM, SelectiveRejectPerMissingFrame){
+    open_channel(FEATURE_ERTM, 10, 0);
+    uint16_t size;
+    uint8_t * packet;
+
+    // frames 0, 1, 2 missing
+    send_i_frame(0, 3, 0, 0x13);
+    mock_simulate_packet_sent();
+    mock_simulate_packet_sent();
+    mock_simulate_packet_sent();
+    CHECK_EQUAL(0, num_received_data);
+    CHECK_EQUAL(3, mock_num_sent_packets());
+    int i;
+    for (i=0;i<3;i++){
+        packet = mock_get_sent_packet(i, &size);
+        check_s_frame(packet, size, L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, i);
+    }
+
+    send_i_frame(0, 1, 0, 0x11);
+    send_i_frame(0, 2, 0, 0x12);
+    CHECK_EQUAL(0, num_received_data);
+    send_i_frame(0, 0, 0, 0x10);
+    CHECK_EQUAL(4, num_received_data);
+    for (i=0;i<4;i++){
+        CHECK_EQUAL(0x10 + i, received_data[i]);
+    }
+}
+
+TEST(L2CAP_ERTM, RetransmissionOnSelectiveReject){
+    open_channel(FEATURE_ERTM, 10, 0);
+    uint16_t size;
+    uint8_t * packet;
+
+    uint8_t data[] = { 0x20, 0x21, 0x22 };
+    int i;
+    for (i=0;i<3;i++){
+        CHECK_EQUAL(0, l2cap_send(local_cid, &data[i], 1));
+        mock_simulate_packet_sent();
+    }
+    CHECK_EQUAL(3, mock_num_sent_packets());
+
+    // only the requested frame gets retransmitted
+    mock_clear_sent_packets();
+    send_s_frame(L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT, 0, 1);
+    mock_simulate_packet_sent();
+    CHECK_EQUAL(1, mock_num_sent_packets());
+    packet = last_sent_packet(&size);
+    CHECK_EQUAL(13, size);
+    uint16_t control = little_endian_read_16(packet, 8);
+    CHECK_EQUAL(0, control & 1);
+    CHECK_EQUAL(1, (control >> 1) & 0x3f);   // tx_seq
+    CHECK_EQUAL(0x21, packet[10]);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
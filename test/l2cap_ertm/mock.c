@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// L2CAP ERTM BTstack Mocks - HCI connection, ACL packet capture and timers
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hci.h"
+#include "l2cap.h"
+
+#include "mock.h"
+
+#define MOCK_MAX_PACKETS     20
+#define MOCK_MAX_PACKET_SIZE 1024
+
+static btstack_packet_handler_t registered_hci_event_handler;
+static btstack_packet_handler_t registered_acl_handler;
+
+static btstack_linked_list_t connections;
+static hci_connection_t      mock_connection;
+
+static uint8_t  outgoing_buffer[HCI_INCOMING_PRE_BUFFER_SIZE + MOCK_MAX_PACKET_SIZE];
+static int      outgoing_buffer_reserved;
+
+static uint8_t  sent_packets[MOCK_MAX_PACKETS][MOCK_MAX_PACKET_SIZE];
+static uint16_t sent_packet_sizes[MOCK_MAX_PACKETS];
+static int      num_sent_packets;
+
+void mock_init(void){
+	memset(&mock_connection, 0, sizeof(mock_connection));
+	connections = NULL;
+	num_sent_packets = 0;
+	outgoing_buffer_reserved = 0;
+}
+
+void mock_simulate_connection(bd_addr_t addr, hci_con_handle_t con_handle, uint16_t extended_feature_mask){
+	bd_addr_copy(mock_connection.address, addr);
+	mock_connection.address_type = BD_ADDR_TYPE_CLASSIC;
+	mock_connection.con_handle = con_handle;
+	mock_connection.bonding_flags = BONDING_RECEIVED_REMOTE_FEATURES;
+	mock_connection.l2cap_state.information_state = L2CAP_INFORMATION_STATE_DONE;
+	mock_connection.l2cap_state.extended_feature_mask = extended_feature_mask;
+	btstack_linked_list_add(&connections, (btstack_linked_item_t *) &mock_connection);
+}
+
+void mock_simulate_acl_packet(uint8_t * packet, uint16_t size){
+	registered_acl_handler(HCI_ACL_DATA_PACKET, 0, packet, size);
+}
+
+void mock_simulate_packet_sent(void){
+	uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
+	registered_hci_event_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+int mock_num_sent_packets(void){
+	return num_sent_packets;
+}
+
+uint8_t * mock_get_sent_packet(int index, uint16_t * size){
+	*size = sent_packet_sizes[index];
+	return sent_packets[index];
+}
+
+void mock_clear_sent_packets(void){
+	num_sent_packets = 0;
+}
+
+// HCI
+
+void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+	registered_hci_event_handler = callback_handler->callback;
+}
+
+void hci_register_acl_packet_handler(btstack_packet_handler_t handler){
+	registered_acl_handler = handler;
+}
+
+void hci_register_acl_recombination_sink_provider(hci_acl_recombination_sink_provider_t provider){
+	UNUSED(provider);
+}
+
+void hci_acl_recombination_sink_release(hci_con_handle_t con_handle, uint8_t * buffer){
+	UNUSED(con_handle);
+	UNUSED(buffer);
+}
+
+hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
+	btstack_linked_list_iterator_t it;
+	btstack_linked_list_iterator_init(&it, &connections);
+	while (btstack_linked_list_iterator_has_next(&it)){
+		hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+		if (connection->con_handle == con_handle) return connection;
+	}
+	return NULL;
+}
+
+hci_connection_t * hci_connection_for_bd_addr_and_type(bd_addr_t addr, bd_addr_type_t addr_type){
+	btstack_linked_list_iterator_t it;
+	btstack_linked_list_iterator_init(&it, &connections);
+	while (btstack_linked_list_iterator_has_next(&it)){
+		hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+		if (connection->address_type != addr_type) continue;
+		if (bd_addr_cmp(connection->address, addr) != 0) continue;
+		return connection;
+	}
+	return NULL;
+}
+
+void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
+	btstack_linked_list_iterator_init(it, &connections);
+}
+
+hci_acl_scheduler_t hci_get_acl_scheduler(void){
+	return HCI_ACL_SCHEDULER_FIFO;
+}
+
+hci_connection_t * hci_acl_scheduler_select(int (*is_ready)(hci_connection_t * connection, void * context), void * context){
+	UNUSED(is_ready);
+	UNUSED(context);
+	return NULL;
+}
+
+int hci_can_send_command_packet_now(void){
+	return 1;
+}
+
+int hci_send_cmd(const hci_cmd_t *cmd, ...){
+	UNUSED(cmd);
+	return 0;
+}
+
+int hci_can_send_acl_packet_now(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+	return !outgoing_buffer_reserved;
+}
+
+int hci_can_send_prepared_acl_packet_now(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+	return 1;
+}
+
+int hci_can_send_acl_classic_packet_now(void){
+	return !outgoing_buffer_reserved;
+}
+
+int hci_can_send_acl_le_packet_now(void){
+	return !outgoing_buffer_reserved;
+}
+
+uint8_t * hci_get_outgoing_packet_buffer(void){
+	return &outgoing_buffer[HCI_INCOMING_PRE_BUFFER_SIZE];
+}
+
+int hci_reserve_packet_buffer(void){
+	outgoing_buffer_reserved = 1;
+	return 1;
+}
+
+void hci_release_packet_buffer(void){
+	outgoing_buffer_reserved = 0;
+}
+
+int hci_is_packet_buffer_reserved(void){
+	return outgoing_buffer_reserved;
+}
+
+int hci_send_acl_packet_buffer(int size){
+	if (num_sent_packets < MOCK_MAX_PACKETS){
+		memcpy(sent_packets[num_sent_packets], hci_get_outgoing_packet_buffer(), size);
+		sent_packet_sizes[num_sent_packets] = size;
+		num_sent_packets++;
+	} else {
+		printf("mock: too many sent packets\n");
+	}
+	outgoing_buffer_reserved = 0;
+	return 0;
+}
+
+uint16_t hci_max_acl_data_packet_length(void){
+	return HCI_ACL_PAYLOAD_SIZE;
+}
+
+int hci_non_flushable_packet_boundary_flag_supported(void){
+	return 1;
+}
+
+uint16_t hci_usable_acl_packet_types(void){
+	return 0;
+}
+
+int hci_authentication_active_for_handle(hci_con_handle_t handle){
+	UNUSED(handle);
+	return 0;
+}
+
+void hci_disconnect_security_block(hci_con_handle_t con_handle){
+	UNUSED(con_handle);
+}
+
+// GAP
+
+void gap_connectable_control(uint8_t enable){
+	UNUSED(enable);
+}
+
+void gap_drop_link_key_for_bd_addr(bd_addr_t addr){
+}
+
+void gap_get_connection_parameter_range(le_connection_parameter_range_t * range){
+	memset(range, 0, sizeof(le_connection_parameter_range_t));
+}
+
+gap_connection_type_t gap_get_connection_type(hci_con_handle_t connection_handle){
+	UNUSED(connection_handle);
+	return GAP_CONNECTION_ACL;
+}
+
+void gap_request_security_level(hci_con_handle_t con_handle, gap_security_level_t level){
+	UNUSED(con_handle);
+	UNUSED(level);
+}
+
+int gap_ssp_supported_on_both_sides(hci_con_handle_t handle){
+	UNUSED(handle);
+	return 0;
+}
+
+// Run Loop - timers never fire
+
+void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+	UNUSED(ts);
+	UNUSED(timeout_in_ms);
+}
+
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*process)(btstack_timer_source_t *_ts)){
+	ts->process = process;
+}
+
+void btstack_run_loop_set_timer_context(btstack_timer_source_t * ts, void * context){
+	ts->context = context;
+}
+
+void * btstack_run_loop_get_timer_context(btstack_timer_source_t * ts){
+	return ts->context;
+}
+
+void btstack_run_loop_add_timer(btstack_timer_source_t * timer){
+	UNUSED(timer);
+}
+
+int btstack_run_loop_remove_timer(btstack_timer_source_t * timer){
+	UNUSED(timer);
+	return 1;
+}
@@ -0,0 +1,12 @@
+#include <stdint.h>
+#include "btstack_defines.h"
+#include "bluetooth.h"
+
+void mock_init(void);
+void mock_simulate_connection(bd_addr_t addr, hci_con_handle_t con_handle, uint16_t extended_feature_mask);
+void mock_simulate_acl_packet(uint8_t * packet, uint16_t size);
+void mock_simulate_packet_sent(void);
+
+int       mock_num_sent_packets(void);
+uint8_t * mock_get_sent_packet(int index, uint16_t * size);
+void      mock_clear_sent_packets(void);
@@ -0,0 +1,506 @@
+
+// *****************************************************************************
+//
+// test L2CAP LE Data Channels: queued and scatter-gather SDUs, receive buffer pool
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "l2cap.h"
+#include "l2cap_signaling.h"
+#include "mock.h"
+
+#define TEST_CON_HANDLE  0x0040
+#define TEST_PSM         0x0080
+#define TEST_REMOTE_CID  0x0070
+#define TEST_REMOTE_MTU  100
+#define TEST_REMOTE_MPS  10
+#define TEST_LOCAL_MTU   50
+// local MPS used by BTstack
+#define TEST_LOCAL_MPS   23
+#define TEST_NUM_RECEIVE_BUFFERS 2
+// SDU len + MTU in PDUs of local MPS
+#define TEST_PDUS_PER_SDU 3
+
+static uint8_t  receive_buffer[TEST_LOCAL_MTU];
+static uint8_t  receive_buffer_storage[TEST_NUM_RECEIVE_BUFFERS * TEST_LOCAL_MTU];
+static uint16_t local_cid;
+static uint16_t initial_credits;
+
+static uint8_t  events[20];
+static int      num_events;
+static uint8_t  channel_opened_status;
+
+static uint8_t * received_sdus[L2CAP_LE_MAX_RECEIVE_BUFFERS];
+static uint16_t  received_sdu_lens[L2CAP_LE_MAX_RECEIVE_BUFFERS];
+static int       num_received_sdus;
+
+static uint8_t   statistics_event[24];
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    if (packet_type == L2CAP_DATA_PACKET){
+        CHECK(num_received_sdus < L2CAP_LE_MAX_RECEIVE_BUFFERS);
+        received_sdus[num_received_sdus] = packet;
+        received_sdu_lens[num_received_sdus] = size;
+        num_received_sdus++;
+        return;
+    }
+    if (packet_type != HCI_EVENT_PACKET) return;
+    uint8_t event = hci_event_packet_get_type(packet);
+    switch (event){
+        case L2CAP_EVENT_LE_CHANNEL_OPENED:
+            channel_opened_status = l2cap_event_le_channel_opened_get_status(packet);
+            break;
+        case L2CAP_EVENT_LE_PACKET_SENT:
+            CHECK_EQUAL(local_cid, l2cap_event_le_packet_sent_get_local_cid(packet));
+            break;
+        case L2CAP_EVENT_LE_PACKET_DROPPED:
+            CHECK_EQUAL(local_cid, l2cap_event_le_packet_dropped_get_local_cid(packet));
+            break;
+        case L2CAP_EVENT_LE_CHANNEL_STATISTICS:
+            CHECK_EQUAL(sizeof(statistics_event), size);
+            memcpy(statistics_event, packet, size);
+            break;
+        default:
+            break;
+    }
+    if (num_events < (int) sizeof(events)){
+        events[num_events++] = event;
+    }
+}
+
+static int count_events(uint8_t event){
+    int count = 0;
+    int i;
+    for (i=0;i<num_events;i++){
+        if (events[i] == event) count++;
+    }
+    return count;
+}
+
+static void send_signaling_packet(uint8_t code, uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint8_t packet[40];
+    little_endian_store_16(packet, 0, TEST_CON_HANDLE | 0x2000);
+    little_endian_store_16(packet, 2, 8 + len);
+    little_endian_store_16(packet, 4, 4 + len);
+    little_endian_store_16(packet, 6, L2CAP_CID_SIGNALING_LE);
+    packet[8] = code;
+    packet[9] = sig_id;
+    little_endian_store_16(packet, 10, len);
+    memcpy(&packet[12], data, len);
+    mock_simulate_acl_packet(packet, 12 + len);
+}
+
+static void send_credits(uint16_t credits){
+    uint8_t data[4];
+    little_endian_store_16(data, 0, local_cid);
+    little_endian_store_16(data, 2, credits);
+    send_signaling_packet(LE_FLOW_CONTROL_CREDIT, 0x30, data, sizeof(data));
+}
+
+static void send_disconnection_request(void){
+    uint8_t data[4];
+    little_endian_store_16(data, 0, local_cid);
+    little_endian_store_16(data, 2, TEST_REMOTE_CID);
+    send_signaling_packet(DISCONNECTION_REQUEST, 0x31, data, sizeof(data));
+}
+
+static uint8_t * get_sent_packet(int index, uint16_t * size){
+    CHECK(index < mock_num_sent_packets());
+    return mock_get_sent_packet(index, size);
+}
+
+static void send_pdu(const uint8_t * payload, uint16_t len){
+    uint8_t packet[40];
+    little_endian_store_16(packet, 0, TEST_CON_HANDLE | 0x2000);
+    little_endian_store_16(packet, 2, 4 + len);
+    little_endian_store_16(packet, 4, len);
+    little_endian_store_16(packet, 6, local_cid);
+    memcpy(&packet[8], payload, len);
+    mock_simulate_acl_packet(packet, 8 + len);
+}
+
+// send SDU in PDUs of local MPS
+static void send_sdu(const uint8_t * data, uint16_t len){
+    uint8_t payload[TEST_LOCAL_MPS];
+    little_endian_store_16(payload, 0, len);
+    uint16_t pos = 2;
+    uint16_t data_pos = 0;
+    do {
+        uint16_t bytes = btstack_min(len - data_pos, TEST_LOCAL_MPS - pos);
+        memcpy(&payload[pos], &data[data_pos], bytes);
+        send_pdu(payload, pos + bytes);
+        data_pos += bytes;
+        pos = 0;
+    } while (data_pos < len);
+}
+
+// open outgoing channel with given number of credits for us
+static void open_channel_with_receive_buffer(uint8_t * buffer, uint16_t remote_credits){
+    mock_simulate_le_connection(TEST_CON_HANDLE);
+
+    uint8_t status = l2cap_le_create_channel(&packet_handler, TEST_CON_HANDLE, TEST_PSM, buffer, TEST_LOCAL_MTU,
+        L2CAP_LE_AUTOMATIC_CREDITS, LEVEL_0, &local_cid);
+    CHECK_EQUAL(0, status);
+
+    // without receive buffer, connection request is sent after l2cap_le_set_receive_buffers
+    if (!buffer){
+        CHECK_EQUAL(0, mock_num_sent_packets());
+        CHECK_EQUAL(0, l2cap_le_set_receive_buffers(local_cid, receive_buffer_storage, TEST_LOCAL_MTU, TEST_NUM_RECEIVE_BUFFERS));
+    }
+
+    // connection request sent -> accept
+    uint16_t size;
+    uint8_t * packet = get_sent_packet(mock_num_sent_packets() - 1, &size);
+    CHECK_EQUAL(L2CAP_CID_SIGNALING_LE, little_endian_read_16(packet, 6));
+    CHECK_EQUAL(LE_CREDIT_BASED_CONNECTION_REQUEST, packet[8]);
+    initial_credits = little_endian_read_16(packet, 20);
+    uint8_t response[10];
+    little_endian_store_16(response, 0, TEST_REMOTE_CID);
+    little_endian_store_16(response, 2, TEST_REMOTE_MTU);
+    little_endian_store_16(response, 4, TEST_REMOTE_MPS);
+    little_endian_store_16(response, 6, remote_credits);
+    little_endian_store_16(response, 8, 0);
+    send_signaling_packet(LE_CREDIT_BASED_CONNECTION_RESPONSE, packet[9], response, sizeof(response));
+
+    CHECK_EQUAL(0, channel_opened_status);
+    mock_clear_sent_packets();
+    num_events = 0;
+}
+
+static void open_channel(uint16_t remote_credits){
+    open_channel_with_receive_buffer(receive_buffer, remote_credits);
+}
+
+static void open_channel_with_receive_buffer_pool(void){
+    open_channel_with_receive_buffer(NULL, 0);
+}
+
+// @returns number of credits in last LE Flow Control Credit packet or 0 if none was sent
+static uint16_t get_sent_credits(void){
+    int i;
+    for (i = mock_num_sent_packets() - 1; i >= 0; i--){
+        uint16_t size;
+        uint8_t * packet = mock_get_sent_packet(i, &size);
+        if (little_endian_read_16(packet, 6) != L2CAP_CID_SIGNALING_LE) continue;
+        if (packet[8] != LE_FLOW_CONTROL_CREDIT) continue;
+        CHECK_EQUAL(TEST_REMOTE_CID, little_endian_read_16(packet, 12));
+        return little_endian_read_16(packet, 14);
+    }
+    return 0;
+}
+
+static void request_statistics(void){
+    memset(statistics_event, 0, sizeof(statistics_event));
+    CHECK_EQUAL(0, l2cap_le_request_channel_statistics_event(local_cid));
+    CHECK_EQUAL(L2CAP_EVENT_LE_CHANNEL_STATISTICS, statistics_event[0]);
+}
+
+// verify PDU on LE Data Channel and return its payload
+static uint8_t * check_pdu(int index, uint16_t payload_len){
+    uint16_t size;
+    uint8_t * packet = get_sent_packet(index, &size);
+    CHECK_EQUAL(8 + payload_len, size);
+    CHECK_EQUAL(payload_len, little_endian_read_16(packet, 4));
+    CHECK_EQUAL(TEST_REMOTE_CID, little_endian_read_16(packet, 6));
+    return &packet[8];
+}
+
+static void fill_data(uint8_t * data, uint16_t len, uint8_t start){
+    uint16_t i;
+    for (i=0;i<len;i++){
+        data[i] = start + i;
+    }
+}
+
+TEST_GROUP(L2CAP_LE_DATA_CHANNEL){
+    void setup(void){
+        mock_init();
+        btstack_memory_init();
+        l2cap_init();
+        local_cid = 0;
+        num_events = 0;
+        num_received_sdus = 0;
+        channel_opened_status = 0xff;
+    }
+};
+
+TEST(L2CAP_LE_DATA_CHANNEL, SduSegmentedAcrossCredits){
+    open_channel(2);
+
+    // 2 bytes SDU len + 25 bytes data -> PDUs with 10, 10 and 7 bytes
+    uint8_t data[25];
+    fill_data(data, sizeof(data), 0);
+    l2cap_le_sdu_t sdu;
+    l2cap_le_sdu_init(&sdu, data, sizeof(data));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu));
+
+    // only two credits
+    CHECK_EQUAL(2, mock_num_sent_packets());
+    uint8_t * payload = check_pdu(0, TEST_REMOTE_MPS);
+    CHECK_EQUAL(sizeof(data), little_endian_read_16(payload, 0));
+    MEMCMP_EQUAL(&data[0], &payload[2], 8);
+    payload = check_pdu(1, TEST_REMOTE_MPS);
+    MEMCMP_EQUAL(&data[8], payload, 10);
+    CHECK_EQUAL(0, count_events(L2CAP_EVENT_LE_PACKET_SENT));
+    CHECK_EQUAL(1, sdu.queued);
+
+    // last PDU sent with next credit
+    send_credits(1);
+    CHECK_EQUAL(3, mock_num_sent_packets());
+    payload = check_pdu(2, 7);
+    MEMCMP_EQUAL(&data[18], payload, 7);
+    CHECK_EQUAL(1, count_events(L2CAP_EVENT_LE_PACKET_SENT));
+    CHECK_EQUAL(0, sdu.queued);
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, ScatterGatherSdu){
+    open_channel(10);
+
+    uint8_t data[20];
+    fill_data(data, sizeof(data), 0x40);
+    l2cap_le_sdu_segment_t segments[3];
+    segments[0].data = &data[0];
+    segments[0].len  = 5;
+    segments[1].data = &data[5];
+    segments[1].len  = 0;
+    segments[2].data = &data[5];
+    segments[2].len  = 15;
+    l2cap_le_sdu_t sdu;
+    l2cap_le_sdu_init_scatter_gather(&sdu, segments, 3);
+    CHECK_EQUAL(20, sdu.len);
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu));
+
+    // segments are concatenated across PDU boundaries
+    CHECK_EQUAL(3, mock_num_sent_packets());
+    uint8_t * payload = check_pdu(0, TEST_REMOTE_MPS);
+    CHECK_EQUAL(sizeof(data), little_endian_read_16(payload, 0));
+    MEMCMP_EQUAL(&data[0], &payload[2], 8);
+    payload = check_pdu(1, TEST_REMOTE_MPS);
+    MEMCMP_EQUAL(&data[8], payload, 10);
+    payload = check_pdu(2, 2);
+    MEMCMP_EQUAL(&data[18], payload, 2);
+    CHECK_EQUAL(1, count_events(L2CAP_EVENT_LE_PACKET_SENT));
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, QueuedSdusSentInOrder){
+    open_channel(0);
+
+    uint8_t data_a[4] = { 0xa0, 0xa1, 0xa2, 0xa3 };
+    uint8_t data_b[3] = { 0xb0, 0xb1, 0xb2 };
+    l2cap_le_sdu_t sdu_a;
+    l2cap_le_sdu_t sdu_b;
+    l2cap_le_sdu_init(&sdu_a, data_a, sizeof(data_a));
+    l2cap_le_sdu_init(&sdu_b, data_b, sizeof(data_b));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu_a));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu_b));
+    CHECK_EQUAL(0, mock_num_sent_packets());
+
+    send_credits(2);
+    CHECK_EQUAL(2, mock_num_sent_packets());
+    uint8_t * payload = check_pdu(0, 2 + sizeof(data_a));
+    MEMCMP_EQUAL(data_a, &payload[2], sizeof(data_a));
+    payload = check_pdu(1, 2 + sizeof(data_b));
+    MEMCMP_EQUAL(data_b, &payload[2], sizeof(data_b));
+    CHECK_EQUAL(2, count_events(L2CAP_EVENT_LE_PACKET_SENT));
+
+    // SDU can be queued again after L2CAP_EVENT_LE_PACKET_SENT
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu_a));
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, SduAlreadyQueuedRejected){
+    open_channel(0);
+
+    uint8_t data[4] = { 0 };
+    l2cap_le_sdu_t sdu;
+    l2cap_le_sdu_init(&sdu, data, sizeof(data));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu));
+    CHECK_EQUAL(ERROR_CODE_COMMAND_DISALLOWED, l2cap_le_queue_sdu(local_cid, &sdu));
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, SduExceedingRemoteMtuRejected){
+    open_channel(10);
+
+    uint8_t data[TEST_REMOTE_MTU + 1];
+    memset(data, 0, sizeof(data));
+    l2cap_le_sdu_t sdu;
+    l2cap_le_sdu_init(&sdu, data, sizeof(data));
+    CHECK_EQUAL(L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU, l2cap_le_queue_sdu(local_cid, &sdu));
+
+    // segments that sum up to more than 16 bit are not truncated
+    l2cap_le_sdu_segment_t segments[2];
+    segments[0].data = data;
+    segments[0].len  = 0xffff;
+    segments[1].data = data;
+    segments[1].len  = 1;
+    l2cap_le_sdu_init_scatter_gather(&sdu, segments, 2);
+    CHECK_EQUAL(0x10000, sdu.len);
+    CHECK_EQUAL(L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU, l2cap_le_queue_sdu(local_cid, &sdu));
+
+    CHECK_EQUAL(0, mock_num_sent_packets());
+    CHECK_EQUAL(0, sdu.queued);
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, QueuedSdusDroppedOnDisconnect){
+    open_channel(1);
+
+    // first SDU partially sent
+    uint8_t data[25] = { 0 };
+    l2cap_le_sdu_t sdu_a;
+    l2cap_le_sdu_t sdu_b;
+    l2cap_le_sdu_init(&sdu_a, data, sizeof(data));
+    l2cap_le_sdu_init(&sdu_b, data, sizeof(data));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu_a));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu_b));
+    CHECK_EQUAL(1, mock_num_sent_packets());
+
+    send_disconnection_request();
+    CHECK_EQUAL(2, count_events(L2CAP_EVENT_LE_PACKET_DROPPED));
+    CHECK_EQUAL(0, count_events(L2CAP_EVENT_LE_PACKET_SENT));
+    CHECK_EQUAL(0, sdu_a.queued);
+    CHECK_EQUAL(0, sdu_b.queued);
+    // dropped events before channel closed event
+    CHECK_EQUAL(L2CAP_EVENT_LE_PACKET_DROPPED, events[0]);
+    CHECK_EQUAL(L2CAP_EVENT_LE_PACKET_DROPPED, events[1]);
+    CHECK(num_events > 2);
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, QueuedSdusDroppedOnHciDisconnect){
+    open_channel(0);
+
+    uint8_t data[4] = { 0 };
+    l2cap_le_sdu_t sdu;
+    l2cap_le_sdu_init(&sdu, data, sizeof(data));
+    CHECK_EQUAL(0, l2cap_le_queue_sdu(local_cid, &sdu));
+
+    mock_simulate_disconnection(TEST_CON_HANDLE);
+    CHECK_EQUAL(1, count_events(L2CAP_EVENT_LE_PACKET_DROPPED));
+    CHECK_EQUAL(L2CAP_EVENT_LE_PACKET_DROPPED, events[0]);
+    CHECK_EQUAL(0, sdu.queued);
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, AutomaticCreditsForReceiveBufferPool){
+    open_channel_with_receive_buffer_pool();
+    // remote may send one full SDU per free receive buffer
+    CHECK_EQUAL(TEST_NUM_RECEIVE_BUFFERS * TEST_PDUS_PER_SDU, initial_credits);
+
+    uint8_t data[TEST_LOCAL_MTU];
+    fill_data(data, sizeof(data), 0x10);
+    send_sdu(data, sizeof(data));
+    send_sdu(data, sizeof(data));
+    CHECK_EQUAL(2, num_received_sdus);
+    CHECK_EQUAL(sizeof(data), received_sdu_lens[0]);
+    MEMCMP_EQUAL(data, received_sdus[0], sizeof(data));
+    MEMCMP_EQUAL(data, received_sdus[1], sizeof(data));
+    // each SDU is delivered in its own receive buffer
+    CHECK(received_sdus[0] != received_sdus[1]);
+
+    // all buffers in use, no credits
+    CHECK_EQUAL(0, get_sent_credits());
+    request_statistics();
+    CHECK_EQUAL(0, l2cap_event_le_channel_statistics_get_credits_incoming(statistics_event));
+    CHECK_EQUAL(0, l2cap_event_le_channel_statistics_get_receive_buffers_free(statistics_event));
+
+    // credits for one SDU after buffer was returned
+    CHECK_EQUAL(0, l2cap_le_release_receive_buffer(local_cid, received_sdus[0]));
+    CHECK_EQUAL(TEST_PDUS_PER_SDU, get_sent_credits());
+    mock_clear_sent_packets();
+    CHECK_EQUAL(0, l2cap_le_release_receive_buffer(local_cid, received_sdus[1]));
+    CHECK_EQUAL(TEST_PDUS_PER_SDU, get_sent_credits());
+
+    request_statistics();
+    CHECK_EQUAL(TEST_NUM_RECEIVE_BUFFERS * TEST_PDUS_PER_SDU, l2cap_event_le_channel_statistics_get_credits_incoming(statistics_event));
+    CHECK_EQUAL(TEST_NUM_RECEIVE_BUFFERS, l2cap_event_le_channel_statistics_get_receive_buffers_free(statistics_event));
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, ReceiveBufferPoolExhausted){
+    open_channel_with_receive_buffer_pool();
+
+    // short SDUs use a single credit but a full receive buffer
+    uint8_t data[3] = { 0x01, 0x02, 0x03 };
+    send_sdu(data, sizeof(data));
+    send_sdu(data, sizeof(data));
+    CHECK_EQUAL(2, num_received_sdus);
+
+    // no free buffer -> SDU dropped
+    send_sdu(data, sizeof(data));
+    CHECK_EQUAL(2, num_received_sdus);
+    request_statistics();
+    CHECK_EQUAL(1, l2cap_event_le_channel_statistics_get_incoming_sdus_dropped(statistics_event));
+    CHECK_EQUAL(0, l2cap_event_le_channel_statistics_get_receive_buffers_free(statistics_event));
+
+    // next SDU delivered in returned buffer
+    uint8_t * buffer = received_sdus[0];
+    CHECK_EQUAL(0, l2cap_le_release_receive_buffer(local_cid, buffer));
+    send_sdu(data, sizeof(data));
+    CHECK_EQUAL(3, num_received_sdus);
+    POINTERS_EQUAL(buffer, received_sdus[2]);
+    MEMCMP_EQUAL(data, received_sdus[2], sizeof(data));
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, ReceiveBufferReleasedOnlyOnce){
+    open_channel_with_receive_buffer_pool();
+
+    uint8_t data[3] = { 0x01, 0x02, 0x03 };
+    send_sdu(data, sizeof(data));
+    CHECK_EQUAL(1, num_received_sdus);
+
+    // buffer that was not delivered
+    uint8_t * other_buffer = (received_sdus[0] == receive_buffer_storage) ? &receive_buffer_storage[TEST_LOCAL_MTU] : receive_buffer_storage;
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_le_release_receive_buffer(local_cid, other_buffer));
+    // pointer into buffer
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_le_release_receive_buffer(local_cid, received_sdus[0] + 1));
+
+    CHECK_EQUAL(0, l2cap_le_release_receive_buffer(local_cid, received_sdus[0]));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_le_release_receive_buffer(local_cid, received_sdus[0]));
+
+    // pool not corrupted: both buffers can be used
+    request_statistics();
+    CHECK_EQUAL(TEST_NUM_RECEIVE_BUFFERS, l2cap_event_le_channel_statistics_get_receive_buffers_free(statistics_event));
+    send_sdu(data, sizeof(data));
+    send_sdu(data, sizeof(data));
+    send_sdu(data, sizeof(data));
+    CHECK_EQUAL(3, num_received_sdus);
+    CHECK(received_sdus[1] != received_sdus[2]);
+    request_statistics();
+    CHECK_EQUAL(1, l2cap_event_le_channel_statistics_get_incoming_sdus_dropped(statistics_event));
+}
+
+TEST(L2CAP_LE_DATA_CHANNEL, MaxReceiveBuffers){
+    static uint8_t storage[(L2CAP_LE_MAX_RECEIVE_BUFFERS + 1) * TEST_LOCAL_MTU];
+    open_channel(0);
+
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_le_set_receive_buffers(local_cid, storage, TEST_LOCAL_MTU, L2CAP_LE_MAX_RECEIVE_BUFFERS + 1));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_le_set_receive_buffers(local_cid, storage, TEST_LOCAL_MTU, 0));
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_le_set_receive_buffers(local_cid, storage, TEST_LOCAL_MTU - 1, 1));
+    CHECK_EQUAL(0, l2cap_le_set_receive_buffers(local_cid, storage, TEST_LOCAL_MTU, L2CAP_LE_MAX_RECEIVE_BUFFERS));
+
+    // automatic credits cover all buffers, last buffer can be delivered
+    uint8_t data[3] = { 0x01, 0x02, 0x03 };
+    int i;
+    for (i = 0; i < L2CAP_LE_MAX_RECEIVE_BUFFERS; i++){
+        send_sdu(data, sizeof(data));
+        mock_clear_sent_packets();
+    }
+    CHECK_EQUAL(L2CAP_LE_MAX_RECEIVE_BUFFERS, num_received_sdus);
+    request_statistics();
+    CHECK_EQUAL(0, l2cap_event_le_channel_statistics_get_receive_buffers_free(statistics_event));
+    CHECK_EQUAL(0, l2cap_event_le_channel_statistics_get_incoming_sdus_dropped(statistics_event));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,13 @@
+#include <stdint.h>
+#include "btstack_defines.h"
+#include "bluetooth.h"
+
+void mock_init(void);
+void mock_simulate_le_connection(hci_con_handle_t con_handle);
+void mock_simulate_disconnection(hci_con_handle_t con_handle);
+void mock_simulate_acl_packet(uint8_t * packet, uint16_t size);
+void mock_simulate_packet_sent(void);
+
+int       mock_num_sent_packets(void);
+uint8_t * mock_get_sent_packet(int index, uint16_t * size);
+void      mock_clear_sent_packets(void);
@@ -0,0 +1,70 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_memory_arena.h"
+
+#include <string.h>
+
+static btstack_memory_arena_t * arena;
+
+TEST_GROUP(MemoryArena){
+    void setup(void){
+        arena = btstack_memory_arena_create();
+    }
+};
+
+TEST(MemoryArena, HeapObject){
+    uint8_t * object = (uint8_t *) btstack_memory_arena_alloc(NULL, 100);
+    CHECK(object != NULL);
+    memset(object, 0x55, 100);
+    btstack_memory_arena_free(object);
+    btstack_memory_arena_release(arena);
+}
+
+TEST(MemoryArena, AllocAndRelease){
+    int i;
+    uint8_t * objects[50];
+    for (i = 0; i < 50; i++){
+        objects[i] = (uint8_t *) btstack_memory_arena_alloc(arena, 40 + i);
+        CHECK(objects[i] != NULL);
+        memset(objects[i], i, 40 + i);
+    }
+    for (i = 0; i < 50; i++){
+        CHECK_EQUAL(i, objects[i][39 + i]);
+    }
+    CHECK_EQUAL(50, btstack_memory_arena_get_in_use(arena));
+    for (i = 0; i < 50; i++){
+        btstack_memory_arena_free(objects[i]);
+    }
+    btstack_memory_arena_release(arena);
+}
+
+TEST(MemoryArena, LargeObject){
+    uint8_t * object = (uint8_t *) btstack_memory_arena_alloc(arena, 3 * BTSTACK_MEMORY_ARENA_CHUNK_SIZE);
+    CHECK(object != NULL);
+    memset(object, 0x55, 3 * BTSTACK_MEMORY_ARENA_CHUNK_SIZE);
+    btstack_memory_arena_free(object);
+    btstack_memory_arena_release(arena);
+}
+
+TEST(MemoryArena, ReuseFreedObject){
+    void * object_1 = btstack_memory_arena_alloc(arena, 64);
+    void * object_2 = btstack_memory_arena_alloc(arena, 32);
+    btstack_memory_arena_free(object_1);
+    POINTERS_EQUAL(object_1, btstack_memory_arena_alloc(arena, 64));
+    CHECK_EQUAL(2, btstack_memory_arena_get_in_use(arena));
+    btstack_memory_arena_free(object_1);
+    btstack_memory_arena_free(object_2);
+    btstack_memory_arena_release(arena);
+}
+
+TEST(MemoryArena, ReleaseWithObjectsInUse){
+    uint8_t * object = (uint8_t *) btstack_memory_arena_alloc(arena, 64);
+    btstack_memory_arena_release(arena);
+    // object still valid until freed
+    memset(object, 0x55, 64);
+    btstack_memory_arena_free(object);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
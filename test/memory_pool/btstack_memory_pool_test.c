@@ -0,0 +1,75 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_memory_pool.h"
+
+#define NUM_BLOCKS 4
+
+typedef struct {
+    void *   next;
+    uint32_t data[4];
+} block_t;
+
+static block_t storage[NUM_BLOCKS];
+static btstack_memory_pool_t pool;
+
+TEST_GROUP(MemoryPool){
+    void setup(void){
+        btstack_memory_pool_create(&pool, storage, NUM_BLOCKS, sizeof(block_t));
+    }
+};
+
+TEST(MemoryPool, GetAll){
+    int i;
+    for (i = 0; i < NUM_BLOCKS; i++){
+        CHECK(btstack_memory_pool_get(&pool) != NULL);
+    }
+    POINTERS_EQUAL(NULL, btstack_memory_pool_get(&pool));
+    CHECK_EQUAL(NUM_BLOCKS, btstack_memory_pool_get_count(&pool));
+    CHECK_EQUAL(NUM_BLOCKS, btstack_memory_pool_get_in_use(&pool));
+    CHECK_EQUAL(1, btstack_memory_pool_get_failures(&pool));
+}
+
+TEST(MemoryPool, FreeAndReuse){
+    void * block = btstack_memory_pool_get(&pool);
+    btstack_memory_pool_free(&pool, block);
+    POINTERS_EQUAL(block, btstack_memory_pool_get(&pool));
+}
+
+TEST(MemoryPool, MaxInUse){
+    void * block_1 = btstack_memory_pool_get(&pool);
+    void * block_2 = btstack_memory_pool_get(&pool);
+    btstack_memory_pool_free(&pool, block_1);
+    btstack_memory_pool_free(&pool, block_2);
+    btstack_memory_pool_get(&pool);
+    CHECK_EQUAL(1, btstack_memory_pool_get_in_use(&pool));
+    CHECK_EQUAL(2, btstack_memory_pool_get_max_in_use(&pool));
+}
+
+TEST(MemoryPool, DoubleFree){
+    void * block_1 = btstack_memory_pool_get(&pool);
+    void * block_2 = btstack_memory_pool_get(&pool);
+    btstack_memory_pool_free(&pool, block_1);
+    btstack_memory_pool_free(&pool, block_1);
+    CHECK_EQUAL(1, btstack_memory_pool_get_in_use(&pool));
+    // free list not corrupted
+    int i;
+    for (i = 0; i < NUM_BLOCKS - 1; i++){
+        void * block = btstack_memory_pool_get(&pool);
+        CHECK(block != NULL);
+        CHECK(block != block_2);
+    }
+    POINTERS_EQUAL(NULL, btstack_memory_pool_get(&pool));
+}
+
+TEST(MemoryPool, FreeInvalidBlock){
+    block_t other;
+    uint8_t * misaligned = ((uint8_t *) &storage[1]) + 1;
+    btstack_memory_pool_get(&pool);
+    btstack_memory_pool_free(&pool, &other);
+    btstack_memory_pool_free(&pool, misaligned);
+    CHECK_EQUAL(1, btstack_memory_pool_get_in_use(&pool));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
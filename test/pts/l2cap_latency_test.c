@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2014 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// L2CAP latency test: media channel vs. bulk channel on the same ACL link
+//
+// Opens two L2CAP channels to the remote device that runs the same test. 
+// Media packets are requested every MEDIA_PERIOD_MS and the time until
+// L2CAP_EVENT_CAN_SEND_NOW is reported, while the bulk channel sends as fast as possible.
+// Compare results with and without channel priority and flush timeout for the media channel.
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "gap.h"
+#include "hci.h"
+#include "hci_cmd.h"
+#include "hci_dump.h"
+#include "l2cap.h"
+#include "btstack_stdin.h"
+ 
+#define LATENCY_TEST_PSM        0x1001
+#define MEDIA_PERIOD_MS         20
+#define MEDIA_PACKET_SIZE       600
+#define MEDIA_FLUSH_TIMEOUT_MS  100
+#define MEDIA_REPORT_INTERVAL   100
+
+static void show_usage(void);
+
+static bd_addr_t remote = {0x00, 0x1B, 0xDC, 0x07, 0x32, 0xef};
+
+static uint16_t handle;
+static uint16_t media_cid;
+static uint16_t bulk_cid;
+static uint16_t bulk_mtu;
+
+static int media_active;
+static int bulk_active;
+static int media_prioritized;
+
+static btstack_timer_source_t media_timer;
+static uint32_t media_request_time_ms;
+static int      media_request_pending;
+
+// statistics
+static uint32_t media_packets;
+static uint32_t media_late;
+static uint32_t media_latency_min_ms;
+static uint32_t media_latency_max_ms;
+static uint32_t media_latency_sum_ms;
+static uint32_t bulk_bytes;
+static uint32_t received_bytes;
+
+static uint8_t  media_packet[MEDIA_PACKET_SIZE];
+static uint8_t  bulk_packet[1021];
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+
+static void statistics_reset(void){
+    media_packets = 0;
+    media_late = 0;
+    media_latency_min_ms = 0xffffffff;
+    media_latency_max_ms = 0;
+    media_latency_sum_ms = 0;
+    bulk_bytes = 0;
+}
+
+static void statistics_report(void){
+    if (!media_packets) {
+        printf("No media packets sent\n");
+        return;
+    }
+    printf("Media %s: %u packets, latency min %u / avg %u / max %u ms, %u late - bulk %u bytes\n",
+        media_prioritized ? "prioritized" : "normal", media_packets, media_latency_min_ms, media_latency_sum_ms / media_packets,
+        media_latency_max_ms, media_late, bulk_bytes);
+}
+
+static void media_configure(void){
+    if (!media_cid) return;
+    l2cap_set_channel_priority(media_cid, media_prioritized ? L2CAP_CHANNEL_PRIORITY_HIGH : L2CAP_CHANNEL_PRIORITY_NORMAL);
+    if (bulk_cid){
+        l2cap_set_channel_priority(bulk_cid, media_prioritized ? L2CAP_CHANNEL_PRIORITY_LOW : L2CAP_CHANNEL_PRIORITY_NORMAL);
+    }
+}
+
+static void media_timer_handler(btstack_timer_source_t * ts){
+    if (!media_active) return;
+    btstack_run_loop_set_timer(ts, MEDIA_PERIOD_MS);
+    btstack_run_loop_add_timer(ts);
+    if (media_request_pending){
+        // previous packet not sent within media period
+        media_late++;
+        return;
+    }
+    media_request_pending = 1;
+    media_request_time_ms = btstack_run_loop_get_time_ms();
+    l2cap_request_can_send_now_event(media_cid);
+}
+
+static void media_send(void){
+    uint32_t latency_ms = btstack_run_loop_get_time_ms() - media_request_time_ms;
+    media_request_pending = 0;
+    media_packets++;
+    media_latency_sum_ms += latency_ms;
+    if (latency_ms < media_latency_min_ms) media_latency_min_ms = latency_ms;
+    if (latency_ms > media_latency_max_ms) media_latency_max_ms = latency_ms;
+    little_endian_store_32(media_packet, 0, media_packets);
+    l2cap_send(media_cid, media_packet, sizeof(media_packet));
+    if ((media_packets % MEDIA_REPORT_INTERVAL) == 0){
+        statistics_report();
+    }
+}
+
+static void bulk_send(void){
+    if (!bulk_active) return;
+    uint16_t len = btstack_min(bulk_mtu, sizeof(bulk_packet));
+    if (l2cap_send(bulk_cid, bulk_packet, len) == 0){
+        bulk_bytes += len;
+    }
+    l2cap_request_can_send_now_event(bulk_cid);
+}
+
+static void packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+
+    UNUSED(channel);
+
+    uint16_t cid;
+
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            switch (hci_event_packet_get_type(packet)) {
+                case BTSTACK_EVENT_STATE:
+                    if (btstack_event_state_get_state(packet) == HCI_STATE_WORKING){
+                        printf("BTstack L2CAP Latency Test Ready\n");
+                        show_usage();
+                    }
+                    break;
+                case HCI_EVENT_CONNECTION_COMPLETE:
+                    handle = hci_event_connection_complete_get_connection_handle(packet);
+                    break;
+
+                case L2CAP_EVENT_CHANNEL_OPENED:
+                    cid = l2cap_event_channel_opened_get_local_cid(packet);
+                    if (l2cap_event_channel_opened_get_status(packet)){
+                        printf("L2CAP channel 0x%02x failed, status 0x%02x\n", cid, l2cap_event_channel_opened_get_status(packet));
+                        break;
+                    }
+                    handle = l2cap_event_channel_opened_get_handle(packet);
+                    printf("L2CAP channel 0x%02x opened, remote mtu %u\n", cid, l2cap_event_channel_opened_get_remote_mtu(packet));
+                    if (cid == bulk_cid){
+                        bulk_mtu = l2cap_event_channel_opened_get_remote_mtu(packet);
+                    }
+                    media_configure();
+                    break;
+
+                case L2CAP_EVENT_INCOMING_CONNECTION:
+                    l2cap_accept_connection(l2cap_event_incoming_connection_get_local_cid(packet));
+                    break;
+
+                case L2CAP_EVENT_CAN_SEND_NOW:
+                    cid = l2cap_event_can_send_now_get_local_cid(packet);
+                    if (cid == media_cid){
+                        media_send();
+                    } else if (cid == bulk_cid){
+                        bulk_send();
+                    }
+                    break;
+
+                case L2CAP_EVENT_CHANNEL_CLOSED:
+                    cid = l2cap_event_channel_closed_get_local_cid(packet);
+                    if (cid == media_cid){
+                        media_cid = 0;
+                        media_active = 0;
+                    }
+                    if (cid == bulk_cid){
+                        bulk_cid = 0;
+                        bulk_active = 0;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+            break;
+
+        case L2CAP_DATA_PACKET:
+            received_bytes += size;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void show_usage(void){
+    printf("\n--- CLI for L2CAP LATENCY TEST ---\n");
+    printf("c      - create media and bulk channel to %s\n", bd_addr_to_str(remote));
+    printf("p      - toggle priority of media channel and flush timeout for new media channel, currently %s\n", media_prioritized ? "on" : "off");
+    printf("m      - start/stop media stream every %u ms\n", MEDIA_PERIOD_MS);
+    printf("b      - start/stop bulk transfer\n");
+    printf("s      - show statistics\n");
+    printf("r      - reset statistics\n");
+    printf("d      - disconnect channels\n");
+    printf("Ctrl-c - exit\n");
+    printf("---\n");
+}
+
+static void stdin_process(char buffer){
+    switch (buffer){
+        case 'c':
+            printf("Creating L2CAP media and bulk channel to %s\n", bd_addr_to_str(remote));
+            l2cap_create_channel(packet_handler, remote, LATENCY_TEST_PSM, MEDIA_PACKET_SIZE, &media_cid);
+            l2cap_create_channel(packet_handler, remote, LATENCY_TEST_PSM, sizeof(bulk_packet), &bulk_cid);
+            // flush timeout is sent in configuration request and cannot be changed later
+            if (media_prioritized){
+                l2cap_set_channel_flush_timeout(media_cid, MEDIA_FLUSH_TIMEOUT_MS);
+            }
+            media_configure();
+            break;
+        case 'p':
+            media_prioritized = !media_prioritized;
+            printf("Media channel priority and flush timeout %s\n", media_prioritized ? "on" : "off");
+            media_configure();
+            statistics_reset();
+            break;
+        case 'm':
+            if (!media_cid) break;
+            media_active = !media_active;
+            printf("Media stream %s\n", media_active ? "started" : "stopped");
+            if (!media_active) break;
+            media_request_pending = 0;
+            btstack_run_loop_set_timer_handler(&media_timer, &media_timer_handler);
+            btstack_run_loop_set_timer(&media_timer, MEDIA_PERIOD_MS);
+            btstack_run_loop_add_timer(&media_timer);
+            break;
+        case 'b':
+            if (!bulk_cid) break;
+            bulk_active = !bulk_active;
+            printf("Bulk transfer %s\n", bulk_active ? "started" : "stopped");
+            if (bulk_active){
+                l2cap_request_can_send_now_event(bulk_cid);
+            }
+            break;
+        case 's':
+            statistics_report();
+            printf("Received %u bytes\n", received_bytes);
+            break;
+        case 'r':
+            statistics_reset();
+            break;
+        case 'd':
+            printf("Disconnect channels\n");
+            if (media_cid) l2cap_disconnect(media_cid, 0);
+            if (bulk_cid)  l2cap_disconnect(bulk_cid, 0);
+            break;
+        case '\n':
+        case '\r':
+            break;
+        default:
+            show_usage();
+            break;
+    }
+}
+
+int btstack_main(int argc, const char * argv[]);
+int btstack_main(int argc, const char * argv[]){
+
+    UNUSED(argc);
+    (void) argv;
+
+    statistics_reset();
+    
+    gap_set_class_of_device(0x220404);
+    gap_discoverable_control(1);
+
+    /* Register for HCI events */
+    hci_event_callback_registration.callback = &packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+
+    l2cap_init();
+    l2cap_register_service(packet_handler, LATENCY_TEST_PSM, sizeof(bulk_packet), LEVEL_0);
+    
+    // turn on!
+    hci_power_control(HCI_POWER_ON);
+
+    btstack_stdin_setup(stdin_process);
+    return 0;
+}
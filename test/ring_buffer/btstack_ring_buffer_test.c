@@ -93,6 +93,168 @@ TEST(RingBuffer, ReadWriteChunks){
     }
 }
 
+TEST(RingBuffer, ReserveCommit){
+    uint8_t test_read_data[6];
+    uint32_t number_of_bytes_read = 0;
+
+    // move indices to middle of storage
+    btstack_ring_buffer_write(&ring_buffer, test_read_data, 6);
+    btstack_ring_buffer_read(&ring_buffer, test_read_data, 6, &number_of_bytes_read);
+
+    // only space until end of storage is contiguous
+    CHECK_EQUAL(storage_size, btstack_ring_buffer_bytes_free(&ring_buffer));
+    CHECK_EQUAL(storage_size - 6, btstack_ring_buffer_bytes_free_contiguous(&ring_buffer));
+    POINTERS_EQUAL(NULL, btstack_ring_buffer_reserve(&ring_buffer, 5));
+
+    uint8_t * buffer = btstack_ring_buffer_reserve(&ring_buffer, 4);
+    POINTERS_EQUAL(&storage[6], buffer);
+    memcpy(buffer, "\x01\x02\x03\x04", 4);
+    btstack_ring_buffer_commit(&ring_buffer, 4);
+    CHECK_EQUAL(4, btstack_ring_buffer_bytes_available(&ring_buffer));
+
+    btstack_ring_buffer_read(&ring_buffer, test_read_data, 4, &number_of_bytes_read);
+    CHECK_EQUAL(0, memcmp("\x01\x02\x03\x04", test_read_data, 4));
+}
+
+TEST(RingBuffer, PeekConsume){
+    uint8_t test_write_data[] = {1,2,3,4,5,6,7,8,9,10};
+    uint8_t test_read_data[8];
+    uint32_t number_of_bytes_read = 0;
+    uint32_t length;
+
+    // data wraps around end of storage
+    btstack_ring_buffer_write(&ring_buffer, test_write_data, 8);
+    btstack_ring_buffer_read(&ring_buffer, test_read_data, 8, &number_of_bytes_read);
+    btstack_ring_buffer_write(&ring_buffer, test_write_data, 10);
+
+    uint8_t * data = btstack_ring_buffer_peek_contiguous(&ring_buffer, &length);
+    CHECK_EQUAL(2, length);
+    CHECK_EQUAL(0, memcmp(test_write_data, data, 2));
+    btstack_ring_buffer_consume(&ring_buffer, 2);
+    CHECK_EQUAL(8, btstack_ring_buffer_bytes_available(&ring_buffer));
+
+    data = btstack_ring_buffer_peek_contiguous(&ring_buffer, &length);
+    CHECK_EQUAL(8, length);
+    CHECK_EQUAL(0, memcmp(&test_write_data[2], data, 8));
+    btstack_ring_buffer_consume(&ring_buffer, 8);
+    CHECK_TRUE(btstack_ring_buffer_empty(&ring_buffer));
+}
+
+static uint8_t spsc_storage[8];
+
+TEST_GROUP(RingBufferSPSC){
+    btstack_ring_buffer_spsc_t ring_buffer;
+
+    void setup(void){
+        btstack_ring_buffer_spsc_init(&ring_buffer, spsc_storage, sizeof(spsc_storage));
+    }
+};
+
+TEST(RingBufferSPSC, InitInvalidSize){
+    btstack_ring_buffer_spsc_t other;
+    CHECK_EQUAL(-1, btstack_ring_buffer_spsc_init(&other, spsc_storage, 6));
+}
+
+TEST(RingBufferSPSC, ReadWriteWrap){
+    uint8_t test_write_data[] = {1,2,3,4,5};
+    uint8_t test_read_data[5];
+    uint32_t number_of_bytes_read = 0;
+    int i;
+    for (i = 0; i < 10; i++){
+        CHECK_EQUAL(0, btstack_ring_buffer_spsc_write(&ring_buffer, test_write_data, sizeof(test_write_data)));
+        CHECK_EQUAL(5, btstack_ring_buffer_spsc_bytes_available(&ring_buffer));
+        CHECK_EQUAL(3, btstack_ring_buffer_spsc_bytes_free(&ring_buffer));
+        CHECK_TRUE(btstack_ring_buffer_spsc_write(&ring_buffer, test_write_data, sizeof(test_write_data)) != 0);
+        btstack_ring_buffer_spsc_read(&ring_buffer, test_read_data, sizeof(test_read_data), &number_of_bytes_read);
+        CHECK_EQUAL(5, number_of_bytes_read);
+        CHECK_EQUAL(0, memcmp(test_write_data, test_read_data, sizeof(test_read_data)));
+    }
+}
+
+TEST(RingBufferSPSC, ReservePeek){
+    uint32_t length;
+    uint8_t * buffer = btstack_ring_buffer_spsc_reserve(&ring_buffer, 6);
+    POINTERS_EQUAL(&spsc_storage[0], buffer);
+    memcpy(buffer, "\x01\x02\x03\x04\x05\x06", 6);
+    btstack_ring_buffer_spsc_commit(&ring_buffer, 6);
+
+    uint8_t * data = btstack_ring_buffer_spsc_peek_contiguous(&ring_buffer, &length);
+    CHECK_EQUAL(6, length);
+    CHECK_EQUAL(0, memcmp("\x01\x02\x03\x04\x05\x06", data, 6));
+    btstack_ring_buffer_spsc_consume(&ring_buffer, 6);
+
+    // 8 bytes free, but only 2 until end of storage
+    CHECK_EQUAL(8, btstack_ring_buffer_spsc_bytes_free(&ring_buffer));
+    POINTERS_EQUAL(NULL, btstack_ring_buffer_spsc_reserve(&ring_buffer, 3));
+    POINTERS_EQUAL(&spsc_storage[6], btstack_ring_buffer_spsc_reserve(&ring_buffer, 2));
+}
+
+#ifdef __linux__
+#include <unistd.h>
+#include "btstack_ring_buffer_mirror.h"
+#include "hci_dump.h"
+
+void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+TEST_GROUP(RingBufferMirror){
+    btstack_ring_buffer_t ring_buffer;
+    uint8_t * mirror_storage;
+    uint32_t  mirror_size;
+
+    void setup(void){
+        mirror_size = (uint32_t) sysconf(_SC_PAGESIZE);
+        mirror_storage = btstack_ring_buffer_mirror_alloc(mirror_size);
+        btstack_ring_buffer_init_mirrored(&ring_buffer, mirror_storage, mirror_size);
+    }
+    void teardown(void){
+        btstack_ring_buffer_mirror_free(mirror_storage, mirror_size);
+    }
+};
+
+TEST(RingBufferMirror, InvalidSize){
+    POINTERS_EQUAL(NULL, btstack_ring_buffer_mirror_alloc(0));
+    POINTERS_EQUAL(NULL, btstack_ring_buffer_mirror_alloc(mirror_size + 1));
+}
+
+TEST(RingBufferMirror, StorageMappedTwice){
+    CHECK_TRUE(mirror_storage != NULL);
+    mirror_storage[0] = 0x55;
+    CHECK_EQUAL(0x55, mirror_storage[mirror_size]);
+    mirror_storage[mirror_size + 1] = 0xaa;
+    CHECK_EQUAL(0xaa, mirror_storage[1]);
+}
+
+TEST(RingBufferMirror, ReservePeekAcrossEnd){
+    uint32_t length;
+    uint8_t test_data[8] = {1,2,3,4,5,6,7,8};
+
+    // move indices to 4 bytes before end of storage
+    uint8_t * buffer = btstack_ring_buffer_reserve(&ring_buffer, mirror_size - 4);
+    POINTERS_EQUAL(mirror_storage, buffer);
+    btstack_ring_buffer_commit(&ring_buffer, mirror_size - 4);
+    btstack_ring_buffer_peek_contiguous(&ring_buffer, &length);
+    CHECK_EQUAL(mirror_size - 4, length);
+    btstack_ring_buffer_consume(&ring_buffer, length);
+
+    // 8 bytes are contiguous although they wrap
+    CHECK_EQUAL(mirror_size, btstack_ring_buffer_bytes_free_contiguous(&ring_buffer));
+    buffer = btstack_ring_buffer_reserve(&ring_buffer, sizeof(test_data));
+    POINTERS_EQUAL(&mirror_storage[mirror_size - 4], buffer);
+    memcpy(buffer, test_data, sizeof(test_data));
+    btstack_ring_buffer_commit(&ring_buffer, sizeof(test_data));
+
+    uint8_t * data = btstack_ring_buffer_peek_contiguous(&ring_buffer, &length);
+    CHECK_EQUAL(sizeof(test_data), length);
+    CHECK_EQUAL(0, memcmp(test_data, data, sizeof(test_data)));
+    CHECK_EQUAL(0, memcmp(&test_data[4], mirror_storage, 4));
+    btstack_ring_buffer_consume(&ring_buffer, length);
+    CHECK_TRUE(btstack_ring_buffer_empty(&ring_buffer));
+}
+#endif
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
\ No newline at end of file
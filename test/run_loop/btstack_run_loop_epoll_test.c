@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2018 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// test epoll run loop: timers, data sources, and calls from other threads
+//
+// *****************************************************************************
+
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_epoll.h"
+#include "btstack_util.h"
+
+// btstack_run_loop_execute does not return, leave it from callbacks
+static jmp_buf run_loop_exit;
+
+static btstack_timer_source_t timeout_timer;
+static int timed_out;
+
+static int     timer_order[4];
+static int     num_timers_fired;
+
+static btstack_data_source_t data_source_a;
+static btstack_data_source_t data_source_b;
+static int     pipe_a[2];
+static int     pipe_b[2];
+static int     num_read_a;
+static int     num_read_b;
+static int     num_write_a;
+
+static void run_loop_stop(void){
+    longjmp(run_loop_exit, 1);
+}
+
+static void timeout_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    timed_out = 1;
+    run_loop_stop();
+}
+
+// run until a callback calls run_loop_stop, or timeout
+static void run_loop_run(uint32_t timeout_ms){
+    btstack_run_loop_set_timer_handler(&timeout_timer, &timeout_handler);
+    btstack_run_loop_set_timer(&timeout_timer, timeout_ms);
+    btstack_run_loop_add_timer(&timeout_timer);
+    if (setjmp(run_loop_exit) == 0){
+        btstack_run_loop_execute();
+    }
+    btstack_run_loop_remove_timer(&timeout_timer);
+}
+
+static void timer_handler(btstack_timer_source_t * ts){
+    int id = (int) (intptr_t) btstack_run_loop_get_timer_context(ts);
+    timer_order[num_timers_fired++] = id;
+    if (num_timers_fired == 2){
+        run_loop_stop();
+    }
+}
+
+static uint8_t read_byte(btstack_data_source_t * ds){
+    uint8_t data = 0;
+    CHECK_EQUAL(1, read(ds->fd, &data, 1));
+    return data;
+}
+
+static void data_source_handler_a(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
+    switch (callback_type){
+        case DATA_SOURCE_CALLBACK_READ:
+            num_read_a++;
+            if (read_byte(ds) == 'r'){
+                // remove other data source
+                btstack_run_loop_remove_data_source(&data_source_b);
+            }
+            break;
+        case DATA_SOURCE_CALLBACK_WRITE:
+            num_write_a++;
+            btstack_run_loop_disable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_WRITE);
+            run_loop_stop();
+            break;
+        default:
+            break;
+    }
+}
+
+static void data_source_handler_b(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(callback_type);
+    num_read_b++;
+    read_byte(ds);
+}
+
+static void add_data_source(btstack_data_source_t * ds, int fds[2], void (*handler)(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type)){
+    CHECK_EQUAL(0, pipe(fds));
+    btstack_run_loop_set_data_source_fd(ds, fds[0]);
+    btstack_run_loop_set_data_source_handler(ds, handler);
+    btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_READ);
+    btstack_run_loop_add_data_source(ds);
+}
+
+static void write_byte(int fd, uint8_t data){
+    CHECK_EQUAL(1, write(fd, &data, 1));
+}
+
+// execute on main thread
+static int main_thread_calls;
+
+static void main_thread_call(void * context){
+    UNUSED(context);
+    main_thread_calls++;
+    if (main_thread_calls == 100){
+        run_loop_stop();
+    }
+}
+
+static void * producer_thread(void * context){
+    UNUSED(context);
+    int i;
+    for (i = 0; i < 100; i++){
+        while (btstack_run_loop_execute_on_main_thread(&main_thread_call, NULL) != 0){
+            // queue full, let run loop catch up
+            usleep(100);
+        }
+    }
+    return NULL;
+}
+
+TEST_GROUP(RunLoopEpoll){
+    void setup(void){
+        timed_out = 0;
+        num_timers_fired = 0;
+        num_read_a = 0;
+        num_read_b = 0;
+        num_write_a = 0;
+        main_thread_calls = 0;
+        memset(&data_source_a, 0, sizeof(data_source_a));
+        memset(&data_source_b, 0, sizeof(data_source_b));
+        pipe_a[0] = pipe_a[1] = -1;
+        pipe_b[0] = pipe_b[1] = -1;
+    }
+    void teardown(void){
+        btstack_run_loop_remove_data_source(&data_source_a);
+        btstack_run_loop_remove_data_source(&data_source_b);
+        int i;
+        for (i=0;i<2;i++){
+            if (pipe_a[i] >= 0) close(pipe_a[i]);
+            if (pipe_b[i] >= 0) close(pipe_b[i]);
+        }
+    }
+};
+
+TEST(RunLoopEpoll, TimersInOrder){
+    btstack_timer_source_t timer_1;
+    btstack_timer_source_t timer_2;
+    btstack_run_loop_set_timer_handler(&timer_1, &timer_handler);
+    btstack_run_loop_set_timer_handler(&timer_2, &timer_handler);
+    btstack_run_loop_set_timer_context(&timer_1, (void *) 1);
+    btstack_run_loop_set_timer_context(&timer_2, (void *) 2);
+    btstack_run_loop_set_timer(&timer_1, 30);
+    btstack_run_loop_set_timer(&timer_2, 10);
+    btstack_run_loop_add_timer(&timer_1);
+    btstack_run_loop_add_timer(&timer_2);
+
+    uint32_t start_ms = btstack_run_loop_get_time_ms();
+    run_loop_run(1000);
+    CHECK_EQUAL(0, timed_out);
+    CHECK_EQUAL(2, num_timers_fired);
+    CHECK_EQUAL(2, timer_order[0]);
+    CHECK_EQUAL(1, timer_order[1]);
+    CHECK(btstack_run_loop_get_time_ms() - start_ms >= 30);
+}
+
+TEST(RunLoopEpoll, RemovedTimerDoesNotFire){
+    btstack_timer_source_t timer_1;
+    btstack_run_loop_set_timer_handler(&timer_1, &timer_handler);
+    btstack_run_loop_set_timer(&timer_1, 10);
+    btstack_run_loop_add_timer(&timer_1);
+    CHECK_EQUAL(0, btstack_run_loop_remove_timer(&timer_1));
+
+    run_loop_run(30);
+    CHECK_EQUAL(1, timed_out);
+    CHECK_EQUAL(0, num_timers_fired);
+}
+
+TEST(RunLoopEpoll, DataSourceReadAndWrite){
+    add_data_source(&data_source_a, pipe_a, &data_source_handler_a);
+    write_byte(pipe_a[1], 'x');
+    // pipe read end is never writable, use write callback of write end instead
+    btstack_run_loop_set_data_source_fd(&data_source_b, pipe_a[1]);
+    btstack_run_loop_set_data_source_handler(&data_source_b, &data_source_handler_a);
+    btstack_run_loop_add_data_source(&data_source_b);
+    btstack_run_loop_enable_data_source_callbacks(&data_source_b, DATA_SOURCE_CALLBACK_WRITE);
+
+    run_loop_run(1000);
+    CHECK_EQUAL(0, timed_out);
+    CHECK_EQUAL(1, num_write_a);
+
+    // read handled before or after write, finish pending read
+    if (num_read_a == 0){
+        run_loop_run(20);
+    }
+    CHECK_EQUAL(1, num_read_a);
+}
+
+TEST(RunLoopEpoll, DisabledDataSourceNotCalled){
+    add_data_source(&data_source_a, pipe_a, &data_source_handler_a);
+    btstack_run_loop_disable_data_source_callbacks(&data_source_a, DATA_SOURCE_CALLBACK_READ);
+    write_byte(pipe_a[1], 'x');
+
+    run_loop_run(20);
+    CHECK_EQUAL(1, timed_out);
+    CHECK_EQUAL(0, num_read_a);
+
+    // enabled again, pending data is reported
+    btstack_run_loop_enable_data_source_callbacks(&data_source_a, DATA_SOURCE_CALLBACK_READ);
+    run_loop_run(20);
+    CHECK_EQUAL(1, num_read_a);
+}
+
+TEST(RunLoopEpoll, RemovedDataSourceNotCalled){
+    add_data_source(&data_source_a, pipe_a, &data_source_handler_a);
+    add_data_source(&data_source_b, pipe_b, &data_source_handler_b);
+
+    // both ready, a removes b - b must not be called afterwards
+    write_byte(pipe_b[1], 'x');
+    write_byte(pipe_a[1], 'r');
+    run_loop_run(20);
+    CHECK_EQUAL(1, num_read_a);
+    CHECK(num_read_b <= 1);
+    int num_read_b_before = num_read_b;
+
+    write_byte(pipe_b[1], 'x');
+    run_loop_run(20);
+    CHECK_EQUAL(num_read_b_before, num_read_b);
+
+    // removing it again fails
+    CHECK_EQUAL(-1, btstack_run_loop_remove_data_source(&data_source_b));
+}
+
+TEST(RunLoopEpoll, RemoveDataSourceWithClosedFd){
+    add_data_source(&data_source_a, pipe_a, &data_source_handler_a);
+    close(pipe_a[0]);
+    CHECK_EQUAL(0, btstack_run_loop_remove_data_source(&data_source_a));
+    pipe_a[0] = -1;
+
+    run_loop_run(10);
+    CHECK_EQUAL(1, timed_out);
+    CHECK_EQUAL(0, num_read_a);
+}
+
+TEST(RunLoopEpoll, ExecuteOnMainThread){
+    pthread_t thread;
+    CHECK_EQUAL(0, pthread_create(&thread, NULL, &producer_thread, NULL));
+    run_loop_run(5000);
+    pthread_join(thread, NULL);
+    CHECK_EQUAL(0, timed_out);
+    CHECK_EQUAL(100, main_thread_calls);
+}
+
+int main (int argc, const char * argv[]){
+    // run loop can only be initialized once
+    btstack_run_loop_init(btstack_run_loop_epoll_get_instance());
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
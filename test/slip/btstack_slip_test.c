@@ -0,0 +1,124 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_slip.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAME_SIZE 300
+
+static uint8_t frame[MAX_FRAME_SIZE];
+static uint8_t encoded[2 * MAX_FRAME_SIZE + 2];
+static uint8_t decoded[MAX_FRAME_SIZE];
+
+// stubs for log functions
+extern "C" void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+static void fill_frame(int len, int seed){
+    int i;
+    srand(seed);
+    for (i = 0; i < len; i++){
+        switch (rand() % 4){
+            case 0:
+                frame[i] = BTSTACK_SLIP_SOF;
+                break;
+            case 1:
+                frame[i] = 0xdb;
+                break;
+            default:
+                frame[i] = rand();
+                break;
+        }
+    }
+}
+
+// reference encoding using single byte API
+static int encode_bytewise(int len){
+    int pos = 0;
+    encoded[pos++] = BTSTACK_SLIP_SOF;
+    btstack_slip_encoder_start(frame, len);
+    while (btstack_slip_encoder_has_data()){
+        encoded[pos++] = btstack_slip_encoder_get_byte();
+    }
+    encoded[pos++] = BTSTACK_SLIP_SOF;
+    return pos;
+}
+
+TEST_GROUP(SLIP){
+};
+
+TEST(SLIP, EncodeBytesMatchesBytewise){
+    uint8_t chunked[sizeof(encoded)];
+    int len;
+    for (len = 1; len < MAX_FRAME_SIZE; len += 7){
+        fill_frame(len, len);
+        int reference_len = encode_bytewise(len);
+        // encode in chunks of varying size, escape sequences might get split
+        int pos = 0;
+        chunked[pos++] = BTSTACK_SLIP_SOF;
+        btstack_slip_encoder_start(frame, len);
+        int chunk = 1;
+        while (btstack_slip_encoder_has_data()){
+            pos += btstack_slip_encoder_get_bytes(&chunked[pos], chunk);
+            chunk = (chunk % 13) + 1;
+        }
+        chunked[pos++] = BTSTACK_SLIP_SOF;
+        CHECK_EQUAL(reference_len, pos);
+        MEMCMP_EQUAL(encoded, chunked, pos);
+    }
+}
+
+TEST(SLIP, DecodeBytes){
+    int len;
+    for (len = 1; len < MAX_FRAME_SIZE; len += 5){
+        fill_frame(len, 1000 + len);
+        int encoded_len = encode_bytewise(len);
+        btstack_slip_decoder_init(decoded, sizeof(decoded));
+        // feed in chunks
+        int pos = 0;
+        int chunk = 3;
+        uint16_t frame_size = 0;
+        while (pos < encoded_len){
+            int chunk_len = chunk < (encoded_len - pos) ? chunk : (encoded_len - pos);
+            pos += btstack_slip_decoder_process_bytes(&encoded[pos], chunk_len);
+            frame_size = btstack_slip_decoder_frame_size();
+            if (frame_size) break;
+            chunk = (chunk % 17) + 1;
+        }
+        CHECK_EQUAL(encoded_len, pos);
+        CHECK_EQUAL(len, frame_size);
+        MEMCMP_EQUAL(frame, decoded, len);
+    }
+}
+
+TEST(SLIP, DecodeBytesStopsAfterFrame){
+    fill_frame(20, 1);
+    int encoded_len = encode_bytewise(20);
+    memcpy(&encoded[encoded_len], encoded, encoded_len);
+    btstack_slip_decoder_init(decoded, sizeof(decoded));
+    uint16_t processed = btstack_slip_decoder_process_bytes(encoded, 2 * encoded_len);
+    CHECK_EQUAL(encoded_len, processed);
+    CHECK_EQUAL(20, btstack_slip_decoder_frame_size());
+    // second frame
+    btstack_slip_decoder_init(decoded, sizeof(decoded));
+    processed = btstack_slip_decoder_process_bytes(&encoded[encoded_len], encoded_len);
+    CHECK_EQUAL(encoded_len, processed);
+    CHECK_EQUAL(20, btstack_slip_decoder_frame_size());
+    MEMCMP_EQUAL(frame, decoded, 20);
+}
+
+TEST(SLIP, DecodeBytesFrameTooLong){
+    fill_frame(100, 2);
+    int encoded_len = encode_bytewise(100);
+    btstack_slip_decoder_init(decoded, 50);
+    uint16_t processed = btstack_slip_decoder_process_bytes(encoded, encoded_len);
+    CHECK_EQUAL(encoded_len, processed);
+    CHECK_EQUAL(0, btstack_slip_decoder_frame_size());
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,215 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_timer_wheel.h"
+
+#include <stdlib.h>
+
+#define NUM_TIMERS 200
+
+static btstack_timer_wheel_t wheel;
+static btstack_timer_source_t timers[NUM_TIMERS];
+static uint32_t fired_at[NUM_TIMERS];
+static int      fired_count;
+static uint32_t current_time;
+
+static btstack_timer_source_t * rearm_timer;
+static uint32_t rearm_delay;
+static btstack_timer_source_t * remove_timer;
+
+// stubs for log functions
+extern "C" void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+static void timer_handler(btstack_timer_source_t * ts){
+    int index = ts - timers;
+    fired_at[index] = current_time;
+    fired_count++;
+    if (ts == rearm_timer){
+        rearm_timer = NULL;
+        ts->timeout = current_time + rearm_delay;
+        btstack_timer_wheel_add(&wheel, ts);
+    }
+    if (remove_timer){
+        btstack_timer_wheel_remove(&wheel, remove_timer);
+        remove_timer = NULL;
+    }
+}
+
+static void setup_timer(int index, uint32_t timeout){
+    timers[index].timeout = timeout;
+    timers[index].process = &timer_handler;
+    btstack_timer_wheel_add(&wheel, &timers[index]);
+}
+
+// advance time in steps as run loop would do, using the reported timeout
+static void run_until(uint32_t end_time){
+    while ((int32_t)(end_time - current_time) > 0){
+        int32_t timeout = btstack_timer_wheel_get_timeout(&wheel, current_time);
+        uint32_t step = end_time - current_time;
+        if (timeout >= 0 && (uint32_t) timeout < step){
+            step = timeout;
+        }
+        if (step == 0){
+            step = 1;
+        }
+        current_time += step;
+        btstack_timer_wheel_process(&wheel, current_time);
+    }
+}
+
+static void init_wheel(uint32_t start_time){
+    int i;
+    current_time = start_time;
+    fired_count = 0;
+    rearm_timer = NULL;
+    remove_timer = NULL;
+    for (i = 0; i < NUM_TIMERS; i++){
+        fired_at[i] = 0xffffffff;
+        timers[i].wheel_list = 0xffff;
+    }
+    btstack_timer_wheel_init(&wheel, start_time);
+}
+
+TEST_GROUP(TimerWheel){
+    void setup(void){
+        init_wheel(1000);
+    }
+};
+
+TEST(TimerWheel, Empty){
+    CHECK_EQUAL(-1, btstack_timer_wheel_get_timeout(&wheel, current_time));
+    run_until(100000);
+    CHECK_EQUAL(0, fired_count);
+}
+
+TEST(TimerWheel, SingleShort){
+    setup_timer(0, 1010);
+    CHECK_EQUAL(10, btstack_timer_wheel_get_timeout(&wheel, current_time));
+    run_until(1009);
+    CHECK_EQUAL(0, fired_count);
+    run_until(1010);
+    CHECK_EQUAL(1, fired_count);
+    CHECK_EQUAL(1010, fired_at[0]);
+    CHECK_EQUAL(-1, btstack_timer_wheel_get_timeout(&wheel, current_time));
+}
+
+TEST(TimerWheel, Expired){
+    setup_timer(0, 900);
+    CHECK_EQUAL(0, btstack_timer_wheel_get_timeout(&wheel, current_time));
+    btstack_timer_wheel_process(&wheel, current_time);
+    CHECK_EQUAL(1, fired_count);
+}
+
+TEST(TimerWheel, LongTimeouts){
+    setup_timer(0, 1000 + 100);
+    setup_timer(1, 1000 + 5000);
+    setup_timer(2, 1000 + 300000);
+    setup_timer(3, 1000 + 20000000);
+    setup_timer(4, 1000 + 2000000000);
+    run_until(1000 + 2000000001);
+    CHECK_EQUAL(5, fired_count);
+    CHECK_EQUAL(1000 + 100,        fired_at[0]);
+    CHECK_EQUAL(1000 + 5000,       fired_at[1]);
+    CHECK_EQUAL(1000 + 300000,     fired_at[2]);
+    CHECK_EQUAL(1000 + 20000000,   fired_at[3]);
+    CHECK_EQUAL(1000 + 2000000000, fired_at[4]);
+}
+
+TEST(TimerWheel, LateProcessing){
+    setup_timer(0, 1100);
+    setup_timer(1, 9000);
+    btstack_timer_wheel_process(&wheel, 20000);
+    CHECK_EQUAL(2, fired_count);
+}
+
+TEST(TimerWheel, Remove){
+    setup_timer(0, 1100);
+    setup_timer(1, 1100);
+    setup_timer(2, 50000);
+    CHECK_EQUAL(0, btstack_timer_wheel_remove(&wheel, &timers[1]));
+    CHECK_EQUAL(0, btstack_timer_wheel_remove(&wheel, &timers[2]));
+    CHECK_EQUAL(-1, btstack_timer_wheel_remove(&wheel, &timers[2]));
+    CHECK_TRUE(btstack_timer_wheel_get_timeout(&wheel, current_time) <= 100);
+    run_until(100000);
+    CHECK_EQUAL(1, fired_count);
+    CHECK_EQUAL(1100, fired_at[0]);
+}
+
+TEST(TimerWheel, RemoveUnknown){
+    // timer that was never added, with invalid or random list index
+    CHECK_EQUAL(-1, btstack_timer_wheel_remove(&wheel, &timers[5]));
+    timers[5].wheel_list = 3;
+    CHECK_EQUAL(-1, btstack_timer_wheel_remove(&wheel, &timers[5]));
+}
+
+TEST(TimerWheel, AddTwice){
+    setup_timer(0, 1100);
+    btstack_timer_wheel_add(&wheel, &timers[0]);
+    run_until(2000);
+    CHECK_EQUAL(1, fired_count);
+    CHECK_EQUAL(1100, fired_at[0]);
+}
+
+TEST(TimerWheel, RearmFromHandler){
+    setup_timer(0, 1100);
+    rearm_timer = &timers[0];
+    rearm_delay = 0;
+    run_until(1100);
+    CHECK_EQUAL(2, fired_count);
+    rearm_timer = &timers[0];
+    rearm_delay = 50;
+    run_until(1100);
+    CHECK_EQUAL(2, fired_count);
+}
+
+TEST(TimerWheel, RemoveExpiredFromHandler){
+    setup_timer(0, 1100);
+    setup_timer(1, 1100);
+    remove_timer = &timers[1];
+    run_until(2000);
+    CHECK_EQUAL(1, fired_count);
+}
+
+TEST(TimerWheel, Wraparound){
+    init_wheel(0xffffff00);
+    setup_timer(0, 0xffffff80);
+    setup_timer(1, 0x00000100);
+    setup_timer(2, 0x00100000);
+    run_until(0x00200000);
+    CHECK_EQUAL(3, fired_count);
+    CHECK_EQUAL(0xffffff80, fired_at[0]);
+    CHECK_EQUAL(0x00000100, fired_at[1]);
+    CHECK_EQUAL(0x00100000, fired_at[2]);
+}
+
+TEST(TimerWheel, Random){
+    int round;
+    srand(0);
+    for (round = 0; round < 20; round++){
+        int i;
+        init_wheel(rand());
+        uint32_t start = current_time;
+        uint32_t max_timeout = 1 << (rand() % 24);
+        for (i = 0; i < NUM_TIMERS; i++){
+            setup_timer(i, start + 1 + (rand() % max_timeout));
+        }
+        // remove some
+        for (i = 0; i < NUM_TIMERS; i += 7){
+            CHECK_EQUAL(0, btstack_timer_wheel_remove(&wheel, &timers[i]));
+        }
+        run_until(start + max_timeout + 1);
+        for (i = 0; i < NUM_TIMERS; i++){
+            if ((i % 7) == 0){
+                CHECK_EQUAL(0xffffffff, fired_at[i]);
+            } else {
+                CHECK_EQUAL(timers[i].timeout, fired_at[i]);
+            }
+        }
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
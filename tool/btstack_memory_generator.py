@@ -79,11 +79,36 @@ extern "C" {
 
 /* API_START */
 
+/**
+ * @brief Usage of a memory type
+ */
+typedef struct {
+    const char * name;
+    uint16_t size;          // size of single object
+    uint16_t count;         // size of memory pool, 0 if allocated via malloc
+    uint16_t in_use;
+    uint16_t max_in_use;
+    uint32_t failures;      // failed allocations
+} btstack_memory_stats_t;
+
 /**
  * @brief Initializes BTstack memory pools.
  */
 void btstack_memory_init(void);
 
+/**
+ * @brief Get usage of memory type
+ * @param type
+ * @param stats
+ * @return 0 if ok, -1 if type is not available
+ */
+int btstack_memory_get_stats(btstack_memory_type_t type, btstack_memory_stats_t * stats);
+
+/**
+ * @brief Log usage of all memory types and add HCI_EVENT_MEMORY_STATISTICS event for each to the packet log
+ */
+void btstack_memory_dump_stats(void);
+
 /* API_END */
 """
 
@@ -107,14 +132,56 @@ cfile_header_begin = """
 
 #include "btstack_memory.h"
 #include "btstack_memory_pool.h"
+#include "btstack_memory_arena.h"
+#include "btstack_debug.h"
+#include "hci_dump.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(ENABLE_BTSTACK_MEMORY_ARENA) && !defined(HAVE_MALLOC)
+#error "ENABLE_BTSTACK_MEMORY_ARENA requires HAVE_MALLOC"
+#endif
+
+#ifdef HAVE_MALLOC
+// usage of types allocated via malloc, inline as not all types might use it
+typedef struct {
+    uint16_t in_use;
+    uint16_t max_in_use;
+    uint32_t failures;
+} btstack_memory_usage_t;
+
+static inline void * btstack_memory_usage_track_get(btstack_memory_usage_t * usage, void * object){
+    if (!object){
+        usage->failures++;
+        return NULL;
+    }
+    usage->in_use++;
+    if (usage->in_use > usage->max_in_use){
+        usage->max_in_use = usage->in_use;
+    }
+    return object;
+}
 
+static inline void btstack_memory_usage_track_free(btstack_memory_usage_t * usage, void * object){
+    if (!object) return;
+    usage->in_use--;
+}
+
+static inline void btstack_memory_usage_get_stats(btstack_memory_usage_t * usage, btstack_memory_stats_t * stats){
+    stats->in_use     = usage->in_use;
+    stats->max_in_use = usage->max_in_use;
+    stats->failures   = usage->failures;
+}
+#endif
 """
 
 header_template = """STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void);
 void   btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME);"""
 
+# objects that belong to a HCI connection can be allocated from its memory arena
+header_arena_template = """STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get_for_connection(hci_con_handle_t con_handle);"""
+
 code_template = """
 // MARK: STRUCT_TYPE
 #if !defined(HAVE_MALLOC) && !defined(POOL_COUNT)
@@ -135,22 +202,65 @@ STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
 void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
     btstack_memory_pool_free(&STRUCT_NAME_pool, STRUCT_NAME);
 }
+static void btstack_memory_STRUCT_NAME_get_stats(btstack_memory_stats_t * stats){
+    stats->count      = POOL_COUNT;
+    stats->in_use     = btstack_memory_pool_get_in_use(&STRUCT_NAME_pool);
+    stats->max_in_use = btstack_memory_pool_get_max_in_use(&STRUCT_NAME_pool);
+    stats->failures   = btstack_memory_pool_get_failures(&STRUCT_NAME_pool);
+}
 #else
+static uint32_t STRUCT_NAME_failures;
 STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
+    STRUCT_NAME_failures++;
     return NULL;
 }
 void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
     // silence compiler warning about unused parameter in a portable way
     (void) STRUCT_NAME;
 };
+static void btstack_memory_STRUCT_NAME_get_stats(btstack_memory_stats_t * stats){
+    stats->failures = STRUCT_NAME_failures;
+}
 #endif
 #elif defined(HAVE_MALLOC)
-STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
-    return (STRUCT_NAME_t*) malloc(sizeof(STRUCT_TYPE));
+static btstack_memory_usage_t STRUCT_NAME_usage;
+MALLOC_ARENA_CODESTRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
+    return (STRUCT_NAME_t*) btstack_memory_usage_track_get(&STRUCT_NAME_usage, malloc(sizeof(STRUCT_TYPE)));
 }
 void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
+    btstack_memory_usage_track_free(&STRUCT_NAME_usage, STRUCT_NAME);
     free(STRUCT_NAME);
 }
+MALLOC_ARENA_END_CODEstatic void btstack_memory_STRUCT_NAME_get_stats(btstack_memory_stats_t * stats){
+    btstack_memory_usage_get_stats(&STRUCT_NAME_usage, stats);
+}
+#endif
+"""
+
+malloc_arena_code = """#ifdef ENABLE_BTSTACK_MEMORY_ARENA
+STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
+    return btstack_memory_STRUCT_NAME_get_for_connection(HCI_CON_HANDLE_INVALID);
+}
+STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get_for_connection(hci_con_handle_t con_handle){
+    void * object = btstack_memory_arena_alloc(hci_connection_get_memory_arena(con_handle), sizeof(STRUCT_TYPE));
+    return (STRUCT_NAME_t*) btstack_memory_usage_track_get(&STRUCT_NAME_usage, object);
+}
+void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
+    btstack_memory_usage_track_free(&STRUCT_NAME_usage, STRUCT_NAME);
+    btstack_memory_arena_free(STRUCT_NAME);
+}
+#else
+"""
+
+malloc_arena_end_code = """#endif
+"""
+
+# without arena, objects are allocated as usual
+arena_fallback_template = """#if !defined(ENABLE_BTSTACK_MEMORY_ARENA) || defined(POOL_COUNT)
+STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get_for_connection(hci_con_handle_t con_handle){
+    (void) con_handle;
+    return btstack_memory_STRUCT_NAME_get();
+}
 #endif
 """
 
@@ -158,6 +268,44 @@ init_template = """#if POOL_COUNT > 0
     btstack_memory_pool_create(&STRUCT_NAME_pool, STRUCT_NAME_storage, POOL_COUNT, sizeof(STRUCT_TYPE));
 #endif"""
 
+enum_template = """    BTSTACK_MEMORY_TYPE_STRUCT_ENUM,"""
+
+stats_case_template = """        case BTSTACK_MEMORY_TYPE_STRUCT_ENUM:
+            stats->name = "STRUCT_NAME";
+            stats->size = sizeof(STRUCT_TYPE);
+            btstack_memory_STRUCT_NAME_get_stats(stats);
+            return 0;"""
+
+stats_begin = """
+int btstack_memory_get_stats(btstack_memory_type_t type, btstack_memory_stats_t * stats){
+    memset(stats, 0, sizeof(btstack_memory_stats_t));
+    switch (type){"""
+
+stats_end = """        default:
+            return -1;
+    }
+}
+
+void btstack_memory_dump_stats(void){
+    btstack_memory_stats_t stats;
+    uint8_t event[15];
+    int type;
+    for (type = 0; type < BTSTACK_MEMORY_TYPE_NUM; type++){
+        if (btstack_memory_get_stats((btstack_memory_type_t) type, &stats)) continue;
+        log_info("%s: size %u, count %u, in use %u, max in use %u, failures %u", stats.name, stats.size,
+            stats.count, stats.in_use, stats.max_in_use, (unsigned int) stats.failures);
+        event[0] = HCI_EVENT_MEMORY_STATISTICS;
+        event[1] = sizeof(event) - 2;
+        event[2] = type;
+        little_endian_store_16(event,  3, stats.size);
+        little_endian_store_16(event,  5, stats.count);
+        little_endian_store_16(event,  7, stats.in_use);
+        little_endian_store_16(event,  9, stats.max_in_use);
+        little_endian_store_32(event, 11, stats.failures);
+        hci_dump_packet(HCI_EVENT_PACKET, 1, event, sizeof(event));
+    }
+}"""
+
 def writeln(f, data):
     f.write(data + "\n")
 
@@ -168,7 +316,7 @@ def replacePlaceholder(template, struct_name):
     else:
         pool_count = "MAX_NR_" + struct_name.upper() + "S"
     pool_count_old_no = pool_count.replace("MAX_NR_", "MAX_NO_")
-    snippet = template.replace("STRUCT_TYPE", struct_type).replace("STRUCT_NAME", struct_name).replace("POOL_COUNT_OLD_NO", pool_count_old_no).replace("POOL_COUNT", pool_count)
+    snippet = template.replace("STRUCT_ENUM", struct_name.upper()).replace("STRUCT_TYPE", struct_type).replace("STRUCT_NAME", struct_name).replace("POOL_COUNT_OLD_NO", pool_count_old_no).replace("POOL_COUNT", pool_count)
     return snippet
     
 list_of_structs = [
@@ -183,24 +331,49 @@ list_of_structs = [
     ["avdtp_connection"],
     ["avrcp_connection"]    
 ]
-list_of_le_structs = [["gatt_client", "whitelist_entry", "sm_lookup_entry"]]
+list_of_le_structs = [["gatt_client", "whitelist_entry", "sm_lookup_entry", "gatt_client_request"]]
+list_of_arena_structs = ["l2cap_channel", "rfcomm_channel", "gatt_client", "gatt_client_request"]
+
+def codeForStruct(struct_name):
+    if struct_name in list_of_arena_structs:
+        code = code_template.replace("MALLOC_ARENA_CODE", malloc_arena_code).replace("MALLOC_ARENA_END_CODE", malloc_arena_end_code)
+        code = code + arena_fallback_template
+    else:
+        code = code_template.replace("MALLOC_ARENA_CODE", "").replace("MALLOC_ARENA_END_CODE", "")
+    return replacePlaceholder(code, struct_name)
+
+def headerForStruct(struct_name):
+    header = header_template
+    if struct_name in list_of_arena_structs:
+        header = header + "\n" + header_arena_template
+    return replacePlaceholder(header, struct_name)
 
 file_name = "../src/btstack_memory"
 
+# BLE types last, so type values don't depend on ENABLE_BLE
+def enum_definition():
+    lines = ["typedef enum {"]
+    for struct_names in list_of_structs + list_of_le_structs:
+        for struct_name in struct_names:
+            lines.append(replacePlaceholder(enum_template, struct_name))
+    lines.append("    BTSTACK_MEMORY_TYPE_NUM")
+    lines.append("} btstack_memory_type_t;")
+    return "\n".join(lines) + "\n"
+
 
 f = open(file_name+".h", "w")
 writeln(f, copyright)
-writeln(f, hfile_header_begin)
+writeln(f, hfile_header_begin.replace("/* API_START */", enum_definition() + "\n/* API_START */"))
 for struct_names in list_of_structs:
     writeln(f, "// "+ ", ".join(struct_names))
     for struct_name in struct_names:
-        writeln(f, replacePlaceholder(header_template, struct_name))
+        writeln(f, headerForStruct(struct_name))
     writeln(f, "")
 writeln(f, "#ifdef ENABLE_BLE")
 for struct_names in list_of_le_structs:
     writeln(f, "// "+ ", ".join(struct_names))
     for struct_name in struct_names:
-        writeln(f, replacePlaceholder(header_template, struct_name))
+        writeln(f, headerForStruct(struct_name))
 writeln(f, "#endif")
 writeln(f, hfile_header_end)
 f.close();
@@ -211,12 +384,12 @@ writeln(f, copyright)
 writeln(f, cfile_header_begin)
 for struct_names in list_of_structs:
     for struct_name in struct_names:
-        writeln(f, replacePlaceholder(code_template, struct_name))
+        writeln(f, codeForStruct(struct_name))
     writeln(f, "")
 writeln(f, "#ifdef ENABLE_BLE")
 for struct_names in list_of_le_structs:
     for struct_name in struct_names:
-        writeln(f, replacePlaceholder(code_template, struct_name))
+        writeln(f, codeForStruct(struct_name))
     writeln(f, "")
 writeln(f, "#endif")
 
@@ -232,5 +405,17 @@ for struct_names in list_of_le_structs:
         writeln(f, replacePlaceholder(init_template, struct_name))
 writeln(f, "#endif")
 writeln(f, "}")
+
+# stats
+writeln(f, stats_begin)
+for struct_names in list_of_structs:
+    for struct_name in struct_names:
+        writeln(f, replacePlaceholder(stats_case_template, struct_name))
+writeln(f, "#ifdef ENABLE_BLE")
+for struct_names in list_of_le_structs:
+    for struct_name in struct_names:
+        writeln(f, replacePlaceholder(stats_case_template, struct_name))
+writeln(f, "#endif")
+writeln(f, stats_end)
 f.close();
     
@@ -22,12 +22,14 @@ header = '''
 // attribute size in bytes (16), flags(16), handle (16), uuid (16/128), value(...)
 
 #include <stdint.h>
+#include "ble/att_db.h"
 
 const uint8_t profile_data[] =
 '''
 
 usage = '''
-Usage: ./compile_gatt.py profile.gatt profile.h
+Usage: ./compile_gatt.py [--index] profile.gatt profile.h
+--index: also create profile_data_index, see att_set_db_index_table
 '''
 
 
@@ -685,6 +687,60 @@ def listHandles(fout):
         fout.write(define)
         fout.write('\n')
 
+def uuid16_for_uuid(uuid):
+    # UUID128 in little endian order, 16-bit UUIDs based on Bluetooth Base UUID
+    if len(uuid) == 2:
+        return uuid[0] | (uuid[1] << 8)
+    bluetooth_base_uuid = [ 0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ]
+    if uuid[0:12] != bluetooth_base_uuid[0:12] or uuid[14:16] != bluetooth_base_uuid[14:16]:
+        return 0
+    return uuid[12] | (uuid[13] << 8)
+
+def listIndex(fout, profile):
+    # get binary representation from generated profile_data
+    body = profile[profile.index('{'):profile.index('};')]
+    body = re.sub('//.*', '', body)
+    db = [int(byte, 16) for byte in re.findall('0x([0-9A-Fa-f]+)', body)]
+
+    # same as att_db_index_build in att_db.c
+    entries = []
+    service_pos = -1
+    offset = 0
+    while True:
+        size = db[offset] | (db[offset+1] << 8)
+        if size == 0:
+            break
+        flags  = db[offset+2] | (db[offset+3] << 8)
+        handle = db[offset+4] | (db[offset+5] << 8)
+        if flags & property_flags['LONG_UUID']:
+            uuid16 = uuid16_for_uuid(db[offset+6:offset+22])
+        else:
+            uuid16 = uuid16_for_uuid(db[offset+6:offset+8])
+        entries.append([handle, offset, uuid16, 0, 0])
+        if uuid16 in [0x2800, 0x2801]:
+            if service_pos >= 0:
+                entries[service_pos][3] = len(entries) - 2
+            service_pos = len(entries) - 1
+        offset += size
+    if service_pos >= 0:
+        entries[service_pos][3] = len(entries) - 1
+    order = sorted(range(len(entries)), key=lambda pos: (entries[pos][2], entries[pos][0]))
+    for pos in range(len(entries)):
+        entries[pos][4] = order[pos]
+
+    fout.write('\n')
+    fout.write('//\n')
+    fout.write('// index for profile_data, see att_set_db_index_table\n')
+    fout.write('// handle, offset, uuid16, group end, uuid16 order\n')
+    fout.write('//\n')
+    fout.write('static const att_db_index_entry_t profile_data_index[] = {\n')
+    for entry in entries:
+        fout.write('    { 0x%04x, %u, 0x%04x, %u, %u },\n' % tuple(entry))
+    fout.write('}; // %u attributes\n' % len(entries))
+
+create_index = '--index' in sys.argv
+if create_index:
+    sys.argv.remove('--index')
 if (len(sys.argv) < 3):
     print(usage)
     sys.exit(1)
@@ -700,6 +756,11 @@ try:
     parse(sys.argv[1], fin, filename, fout)
     listHandles(fout)    
     fout.close()
+    if create_index:
+        with open (filename, 'r') as fin:
+            profile = fin.read()
+        with open (filename, 'a') as fout:
+            listIndex(fout, profile)
     print('Created %s' % filename)
 
 except IOError as e: